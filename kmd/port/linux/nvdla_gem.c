@@ -80,6 +80,7 @@ static int32_t nvdla_submit(struct drm_device *drm, void *arg,
 					struct drm_file *file)
 {
 	int32_t err = 0;
+	uint32_t i;
 	struct nvdla_task *task;
 	struct nvdla_ioctl_submit_task local_task;
 	struct nvdla_ioctl_submit_task __user *user_task;
@@ -92,32 +93,42 @@ static int32_t nvdla_submit(struct drm_device *drm, void *arg,
 	if (!user_task)
 		return -EINVAL;
 
-	/* IOCTL copy descriptors */
-	if (copy_from_user(&local_task, (void __user *)user_task,
-			(sizeof(*user_task))))
-		return -EFAULT;
+	if (args->num_tasks == 0 ||
+		args->num_tasks > NVDLA_MAX_TASKS_PER_SUBMIT)
+		return -EINVAL;
 
-	task = kzalloc(sizeof(*task), GFP_KERNEL);
-	if (task == NULL)
-		return -EFAULT;
+	/* tasks run one after the other, in array order */
+	for (i = 0; i < args->num_tasks; i++) {
+		/* IOCTL copy descriptors */
+		if (copy_from_user(&local_task, (void __user *)&user_task[i],
+				(sizeof(*user_task))))
+			return -EFAULT;
 
-	nvdla_dev->task = task;
-	kref_init(&task->ref);
-	task->nvdla_dev = nvdla_dev;
-	task->file = file;
+		task = kzalloc(sizeof(*task), GFP_KERNEL);
+		if (task == NULL)
+			return -EFAULT;
 
-	/* update task desc fields */
-	err = nvdla_fill_task_desc(&local_task, task);
-	if (err)
-		goto free_task_desc;
+		nvdla_dev->task = task;
+		kref_init(&task->ref);
+		task->nvdla_dev = nvdla_dev;
+		task->file = file;
+
+		/* update task desc fields */
+		err = nvdla_fill_task_desc(&local_task, task);
+		if (err)
+			goto free_task_desc;
 
-	err = nvdla_task_submit(nvdla_dev, task);
+		err = nvdla_task_submit(nvdla_dev, task);
 
-	kfree(task->address_list);
+		kfree(task->address_list);
 
 free_task_desc:
-	kfree(task);
-	return err;
+		kfree(task);
+		if (err)
+			return err;
+	}
+
+	return 0;
 }
 
 static int32_t nvdla_gem_alloc(struct nvdla_gem_object *nobj)
@@ -33,10 +33,51 @@ Dla Socket Class and utilities.
 
 import os
 import sys
+import array
 import logging
+import mmap
 import socket
 import time
 import struct
+import hashlib
+import itertools
+
+# Wire protocol, see umd/tests/runtime/WireProtocol.h. Every message is a
+# fixed header followed by the payload; replies echo the opcode and request
+# id and come back in request order.
+WIRE_MAGIC = 0x4e56444c
+WIRE_HEADER = struct.Struct('!IHHII')  # magic, opcode, flags, request id, length
+
+OP_GET_WELCOME = 1
+OP_QUERY_FLATBUF = 2
+OP_READ_FLATBUF = 3
+OP_RUN_FLATBUF = 4
+OP_RUN_IMAGE = 5
+OP_GET_NUMOUTPUTS = 6
+OP_GET_OUTPUT = 7
+OP_SHUTDOWN = 8
+OP_GET_STATS = 9  # reply: server metrics, Prometheus text format
+OP_MAP_BUFFERS = 10  # local socket only, reply carries the buffers' fds
+OP_RUN_BUFFER = 11
+
+FLAG_REPLY = 1 << 0
+FLAG_ERROR = 1 << 1
+FLAG_MODEL = 1 << 2  # run payload starts with the model id
+FLAG_DEADLINE = 1 << 3  # payload starts with a u32 budget in microseconds
+FLAG_TRACE = 1 << 4  # run reply gets a second line tracing it through the cascade
+
+PRIORITY_SHIFT = 8
+PRIORITY_NORMAL = 0
+PRIORITY_INTERACTIVE = 1
+PRIORITY_BULK = 2
+
+BUFFERS_REPLY = struct.Struct('!IQQ')  # slots, input size, output size
+
+def modelId(loadable):
+    """
+    Models are named by the SHA-256 of their loadable.
+    """
+    return hashlib.sha256(loadable).digest()
 
 class dlaSocket:
     """
@@ -45,9 +86,7 @@ class dlaSocket:
 
     PORT = 39485
     HOST = 'localhost'
-    MSGLEN = 256
     TIMEOUT = 100000
-    SEP = '\n'
 
     def __init__(self, sock=None):
         if sock is None:
@@ -55,6 +94,7 @@ class dlaSocket:
                 socket.AF_INET, socket.SOCK_STREAM)
         else:
             self.sock = sock
+        self.requestIds = itertools.count(1)
 
     def getPort(self):
         return self.PORT
@@ -75,12 +115,6 @@ class dlaSocket:
         self.sock.settimeout(timeout)
         return
 
-    def getRecvBufSize(self):
-        return self.sock.getsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF)
-
-    def getSendBufSize(self):
-        return self.sock.getsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF)
-
     def closeConnection(self):
         self.sock.close()
 
@@ -93,6 +127,7 @@ class dlaSocket:
             l_linger = 0
             self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER,
                 struct.pack('ii', l_onoff, l_linger))
+            self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
 
             self.sock.connect((str(host), int(port)))
 
@@ -104,101 +139,149 @@ class dlaSocket:
 
         logging.info("Connection accepted")
 
-    def send(self, msg):
-        self.sendSize(len(msg))
-        self.sendData(msg)
-
-    def receive(self):
-        size = self.receiveSize()
-        msg = self.receiveData(size)
-
-        return msg
-
-    def sendSize(self, size):
-        sent = 0
+    def connectLocal(self, path):
+        """
+        Connects to the server's --socket Unix socket, which also serves
+        mapBuffers().
+        """
+        self.sock.close()
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
 
         try:
-            logging.info("sending size %u bytes" % size)
-            sent = self.sock.send(str(size) + self.SEP)
+            self.sock.connect(path)
         except socket.error as err:
-            msg = "sendSize failed: {0}\n".format(err.strerror)
+            msg = "Couldn't Connect with the socket-server: {0}\n" \
+                  " terminating program\n".format(err)
             logging.error(msg)
+            sys.exit(1)
 
-        if sent == 0:
-            msg = "Socket Connection Broken."
+        logging.info("Connection accepted")
+
+    def send(self, opcode, payload=b'', flags=0, priority=PRIORITY_NORMAL, deadlineUs=None):
+        """
+        Sends one request without waiting for its reply, returns its id.
+        Runs past deadlineUs from now are answered with an error, unrun.
+        """
+        requestId = next(self.requestIds)
+        flags |= priority << PRIORITY_SHIFT
+        if deadlineUs is not None:
+            payload = struct.pack('!I', deadlineUs) + payload
+            flags |= FLAG_DEADLINE
+        header = WIRE_HEADER.pack(WIRE_MAGIC, opcode, flags, requestId, len(payload))
+
+        logging.info("sending opcode %u, request %u, %u bytes" % (opcode, requestId, len(payload)))
+        try:
+            if hasattr(self.sock, 'sendmsg'):
+                # header and payload go out together without joining them
+                sent = self.sock.sendmsg([header, payload])
+                if sent < len(header) + len(payload):
+                    self.sock.sendall((header + payload)[sent:])
+            else:
+                self.sock.sendall(header + payload)
+        except socket.error as err:
+            msg = "send failed: {0}\n".format(err)
             logging.error(msg)
             raise RuntimeError(msg)
 
-    def sendData(self, msg):
-        maxSendSize = self.getSendBufSize()
-        sentSize = 0
-        remainingSize = 0
-        sendSize = 0
-
-        while sentSize < len(msg):
-            curSize = 0
-            remainingSize = len(msg) - sentSize
-            sendSize = maxSendSize if (maxSendSize < remainingSize) else remainingSize
-
-            try:
-                curSize = self.sock.send(msg[sentSize:(sentSize+sendSize)])
-            except socket.error as err:
-                msg = "sendSize failed: {0}\n".format(err.strerror)
-                logging.error(msg)
-
-            if curSize > 0:
-                sentSize += curSize
-
-            if curSize <= 0:
+        return requestId
+
+    def receive(self, requestId=None):
+        """
+        Receives the next reply, checking it answers requestId if given.
+        Error replies are returned like any other, their payload says why.
+        """
+        return self.receiveReply(self.receiveData(WIRE_HEADER.size), requestId)
+
+    def receiveWithFds(self, requestId, maxFds):
+        """
+        Like receive(), also returning the fds passed along with the reply.
+        """
+        header = b''
+        fds = array.array('i')
+
+        while len(header) < WIRE_HEADER.size:
+            data, ancdata, flags, addr = self.sock.recvmsg(WIRE_HEADER.size - len(header),
+                                                          socket.CMSG_SPACE(maxFds * fds.itemsize))
+            if not data:
                 msg = "Socket Connection Broken."
                 logging.error(msg)
                 raise RuntimeError(msg)
 
-    def receiveSize(self):
-        sizestr = ""
+            header += data
+            for level, kind, cdata in ancdata:
+                if level == socket.SOL_SOCKET and kind == socket.SCM_RIGHTS:
+                    fds.frombytes(cdata[:len(cdata) - len(cdata) % fds.itemsize])
 
-        while True:
-            # Read one byte at a time until we hit our separator
-            sizechar = self.sock.recv(1)
+        return self.receiveReply(header, requestId), list(fds)
 
-            if len(sizechar) <= 0:
-                msg = "Socket Connection Broken."
-                logging.error(msg)
-                raise RuntimeError(msg)
+    def receiveReply(self, header, requestId):
+        magic, opcode, flags, replyId, size = WIRE_HEADER.unpack(header)
 
-            if sizechar == self.SEP:
-                break
-            else:
-                sizestr += sizechar
+        if magic != WIRE_MAGIC or not (flags & FLAG_REPLY):
+            msg = "Malformed reply header."
+            logging.error(msg)
+            raise RuntimeError(msg)
+
+        if requestId is not None and replyId != requestId:
+            msg = "Reply to request %u, expected %u." % (replyId, requestId)
+            logging.error(msg)
+            raise RuntimeError(msg)
+
+        msg = self.receiveData(size)
+        if flags & FLAG_ERROR:
+            logging.error("request %u failed: %s" % (replyId, msg))
+
+        return msg
+
+    def mapBuffers(self, count, model=None):
+        """
+        Shares count pairs of input and output tensor buffers with the
+        server, over the local socket only. Returns (input, output) mmaps:
+        write a packed input tensor, runBuffer() its slot and read the
+        output in place. Runs use model, or the connection's model if None.
+        """
+        payload = struct.pack('!I', count)
+        flags = 0
+        if model is not None:
+            payload = model + payload
+            flags = FLAG_MODEL
+
+        requestId = self.send(OP_MAP_BUFFERS, payload, flags)
+        reply, fds = self.receiveWithFds(requestId, 2 * count)
 
-        size = -1
-        # Convert string size to integer
         try:
-            size = int(sizestr)
-        except ValueError:
-            logging.error("received non-integer size (%s)" % sizestr)
+            if len(reply) != BUFFERS_REPLY.size or len(fds) != 2 * count:
+                msg = "Unable to map buffers: {0}".format(reply)
+                logging.error(msg)
+                raise RuntimeError(msg)
 
-        return size
+            slots, inputSize, outputSize = BUFFERS_REPLY.unpack(reply)
+            return [(mmap.mmap(fds[2 * s], inputSize), mmap.mmap(fds[2 * s + 1], outputSize))
+                    for s in range(slots)]
+        finally:
+            # the mappings keep the buffers
+            for fd in fds:
+                os.close(fd)
 
-    def receiveData(self, size):
-        maxRecvSize = self.getRecvBufSize()
+    def runBuffer(self, slot):
+        """
+        Runs the input in a mapBuffers() slot, returns the result line.
+        """
+        return self.receive(self.send(OP_RUN_BUFFER, struct.pack('!I', slot)))
 
-        buf = ""
+    def receiveData(self, size):
+        buf = bytearray(size)
+        view = memoryview(buf)
         receivedSize = 0
-        remainingSize = 0
 
         logging.info("reading %u bytes from Server." % size)
         while receivedSize < size:
-            remainingSize = size - receivedSize
-            recvSize = maxRecvSize if (maxRecvSize < remainingSize) else remainingSize
-
-            recvdata = self.sock.recv(recvSize)
-            if len(recvdata) <= 0:
+            curSize = self.sock.recv_into(view[receivedSize:], size - receivedSize)
+            if curSize <= 0:
                 msg = "Socket Connection Broken."
                 logging.error(msg)
                 raise RuntimeError(msg)
 
-            buf += recvdata
-            receivedSize = len(buf)
+            receivedSize += curSize
 
-        return buf
+        return bytes(buf)
@@ -39,6 +39,7 @@ import logging
 import socket
 import time
 import optparse
+import struct
 import TestUtils as tu
 import dlaSocket as ds
 
@@ -65,6 +66,12 @@ def parse_options(argv):
                     default=False, help='Don\'t Shut Down Server.')
     parser.add_option('--image', '--img', dest='image_file', action='store',
                     default=None, help='Image file')
+    parser.add_option('--socket', dest='socket_path', action='store',
+                    default=None, help='Connect over the server\'s Unix socket instead.', metavar='PATH')
+    parser.add_option('--trace', action="store_true", dest="trace",
+                    default=False, help='Log how each run went through the cascade.')
+    parser.add_option('--stats', action="store_true", dest="get_stats",
+                    default=False, help='Save the server metrics to OUTPUT_DIR/server_stats.txt.')
 
     options, categories = parser.parse_args(argv[1:])
     _input = options.input_file
@@ -96,9 +103,9 @@ def getFlatBufData(input_file):
     """
     Collect fbuf data from input file and return.
     """
-    data = ""
+    data = b""
 
-    with open(input_file, 'r') as _file:
+    with open(input_file, 'rb') as _file:
         data = _file.read()
 
     return data
@@ -107,9 +114,9 @@ def getImageData(image_file):
     """
     Collect image data from image file and return.
     """
-    image = ""
+    image = b""
 
-    with open(image_file, 'r') as _file:
+    with open(image_file, 'rb') as _file:
         image = _file.read()
 
     return image
@@ -118,7 +125,7 @@ def validateTestExecution(msg):
     """
     Helper API to validate the Test Execution output.
     """
-    if "PASSED" not in msg:
+    if b"PASSED" not in msg:
         passed = "FAIL"
     else:
         passed = "PASS"
@@ -130,28 +137,36 @@ def validateTestExecution(msg):
 
 def getWelcomeMessage(sock, timeout=1000):
     logging.info("Requesting welcome message");
-    cmd = "GET_WELCOME"
-    sock.send(cmd)
+    requestId = sock.send(ds.OP_GET_WELCOME)
 
     # Wait to receive welcome message
     sock.setTimeout(timeout)
-    welcome = sock.receive()
-    if "ERR" in welcome:
+    welcome = sock.receive(requestId)
+    if b"ERR" in welcome:
         logging.error("Unable to receive welcome message")
         sock.closeConnection()
         sys.exit(1)
 
     logging.info("Received welcome message: {%s}" % welcome);
 
-def runFlatbuf(sock, fbuf_file, timeout=1000000):
+def checkFlatbuf(sock, loadId):
+    # READ_FLATBUF is pipelined with the run, its reply comes first
+    msg = sock.receive(loadId)
+    if msg != b"OK":
+        logging.error("Unable to load the flatbuf: {0}".format(msg))
+        sock.closeConnection()
+        sys.exit(1)
+
+def runFlatbuf(sock, fbuf_file, model, loadId=None, timeout=1000000, trace=False):
     logging.info("Sending and executing flatbuffer");
-    cmd = "RUN_FLATBUF"
-    sock.send(cmd)
+    requestId = sock.send(ds.OP_RUN_FLATBUF, model, ds.FLAG_MODEL | (ds.FLAG_TRACE if trace else 0))
 
     # Wait to receive test results
     sock.setTimeout(timeout)
-    testResults = sock.receive()
-    if "ERR" in testResults:
+    if loadId is not None:
+        checkFlatbuf(sock, loadId)
+    testResults = sock.receive(requestId)
+    if b"ERR" in testResults:
         logging.error("Unable to receive test results")
         sock.closeConnection()
         sys.exit(1)
@@ -161,47 +176,58 @@ def runFlatbuf(sock, fbuf_file, timeout=1000000):
 
     validateTestExecution(testResults)
 
-def queryFlatbuf(sock, timeout=1000000):
+def queryFlatbuf(sock, model, timeout=1000000):
     logging.info("Querying if flatbuf is cached.")
-    cmd = "QUERY_FLATBUF"
-    sock.send(cmd)
+    requestId = sock.send(ds.OP_QUERY_FLATBUF, model)
 
     sock.setTimeout(timeout)
-    msg = sock.receive()
+    msg = sock.receive(requestId)
 
     logging.info("Received flatbuf query response from Server: {0}".format(msg))
 
-    return msg
+    return msg == b"YES"
+
+def loadFlatbuf(sock, fbuf_file):
+    """
+    Uploads the flatbuf only if the server doesn't have it yet. Returns its
+    model id, and the pending READ_FLATBUF request if there is one.
+    """
+    model = ds.modelId(getFlatBufData(fbuf_file))
+    if queryFlatbuf(sock, model):
+        logging.info("Server already has the flatbuf, not sending it.")
+        return model, None
+
+    return model, readFlatbuf(sock, fbuf_file)
 
 def readFlatbuf(sock, fbuf_file):
     data = getFlatBufData(fbuf_file)
-    if data == "":
+    if data == b"":
         logging.error("Unable to read the flatbuf: %s".format(fbuf_file))
         sock.closeConnection()
         sys.exit(1)
 
     logging.info("Sending and loading flatbuffer");
-    cmd = "READ_FLATBUF"
-    sock.send(cmd)
-    sock.send(data)
 
-def runImage(sock, img_file, timeout=1000):
+    return sock.send(ds.OP_READ_FLATBUF, data)
+
+def runImage(sock, img_file, model, loadId=None, timeout=1000, trace=False):
     image = getImageData(img_file)
-    if image == "":
+    if image == b"":
         logging.error("Unable to read the image: %s".format(img_file))
         sock.closeConnection()
         sys.exit(1)
 
     file_name = img_file.split("/")[-1]
     logging.info("Seding and running image");
-    cmd = "RUN_IMAGE_" + file_name
-    sock.send(cmd)
-    sock.send(image)
+    requestId = sock.send(ds.OP_RUN_IMAGE, model + file_name.encode() + b"\0" + image,
+                          ds.FLAG_MODEL | (ds.FLAG_TRACE if trace else 0))
 
     # Wait to receive test results
     sock.setTimeout(timeout)
-    testResults = sock.receive()
-    if "ERR" in testResults:
+    if loadId is not None:
+        checkFlatbuf(sock, loadId)
+    testResults = sock.receive(requestId)
+    if b"ERR" in testResults:
         logging.error("Unable to receive test results")
         sock.closeConnection()
         sys.exit(1)
@@ -212,13 +238,12 @@ def runImage(sock, img_file, timeout=1000):
 
 def getNumOutputs(sock, timeout=1000):
     logging.info("Requesting number of test outputs");
-    cmd = "GET_NUMOUTPUTS"
-    sock.send(cmd)
+    requestId = sock.send(ds.OP_GET_NUMOUTPUTS)
 
     # Wait to receive the number of test outputs
     sock.setTimeout(timeout)
-    numOutputs = sock.receive()
-    if "ERR" in numOutputs:
+    numOutputs = sock.receive(requestId)
+    if b"ERR" in numOutputs:
         logging.error("Unable to receive the number of test outputs")
         sock.closeConnection()
         sys.exit(1)
@@ -229,30 +254,43 @@ def getNumOutputs(sock, timeout=1000):
 
 def writeOutput(sock, index, resultsDir, timeout=1000000):
     logging.info("Requesting test output[%d]" % index);
-    cmd = "GET_OUTPUT"
-    sock.send(cmd)
-    sock.send(str(index))
+    requestId = sock.send(ds.OP_GET_OUTPUT, struct.pack('!I', index))
 
     # Wait to receive the number of test outputs
-    # We need a proper way to check for communication failure here
     sock.setTimeout(timeout)
-    dimg = sock.receive()
+    dimg = sock.receive(requestId)
+    if b"ERR" in dimg[:8]:
+        logging.error("Unable to receive test output[%d]" % index)
+        sock.closeConnection()
+        sys.exit(1)
 
     logging.info("Received test output[%d]" % index)
 
     filename = resultsDir + ('o_%06d.dimg' % index)
-    f = open(filename, 'w')
+    f = open(filename, 'wb')
     f.write(dimg)
     f.close()
 
+def writeServerStats(sock, statsFile, timeout=1000):
+    logging.info("Requesting server metrics");
+    requestId = sock.send(ds.OP_GET_STATS)
+
+    sock.setTimeout(timeout)
+    stats = sock.receive(requestId)
+
+    f = open(statsFile, 'wb')
+    f.write(stats)
+    f.close()
+
+    logging.info("Saved server metrics to {0}".format(statsFile))
+
 def shutDownServer(sock, timeout=1000):
     logging.info("Requesting to Shutdown the server.");
-    cmd = "SHUTDOWN"
-    sock.send(cmd)
+    requestId = sock.send(ds.OP_SHUTDOWN)
 
     # Wait to receive the ACK from Server
     sock.setTimeout(timeout)
-    msg = sock.receive()
+    msg = sock.receive(requestId)
 
     logging.info("Received response from Server: {0}".format(msg))
 
@@ -269,7 +307,10 @@ def main():
     #Set Client Port
     dlasocket.setPort(options.port_addr)
 
-    dlasocket.connect(dlasocket.HOST, dlasocket.PORT)
+    if options.socket_path is None:
+        dlasocket.connect(dlasocket.HOST, dlasocket.PORT)
+    else:
+        dlasocket.connectLocal(options.socket_path)
     dlasocket.setTimeout(dlasocket.getTimeout())
 
     logging.info("DLA Client open at PORT: {0}.".format(dlasocket.getPort()))
@@ -286,12 +327,12 @@ def main():
             logging.info("Attempting to read flatbuf: [{0}], " \
                      "size[{1}].".format(fbuf_file_name, fbuf_size))
 
-            readFlatbuf(dlasocket, fbuf_file)
+            model, loadId = loadFlatbuf(dlasocket, fbuf_file)
 
             logging.info("Attempting to run flatbuf: [{0}], " \
                      "size[{1}].".format(fbuf_file_name, fbuf_size))
 
-            runFlatbuf(dlasocket, fbuf_file)
+            runFlatbuf(dlasocket, fbuf_file, model, loadId, trace=options.trace)
         else:
             img_file  = options.image_file[test_i]
             img_size  = os.stat(img_file).st_size
@@ -300,13 +341,13 @@ def main():
             logging.info("Attempting to read flatbuf: [{0}], " \
                      "size[{1}].".format(fbuf_file_name, fbuf_size))
 
-            readFlatbuf(dlasocket, fbuf_file)
+            model, loadId = loadFlatbuf(dlasocket, fbuf_file)
 
             image_file_name = options.image_file[test_i].split("/")[-1]
             logging.info("Attempting to run image: [{0}], " \
                      "size[{1}].".format(image_file_name, img_size))
 
-            runImage(dlasocket, img_file)
+            runImage(dlasocket, img_file, model, loadId, trace=options.trace)
 
         numOutputs = getNumOutputs(dlasocket)
         for ii in range(numOutputs):
@@ -314,6 +355,9 @@ def main():
 
         test_i += 1
 
+    if options.get_stats:
+        writeServerStats(dlasocket, options.output_dir + "/server_stats.txt")
+
     #Send ShutDown command to Server if shut_server is True.
     if options.shut_server:
         shutDownServer(dlasocket)
@@ -130,6 +130,19 @@ size_t EMULogOpDescAccessor::struct_align() const { return _n.struct_align(); }
 EMUCommonOpDescAccessor EMULogOpDescAccessor::commonOpDescAccessor() const { return _n.commonOpDescAccessor(_base); }
 
 
+//
+// emu_topk_op_desc
+//
+EMUTopKOpDescAccessor::EMUTopKOpDescAccessor(NvU8 *base, const EMUTopKOpDesc &n) : _base(base), _n(n) { }
+
+NvU8 * EMUTopKOpDescAccessor::struct_base()  const { return _base;      }
+size_t EMUTopKOpDescAccessor::struct_size()  const { return _n.struct_size();  }
+size_t EMUTopKOpDescAccessor::struct_align() const { return _n.struct_align(); }
+
+EMUCommonOpDescAccessor EMUTopKOpDescAccessor::commonOpDescAccessor() const { return _n.commonOpDescAccessor(_base); }
+NvU8 * EMUTopKOpDescAccessor::k()   const { return _n.k(_base); }
+
+
 //
 // emu_operation_container
 //
@@ -142,6 +155,7 @@ size_t EMUOperationContainerAccessor::struct_align() const { return _n.struct_al
 EMUPowerOpDescAccessor EMUOperationContainerAccessor::powerOpDescAccessor(size_t c) const { return _n.powerOpDescAccessor(_base, c); }
 EMUSoftmaxOpDescAccessor EMUOperationContainerAccessor::softmaxOpDescAccessor(size_t c) const { return _n.softmaxOpDescAccessor(_base, c); }
 EMULogOpDescAccessor EMUOperationContainerAccessor::logOpDescAccessor(size_t c) const { return _n.logOpDescAccessor(_base, c); }
+EMUTopKOpDescAccessor EMUOperationContainerAccessor::topKOpDescAccessor(size_t c) const { return _n.topKOpDescAccessor(_base, c); }
 
 
 //
@@ -202,6 +216,19 @@ EMUBufferDescAccessor EMULogBufferDescsAccessor::srcDataAccessor() const { retur
 EMUBufferDescAccessor EMULogBufferDescsAccessor::dstDataAccessor() const { return _n.dstDataAccessor(_base); }
 
 
+//
+// emu_topk_buffer_descs
+//
+EMUTopKBufferDescsAccessor::EMUTopKBufferDescsAccessor(NvU8 *base, const EMUTopKBufferDescs &n) : _base(base), _n(n) { }
+
+NvU8 * EMUTopKBufferDescsAccessor::struct_base()  const { return _base;      }
+size_t EMUTopKBufferDescsAccessor::struct_size()  const { return _n.struct_size();  }
+size_t EMUTopKBufferDescsAccessor::struct_align() const { return _n.struct_align(); }
+
+EMUBufferDescAccessor EMUTopKBufferDescsAccessor::srcDataAccessor() const { return _n.srcDataAccessor(_base); }
+EMUBufferDescAccessor EMUTopKBufferDescsAccessor::dstDataAccessor() const { return _n.dstDataAccessor(_base); }
+
+
 //
 // emu_operation_buffer_container
 //
@@ -214,6 +241,23 @@ size_t EMUOperationBufferContainerAccessor::struct_align() const { return _n.str
 EMUPowerBufferDescsAccessor EMUOperationBufferContainerAccessor::powerBufferDescsAccessor(size_t c) const { return _n.powerBufferDescsAccessor(_base, c); }
 EMUSoftmaxBufferDescsAccessor EMUOperationBufferContainerAccessor::softmaxBufferDescsAccessor(size_t c) const { return _n.softmaxBufferDescsAccessor(_base, c); }
 EMULogBufferDescsAccessor EMUOperationBufferContainerAccessor::logBufferDescsAccessor(size_t c) const { return _n.logBufferDescsAccessor(_base, c); }
+EMUTopKBufferDescsAccessor EMUOperationBufferContainerAccessor::topKBufferDescsAccessor(size_t c) const { return _n.topKBufferDescsAccessor(_base, c); }
+
+
+//
+// emu_topk_result
+//
+EMUTopKResultAccessor::EMUTopKResultAccessor(NvU8 *base, const EMUTopKResult &n) : _base(base), _n(n) { }
+
+NvU8 * EMUTopKResultAccessor::struct_base()  const { return _base;      }
+size_t EMUTopKResultAccessor::struct_size()  const { return _n.struct_size();  }
+size_t EMUTopKResultAccessor::struct_align() const { return _n.struct_align(); }
+
+NvU32 * EMUTopKResultAccessor::k()                const { return _n.k(_base); }
+size_t  EMUTopKResultAccessor::maxK()             const { return _n.maxK(); }
+NvU32 * EMUTopKResultAccessor::index(size_t c)    const { return _n.index(_base, c); }
+NvF32 * EMUTopKResultAccessor::prob(size_t c)     const { return _n.prob(_base, c); }
+NvF32 * EMUTopKResultAccessor::margin()           const { return _n.margin(_base); }
 
 
 //
@@ -223,6 +267,7 @@ EMUTaskDescAccessor     EMUInterface::taskDescAccessor(NvU8 *base)     const { r
 EMUNetworkDescAccessor  EMUInterface::networkDescAccessor(NvU8 *base)  const { return EMUNetworkDescAccessor(base, networkDesc()); }
 EMUOperationContainerAccessor EMUInterface::operationContainerAccessor(NvU8 *base) const { return EMUOperationContainerAccessor(base, operationContainer()); }
 EMUOperationBufferContainerAccessor   EMUInterface::operationBufferContainerAccessor(NvU8 *base)   const { return EMUOperationBufferContainerAccessor(base, operationBufferContainer()); }
+EMUTopKResultAccessor   EMUInterface::topKResultAccessor(NvU8 *base)   const { return EMUTopKResultAccessor(base, topKResult()); }
 
 } // nvdla::priv
 } // nvdla
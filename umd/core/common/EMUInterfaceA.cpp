@@ -185,6 +185,27 @@ protected:
 static EMULogOpDescA g_emu_log_op_desc;
 
 
+//
+// struct emu_topk_op_desc
+//
+class EMUTopKOpDescA : public EMUTopKOpDesc
+{
+public:
+    virtual ~EMUTopKOpDescA() { }
+
+    virtual size_t struct_size()  const { return sizeof(emu_topk_op_desc);    }
+    virtual size_t struct_align() const { return 4; }
+
+    virtual EMUCommonOpDescAccessor commonOpDescAccessor(NvU8 *base) const { return EMUCommonOpDescAccessor(cir(&(ric(base)->common)), g_emu_common_op_desc); }
+    virtual NvU8 * k(NvU8 *base) const { return &ric(base)->k; }
+
+protected:
+    static inline NvU8          *cir(emu_common_op_desc *c)     { return reinterpret_cast<NvU8 *>(c);             }
+    static inline emu_topk_op_desc *ric(NvU8 *base)             { return reinterpret_cast<emu_topk_op_desc *>(base); }
+};
+static EMUTopKOpDescA g_emu_topk_op_desc;
+
+
 //
 // struct emu_operation_container
 //
@@ -199,11 +220,13 @@ public:
     virtual EMUPowerOpDescAccessor powerOpDescAccessor(NvU8 *base, size_t c) const { return EMUPowerOpDescAccessor(sir(&(ric(base)[c].power_op)), g_emu_power_op_desc); }
     virtual EMUSoftmaxOpDescAccessor softmaxOpDescAccessor(NvU8 *base, size_t c) const { return EMUSoftmaxOpDescAccessor(sir(&(ric(base)[c].softmax_op)), g_emu_softmax_op_desc); }
     virtual EMULogOpDescAccessor logOpDescAccessor(NvU8 *base, size_t c) const { return EMULogOpDescAccessor(sir(&(ric(base)[c].log_op)), g_emu_log_op_desc); }
+    virtual EMUTopKOpDescAccessor topKOpDescAccessor(NvU8 *base, size_t c) const { return EMUTopKOpDescAccessor(sir(&(ric(base)[c].topk_op)), g_emu_topk_op_desc); }
 
 protected:
     static inline NvU8          *sir(emu_power_op_desc *c)       { return reinterpret_cast<NvU8 *>(c);             }
     static inline NvU8          *sir(emu_softmax_op_desc *c)     { return reinterpret_cast<NvU8 *>(c);             }
     static inline NvU8          *sir(emu_log_op_desc *c)         { return reinterpret_cast<NvU8 *>(c);             }
+    static inline NvU8          *sir(emu_topk_op_desc *c)        { return reinterpret_cast<NvU8 *>(c);             }
     static inline emu_operation_container *ric(NvU8 *base)       { return reinterpret_cast<emu_operation_container *>(base); }
 };
 static EMUOperationContainerA g_emu_operation_container;
@@ -302,6 +325,28 @@ protected:
 static EMULogBufferDescsA g_emu_log_buffer_descs;
 
 
+//
+// struct emu_topk_buffer_descs
+//
+
+class EMUTopKBufferDescsA : public EMUTopKBufferDescs
+{
+public:
+    virtual ~EMUTopKBufferDescsA() { }
+
+    virtual size_t struct_size()  const { return sizeof(emu_topk_buffer_descs);    }
+    virtual size_t struct_align() const { return 4; }
+
+    virtual EMUBufferDescAccessor srcDataAccessor(NvU8 *base) const { return EMUBufferDescAccessor(dir(&ric(base)->src_data), g_emu_buffer_desc); }
+    virtual EMUBufferDescAccessor dstDataAccessor(NvU8 *base) const { return EMUBufferDescAccessor(dir(&ric(base)->dst_data), g_emu_buffer_desc); }
+
+protected:
+    static inline NvU8          *dir(emu_buffer_desc *d)    { return reinterpret_cast<NvU8 *>(d);             }
+    static inline emu_topk_buffer_descs *ric(NvU8 *base)    { return reinterpret_cast<emu_topk_buffer_descs *>(base); }
+};
+static EMUTopKBufferDescsA g_emu_topk_buffer_descs;
+
+
 //
 // struct emu_operation_buffer_container
 //
@@ -328,16 +373,46 @@ public:
         return EMULogBufferDescsAccessor(sir( &(ric(base)[c]).log_buffers), g_emu_log_buffer_descs);
     }
 
+    virtual EMUTopKBufferDescsAccessor topKBufferDescsAccessor(NvU8 *base, size_t c) const
+    {
+        return EMUTopKBufferDescsAccessor(sir( &(ric(base)[c]).topk_buffers), g_emu_topk_buffer_descs);
+    }
+
 protected:
     static inline NvU8 *sir(emu_power_buffer_descs *c) { return reinterpret_cast<NvU8 *>(c); }
     static inline NvU8 *sir(emu_softmax_buffer_descs *c) { return reinterpret_cast<NvU8 *>(c); }
     static inline NvU8 *sir(emu_log_buffer_descs *c) { return reinterpret_cast<NvU8 *>(c); }
+    static inline NvU8 *sir(emu_topk_buffer_descs *c) { return reinterpret_cast<NvU8 *>(c); }
     static inline emu_operation_buffer_container *ric(NvU8 *base)  { return reinterpret_cast<emu_operation_buffer_container *>(base); }
 };
 static EMUOperationBufferContainerA g_emu_operation_buffer_container;
 const EMUOperationBufferContainer & EMUInterfaceA::operationBufferContainer() const { return g_emu_operation_buffer_container; }
 
 
+//
+// struct emu_topk_result
+//
+class EMUTopKResultA : public EMUTopKResult
+{
+public:
+    virtual ~EMUTopKResultA() { }
+
+    virtual size_t struct_size()  const { return sizeof(emu_topk_result);    }
+    virtual size_t struct_align() const { return 4; }
+
+    virtual NvU32 * k(NvU8 *base) const { return &ric(base)->k; }
+    virtual size_t maxK() const { return NVDLA_EMU_TOPK_MAX; }
+    virtual NvU32 * index(NvU8 *base, size_t c) const { return &ric(base)->index[c]; }
+    virtual NvF32 * prob(NvU8 *base, size_t c) const { return &ric(base)->prob[c]; }
+    virtual NvF32 * margin(NvU8 *base) const { return &ric(base)->margin; }
+
+protected:
+    static inline emu_topk_result *ric(NvU8 *base) { return reinterpret_cast<emu_topk_result *>(base); }
+};
+static EMUTopKResultA g_emu_topk_result;
+const EMUTopKResult & EMUInterfaceA::topKResult() const { return g_emu_topk_result; }
+
+
 //
 // interface
 //
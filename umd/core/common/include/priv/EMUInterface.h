@@ -289,6 +289,41 @@ protected:
 };
 
 
+//
+// struct emu_topk_op_desc
+//
+class EMUTopKOpDesc
+{
+public:
+    virtual size_t struct_size()  const = 0;
+    virtual size_t struct_align() const = 0;
+
+    virtual EMUCommonOpDescAccessor commonOpDescAccessor(NvU8 *base) const = 0;
+    virtual NvU8 * k(NvU8 *base) const = 0;
+
+protected:
+    EMUTopKOpDesc()          { }
+    virtual ~EMUTopKOpDesc() { }
+};
+
+class EMUTopKOpDescAccessor
+{
+public:
+    NvU8 * struct_base()  const;
+    size_t struct_size()  const;
+    size_t struct_align() const;
+
+    EMUCommonOpDescAccessor commonOpDescAccessor() const;
+    NvU8 * k() const;
+
+    EMUTopKOpDescAccessor(NvU8 *base, const EMUTopKOpDesc &);
+
+protected:
+    NvU8 *_base;
+    const EMUTopKOpDesc &_n;
+};
+
+
 //
 // union emu_operation_container
 //
@@ -301,6 +336,7 @@ public:
     virtual EMUPowerOpDescAccessor powerOpDescAccessor(NvU8 *base, size_t c) const = 0;
     virtual EMUSoftmaxOpDescAccessor softmaxOpDescAccessor(NvU8 *base, size_t c) const = 0;
     virtual EMULogOpDescAccessor logOpDescAccessor(NvU8 *base, size_t c) const = 0;
+    virtual EMUTopKOpDescAccessor topKOpDescAccessor(NvU8 *base, size_t c) const = 0;
 
 protected:
     EMUOperationContainer()          { }
@@ -317,6 +353,7 @@ public:
     EMUPowerOpDescAccessor powerOpDescAccessor(size_t c) const;
     EMUSoftmaxOpDescAccessor softmaxOpDescAccessor(size_t c) const;
     EMULogOpDescAccessor logOpDescAccessor(size_t c) const;
+    EMUTopKOpDescAccessor topKOpDescAccessor(size_t c) const;
 
     EMUOperationContainerAccessor(NvU8 *base, const EMUOperationContainer &);
 
@@ -478,6 +515,41 @@ protected:
 };
 
 
+//
+// struct emu_topk_buffer_descs
+//
+class EMUTopKBufferDescs
+{
+public:
+    virtual size_t struct_size()  const = 0;
+    virtual size_t struct_align() const = 0;
+
+    virtual EMUBufferDescAccessor srcDataAccessor(NvU8 *base) const = 0;
+    virtual EMUBufferDescAccessor dstDataAccessor(NvU8 *base) const = 0;
+
+protected:
+    EMUTopKBufferDescs()          { }
+    virtual ~EMUTopKBufferDescs() { }
+};
+
+class EMUTopKBufferDescsAccessor
+{
+public:
+    NvU8 * struct_base()  const;
+    size_t struct_size()  const;
+    size_t struct_align() const;
+
+    EMUBufferDescAccessor srcDataAccessor() const;
+    EMUBufferDescAccessor dstDataAccessor() const;
+
+    EMUTopKBufferDescsAccessor(NvU8 *base, const EMUTopKBufferDescs &);
+
+protected:
+    NvU8 *_base;
+    const EMUTopKBufferDescs &_n;
+};
+
+
 //
 // union emu_operation_buffer_container
 //
@@ -490,6 +562,7 @@ public:
     virtual EMUPowerBufferDescsAccessor powerBufferDescsAccessor(NvU8 *base, size_t c) const = 0;
     virtual EMUSoftmaxBufferDescsAccessor softmaxBufferDescsAccessor(NvU8 *base, size_t c) const = 0;
     virtual EMULogBufferDescsAccessor logBufferDescsAccessor(NvU8 *base, size_t c) const = 0;
+    virtual EMUTopKBufferDescsAccessor topKBufferDescsAccessor(NvU8 *base, size_t c) const = 0;
 
 protected:
     EMUOperationBufferContainer()          { }
@@ -506,6 +579,7 @@ public:
     EMUPowerBufferDescsAccessor powerBufferDescsAccessor(size_t c) const;
     EMUSoftmaxBufferDescsAccessor softmaxBufferDescsAccessor(size_t c) const;
     EMULogBufferDescsAccessor logBufferDescsAccessor(size_t c) const;
+    EMUTopKBufferDescsAccessor topKBufferDescsAccessor(size_t c) const;
 
     EMUOperationBufferContainerAccessor(NvU8 *base, const EMUOperationBufferContainer &);
 
@@ -515,6 +589,47 @@ protected:
 };
 
 
+//
+// struct emu_topk_result
+//
+class EMUTopKResult
+{
+public:
+    virtual size_t struct_size()  const = 0;
+    virtual size_t struct_align() const = 0;
+
+    virtual NvU32 * k(NvU8 *base) const = 0;
+    virtual size_t maxK() const = 0;
+    virtual NvU32 * index(NvU8 *base, size_t c) const = 0;
+    virtual NvF32 * prob(NvU8 *base, size_t c) const = 0;
+    virtual NvF32 * margin(NvU8 *base) const = 0;
+
+protected:
+    EMUTopKResult()          { }
+    virtual ~EMUTopKResult() { }
+};
+
+class EMUTopKResultAccessor
+{
+public:
+    NvU8 * struct_base()  const;
+    size_t struct_size()  const;
+    size_t struct_align() const;
+
+    NvU32 * k() const;
+    size_t maxK() const;
+    NvU32 * index(size_t c) const;
+    NvF32 * prob(size_t c) const;
+    NvF32 * margin() const;
+
+    EMUTopKResultAccessor(NvU8 *base, const EMUTopKResult &);
+
+protected:
+    NvU8 *_base;
+    const EMUTopKResult &_n;
+};
+
+
 class EMUInterface
 {
 public:
@@ -539,12 +654,14 @@ public:
     EMUNetworkDescAccessor   networkDescAccessor(NvU8 *base)  const;
     EMUOperationContainerAccessor operationContainerAccessor(NvU8 *base)  const;
     EMUOperationBufferContainerAccessor operationBufferContainerAccessor(NvU8 *base)  const;
+    EMUTopKResultAccessor topKResultAccessor(NvU8 *base)  const;
 
 protected:
     virtual const EMUTaskDesc     & taskDesc()  const = 0;
     virtual const EMUNetworkDesc  & networkDesc()  const = 0;
     virtual const EMUOperationContainer & operationContainer()  const = 0;
     virtual const EMUOperationBufferContainer & operationBufferContainer()  const = 0;
+    virtual const EMUTopKResult & topKResult()  const = 0;
 };
 
 
@@ -573,6 +690,7 @@ protected:
     const EMUNetworkDesc  & networkDesc()  const;
     const EMUOperationContainer & operationContainer()  const;
     const EMUOperationBufferContainer & operationBufferContainer()  const;
+    const EMUTopKResult & topKResult()  const;
     const EMUAddress & address()  const;
 };
 
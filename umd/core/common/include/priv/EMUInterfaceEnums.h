@@ -43,7 +43,8 @@
 #define EMU_OP_TYPE_ENUMS(op)               \
     op(POWER, 0U)                           \
     op(SOFTMAX, 1U)                         \
-    op(LOG, 2U)
+    op(LOG, 2U)                             \
+    op(TOPK, 3U)
 
 #define ENUM_MACRO(x, y) x = y,
 
@@ -39,8 +39,11 @@
 #define NVDLA_EMU_OP_POWER    0
 #define NVDLA_EMU_OP_SOFTMAX  1
 #define NVDLA_EMU_OP_LOG      2
+#define NVDLA_EMU_OP_TOPK     3
 /** @} */
 
+#define NVDLA_EMU_TOPK_MAX    8
+
 /**
  * Address
  */
@@ -97,11 +100,24 @@ struct emu_log_op_desc
     emu_common_op_desc common;
 } __attribute__ ((packed, aligned(4)));
 
+/**
+ * Top-k
+ *
+ * Softmax over the whole source cube followed by the k most probable
+ * entries.  Result is written to dst as struct emu_topk_result.
+ */
+struct emu_topk_op_desc
+{
+    emu_common_op_desc common;
+    NvU8 k;
+} __attribute__ ((packed, aligned(4)));
+
 union emu_operation_container
 {
     struct emu_power_op_desc power_op;
     struct emu_softmax_op_desc softmax_op;
     struct emu_log_op_desc log_op;
+    struct emu_topk_op_desc topk_op;
 };
 
 struct emu_buffer_desc
@@ -144,12 +160,36 @@ struct emu_log_buffer_descs
     struct emu_buffer_desc dst_data;
 } __attribute__ ((packed, aligned(4)));
 
+struct emu_topk_buffer_descs
+{
+    /* Buffer Descriptors */
+    struct emu_buffer_desc src_data;
+    struct emu_buffer_desc dst_data;
+} __attribute__ ((packed, aligned(4)));
+
 union emu_operation_buffer_container
 {
     struct emu_power_buffer_descs power_buffers;
     struct emu_softmax_buffer_descs softmax_buffers;
     struct emu_log_buffer_descs log_buffers;
+    struct emu_topk_buffer_descs topk_buffers;
 };
 
+/**
+ * Top-k result
+ *
+ * @k: number of valid entries
+ * @index: flattened (c, h, w) index of each entry, most probable first
+ * @prob: softmax probability of each entry
+ * @margin: prob[0] - prob[1]
+ */
+struct emu_topk_result
+{
+    NvU32 k;
+    NvU32 index[NVDLA_EMU_TOPK_MAX];
+    NvF32 prob[NVDLA_EMU_TOPK_MAX];
+    NvF32 margin;
+} __attribute__ ((packed, aligned(4)));
+
 
 #endif // NVDLA_PRIV_EMU_EMU1_A_EMU_INTERFACE_H
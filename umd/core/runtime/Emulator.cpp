@@ -26,7 +26,11 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <queue>
+#include <thread>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <map>
 
 #include "half.h"
 #include "priv/Emulator.h"
@@ -40,12 +44,82 @@ namespace nvdla
 namespace priv
 {
 
+//
+// 4-wide float vectors.  GCC lowers these to NEON on aarch64 and SSE on x86.
+//
+typedef NvF32 EmuF32x4 __attribute__((vector_size(16)));
+typedef NvS32 EmuS32x4 __attribute__((vector_size(16)));
+
+static inline EmuF32x4 splatF32x4(NvF32 v)
+{
+    EmuF32x4 r = { v, v, v, v };
+    return r;
+}
+
+//
+// Cephes style expf: range reduce by ln2, degree 5 polynomial, rebuild 2^k
+// through the exponent bits.  Inputs below the fp32 range flush to zero so
+// padding lanes seeded with -inf contribute nothing to a sum.
+//
+static inline EmuF32x4 expF32x4(EmuF32x4 x)
+{
+    const EmuF32x4 hi = splatF32x4(88.3762626647949f);
+    const EmuF32x4 lo = splatF32x4(-87.3365478515625f);
+    const EmuF32x4 magic = splatF32x4(12582912.0f); // 1.5 * 2^23, rounds to nearest
+
+    EmuS32x4 underflow = x < lo;
+    x = x > hi ? hi : x;
+    x = x < lo ? lo : x;
+
+    EmuF32x4 fk = x * splatF32x4(1.44269504088896341f) + magic;
+    EmuS32x4 k = (EmuS32x4)fk - (EmuS32x4)magic;
+    fk = fk - magic;
+
+    EmuF32x4 r = x - fk * splatF32x4(0.693359375f);
+    r = r + fk * splatF32x4(2.12194440e-4f);
+
+    EmuF32x4 p = splatF32x4(1.9875691500E-4f);
+    p = p * r + splatF32x4(1.3981999507E-3f);
+    p = p * r + splatF32x4(8.3334519073E-3f);
+    p = p * r + splatF32x4(4.1665795894E-2f);
+    p = p * r + splatF32x4(1.6666665459E-1f);
+    p = p * r + splatF32x4(5.0000001201E-1f);
+    EmuF32x4 y = p * r * r + r + splatF32x4(1.0f);
+
+    EmuS32x4 pow2 = (k + 127) << 23;
+    y = y * (EmuF32x4)pow2;
+
+    return underflow ? splatF32x4(0.0f) : y;
+}
+
+static inline NvU32 roundUp4(NvU32 n)
+{
+    return (n + 3U) & ~3U;
+}
+
 Emulator::Emulator() :
+        m_taskHead(0),
+        m_taskTail(0),
+        m_taskError(NvDlaSuccess),
         m_thread(),
         m_threadActive(false),
-        m_signalShutdown(false)
+        m_signalShutdown(false),
+        m_numWorkers(0),
+        m_jobGeneration(0),
+        m_jobPending(0),
+        m_jobChunks(0),
+        m_jobRows(0),
+        m_jobFunction(NULL),
+        m_jobContext(NULL),
+        m_workersShutdown(false),
+        m_numAllocations(0)
 {
-
+    for (NvU32 ii = 0; ii < MAX_WORKERS; ii++)
+    {
+        m_workers[ii] = NULL;
+        m_workerArgs[ii].engine = this;
+        m_workerArgs[ii].id = ii;
+    }
 }
 
 Emulator::~Emulator()
@@ -60,22 +134,53 @@ bool Emulator::ping()
 
 NvDlaError Emulator::submit(NvU8* task_mem, bool blocking)
 {
-    m_taskQueue.push(task_mem);
+    std::unique_lock<std::mutex> lock(m_taskMutex);
+
+    // wait for a free ring slot
+    while (m_taskHead - m_taskTail >= TASK_RING_SIZE)
+    {
+        m_taskDoneCond.wait(lock);
+    }
+
+    NvU64 seq = m_taskHead++;
+    m_taskRing[seq % TASK_RING_SIZE] = task_mem;
+    m_taskCond.notify_one();
 
     if (blocking) {
-        // wait until queue becomes empty
-        while (!m_taskQueue.empty()) {
-            NvDlaThreadYield();
+        // wait until this task has been processed
+        while (m_taskTail <= seq) {
+            m_taskDoneCond.wait(lock);
         }
+
+        // report this task's failure or that of a non-blocking one before it
+        NvDlaError e = m_taskError;
+        m_taskError = NvDlaSuccess;
+        return e;
     }
 
     return NvDlaSuccess;
 }
 
+NvU64 Emulator::numAllocations() const
+{
+    return m_numAllocations;
+}
+
+template <typename T>
+void Emulator::growPool(std::vector<T>& pool, size_t n)
+{
+    if (pool.size() < n)
+    {
+        pool.resize(n);
+        m_numAllocations++;
+    }
+}
+
 NvDlaError Emulator::start()
 {
     NvDlaError e = NvDlaSuccess;
 
+    PROPAGATE_ERROR_FAIL(startWorkers());
     PROPAGATE_ERROR_FAIL(NvDlaThreadCreate(threadFunction, this, &m_thread), "Failed to create thread");
 
     return NvDlaSuccess;
@@ -90,17 +195,149 @@ void Emulator::threadFunction(void* arg)
     engine->run();
 }
 
+void Emulator::workerFunction(void* arg)
+{
+    WorkerArgs* args = static_cast<WorkerArgs*>(arg);
+    args->engine->workerLoop(args->id);
+}
+
+NvDlaError Emulator::startWorkers()
+{
+    NvDlaError e = NvDlaSuccess;
+    NvU32 numCpus = std::thread::hardware_concurrency();
+
+    m_workersShutdown = false;
+    m_numWorkers = 0;
+
+    // the emulator thread itself always takes the first chunk
+    NvU32 wanted = numCpus > 1 ? numCpus - 1 : 0;
+    if (wanted > MAX_WORKERS)
+        wanted = MAX_WORKERS;
+
+    for (NvU32 ii = 0; ii < wanted; ii++)
+    {
+        PROPAGATE_ERROR_FAIL(NvDlaThreadCreate(workerFunction, &m_workerArgs[ii], &m_workers[ii]), "Failed to create worker thread");
+        m_numWorkers++;
+    }
+
+    return NvDlaSuccess;
+
+fail:
+    stopWorkers();
+    return e;
+}
+
+void Emulator::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_workersShutdown = true;
+    }
+    m_jobCond.notify_all();
+
+    for (NvU32 ii = 0; ii < m_numWorkers; ii++)
+    {
+        NvDlaThreadJoin(m_workers[ii]);
+        m_workers[ii] = NULL;
+    }
+    m_numWorkers = 0;
+}
+
+void Emulator::workerLoop(NvU32 id)
+{
+    NvU32 seenGeneration = 0;
+
+    while (true)
+    {
+        RowFunction fn;
+        void* ctx;
+        NvU32 chunk = id + 1;
+        NvU32 chunks;
+        NvU32 rows;
+
+        {
+            std::unique_lock<std::mutex> lock(m_jobMutex);
+            while (!m_workersShutdown && m_jobGeneration == seenGeneration)
+                m_jobCond.wait(lock);
+
+            if (m_workersShutdown)
+                return;
+
+            seenGeneration = m_jobGeneration;
+            fn = m_jobFunction;
+            ctx = m_jobContext;
+            chunks = m_jobChunks;
+            rows = m_jobRows;
+        }
+
+        if (chunk >= chunks)
+            continue;
+
+        fn(ctx, (NvU64)rows * chunk / chunks, (NvU64)rows * (chunk + 1) / chunks, chunk);
+
+        {
+            std::lock_guard<std::mutex> lock(m_jobMutex);
+            m_jobPending--;
+        }
+        m_jobDoneCond.notify_one();
+    }
+}
+
+void Emulator::parallelFor(NvU32 numRows, NvU32 minRowsPerChunk, RowFunction fn, void* ctx)
+{
+    NvU32 chunks = minRowsPerChunk ? numRows / minRowsPerChunk : numRows;
+
+    if (chunks > m_numWorkers + 1)
+        chunks = m_numWorkers + 1;
+
+    if (chunks <= 1)
+    {
+        fn(ctx, 0, numRows, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_jobFunction = fn;
+        m_jobContext = ctx;
+        m_jobRows = numRows;
+        m_jobChunks = chunks;
+        m_jobPending = chunks - 1;
+        m_jobGeneration++;
+    }
+    m_jobCond.notify_all();
+
+    fn(ctx, 0, (NvU64)numRows / chunks, 0);
+
+    std::unique_lock<std::mutex> lock(m_jobMutex);
+    while (m_jobPending)
+        m_jobDoneCond.wait(lock);
+}
+
+NvF32* Emulator::rowScratch(NvU32 slot, NvU32 numElements)
+{
+    std::vector<NvF32>& scratch = m_rowScratch[slot];
+    growPool(scratch, numElements);
+    return &scratch[0];
+}
+
 bool Emulator::stop()
 {
     bool ok = true;
 
     if (m_thread)
     {
-        m_signalShutdown = true;
+        {
+            std::lock_guard<std::mutex> lock(m_taskMutex);
+            m_signalShutdown = true;
+        }
+        m_taskCond.notify_all();
         NvDlaThreadJoin(m_thread);
         m_thread = NULL;
     }
 
+    stopWorkers();
+
     return ok;
 }
 
@@ -109,127 +346,290 @@ bool Emulator::run()
     bool ok = true;
     m_threadActive = true;
 
-    EMUInterface* emu_if = new EMUInterfaceA();
-
     NvDlaDebugPrintf("Emulator starting\n");
 
     while (true)
     {
-        if (!m_taskQueue.empty())
-        {
-            NvU8* task_mem = m_taskQueue.front();
-            NvDlaDebugPrintf("Work Found!\n");
-
-            EMUTaskDescAccessor task_desc = emu_if->taskDescAccessor(task_mem);
+        NvU8* task_mem = NULL;
 
-            NvU32 numAddresses = *task_desc.numAddresses();
-            std::vector<NvU8*> mappedAddressList;
-            mappedAddressList.resize(numAddresses);
-
-            // Replace all mem handles with mapped addresses
-            for (NvU32 ii=0; ii<numAddresses; ii++)
+        {
+            std::unique_lock<std::mutex> lock(m_taskMutex);
+            while (m_taskHead == m_taskTail && !m_signalShutdown)
             {
-                void* base = *((void **)task_desc.addressList(ii).hMem());
-                NvU32 offset = *task_desc.addressList(ii).offset();
-
-                if (base == 0) {
-                    mappedAddressList[ii] = NULL;
-                }
-                else {
-                    mappedAddressList[ii] = (NvU8*)base + offset;
-                }
+                m_taskCond.wait(lock);
             }
 
-            // Process the task
-            processTask(task_mem, mappedAddressList);
-            NvDlaDebugPrintf("Work Done\n");
+            if (m_taskHead == m_taskTail)
+            {
+                NvDlaDebugPrintf("Shutdown signal received, exiting\n");
+                break;
+            }
 
-            m_taskQueue.pop();
-            continue;
+            task_mem = m_taskRing[m_taskTail % TASK_RING_SIZE];
         }
 
-        if (m_signalShutdown)
+        NvDlaDebugPrintf("Work Found!\n");
+
+        EMUTaskDescAccessor task_desc = m_emu_if.taskDescAccessor(task_mem);
+
+        NvU32 numAddresses = *task_desc.numAddresses();
+        growPool(m_addressList, numAddresses);
+
+        // Replace all mem handles with mapped addresses
+        for (NvU32 ii=0; ii<numAddresses; ii++)
         {
-            NvDlaDebugPrintf("Shutdown signal received, exiting\n");
-            break;
+            void* base = *((void **)task_desc.addressList(ii).hMem());
+            NvU32 offset = *task_desc.addressList(ii).offset();
+
+            if (base == 0) {
+                m_addressList[ii] = NULL;
+            }
+            else {
+                m_addressList[ii] = (NvU8*)base + offset;
+            }
         }
 
-        if (m_taskQueue.empty())
+        // Process the task
+        bool processed = processTask(task_mem, numAddresses ? &m_addressList[0] : NULL);
+        NvDlaDebugPrintf("Work Done\n");
+
         {
-            NvDlaSleepMS(500);
+            std::lock_guard<std::mutex> lock(m_taskMutex);
+            if (!processed && m_taskError == NvDlaSuccess)
+                m_taskError = NvDlaError_InvalidState;
+            m_taskTail++;
         }
+        m_taskDoneCond.notify_all();
     }
 
-    // Cleanup
-    while (!m_taskQueue.empty())
-    {
-        m_taskQueue.pop();
-    }
-
-    delete emu_if;
     m_threadActive = false;
     m_signalShutdown = false;
 
     return ok;
 }
 
-bool Emulator::processTask(NvU8* task_mem, std::vector<NvU8*> addressList)
+static inline EMUBufferDescAccessor opSrc(EMUOperationBufferContainerAccessor bufs, EMUOpType type, NvU16 op)
 {
-    EMUInterface* emu_if = new EMUInterfaceA();
-    EMUTaskDescAccessor task_desc = emu_if->taskDescAccessor(task_mem);
+    switch (type)
+    {
+    case EMUOpType::SOFTMAX: return bufs.softmaxBufferDescsAccessor(op).srcDataAccessor();
+    case EMUOpType::LOG:     return bufs.logBufferDescsAccessor(op).srcDataAccessor();
+    case EMUOpType::TOPK:    return bufs.topKBufferDescsAccessor(op).srcDataAccessor();
+    default:                 return bufs.powerBufferDescsAccessor(op).srcDataAccessor();
+    }
+}
+
+static inline EMUBufferDescAccessor opDst(EMUOperationBufferContainerAccessor bufs, EMUOpType type, NvU16 op)
+{
+    switch (type)
+    {
+    case EMUOpType::SOFTMAX: return bufs.softmaxBufferDescsAccessor(op).dstDataAccessor();
+    case EMUOpType::LOG:     return bufs.logBufferDescsAccessor(op).dstDataAccessor();
+    case EMUOpType::TOPK:    return bufs.topKBufferDescsAccessor(op).dstDataAccessor();
+    default:                 return bufs.powerBufferDescsAccessor(op).dstDataAccessor();
+    }
+}
+
+static inline bool isElementwise(EMUOpType type)
+{
+    return type == EMUOpType::POWER || type == EMUOpType::LOG;
+}
+
+static inline bool sameFF16Cube(EMUBufferDescAccessor a, EMUBufferDescAccessor b)
+{
+    return *a.format() == (NvU16)EMUBufferType::DLA_FEATURE_FP16_FORMAT &&
+           *b.format() == (NvU16)EMUBufferType::DLA_FEATURE_FP16_FORMAT &&
+           *a.width() == *b.width() && *a.height() == *b.height() && *a.channel() == *b.channel();
+}
+
+bool Emulator::processTask(NvU8* task_mem, NvU8** addressList)
+{
+    EMUTaskDescAccessor task_desc = m_emu_if.taskDescAccessor(task_mem);
     NVDLA_UNUSED(task_desc);
 
+    if (!addressList)
+        return false;
+
     // 0 - network descriptor
-    EMUNetworkDescAccessor network_desc = emu_if->networkDescAccessor(addressList[0]);
+    EMUNetworkDescAccessor network_desc = m_emu_if.networkDescAccessor(addressList[0]);
+
+    EMUOperationContainerAccessor operation_container = m_emu_if.operationContainerAccessor(addressList[*network_desc.operationDescIndex()]);
+    EMUOperationBufferContainerAccessor operation_buffer_container = m_emu_if.operationBufferContainerAccessor(addressList[*network_desc.operationBufferDescIndex()]);
+    NvU16 numOps = *network_desc.numOperations();
+
+    growPool(m_opTypes, numOps);
+    growPool(m_opSrc, numOps);
+    growPool(m_opDst, numOps);
+    growPool(m_opProducer, numOps);
+    growPool(m_opOrder, numOps);
+    growPool(m_opDone, numOps);
+
+    for (NvU16 op = 0; op < numOps; op++)
+    {
+        m_opTypes[op] = (EMUOpType)*operation_container.softmaxOpDescAccessor(op).commonOpDescAccessor().op_type();
+        m_opSrc[op] = *opSrc(operation_buffer_container, m_opTypes[op], op).addressIndex();
+        m_opDst[op] = *opDst(operation_buffer_container, m_opTypes[op], op).addressIndex();
+        m_opDone[op] = 0;
+    }
+
+    //
+    // dependency order: an op runs after the op producing its source.  the
+    // producer is the closest earlier op writing that address, or failing
+    // that a later one (ops listed out of order).  ties keep list order.
+    //
+    for (NvU16 op = 0; op < numOps; op++)
+    {
+        m_opProducer[op] = -1;
+        for (NvS32 p = NvS32(op) - 1; p >= 0 && m_opProducer[op] < 0; p--)
+        {
+            if (m_opDst[p] == m_opSrc[op])
+                m_opProducer[op] = p;
+        }
+        for (NvU16 p = op + 1; p < numOps && m_opProducer[op] < 0; p++)
+        {
+            if (m_opDst[p] == m_opSrc[op])
+                m_opProducer[op] = p;
+        }
+    }
 
-    EMUOperationContainerAccessor operation_container_0 = emu_if->operationContainerAccessor(addressList[*network_desc.operationDescIndex()]);
-    EMUOperationBufferContainerAccessor operation_buffer_container_0 = emu_if->operationBufferContainerAccessor(addressList[*network_desc.operationBufferDescIndex()]);
-    EMUCommonOpDescAccessor common_op_desc_0 = operation_container_0.softmaxOpDescAccessor(0).commonOpDescAccessor();
+    NvU16 numOrdered = 0;
+    while (numOrdered < numOps)
+    {
+        NvU16 before = numOrdered;
+        for (NvU16 op = 0; op < numOps; op++)
+        {
+            if (!m_opDone[op] && (m_opProducer[op] < 0 || m_opDone[m_opProducer[op]]))
+            {
+                m_opOrder[numOrdered++] = op;
+                m_opDone[op] = 1;
+                break;
+            }
+        }
+        if (numOrdered == before)
+        {
+            // cycle, run whatever is left in list order
+            for (NvU16 op = 0; op < numOps; op++)
+            {
+                if (!m_opDone[op])
+                {
+                    m_opOrder[numOrdered++] = op;
+                    m_opDone[op] = 1;
+                }
+            }
+        }
+    }
 
-    EMUOpType opType = (EMUOpType)*common_op_desc_0.op_type();
-    if (opType == EMUOpType::POWER)
+    //
+    // fuse elementwise chains (power, log), optionally closed by a softmax,
+    // when each intermediate is read only by the next op of the chain.  other
+    // tasks may still read an intermediate, so fusion saves the re-reads and
+    // extra sweeps but not the stores.
+    //
+    for (NvU16 pos = 0; pos < numOps; )
     {
-        EMUPowerOpDescAccessor power_op_desc = operation_container_0.powerOpDescAccessor(0);
-        EMUPowerBufferDescsAccessor power_op_buffer_descs = operation_buffer_container_0.powerBufferDescsAccessor(0);
+        NvU16 op = m_opOrder[pos];
+        NvU16 chain[MAX_FUSED_OPS];
+        NvU32 chainLength = 1;
+        bool ok = false;
+        chain[0] = op;
+
+        if (isElementwise(m_opTypes[op]) &&
+            sameFF16Cube(opSrc(operation_buffer_container, m_opTypes[op], op), opDst(operation_buffer_container, m_opTypes[op], op)))
+        {
+            EMUBufferDescAccessor head = opSrc(operation_buffer_container, m_opTypes[op], op);
+            while (pos + chainLength < numOps && chainLength < MAX_FUSED_OPS)
+            {
+                NvU16 last = chain[chainLength - 1];
+                NvU16 next = m_opOrder[pos + chainLength];
+                NvU32 readers = 0;
 
-        executePower(power_op_desc, power_op_buffer_descs, addressList);
+                for (NvU16 other = 0; other < numOps; other++)
+                {
+                    readers += (m_opSrc[other] == m_opDst[last]) ? 1 : 0;
+                }
 
-    } else if (opType == EMUOpType::SOFTMAX) {
-        EMUSoftmaxOpDescAccessor softmax_op_desc = operation_container_0.softmaxOpDescAccessor(0);
-        EMUSoftmaxBufferDescsAccessor softmax_op_buffer_descs = operation_buffer_container_0.softmaxBufferDescsAccessor(0);
+                if (!isElementwise(m_opTypes[last]) ||
+                    m_opSrc[next] != m_opDst[last] || readers != 1 ||
+                    m_opDst[last] == m_opSrc[op])
+                    break;
+                if (!isElementwise(m_opTypes[next]) && m_opTypes[next] != EMUOpType::SOFTMAX)
+                    break;
+                if (!sameFF16Cube(head, opSrc(operation_buffer_container, m_opTypes[next], next)) ||
+                    !sameFF16Cube(head, opDst(operation_buffer_container, m_opTypes[next], next)))
+                    break;
+
+                chain[chainLength++] = next;
+            }
+        }
 
-        executeSoftmax(softmax_op_desc, softmax_op_buffer_descs, addressList);
+        if (chainLength > 1)
+        {
+            ok = executeFused(operation_container, operation_buffer_container, chain, chainLength, addressList);
+        }
+        else if (m_opTypes[op] == EMUOpType::POWER)
+        {
+            ok = executePower(operation_container.powerOpDescAccessor(op), operation_buffer_container.powerBufferDescsAccessor(op), addressList);
+        }
+        else if (m_opTypes[op] == EMUOpType::SOFTMAX)
+        {
+            ok = executeSoftmax(operation_container.softmaxOpDescAccessor(op), operation_buffer_container.softmaxBufferDescsAccessor(op), addressList);
+        }
+        else if (m_opTypes[op] == EMUOpType::LOG)
+        {
+            ok = executeLog(operation_container.logOpDescAccessor(op), operation_buffer_container.logBufferDescsAccessor(op), addressList);
+        }
+        else if (m_opTypes[op] == EMUOpType::TOPK)
+        {
+            EMUTopKBufferDescsAccessor topk_op_buffer_descs = operation_buffer_container.topKBufferDescsAccessor(op);
+            EMUTopKResultAccessor topk_result = m_emu_if.topKResultAccessor(addressList[*topk_op_buffer_descs.dstDataAccessor().addressIndex()]);
 
-    } else if (opType == EMUOpType::LOG) {
-        EMULogOpDescAccessor log_op_desc = operation_container_0.logOpDescAccessor(0);
-        EMULogBufferDescsAccessor log_op_buffer_descs = operation_buffer_container_0.logBufferDescsAccessor(0);
+            ok = executeTopK(operation_container.topKOpDescAccessor(op), topk_op_buffer_descs, topk_result, addressList);
+        }
+        else
+        {
+            NvDlaDebugPrintf("Unknown op type %u\n", (NvU32)m_opTypes[op]);
+        }
 
-        executeLog(log_op_desc, log_op_buffer_descs, addressList);
+        // later ops would consume what this one failed to write
+        if (!ok)
+        {
+            NvDlaDebugPrintf("Op %u failed, abandoning task\n", NvU32(op));
+            return false;
+        }
 
-    } else {
-        NvDlaDebugPrintf("Unknown op type %u\n", *common_op_desc_0.op_type());
+        pos += chainLength;
     }
 
-    delete emu_if;
-
     return true;
 }
 
 NvDlaError Emulator::getAddrOffset(EMUBufferDescAccessor in, NvU32 w, NvU32 h, NvU32 c, NvU32* offset)
 {
     NvDlaError e = NvDlaSuccess;
+    NvU8 bpe;
+    NvU32 x;
+
+    switch ((EMUBufferType)*in.format())
+    {
+    case EMUBufferType::DLA_FEATURE_INT8_FORMAT:
+        bpe = 1;
+        x = 32;
+        break;
+    case EMUBufferType::DLA_FEATURE_INT16_FORMAT:
+    case EMUBufferType::DLA_FEATURE_FP16_FORMAT:
+        bpe = 2;
+        x = 16;
+        break;
+    default:
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter);
+    }
 
-    if ((*in.format()) == 2/*NVDLA_FF16_F_FORMAT*/)
     {
-        NvU8 bpe = 2;
-        NvU32 x = 16;
         NvU32 xStride = x * bpe;
         NvU32 cquotient = c / x;
         NvU32 cremainder = c % x;
 
         *offset = (cquotient * (*in.surfStride())) + (h * (*in.lineStride())) + (w * xStride) + (cremainder * bpe);
-    } else {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter);
     }
 
     return NvDlaSuccess;
@@ -238,7 +638,7 @@ fail:
     return e;
 }
 
-bool Emulator::executePower(EMUPowerOpDescAccessor opDesc, EMUPowerBufferDescsAccessor bufDescs, std::vector<NvU8*> addressList)
+bool Emulator::executePower(EMUPowerOpDescAccessor opDesc, EMUPowerBufferDescsAccessor bufDescs, NvU8** addressList)
 {
 
     EMUBufferDescAccessor src = bufDescs.srcDataAccessor();
@@ -255,39 +655,164 @@ bool Emulator::executePower(EMUPowerOpDescAccessor opDesc, EMUPowerBufferDescsAc
         NvDlaDebugPrintf("\taddress[%u] 0x%llx (%ux%ux%u) %uB\n", *dst.addressIndex(), addressList[*dst.addressIndex()], *dst.width(), *dst.height(), *dst.channel(), *dst.size());
         NvDlaDebugPrintf("\tline_stride %uB surface_stride %uB\n", *dst.lineStride(), *dst.surfStride());
     }
-    NvU8* pSrc = addressList[*src.addressIndex()];
-    NvU8* pDst = addressList[*dst.addressIndex()];
 
-    // Execute
-    for (NvU32 channel=0; channel<*src.channel(); channel++)
+    ElementwiseStage stage;
+    stage.type = EMUOpType::POWER;
+    stage.power = *opDesc.power();
+    stage.scale = *opDesc.scale();
+    stage.shift = *opDesc.shift();
+    stage.out = NULL;
+
+    if ((EMUBufferType)*src.format() != EMUBufferType::DLA_FEATURE_FP16_FORMAT)
+        return runLookup(src, dst, stage, addressList);
+
+    return runElementwise(src, dst, &stage, 1, addressList);
+}
+
+
+//
+// softmax is computed along one axis of a CxHWx16 fp16 feature surface.
+// every other coordinate indexes an independent row, rows are split over
+// the worker threads.
+//
+enum SoftmaxAxis
+{
+    SOFTMAX_AXIS_C = 0,
+    SOFTMAX_AXIS_H = 1,
+    SOFTMAX_AXIS_W = 2,
+};
+
+struct SoftmaxJob
+{
+    const NvU8* src;
+    NvU8* dst;
+    NvU32 srcLineStride;
+    NvU32 srcSurfStride;
+    NvU32 dstLineStride;
+    NvU32 dstSurfStride;
+    NvU32 width;
+    NvU32 height;
+    NvU32 channel;
+    SoftmaxAxis axis;
+    NvU32 axisLength;
+    const Emulator::ElementwiseStage* prologue;
+    NvU32 numPrologue;
+    NvF32* scratch[8];
+};
+
+static inline NvF32 applyStages(const Emulator::ElementwiseStage* stages, NvU32 numStages, NvF32 x)
+{
+    for (NvU32 ii = 0; ii < numStages; ii++)
+    {
+        if (stages[ii].type == EMUOpType::POWER)
+            x = powf(stages[ii].shift + stages[ii].scale * x, stages[ii].power);
+        else
+            x = logf(x);
+    }
+    return x;
+}
+
+static inline NvU32 ff16Offset(NvU32 w, NvU32 h, NvU32 c, NvU32 lineStride, NvU32 surfStride)
+{
+    return ((c >> 4) * surfStride) + (h * lineStride) + (w << 5) + ((c & 15) << 1);
+}
+
+// applyStages() for the element at (w, h, c), storing the stages which have an output
+static inline NvF32 applyStagesAt(const Emulator::ElementwiseStage* stages, NvU32 numStages, NvF32 x,
+                                  NvU32 w, NvU32 h, NvU32 c)
+{
+    for (NvU32 ii = 0; ii < numStages; ii++)
     {
-        for (NvU32 height=0; height<*src.height(); height++)
+        x = applyStages(&stages[ii], 1, x);
+        if (stages[ii].out)
         {
-            for (NvU32 width=0; width<*src.width(); width++)
-            {
-                NvU32 srcoffset = 0;
-                NvU32 dstoffset = 0;
-                if (getAddrOffset(src, width, height, channel, &srcoffset) != NvDlaSuccess)
-                    return false;
-                if (getAddrOffset(dst, width, height, channel, &dstoffset) != NvDlaSuccess)
-                    return false;
-
-                half_float::half* srchalfp = reinterpret_cast<half_float::half*>(pSrc + srcoffset);
-                half_float::half* dsthalfp = reinterpret_cast<half_float::half*>(pDst + dstoffset);
-
-                NvF32 x = float(*srchalfp);
-                NvF32 y = powf((*opDesc.shift() + (*opDesc.scale() * x)), *opDesc.power());
-                *dsthalfp = half(y);
-            }
+            NvU8* p = stages[ii].out + ff16Offset(w, h, c, stages[ii].outLineStride, stages[ii].outSurfStride);
+            *reinterpret_cast<half*>(p) = half(x);
         }
     }
+    return x;
+}
 
+static void softmaxRows(void* ctx, NvU32 begin, NvU32 end, NvU32 slot)
+{
+    const SoftmaxJob* job = static_cast<const SoftmaxJob*>(ctx);
+    NvF32* scratch = job->scratch[slot];
+    NvU32 n = job->axisLength;
+    NvU32 nv = roundUp4(n);
 
-    return true;
-}
+    for (NvU32 row = begin; row < end; row++)
+    {
+        NvU32 w = 0, h = 0, c = 0;
+        NvU32 srcStep, dstStep;
+        const NvU8* src;
+        NvU8* dst;
+
+        switch (job->axis)
+        {
+        case SOFTMAX_AXIS_H:
+            w = row % job->width;
+            c = row / job->width;
+            srcStep = job->srcLineStride;
+            dstStep = job->dstLineStride;
+            break;
+        case SOFTMAX_AXIS_W:
+            h = row % job->height;
+            c = row / job->height;
+            srcStep = 32;
+            dstStep = 32;
+            break;
+        default:
+            w = row % job->width;
+            h = row / job->width;
+            srcStep = 0;
+            dstStep = 0;
+            break;
+        }
+
+        src = job->src + ff16Offset(w, h, c, job->srcLineStride, job->srcSurfStride);
+        dst = job->dst + ff16Offset(w, h, c, job->dstLineStride, job->dstSurfStride);
+
+        // gather the row to fp32, tracking the max on the way
+        NvF32 maxval = -INFINITY;
+        for (NvU32 ii = 0; ii < n; ii++)
+        {
+            const NvU8* p = srcStep ? src + ii * srcStep :
+                            src + ff16Offset(0, 0, ii, 0, job->srcSurfStride);
+            NvU32 iw = (job->axis == SOFTMAX_AXIS_W) ? ii : w;
+            NvU32 ih = (job->axis == SOFTMAX_AXIS_H) ? ii : h;
+            NvU32 ic = (job->axis == SOFTMAX_AXIS_C) ? ii : c;
+            NvF32 x = applyStagesAt(job->prologue, job->numPrologue, float(*reinterpret_cast<const half*>(p)), iw, ih, ic);
+            scratch[ii] = x;
+            maxval = x > maxval ? x : maxval;
+        }
+        for (NvU32 ii = n; ii < nv; ii++)
+        {
+            scratch[ii] = -INFINITY;
+        }
 
+        // one exponential per element, 4 lanes at a time
+        EmuF32x4 vmax = splatF32x4(maxval);
+        EmuF32x4 vsum = splatF32x4(0.0f);
+        for (NvU32 ii = 0; ii < nv; ii += 4)
+        {
+            EmuF32x4 x;
+            std::memcpy(&x, &scratch[ii], sizeof(x));
+            x = expF32x4(x - vmax);
+            std::memcpy(&scratch[ii], &x, sizeof(x));
+            vsum += x;
+        }
+        NvF32 inv = 1.0f / (vsum[0] + vsum[1] + vsum[2] + vsum[3]);
 
-bool Emulator::executeSoftmax(EMUSoftmaxOpDescAccessor opDesc, EMUSoftmaxBufferDescsAccessor bufDescs, std::vector<NvU8*> addressList)
+        for (NvU32 ii = 0; ii < n; ii++)
+        {
+            NvU8* p = dstStep ? dst + ii * dstStep :
+                      dst + ff16Offset(0, 0, ii, 0, job->dstSurfStride);
+            *reinterpret_cast<half*>(p) = half(scratch[ii] * inv);
+        }
+    }
+}
+
+bool Emulator::executeSoftmax(EMUSoftmaxOpDescAccessor opDesc, EMUSoftmaxBufferDescsAccessor bufDescs, NvU8** addressList)
 {
     EMUBufferDescAccessor src = bufDescs.srcDataAccessor();
     EMUBufferDescAccessor dst = bufDescs.dstDataAccessor();
@@ -304,32 +829,226 @@ bool Emulator::executeSoftmax(EMUSoftmaxOpDescAccessor opDesc, EMUSoftmaxBufferD
         NvDlaDebugPrintf("\tline_stride %uB surface_stride %uB\n", *dst.lineStride(), *dst.surfStride());
     }
 
-    half* pSrc = reinterpret_cast<half*>(addressList[*src.addressIndex()]);
-    half* pDst = reinterpret_cast<half*>(addressList[*dst.addressIndex()]);
+    return runSoftmax(src, dst, *opDesc.axis(), NULL, 0, addressList) == NvDlaSuccess;
+}
 
-    NvF32 maxval = -INFINITY;
-    for (NvU32 ii=0; ii<*src.channel(); ii++)
+NvDlaError Emulator::runSoftmax(EMUBufferDescAccessor src, EMUBufferDescAccessor dst, NvU8 axis,
+                                const ElementwiseStage* prologue, NvU32 numPrologue,
+                                NvU8** addressList)
+{
+    NvDlaError e = NvDlaSuccess;
+    SoftmaxJob job;
+    NvU32 numRows = 0;
+
+    if ((EMUBufferType)*src.format() != EMUBufferType::DLA_FEATURE_FP16_FORMAT ||
+        (EMUBufferType)*dst.format() != EMUBufferType::DLA_FEATURE_FP16_FORMAT)
     {
-        if (float(pSrc[ii]) > maxval)
+        ORIGINATE_ERROR_FAIL(NvDlaError_NotSupported, "softmax: unsupported format %u -> %u", *src.format(), *dst.format());
+    }
+
+    // a feature surface is NCHW with N == 1, softmax runs along C, H or W
+    if (axis >= SOFTMAX_SURFACE_DIMS)
+    {
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "softmax: axis %u out of range for %u dims", axis, SOFTMAX_SURFACE_DIMS);
+    }
+
+    job.src = addressList[*src.addressIndex()];
+    job.dst = addressList[*dst.addressIndex()];
+    job.srcLineStride = *src.lineStride();
+    job.srcSurfStride = *src.surfStride();
+    job.dstLineStride = *dst.lineStride();
+    job.dstSurfStride = *dst.surfStride();
+    job.width = *src.width();
+    job.height = *src.height();
+    job.channel = *src.channel();
+    job.prologue = prologue;
+    job.numPrologue = numPrologue;
+
+    if (!job.src || !job.dst)
+    {
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "softmax: unmapped buffer");
+    }
+
+    // axis follows NCHW numbering: 1 = C, 2 = H, 3 = W.  axis 0 is what
+    // loadables written before the axis was honoured carry, and those always
+    // ran along C
+    switch (axis)
+    {
+    case 0:
+    case 1:
+        job.axis = SOFTMAX_AXIS_C;
+        job.axisLength = job.channel;
+        numRows = job.width * job.height;
+        break;
+    case 2:
+        job.axis = SOFTMAX_AXIS_H;
+        job.axisLength = job.height;
+        numRows = job.width * job.channel;
+        break;
+    case 3:
+        job.axis = SOFTMAX_AXIS_W;
+        job.axisLength = job.width;
+        numRows = job.height * job.channel;
+        break;
+    default:
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "softmax: unsupported axis %u", axis);
+    }
+
+    if (job.axisLength != 0 && numRows != 0)
+    {
+        for (NvU32 slot = 0; slot <= m_numWorkers; slot++)
         {
-            maxval = float(pSrc[ii]);
+            job.scratch[slot] = rowScratch(slot, roundUp4(job.axisLength));
         }
+
+        // only fan out when each chunk has enough work to pay for the wakeup
+        NvU32 minRows = 1 + (16384 / job.axisLength);
+        parallelFor(numRows, minRows, softmaxRows, &job);
     }
-    NvF32 sumexp = 0.0f;
-    for (NvU32 ii=0; ii<*src.channel(); ii++)
+
+fail:
+    return e;
+}
+
+
+//
+// elementwise chains walk the cube one (c, h) line at a time, fp16 in and
+// out, with every stage applied in registers.
+//
+struct ElementwiseJob
+{
+    const NvU8* src;
+    NvU8* dst;
+    NvU32 srcLineStride;
+    NvU32 srcSurfStride;
+    NvU32 dstLineStride;
+    NvU32 dstSurfStride;
+    NvU32 width;
+    NvU32 height;
+    const Emulator::ElementwiseStage* stages;
+    NvU32 numStages;
+};
+
+static void elementwiseRows(void* ctx, NvU32 begin, NvU32 end, NvU32 /*slot*/)
+{
+    const ElementwiseJob* job = static_cast<const ElementwiseJob*>(ctx);
+
+    for (NvU32 row = begin; row < end; row++)
     {
-        sumexp += expf(float(pSrc[ii])-maxval);
+        NvU32 h = row % job->height;
+        NvU32 c = row / job->height;
+        const NvU8* src = job->src + ff16Offset(0, h, c, job->srcLineStride, job->srcSurfStride);
+        NvU8* dst = job->dst + ff16Offset(0, h, c, job->dstLineStride, job->dstSurfStride);
+
+        for (NvU32 w = 0; w < job->width; w++)
+        {
+            NvF32 x = float(*reinterpret_cast<const half*>(src + (w << 5)));
+            *reinterpret_cast<half*>(dst + (w << 5)) = half(applyStagesAt(job->stages, job->numStages, x, w, h, c));
+        }
     }
-    for (NvU32 ii=0; ii<*src.channel(); ii++)
+}
+
+bool Emulator::runElementwise(EMUBufferDescAccessor src, EMUBufferDescAccessor dst,
+                              const ElementwiseStage* stages, NvU32 numStages,
+                              NvU8** addressList)
+{
+    if ((EMUBufferType)*src.format() != EMUBufferType::DLA_FEATURE_FP16_FORMAT ||
+        (EMUBufferType)*dst.format() != EMUBufferType::DLA_FEATURE_FP16_FORMAT)
     {
-        pDst[ii] = expf(float(pSrc[ii])-maxval) / sumexp;
+        return false;
     }
 
+    ElementwiseJob job;
+    job.src = addressList[*src.addressIndex()];
+    job.dst = addressList[*dst.addressIndex()];
+    job.srcLineStride = *src.lineStride();
+    job.srcSurfStride = *src.surfStride();
+    job.dstLineStride = *dst.lineStride();
+    job.dstSurfStride = *dst.surfStride();
+    job.width = *src.width();
+    job.height = *src.height();
+    job.stages = stages;
+    job.numStages = numStages;
+
+    if (!job.src || !job.dst)
+        return false;
+
+    NvU32 numRows = job.height * *src.channel();
+    if (numRows == 0 || job.width == 0)
+        return true;
+
+    parallelFor(numRows, 1 + (4096 / job.width), elementwiseRows, &job);
+
     return true;
 }
 
+//
+// run a chain found by processTask() as a single sweep.  only the source of
+// the first op is read, intermediates are computed in registers and stored
+// on the way since a DLA task or another EMU task may consume them.
+//
+bool Emulator::executeFused(EMUOperationContainerAccessor ops, EMUOperationBufferContainerAccessor bufs,
+                            const NvU16* chain, NvU32 chainLength, NvU8** addressList)
+{
+    ElementwiseStage stages[MAX_FUSED_OPS];
+    NvU32 numStages = 0;
+    NvU16 first = chain[0];
+    NvU16 last = chain[chainLength - 1];
+    EMUOpType firstType = (EMUOpType)*ops.softmaxOpDescAccessor(first).commonOpDescAccessor().op_type();
+    EMUOpType lastType = (EMUOpType)*ops.softmaxOpDescAccessor(last).commonOpDescAccessor().op_type();
+    EMUBufferDescAccessor src = (firstType == EMUOpType::LOG) ? bufs.logBufferDescsAccessor(first).srcDataAccessor() :
+                                                                bufs.powerBufferDescsAccessor(first).srcDataAccessor();
+
+    for (NvU32 ii = 0; ii < chainLength && ii < MAX_FUSED_OPS; ii++)
+    {
+        EMUOpType type = (EMUOpType)*ops.softmaxOpDescAccessor(chain[ii]).commonOpDescAccessor().op_type();
+        if (type == EMUOpType::SOFTMAX)
+            break;
+
+        ElementwiseStage stage;
+        stage.type = type;
+        stage.power = 1.0f;
+        stage.scale = 1.0f;
+        stage.shift = 0.0f;
+        if (type == EMUOpType::POWER)
+        {
+            EMUPowerOpDescAccessor power = ops.powerOpDescAccessor(chain[ii]);
+            stage.power = *power.power();
+            stage.scale = *power.scale();
+            stage.shift = *power.shift();
+        }
+
+        // the intermediate may be read by a later task, keep storing it
+        stage.out = NULL;
+        if (ii + 1 < chainLength)
+        {
+            EMUBufferDescAccessor out = (type == EMUOpType::LOG) ? bufs.logBufferDescsAccessor(chain[ii]).dstDataAccessor() :
+                                                                   bufs.powerBufferDescsAccessor(chain[ii]).dstDataAccessor();
+            stage.out = addressList[*out.addressIndex()];
+            stage.outLineStride = *out.lineStride();
+            stage.outSurfStride = *out.surfStride();
+        }
+        stages[numStages++] = stage;
+    }
 
-bool Emulator::executeLog(EMULogOpDescAccessor opDesc, EMULogBufferDescsAccessor bufDescs, std::vector<NvU8*> addressList)
+    if ( debugOps() )
+    {
+        NvDlaDebugPrintf("Processing fused chain of %u ops [%u..%u]\n", chainLength, first, last);
+    }
+
+    if (lastType == EMUOpType::SOFTMAX)
+    {
+        EMUSoftmaxBufferDescsAccessor softmax = bufs.softmaxBufferDescsAccessor(last);
+        return runSoftmax(src, softmax.dstDataAccessor(), *ops.softmaxOpDescAccessor(last).axis(),
+                          stages, numStages, addressList) == NvDlaSuccess;
+    }
+
+    EMUBufferDescAccessor dst = (lastType == EMUOpType::LOG) ? bufs.logBufferDescsAccessor(last).dstDataAccessor() :
+                                                               bufs.powerBufferDescsAccessor(last).dstDataAccessor();
+    return runElementwise(src, dst, stages, numStages, addressList);
+}
+
+bool Emulator::executeLog(EMULogOpDescAccessor opDesc, EMULogBufferDescsAccessor bufDescs, NvU8** addressList)
 {
     EMUBufferDescAccessor src = bufDescs.srcDataAccessor();
     EMUBufferDescAccessor dst = bufDescs.dstDataAccessor();
@@ -346,56 +1065,331 @@ bool Emulator::executeLog(EMULogOpDescAccessor opDesc, EMULogBufferDescsAccessor
         NvDlaDebugPrintf("\tline_stride %uB surface_stride %uB\n", *dst.lineStride(), *dst.surfStride());
     }
 
-    NvU8* pSrc = addressList[*src.addressIndex()];
-    NvU8* pDst = addressList[*dst.addressIndex()];
+    ElementwiseStage stage;
+    stage.type = EMUOpType::LOG;
+    stage.power = 1.0f;
+    stage.scale = 1.0f;
+    stage.shift = 0.0f;
+    stage.out = NULL;
+
+    if ((EMUBufferType)*src.format() != EMUBufferType::DLA_FEATURE_FP16_FORMAT)
+        return runLookup(src, dst, stage, addressList);
+
+    return runElementwise(src, dst, &stage, 1, addressList);
+}
+
+//
+// integer feature formats have at most 64K distinct inputs, so power and
+// log are tabulated once per (op, parameters, format) and kept for the
+// lifetime of the emulator.  results are rounded to nearest and saturated,
+// NaN maps to 0.
+//
+bool Emulator::LookupKey::operator<(const LookupKey& o) const
+{
+    if (type != o.type)     return type < o.type;
+    if (format != o.format) return format < o.format;
+    if (power != o.power)   return power < o.power;
+    if (scale != o.scale)   return scale < o.scale;
+    return shift < o.shift;
+}
+
+static inline NvU32 floatBits(NvF32 f)
+{
+    NvU32 u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline NvS32 saturate(NvF32 y, NvS32 lo, NvS32 hi)
+{
+    if (y != y)
+        return 0;
+    y = rintf(y);
+    if (y <= NvF32(lo))
+        return lo;
+    if (y >= NvF32(hi))
+        return hi;
+    return NvS32(y);
+}
+
+// only int8 and int16 surfaces are looked up, the caller checks the format
+const NvU8* Emulator::lookupTable(const ElementwiseStage& stage, NvU16 format)
+{
+    LookupKey key;
+    key.type = (NvU8)stage.type;
+    key.format = format;
+    key.power = floatBits(stage.power);
+    key.scale = floatBits(stage.scale);
+    key.shift = floatBits(stage.shift);
+
+    std::map<LookupKey, std::vector<NvU8> >::iterator it = m_lookupTables.find(key);
+    if (it != m_lookupTables.end())
+        return &it->second[0];
+
+    std::vector<NvU8>& table = m_lookupTables[key];
+    m_numAllocations++;
+    if (format == (NvU16)EMUBufferType::DLA_FEATURE_INT8_FORMAT)
+    {
+        table.resize(256);
+        for (NvU32 ii = 0; ii < 256; ii++)
+        {
+            NvF32 y = applyStages(&stage, 1, NvF32(NvS8(ii)));
+            table[ii] = NvU8(NvS8(saturate(y, -128, 127)));
+        }
+    }
+    else
+    {
+        table.resize(65536 * sizeof(NvS16));
+        NvS16* table16 = reinterpret_cast<NvS16*>(&table[0]);
+        for (NvU32 ii = 0; ii < 65536; ii++)
+        {
+            NvF32 y = applyStages(&stage, 1, NvF32(NvS16(ii)));
+            table16[ii] = NvS16(saturate(y, -32768, 32767));
+        }
+    }
+
+    return &table[0];
+}
+
+struct LookupJob
+{
+    const NvU8* src;
+    NvU8* dst;
+    NvU32 srcLineStride;
+    NvU32 srcSurfStride;
+    NvU32 dstLineStride;
+    NvU32 dstSurfStride;
+    NvU32 width;
+    NvU32 height;
+    bool int8;
+    const NvU8* table;
+};
+
+//
+// the lookup stays scalar: a table lookup is a gather, which SSE2 and NEON
+// lack and AVX2 only has for 32-bit lanes where it is no faster than scalar
+// loads, and one row reads a single element per atom so there is no run of
+// contiguous elements to load as a vector.  the int8 table sits in L1 and
+// the int16 one in L2, the loop is bound by those loads.
+//
+static void lookupRows(void* ctx, NvU32 begin, NvU32 end, NvU32 /*slot*/)
+{
+    const LookupJob* job = static_cast<const LookupJob*>(ctx);
+    NvU32 atom = job->int8 ? 32 : 16;
+    NvU32 bpe = job->int8 ? 1 : 2;
+    NvU32 step = atom * bpe;
+
+    for (NvU32 row = begin; row < end; row++)
+    {
+        NvU32 h = row % job->height;
+        NvU32 c = row / job->height;
+        const NvU8* src = job->src + (c / atom) * job->srcSurfStride + h * job->srcLineStride + (c % atom) * bpe;
+        NvU8* dst = job->dst + (c / atom) * job->dstSurfStride + h * job->dstLineStride + (c % atom) * bpe;
+
+        if (job->int8)
+        {
+            for (NvU32 w = 0; w < job->width; w++)
+                dst[w * step] = job->table[src[w * step]];
+        }
+        else
+        {
+            const NvS16* table16 = reinterpret_cast<const NvS16*>(job->table);
+            for (NvU32 w = 0; w < job->width; w++)
+                *reinterpret_cast<NvS16*>(dst + w * step) = table16[*reinterpret_cast<const NvU16*>(src + w * step)];
+        }
+    }
+}
+
+bool Emulator::runLookup(EMUBufferDescAccessor src, EMUBufferDescAccessor dst, const ElementwiseStage& stage,
+                         NvU8** addressList)
+{
+    NvU32 srcLast = 0;
+    NvU32 dstLast = 0;
+
+    if (*src.format() != (NvU16)EMUBufferType::DLA_FEATURE_INT8_FORMAT &&
+        *src.format() != (NvU16)EMUBufferType::DLA_FEATURE_INT16_FORMAT)
+        return false;
+
+    if (*src.format() != *dst.format() ||
+        *src.width() != *dst.width() || *src.height() != *dst.height() || *src.channel() != *dst.channel())
+        return false;
+
+    if (*src.width() == 0 || *src.height() == 0 || *src.channel() == 0)
+        return true;
+
+    // reject descriptors whose last element lies outside the buffer
+    if (getAddrOffset(src, *src.width() - 1, *src.height() - 1, *src.channel() - 1, &srcLast) != NvDlaSuccess ||
+        getAddrOffset(dst, *dst.width() - 1, *dst.height() - 1, *dst.channel() - 1, &dstLast) != NvDlaSuccess)
+        return false;
+    if (srcLast >= *src.size() || dstLast >= *dst.size())
+        return false;
+
+    LookupJob job;
+    job.src = addressList[*src.addressIndex()];
+    job.dst = addressList[*dst.addressIndex()];
+    job.srcLineStride = *src.lineStride();
+    job.srcSurfStride = *src.surfStride();
+    job.dstLineStride = *dst.lineStride();
+    job.dstSurfStride = *dst.surfStride();
+    job.width = *src.width();
+    job.height = *src.height();
+    job.int8 = (*src.format() == (NvU16)EMUBufferType::DLA_FEATURE_INT8_FORMAT);
+
+    if (!job.src || !job.dst)
+        return false;
+
+    // built once the op is known to run
+    job.table = lookupTable(stage, *src.format());
+
+    parallelFor(job.height * *src.channel(), 1 + (8192 / job.width), lookupRows, &job);
+
+    return true;
+}
+
+static inline NvF32 featureValue(const NvU8* p, NvU16 format)
+{
+    switch ((EMUBufferType)format)
+    {
+    case EMUBufferType::DLA_FEATURE_INT8_FORMAT:
+        return NvF32(*reinterpret_cast<const NvS8*>(p));
+    case EMUBufferType::DLA_FEATURE_INT16_FORMAT:
+        return NvF32(*reinterpret_cast<const NvS16*>(p));
+    default:
+        return float(*reinterpret_cast<const half*>(p));
+    }
+}
+
+NvDlaError Emulator::topK(const NvU8* src, NvU16 format,
+                          NvU32 width, NvU32 height, NvU32 channel,
+                          NvU32 lineStride, NvU32 surfStride,
+                          NvU32 k, NvU32* numOut, NvU32* index, NvF32* prob, NvF32* margin)
+{
+    NvDlaError e = NvDlaSuccess;
+    NvU32 atom = (format == (NvU16)EMUBufferType::DLA_FEATURE_INT8_FORMAT) ? 32 : 16;
+    NvU32 bpe = (format == (NvU16)EMUBufferType::DLA_FEATURE_INT8_FORMAT) ? 1 : 2;
+    NvU32 total = width * height * channel;
+    NvF32 best[TOPK_MAX];
+    NvU32 n = 0;
+
+    if (!src || !numOut || !index || !prob || !margin)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter);
+    if (format > (NvU16)EMUBufferType::DLA_FEATURE_FP16_FORMAT)
+        ORIGINATE_ERROR_FAIL(NvDlaError_NotSupported, "topk: unsupported format %u", format);
+
+    k = std::min(std::min(k, NvU32(TOPK_MAX)), total);
+    if (k == 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "topk: empty selection");
 
-    // Execute
-    for (NvU32 channel=0; channel<*src.channel(); channel++)
+    // pass 1: running max and a sorted top-k of the raw logits.  the order
+    // of the flattened index follows (c, h, w), same as NvDlaImage::to_float
+    for (NvU32 c = 0; c < channel; c++)
     {
-        for (NvU32 height=0; height<*src.height(); height++)
+        for (NvU32 h = 0; h < height; h++)
         {
-            for (NvU32 width=0; width<*src.width(); width++)
+            const NvU8* line = src + (c / atom) * surfStride + h * lineStride + (c % atom) * bpe;
+            for (NvU32 w = 0; w < width; w++)
             {
-                NvU32 srcoffset = 0;
-                NvU32 dstoffset = 0;
-                if (getAddrOffset(src, width, height, channel, &srcoffset) != NvDlaSuccess)
-                    return false;
-                if (getAddrOffset(dst, width, height, channel, &dstoffset) != NvDlaSuccess)
-                    return false;
-
-                EMUBufferType srcFormat = (EMUBufferType)*src.format();
-                EMUBufferType dstFormat = (EMUBufferType)*dst.format();
-                if (srcFormat == EMUBufferType::DLA_FEATURE_INT8_FORMAT &&
-                    dstFormat == EMUBufferType::DLA_FEATURE_INT8_FORMAT) {
-                    NvS8* srcint8 = reinterpret_cast<NvS8*>(pSrc + srcoffset);
-                    NvS8* dstint8 = reinterpret_cast<NvS8*>(pDst + dstoffset);
-
-                    NvF32 x = float(*srcint8);
-                    NvF32 y = rintf(logf(x));
-                    *dstint8 = (NvS8)y;
-                } else if (srcFormat == EMUBufferType::DLA_FEATURE_INT16_FORMAT &&
-                           dstFormat == EMUBufferType::DLA_FEATURE_INT16_FORMAT) {
-                    NvS16* srcint16 = reinterpret_cast<NvS16*>(pSrc + srcoffset);
-                    NvS16* dstint16 = reinterpret_cast<NvS16*>(pDst + dstoffset);
-
-                    NvF32 x = float(*srcint16);
-                    NvF32 y = rintf(logf(x));
-                    *dstint16 = (NvS16)y;
-                } else if (srcFormat == EMUBufferType::DLA_FEATURE_FP16_FORMAT &&
-                           dstFormat == EMUBufferType::DLA_FEATURE_FP16_FORMAT) {
-                    half_float::half* srchalfp = reinterpret_cast<half_float::half*>(pSrc + srcoffset);
-                    half_float::half* dsthalfp = reinterpret_cast<half_float::half*>(pDst + dstoffset);
-
-                    NvF32 x = float(*srchalfp);
-                    NvF32 y = logf(x);
-                    *dsthalfp = half(y);
-                } else {
-                    return false;
+                NvF32 x = featureValue(line + w * atom * bpe, format);
+                if (x != x)
+                    continue;
+
+                if (n < k || x > best[n - 1])
+                {
+                    NvU32 pos = (n < k) ? n++ : k - 1;
+                    while (pos > 0 && best[pos - 1] < x)
+                    {
+                        best[pos] = best[pos - 1];
+                        index[pos] = index[pos - 1];
+                        pos--;
+                    }
+                    best[pos] = x;
+                    index[pos] = (c * height + h) * width + w;
                 }
             }
         }
     }
 
+    if (n == 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadValue, "topk: no finite values");
+
+    {
+        // pass 2: softmax denominator, max comes from the top entry
+        EmuF32x4 vmax = splatF32x4(best[0]);
+        EmuF32x4 vsum = splatF32x4(0.0f);
+        EmuF32x4 lanes = splatF32x4(-INFINITY);
+        NvU32 fill = 0;
+
+        for (NvU32 c = 0; c < channel; c++)
+        {
+            for (NvU32 h = 0; h < height; h++)
+            {
+                const NvU8* line = src + (c / atom) * surfStride + h * lineStride + (c % atom) * bpe;
+                for (NvU32 w = 0; w < width; w++)
+                {
+                    NvF32 x = featureValue(line + w * atom * bpe, format);
+                    lanes[fill++] = (x != x) ? -INFINITY : x;
+                    if (fill == 4)
+                    {
+                        vsum += expF32x4(lanes - vmax);
+                        lanes = splatF32x4(-INFINITY);
+                        fill = 0;
+                    }
+                }
+            }
+        }
+        if (fill)
+            vsum += expF32x4(lanes - vmax);
+
+        NvF32 inv = 1.0f / (vsum[0] + vsum[1] + vsum[2] + vsum[3]);
+        for (NvU32 ii = 0; ii < n; ii++)
+        {
+            prob[ii] = std::exp(best[ii] - best[0]) * inv;
+        }
+    }
+
+    *numOut = n;
+    *margin = (n > 1) ? prob[0] - prob[1] : prob[0];
+
+fail:
+    return e;
+}
+
+bool Emulator::executeTopK(EMUTopKOpDescAccessor opDesc, EMUTopKBufferDescsAccessor bufDescs, EMUTopKResultAccessor result, NvU8** addressList)
+{
+    EMUBufferDescAccessor src = bufDescs.srcDataAccessor();
+    EMUBufferDescAccessor dst = bufDescs.dstDataAccessor();
+    NvU32 index[TOPK_MAX];
+    NvF32 prob[TOPK_MAX];
+    NvU32 n = 0;
+    NvF32 margin = 0.0f;
+
+    if ( debugOps() )
+    {
+        NvDlaDebugPrintf("Processing topk [k=%u]\n", *opDesc.k());
+        NvDlaDebugPrintf("src format %u\n", *src.format());
+        NvDlaDebugPrintf("\taddress[%u] 0x%llx (%ux%ux%u) %uB\n", *src.addressIndex(), addressList[*src.addressIndex()], *src.width(), *src.height(), *src.channel(), *src.size());
+        NvDlaDebugPrintf("\tline_stride %uB surface_stride %uB\n", *src.lineStride(), *src.surfStride());
+
+        NvDlaDebugPrintf("dst address[%u] 0x%llx %uB\n", *dst.addressIndex(), addressList[*dst.addressIndex()], *dst.size());
+    }
+
+    if (!addressList[*dst.addressIndex()] || *dst.size() < result.struct_size())
+        return false;
+
+    NvDlaError e = topK(addressList[*src.addressIndex()], *src.format(),
+                        *src.width(), *src.height(), *src.channel(),
+                        *src.lineStride(), *src.surfStride(),
+                        std::min(NvU32(*opDesc.k()), NvU32(result.maxK())), &n, index, prob, &margin);
+    if (e != NvDlaSuccess)
+        return false;
+
+    for (NvU32 ii = 0; ii < n; ii++)
+    {
+        *result.index(ii) = index[ii];
+        *result.prob(ii) = prob[ii];
+    }
+    *result.k() = n;
+    *result.margin() = margin;
 
     return true;
 }
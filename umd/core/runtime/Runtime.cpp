@@ -26,9 +26,11 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <chrono>
 #include <cstdio>
 #include <cstring>
 #include <sstream>
+#include <algorithm>
 #include <map>
 #include <list>
 
@@ -134,10 +136,24 @@ Runtime::Runtime() :
     IRuntime(),
     m_dla_handle(0),
     m_emu_engine(0),
+    m_emu_task_mem(0),
+    m_emu_task_mem_size(0),
+    m_emu_task_mem_count(0),
+    m_submit_allocations(0),
+    m_num_submits(0),
+    m_num_batch_elements(0),
+    m_num_emu_tasks(0),
+    m_last_submit_us(0),
+    m_last_wait_us(0),
     h_network_desc_mem(0),
     h_op_desc_mem(0),
     h_surf_desc_mem(0),
-    h_dependency_list_mem(0)
+    h_dependency_list_mem(0),
+    m_loadable_batch(1),
+    m_runs_packable(true),
+    m_dla_tasks(0),
+    m_dla_task_count(0),
+    m_dla_address_count(0)
 {
     m_dla_device_handles[0] = 0;
     m_dla_device_handles[1] = 0;
@@ -149,6 +165,9 @@ Runtime::~Runtime()
     // Close all device nodes
     NvDlaClose(m_dla_device_handles[0]);
     NvDlaClose(m_dla_device_handles[1]);
+
+    delete[] m_emu_task_mem;
+    delete[] m_dla_tasks;
 }
 
 bool Runtime::initEMU(void)
@@ -161,6 +180,16 @@ bool Runtime::initEMU(void)
         m_emu_engine = new Emulator();
         m_emu_engine->start();
 
+        // one task descriptor serves every unbatched submit, batches grow it
+        if (!m_emu_task_mem)
+        {
+            m_emu_task_mem_size = m_emu_if.taskDescAccessor(0).struct_size();
+            m_emu_task_mem_count = 1;
+            m_emu_task_mem = new NvU8[m_emu_task_mem_size];
+            std::memset(m_emu_task_mem, 0, m_emu_task_mem_size);
+            m_submit_allocations++;
+        }
+
         // Wait for emulator engine to warm up
         // We should have the ability to timeout here
         while (!m_emu_engine->ping())
@@ -387,6 +416,8 @@ bool Runtime::load(NvU8 *buf, int instance)
         }
     }
 
+    PROPAGATE_ERROR_FAIL( initBatchLayout() );
+
     ok = true;
     m_loaded = loadable;
 
@@ -399,6 +430,8 @@ bool Runtime::load(NvU8 *buf, int instance)
 
 void Runtime::unload()
 {
+    freeRunMemory();
+
     // Free all non binded memories
     for ( size_t mi = 0, MI = m_memory_entries.size(); mi != MI; ++mi ) {
         unloadMemory(&m_memory[mi]);
@@ -414,9 +447,15 @@ void Runtime::unload()
     m_task.clear();
     m_submit.clear();
     m_memory.clear();
+    for ( size_t w = 0; w != IOD_Max; ++w ) {
+        m_batch_bindings[w].clear();
+    }
     m_event.clear();
     m_address.clear();
     m_tensor_desc.clear();
+    m_address_batch_rank.clear();
+    m_address_batch_base.clear();
+    m_loadable_batch = 1;
 
     if (m_loaded)
         LoadableFactory::deleteLoadable(LoadableFactory::i(m_loaded));
@@ -435,6 +474,8 @@ bool Runtime::bindInputTensor(int index, void *hMem)
         goto done;
     }
 
+    clearBatchBinding(IOD_Input, index);
+
     // determine which mem needs to be rebound
     for ( size_t mi = 0, MI = m_memory.size(); mi != MI; ++mi ) {
         if ( m_memory[mi].inputBindId() == index ) {
@@ -461,6 +502,8 @@ bool Runtime::bindOutputTensor(int index, void *hMem)
         goto done;
     }
 
+    clearBatchBinding(IOD_Output, index);
+
     // determine which mem needs to be rebound
     for ( size_t mi = 0, MI = m_memory.size(); mi != MI; ++mi ) {
         if ( m_memory[mi].outputBindId() == index ) {
@@ -478,7 +521,240 @@ done:
     return ok;
 }
 
-bool Runtime::fillTaskAddressList(Task *task, NvDlaTask *dla_task)
+NvDlaError Runtime::bindInputTensorBatch(int index, NvU32 numBatch, void *const *hMem)
+{
+    return bindTensorBatch(IOD_Input, index, numBatch, hMem, 0);
+}
+
+NvDlaError Runtime::bindInputTensorBatch(int index, NvU32 numBatch, void *hMem, NvU64 batchStride)
+{
+    return bindTensorBatch(IOD_Input, index, numBatch, &hMem, batchStride);
+}
+
+NvDlaError Runtime::bindOutputTensorBatch(int index, NvU32 numBatch, void *const *hMem)
+{
+    return bindTensorBatch(IOD_Output, index, numBatch, hMem, 0);
+}
+
+NvDlaError Runtime::bindOutputTensorBatch(int index, NvU32 numBatch, void *hMem, NvU64 batchStride)
+{
+    return bindTensorBatch(IOD_Output, index, numBatch, &hMem, batchStride);
+}
+
+//
+// batchStride == 0 takes numBatch handles, otherwise one handle walked by stride.
+// element 0 is also bound singly so a plain submit() still works.
+//
+NvDlaError Runtime::bindTensorBatch(IOD w, int index, NvU32 numBatch, void *const *hMem, NvU64 batchStride)
+{
+    NvDlaError e = NvDlaSuccess;
+    size_t numHandles = batchStride ? 1 : numBatch;
+    bool ok;
+
+    if ( index < 0 || !hMem ) {
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "bad batch binding for bind id %d", index);
+    }
+    if ( numBatch == 0 || numBatch > NVDLA_RUNTIME_BATCH_MAX ) {
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "batch of %u out of range", numBatch);
+    }
+
+    ok = (w == IOD_Input) ? bindInputTensor(index, hMem[0]) : bindOutputTensor(index, hMem[0]);
+    if ( !ok ) {
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "bind id %d", index);
+    }
+
+    {
+        if ( m_batch_bindings[w].size() <= size_t(index) ) {
+            m_batch_bindings[w].resize(index + 1);
+        }
+
+        BatchBinding &binding = m_batch_bindings[w][index];
+        binding.hMem.assign(hMem, hMem + numHandles);
+        binding.virtAddr.resize(numHandles);
+        binding.stride = batchStride;
+        binding.count = numBatch;
+
+        for ( size_t hi = 0; hi != numHandles; ++hi ) {
+            std::map<void *, void *>::iterator f = m_hmem_memory_map.find(hMem[hi]);
+            if ( f == m_hmem_memory_map.end() ) {
+                clearBatchBinding(w, index);
+                ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "batch element %u of bind id %d is not runtime memory", NvU32(hi), index);
+            }
+            binding.virtAddr[hi] = f->second;
+        }
+    }
+
+    if ( debugBinding() )
+    {
+        gLogInfo << "bound " << numBatch << " batch elements to " << (w == IOD_Input ? "input" : "output")
+                 << " bind id=" << index << " stride=" << batchStride << endl;
+    }
+
+fail:
+    return e;
+}
+
+void Runtime::clearBatchBinding(IOD w, int index)
+{
+    if ( index >= 0 && size_t(index) < m_batch_bindings[w].size() ) {
+        m_batch_bindings[w][index] = BatchBinding();
+    }
+}
+
+//
+// number the address list entries of each bindable memory in offset order.
+// a loadable compiled for a batch of n has n entries per bindable tensor.
+//
+NvDlaError Runtime::initBatchLayout()
+{
+    NvDlaError e = NvDlaSuccess;
+    vector<vector<NvU16>> entries(m_memory.size());
+
+    m_loadable_batch = 1;
+    m_runs_packable = true;
+    m_address_batch_rank.assign(m_address.size(), 0);
+    m_address_batch_base.assign(m_address.size(), 0);
+
+    for ( size_t ai = 0, AI = m_address.size(); ai != AI; ++ai )
+    {
+        NvU16 mi = m_address[ai].mem_id();
+
+        if ( mi >= m_memory.size() ) {
+            ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "address id %u has bogus mem id %u", NvU32(ai), NvU32(mi));
+        }
+
+        if ( m_memory[mi].bindable() ) {
+            vector<NvU16> &list = entries[mi];
+            size_t pos = list.size();
+            while ( pos && m_address[list[pos - 1]].offset() > m_address[ai].offset() ) {
+                pos--;
+            }
+            list.insert(list.begin() + pos, NvU16(ai));
+        }
+    }
+
+    for ( size_t mi = 0, MI = m_memory.size(); mi != MI; ++mi )
+    {
+        Memory *mem = &m_memory[mi];
+        const vector<NvU16> &list = entries[mi];
+
+        for ( size_t ei = 0, EI = list.size(); ei != EI; ++ei ) {
+            m_address_batch_rank[list[ei]] = NvU32(ei);
+            m_address_batch_base[list[ei]] = m_address[list[0]].offset();
+        }
+        m_loadable_batch = std::max(m_loadable_batch, NvU32(list.size()));
+
+        if ( (mem->flags() & ILoadable::MemoryListEntry::flags_alloc()) && !mem->bindable() &&
+             mem->domain() != ILoadable::MemoryListEntry::domain_sysmem() ) {
+            m_runs_packable = false;
+        }
+    }
+
+    if ( debugBinding() )
+    {
+        gLogInfo << "loadable batch=" << m_loadable_batch << " runs packable=" << m_runs_packable << endl;
+    }
+
+fail:
+    return e;
+}
+
+// intermediates and the firmware consumed dependency graph can't be shared by runs in flight
+bool Runtime::isRunPrivate(Memory *mem)
+{
+    if ( !(mem->flags() & ILoadable::MemoryListEntry::flags_alloc()) || mem->bindable() ||
+         mem->domain() != ILoadable::MemoryListEntry::domain_sysmem() ) {
+        return false;
+    }
+
+    if ( !(mem->flags() & ILoadable::MemoryListEntry::flags_set()) ) {
+        return true;
+    }
+
+    for ( vector<string>::iterator ci = mem->contents().begin(); ci != mem->contents().end(); ++ci ) {
+        if ( (*ci).find("dep_graph") != std::string::npos ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+NvDlaError Runtime::allocRunMemory(NvU32 numRuns)
+{
+    NvDlaError e = NvDlaSuccess;
+    void *hDla = getDLADeviceContext(m_loaded_instance);
+
+    while ( m_run_memory.size() + 1 < numRuns )
+    {
+        m_run_memory.push_back(vector<RunMemory>(m_memory.size()));
+        vector<RunMemory> &copies = m_run_memory.back();
+
+        for ( size_t mi = 0, MI = m_memory.size(); mi != MI; ++mi ) {
+            copies[mi].hMem = NULL;
+            copies[mi].virtAddr = NULL;
+            if ( isRunPrivate(&m_memory[mi]) ) {
+                PROPAGATE_ERROR_FAIL( NvDlaAllocMem(m_dla_handle, hDla, &copies[mi].hMem, &copies[mi].virtAddr,
+                                                    m_memory[mi].size(), NvDlaHeap_System) );
+            }
+        }
+        m_submit_allocations++;
+    }
+
+fail:
+    return e;
+}
+
+void Runtime::freeRunMemory()
+{
+    void *hDla = getDLADeviceContext(m_loaded_instance);
+
+    for ( size_t ri = 0, RI = m_run_memory.size(); ri != RI; ++ri ) {
+        for ( size_t mi = 0, MI = m_run_memory[ri].size(); mi != MI; ++mi ) {
+            RunMemory &copy = m_run_memory[ri][mi];
+            if ( copy.hMem ) {
+                NvDlaFreeMem(NULL, hDla, copy.hMem, copy.virtAddr, m_memory[mi].size());
+            }
+        }
+    }
+    m_run_memory.clear();
+}
+
+//
+// memory seen by one run of the loadable.  batch bound tensors pick the
+// element each address list entry stands for, runs after the first use
+// their own intermediates, everything else is shared.
+//
+void Runtime::resolveBatchMemory(Memory *mem, NvU16 addressId, NvU32 run, void **hMem, void **virtAddr, NvU64 *offset)
+{
+    IOD w;
+    int id = mem->bindId(w);
+    size_t mi = mem - &m_memory[0];
+
+    *hMem = mem->getHandle();
+    *virtAddr = mem->getVirtAddr();
+
+    if ( run && run <= m_run_memory.size() && m_run_memory[run - 1][mi].hMem ) {
+        *hMem = m_run_memory[run - 1][mi].hMem;
+        *virtAddr = m_run_memory[run - 1][mi].virtAddr;
+        return;
+    }
+
+    if ( id < 0 || size_t(id) >= m_batch_bindings[w].size() || !m_batch_bindings[w][id].count ) {
+        return;
+    }
+
+    // a short last run repeats the last element
+    const BatchBinding &binding = m_batch_bindings[w][id];
+    NvU32 element = std::min(run * m_loadable_batch + m_address_batch_rank[addressId], binding.count - 1);
+    size_t hi = binding.stride ? 0 : element;
+
+    *hMem = binding.hMem[hi];
+    *virtAddr = binding.virtAddr[hi];
+    *offset = m_address_batch_base[addressId] + binding.stride * element;
+}
+
+bool Runtime::fillTaskAddressList(Task *task, NvU32 run, NvDlaTask *dla_task)
 {
     size_t num_memory_ids = m_memory.size();
     size_t num_task_addr_list_entries = task->mEntry.address_list.size();
@@ -516,16 +792,20 @@ bool Runtime::fillTaskAddressList(Task *task, NvDlaTask *dla_task)
         }
 
         Memory *mem = &m_memory[memory_id];
-        void *hMem   = mem->getHandle();
+        void *hMem;
+        void *virtAddr;
+        NvU64 offset = m_address[address_list_entry_id].mEntry.offset;
+
+        resolveBatchMemory(mem, address_list_entry_id, run, &hMem, &virtAddr, &offset);
 
         dla_task->address_list[ali].handle = hMem;
-        dla_task->address_list[ali].offset = m_address[address_list_entry_id].mEntry.offset;
+        dla_task->address_list[ali].offset = offset;
     }
 
     return true;
 }
 
-bool Runtime::fillEMUTaskAddressList(Task *task, EMUTaskDescAccessor taskDescAcc)
+bool Runtime::fillEMUTaskAddressList(Task *task, NvU32 run, EMUTaskDescAccessor taskDescAcc)
 {
     size_t num_memory_ids = m_memory.size();
     size_t num_task_addr_list_entries = task->mEntry.address_list.size();
@@ -561,9 +841,12 @@ bool Runtime::fillEMUTaskAddressList(Task *task, EMUTaskDescAccessor taskDescAcc
         }
 
         Memory *mem = &m_memory[memory_id];
-        void *hMem = mem->getVirtAddr();
+        void *handle;
+        void *hMem;
         NvU64         offset = m_address[address_list_entry_id].mEntry.offset;
 
+        resolveBatchMemory(mem, address_list_entry_id, run, &handle, &hMem, &offset);
+
         if ( mem->domain() == ILoadable::MemoryListEntry::domain_sram() )
         {
             hMem = 0;
@@ -588,38 +871,42 @@ bool Runtime::submit()
 {
     NvDlaError e = NvDlaSuccess;
     NvDlaDebugPrintf("Beginning Submit...");
-    e = submitInternal();
+    e = submitInternal(1);
     NvDlaDebugPrintf("Submit Successful!");
     return e == NvDlaSuccess;
 }
 
-NvDlaError Runtime::submitInternal()
+NvDlaError Runtime::submitBatch(NvU32 numBatch)
 {
     NvDlaError e = NvDlaSuccess;
-    Task *task;
-
-    vector<EMUTaskDescAccessor*> emu_task_descs;
-    size_t ii;
-    size_t num_emu_instances;
 
-    NvDlaDebugPrintf("Checking if loaded...");
-    bool ok = true;
-    NVDLA_UNUSED(ok);
-    if ( !m_loaded ) {
-        ORIGINATE_ERROR_FAIL(NvDlaError_InvalidState, "exec requires a successful load first");
+    if ( numBatch == 0 || numBatch > NVDLA_RUNTIME_BATCH_MAX ) {
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "batch of %u out of range", numBatch);
     }
 
-    if ( !m_task.size() ) {
-        ORIGINATE_ERROR_FAIL(NvDlaError_InvalidState, "no tasks to exec");
+    // every batch bound tensor needs a buffer for each element
+    for ( size_t w = 0; w != IOD_Max; ++w ) {
+        for ( size_t id = 0, ID = m_batch_bindings[w].size(); id != ID; ++id ) {
+            NvU32 count = m_batch_bindings[w][id].count;
+            if ( count && count < numBatch ) {
+                ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "bind id %u has %u of %u batch elements", NvU32(id), count, numBatch);
+            }
+        }
     }
 
-    if ( !m_submit.size() ) {
-        ORIGINATE_ERROR_FAIL(NvDlaError_InvalidState, "no submission sets to exec");
-    }
+    NvDlaDebugPrintf("Beginning Submit of %u...", numBatch);
+    PROPAGATE_ERROR_FAIL( submitInternal(numBatch) );
+    NvDlaDebugPrintf("Submit Successful!");
+
+fail:
+    return e;
+}
+
+// firmware consumes the dependency graph, so each dla run needs a fresh copy
+NvDlaError Runtime::reloadDependencyGraph(NvU32 numRuns)
+{
+    NvDlaError e = NvDlaSuccess;
 
-    NvDlaDebugPrintf("Loading memory...");
-    // Force reload dependency graph contents from the loadable to
-    // satisfy firmware requirements
     for ( size_t mi = 0, MI = m_memory_entries.size(); mi != MI; ++mi )
     {
         Memory* memory = &m_memory[mi];
@@ -631,18 +918,64 @@ NvDlaError Runtime::submitInternal()
                 if ((*ci).find("dep_graph") != std::string::npos)
                 {
                     PROPAGATE_ERROR_FAIL( loadMemory(m_loaded, &m_memory[mi]) );
+
+                    for ( NvU32 run = 1; run < numRuns && run <= m_run_memory.size(); run++ ) {
+                        if ( m_run_memory[run - 1][mi].virtAddr && memory->getVirtAddr() ) {
+                            std::memcpy(m_run_memory[run - 1][mi].virtAddr, memory->getVirtAddr(), memory->size());
+                        }
+                    }
+                    break;
                 }
             }
         }
     }
 
-    num_emu_instances = 1;
-    NvDlaDebugPrintf("Submitting tasks...");
-    for ( size_t ss=0; ss < m_submit.size(); ss++ ) {
+fail:
+    return e;
+}
 
-        size_t emu_instance = 0;
+//
+// a batch is covered by runs of the loadable, each run with its own
+// intermediates.  consecutive tasks on one engine are queued for every run
+// at once: dla tasks go down in a single submit, emu tasks are queued
+// without waiting and the queue is only drained before a dla task or at
+// the end.  when runs can't get their own memory they go one at a time.
+//
+NvDlaError Runtime::submitInternal(NvU32 numBatch)
+{
+    NvDlaError e = NvDlaSuccess;
+    Task *task;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration waited(0);
+
+    size_t num_emu_tasks = 0;
+    size_t num_emu_instances = 1;
+    size_t max_dla_tasks = 0;
+    size_t dla_tasks = 0;
+    size_t submitOrderCapacity;
+    NvU32 numRuns;
+    NvU32 runsPerGroup;
 
-        for ( ii=0; ii < m_submit[ss].tasks().size(); ii++ )
+    NvDlaDebugPrintf("Checking if loaded...");
+    bool ok = true;
+    NVDLA_UNUSED(ok);
+    if ( !m_loaded ) {
+        ORIGINATE_ERROR_FAIL(NvDlaError_InvalidState, "exec requires a successful load first");
+    }
+
+    if ( !m_task.size() ) {
+        ORIGINATE_ERROR_FAIL(NvDlaError_InvalidState, "no tasks to exec");
+    }
+
+    if ( !m_submit.size() ) {
+        ORIGINATE_ERROR_FAIL(NvDlaError_InvalidState, "no submission sets to exec");
+    }
+
+    // flatten the submission sets into the order each run goes in
+    submitOrderCapacity = m_submit_order.capacity();
+    m_submit_order.clear();
+    for ( size_t ss=0; ss < m_submit.size(); ss++ ) {
+        for ( size_t ii=0; ii < m_submit[ss].tasks().size(); ii++ )
         {
             size_t task_id = m_submit[ss].tasks()[ii];
 
@@ -650,77 +983,173 @@ NvDlaError Runtime::submitInternal()
                 ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "task id out of range");
             }
 
-            task = &m_task[ task_id ];
+            m_submit_order.push_back(&m_task[task_id]);
+            if ( m_task[task_id].interface() == ILoadable::Interface_EMU1 ) {
+                num_emu_tasks++;
+                dla_tasks = 0;
+            } else {
+                max_dla_tasks = std::max(max_dla_tasks, ++dla_tasks);
+            }
+        }
+    }
+    if ( m_submit_order.capacity() != submitOrderCapacity ) {
+        m_submit_allocations++;
+    }
 
-            switch ( task->interface() ) {
+    numRuns = (numBatch + m_loadable_batch - 1) / m_loadable_batch;
+    runsPerGroup = m_runs_packable ? numRuns : 1;
 
-                case ILoadable::Interface_DLA1:
-                {
-                    NvDlaDebugPrintf("Submitting DLA task...");
-                    void *dev;
-                    NvDlaTask dla_task;
+    // queued emu tasks each need their own descriptor
+    if ( m_emu_engine && m_emu_task_mem && num_emu_tasks * runsPerGroup > m_emu_task_mem_count )
+    {
+        delete[] m_emu_task_mem;
+        m_emu_task_mem_count = num_emu_tasks * runsPerGroup;
+        m_emu_task_mem = new NvU8[m_emu_task_mem_count * m_emu_task_mem_size];
+        std::memset(m_emu_task_mem, 0, m_emu_task_mem_count * m_emu_task_mem_size);
+        m_submit_allocations++;
+    }
+
+    // left uninitialized, only the used head of each address list is written
+    if ( max_dla_tasks * runsPerGroup > m_dla_task_count )
+    {
+        delete[] m_dla_tasks;
+        m_dla_task_count = max_dla_tasks * runsPerGroup;
+        m_dla_tasks = new NvDlaTask[m_dla_task_count];
+        m_submit_allocations++;
+    }
 
-                    dev = getDLADeviceContext(m_loaded_instance);
+    PROPAGATE_ERROR_FAIL( allocRunMemory(runsPerGroup) );
 
-                    std::memset(&dla_task, 0, sizeof(dla_task));
+    m_num_submits++;
+    m_num_batch_elements += std::max(numBatch, m_loadable_batch);
+    NvDlaDebugPrintf("Submitting tasks...");
+    for ( NvU32 first = 0; first < numRuns; first += runsPerGroup ) {
 
-                    dla_task.task_id = task->id();
+        NvU32 runs = std::min(runsPerGroup, numRuns - first);
+        size_t emu_desc = 0;
 
-                    fillTaskAddressList(task, &dla_task);
+        NvDlaDebugPrintf("Loading memory...");
+        // Force reload dependency graph contents from the loadable to
+        // satisfy firmware requirements
+        PROPAGATE_ERROR_FAIL( reloadDependencyGraph(runs) );
 
-                    NvDlaDebugPrintf("Submitting DLA task to instance %d", m_loaded_instance);
-                    PROPAGATE_ERROR_FAIL( NvDlaSubmit(NULL, dev, &dla_task, 1) );
+        for ( size_t ti = 0, TI = m_submit_order.size(); ti != TI; )
+        {
+            NvU32 interface = m_submit_order[ti]->interface();
+            size_t end = ti + 1;
+
+            while ( end != TI && m_submit_order[end]->interface() == interface ) {
+                end++;
+            }
+
+            switch ( interface ) {
+
+                case ILoadable::Interface_DLA1:
+                {
+                    NvDlaDebugPrintf("Submitting DLA tasks...");
+                    void *dev = getDLADeviceContext(m_loaded_instance);
+                    size_t num_dla_tasks = 0;
+                    size_t num_addresses = 0;
+
+                    for ( NvU32 run = first; run != first + runs; run++ ) {
+                        for ( size_t si = ti; si != end; si++ ) {
+                            NvDlaTask *dla_task = &m_dla_tasks[num_dla_tasks++];
+
+                            task = m_submit_order[si];
+                            dla_task->task_id = task->id();
+                            if ( !fillTaskAddressList(task, run, dla_task) ) {
+                                ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "dla task address list");
+                            }
+                            num_addresses += dla_task->num_addresses;
+                        }
+                    }
+
+                    // the port grows its address list to the largest submit seen
+                    if ( num_addresses > m_dla_address_count ) {
+                        m_dla_address_count = num_addresses;
+                        m_submit_allocations++;
+                    }
+
+                    NvDlaDebugPrintf("Submitting %u DLA tasks to instance %d", NvU32(num_dla_tasks), m_loaded_instance);
+                    std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+                    e = NvDlaSubmit(NULL, dev, m_dla_tasks, NvU32(num_dla_tasks));
+                    waited += std::chrono::steady_clock::now() - submitted;
+                    PROPAGATE_ERROR_FAIL( e );
                 }
                 break;
                 case ILoadable::Interface_EMU1:
                 {
-                    NvDlaDebugPrintf("Submitting EMU task...");
-                    EMUInterface *emu_if = new EMUInterfaceA();
-
-                    NvU8* task_mem = new NvU8[emu_if->taskDescAccessor(0).struct_size()];
-
-                    std::memset(task_mem, 0, emu_if->taskDescAccessor(0).struct_size());
+                    NvDlaDebugPrintf("Submitting EMU tasks...");
 
-                    EMUTaskDescAccessor emu_task_desc = emu_if->taskDescAccessor(task_mem);
-                    emu_task_descs.push_back(&emu_task_desc);
-
-                    if (!m_emu_engine)
+                    if (!m_emu_engine || !m_emu_task_mem)
                     {
                         ORIGINATE_ERROR_FAIL(NvDlaError_NotInitialized);
                     }
 
-                    if ( task->instance() != ILoadable::TaskListEntry::instance_ANY() ) {
-                        if ( task->instance() < (int)num_emu_instances ) {
-                            emu_instance = task->instance();
-                        } else {
-                            ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "emu instance out of bounds");
-                        }
-                    }
+                    for ( NvU32 run = first; run != first + runs; run++ ) {
+                        for ( size_t si = ti; si != end; si++ ) {
+                            NvU8 *task_mem = m_emu_task_mem + emu_desc++ * m_emu_task_mem_size;
+                            EMUTaskDescAccessor emu_task_desc = m_emu_if.taskDescAccessor(task_mem);
 
-                    fillEMUTaskAddressList(task, *(emu_task_descs.back()));
+                            task = m_submit_order[si];
+                            if ( task->instance() != ILoadable::TaskListEntry::instance_ANY() &&
+                                 task->instance() >= (int)num_emu_instances ) {
+                                ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "emu instance out of bounds");
+                            }
 
-                    NvDlaDebugPrintf("Submitting EMU task to instance %d", emu_instance);
-                    PROPAGATE_ERROR_FAIL( m_emu_engine->submit(task_mem, 1) );
+                            if ( !fillEMUTaskAddressList(task, run, emu_task_desc) ) {
+                                ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "emu task address list");
+                            }
 
-                    emu_instance = (emu_instance + 1) % num_emu_instances;
+                            // wait on the last one, whatever comes next consumes the results
+                            bool blocking = run + 1 == first + runs && si + 1 == end;
 
-                    /* since blocking call, deleting here should be fine.*/
-                    delete[] task_mem;
-                    delete emu_if;
+                            std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+                            e = m_emu_engine->submit(task_mem, blocking);
+                            waited += std::chrono::steady_clock::now() - submitted;
+                            PROPAGATE_ERROR_FAIL( e );
+                            m_num_emu_tasks++;
+                        }
+                    }
                 }
                 break;
                 default:
                     ok = false;
-                    ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "unrecognized interface %d", task->interface());
+                    ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "unrecognized interface %d", interface);
                     break;
 
             } // switch on engine type
 
-        } // each task in a submission
+            ti = end;
 
-    } // each submission set
+        } // each run of consecutive tasks on one engine
+
+    } // each group of runs
 
 fail:
+    m_last_submit_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    m_last_wait_us = std::chrono::duration_cast<std::chrono::microseconds>(waited).count();
+    return e;
+}
+
+NvDlaError Runtime::getStats(IRuntime::NvDlaRuntimeStats *stats)
+{
+    NvDlaError e = NvDlaSuccess;
+
+    if ( !stats )
+    {
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter);
+    }
+
+    stats->numSubmits = m_num_submits;
+    stats->numBatchElements = m_num_batch_elements;
+    stats->numEmuTasks = m_num_emu_tasks;
+    stats->lastSubmitUs = m_last_submit_us;
+    stats->lastWaitUs = m_last_wait_us;
+    stats->submitAllocations = m_submit_allocations +
+                               (m_emu_engine ? m_emu_engine->numAllocations() : 0);
+
+ fail:
     return e;
 }
 
@@ -751,6 +1180,20 @@ void Runtime::freeSystemMemory(void *phMem, NvU64 size)
     m_hmem_memory_map.erase(phMem);
 }
 
+NvDlaError Runtime::getSystemMemoryFd(void *hMem, NvS32 *fd)
+{
+    NvDlaError e = NvDlaSuccess;
+
+    if ( m_hmem_memory_map.find(hMem) == m_hmem_memory_map.end() ) {
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "memory not allocated by this runtime");
+    }
+
+    PROPAGATE_ERROR_FAIL( NvDlaGetMemFd(getDLADeviceContext(m_loaded_instance), hMem, fd) );
+
+fail:
+    return e;
+}
+
 void Runtime::unloadMemory(Memory *memory)
 {
     if (! (memory->flags() & ILoadable::MemoryListEntry::flags_alloc()))
@@ -1040,6 +1483,72 @@ NvDlaError Runtime::getOutputTensorDesc(int id, IRuntime::NvDlaTensor *td)
     return e;
 }
 
+//
+// reduce a bound output to its softmax top-k straight from the mapped
+// surface, so callers that only need a decision skip the host copy.
+//
+NvDlaError Runtime::getOutputTopK(int id, NvU32 k, IRuntime::NvDlaTopK *topk)
+{
+    NvDlaError e = NvDlaSuccess;
+    Memory *bound_mem = 0;
+    int tensor_desc_id = -1;
+    IRuntime::NvDlaTensor td;
+
+    PROPAGATE_ERROR_FAIL( getMemoryFromBindId(IOD_Output, id, bound_mem) );
+
+    tensor_desc_id = bound_mem->tensorDescId();
+    if ( (tensor_desc_id < 0) || (size_t(tensor_desc_id) >= m_tensor_desc.size()) ) {
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "Tensor desc id out of range:%d", tensor_desc_id);
+    }
+
+    if ( !bound_mem->getVirtAddr() ) {
+        ORIGINATE_ERROR_FAIL(NvDlaError_InvalidState, "Output %d is not bound", id);
+    }
+
+    td = m_tensor_desc[tensor_desc_id].bindTensorDesc();
+    PROPAGATE_ERROR_FAIL( getTopK(&td, bound_mem->getVirtAddr(), k, topk) );
+
+ fail:
+    return e;
+}
+
+//
+// same as getOutputTopK() on a caller owned copy of an output surface,
+// lets results be read after the tensor has been rebound
+//
+NvDlaError Runtime::getTopK(const IRuntime::NvDlaTensor *td, const void *data, NvU32 k, IRuntime::NvDlaTopK *topk)
+{
+    NvDlaError e = NvDlaSuccess;
+    EMUBufferType format;
+
+    if ( !td || !data || !topk )
+    {
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter);
+    }
+
+    if ( td->pixelFormat != TENSOR_PIXEL_FORMAT_FEATURE ) {
+        ORIGINATE_ERROR_FAIL(NvDlaError_NotSupported, "topk needs a feature surface, got pixel format %u", td->pixelFormat);
+    }
+
+    switch ( td->dataType )
+    {
+    case TENSOR_DATA_TYPE_HALF:  format = EMUBufferType::DLA_FEATURE_FP16_FORMAT;  break;
+    case TENSOR_DATA_TYPE_INT16: format = EMUBufferType::DLA_FEATURE_INT16_FORMAT; break;
+    case TENSOR_DATA_TYPE_INT8:  format = EMUBufferType::DLA_FEATURE_INT8_FORMAT;  break;
+    default:
+        ORIGINATE_ERROR_FAIL(NvDlaError_NotSupported, "topk: unsupported data type %u", td->dataType);
+    }
+
+    PROPAGATE_ERROR_FAIL( Emulator::topK((const NvU8 *)data, (NvU16)format,
+                                         td->dims.w, td->dims.h, td->dims.c,
+                                         td->stride[1], td->stride[2],
+                                         std::min(k, NvU32(NVDLA_RUNTIME_TOPK_MAX)),
+                                         &topk->k, topk->index, topk->prob, &topk->margin) );
+
+ fail:
+    return e;
+}
+
 //
 // take a tensor descriptor from the user-facing API and inspect the
 // changed elements.  react to those which can be legitimately tweaked
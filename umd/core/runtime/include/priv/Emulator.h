@@ -29,7 +29,11 @@
 #ifndef NVDLA_PRIV_EMULATOR_H
 #define NVDLA_PRIV_EMULATOR_H
 
-#include <queue>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 #include "priv/EMUInterface.h"
 
@@ -55,26 +59,139 @@ public: // externally facing
     bool stop();
     bool run();
 
+    // heap allocations made while running tasks: scratch pool growth and
+    // lookup table builds. flat in steady state
+    NvU64 numAllocations() const;
+
 public: // internally facing
     inline bool debugOps() { return false; }
 
+    // row kernels get [begin, end) and the worker slot which owns scratch memory
+    typedef void (*RowFunction)(void* ctx, NvU32 begin, NvU32 end, NvU32 slot);
+
+    static const NvU32 TOPK_MAX = 8;
+
+    // one step of a fused elementwise chain. out, when set, is the op's own
+    // fp16 destination, still written since readers outside the task may need it.
+    struct ElementwiseStage
+    {
+        EMUOpType type;
+        NvF32 power;
+        NvF32 scale;
+        NvF32 shift;
+        NvU8* out;
+        NvU32 outLineStride;
+        NvU32 outSurfStride;
+    };
+
+    // softmax over a whole feature cube reduced to its k most probable entries.
+    // shared by the TOPK op and Runtime::getOutputTopK().
+    static NvDlaError topK(const NvU8* src, NvU16 format,
+                           NvU32 width, NvU32 height, NvU32 channel,
+                           NvU32 lineStride, NvU32 surfStride,
+                           NvU32 k, NvU32* numOut, NvU32* index, NvF32* prob, NvF32* margin);
+
 protected:
+    static const NvU32 MAX_WORKERS = 4;
+    static const NvU32 TASK_RING_SIZE = 8;
+    static const NvU32 MAX_FUSED_OPS = 16;
+    static const NvU32 SOFTMAX_SURFACE_DIMS = 4;
+
+    struct WorkerArgs
+    {
+        Emulator* engine;
+        NvU32 id;
+    };
+
     static void threadFunction(void* arg);
-    bool processTask(NvU8* task_mem, std::vector<NvU8*> addressList);
+    static void workerFunction(void* arg);
+
+    NvDlaError startWorkers();
+    void stopWorkers();
+    void workerLoop(NvU32 id);
+    void parallelFor(NvU32 numRows, NvU32 minRowsPerChunk, RowFunction fn, void* ctx);
+    NvF32* rowScratch(NvU32 slot, NvU32 numElements);
+
+    template <typename T>
+    void growPool(std::vector<T>& pool, size_t n);
+
+    bool processTask(NvU8* task_mem, NvU8** addressList);
 
     NvDlaError getAddrOffset(EMUBufferDescAccessor in, NvU32 x, NvU32 y, NvU32 c, NvU32* offset);
 
-    bool executePower(EMUPowerOpDescAccessor opDesc, EMUPowerBufferDescsAccessor bufDescs, std::vector<NvU8*> addressList);
-    bool executeSoftmax(EMUSoftmaxOpDescAccessor opDesc, EMUSoftmaxBufferDescsAccessor bufDescs, std::vector<NvU8*> addressList);
-    bool executeLog(EMULogOpDescAccessor opDesc, EMULogBufferDescsAccessor bufDescs, std::vector<NvU8*> addressList);
+    bool executePower(EMUPowerOpDescAccessor opDesc, EMUPowerBufferDescsAccessor bufDescs, NvU8** addressList);
+    bool executeSoftmax(EMUSoftmaxOpDescAccessor opDesc, EMUSoftmaxBufferDescsAccessor bufDescs, NvU8** addressList);
+    bool executeLog(EMULogOpDescAccessor opDesc, EMULogBufferDescsAccessor bufDescs, NvU8** addressList);
+    // cache key for integer lookup tables, floats compared bitwise
+    struct LookupKey
+    {
+        NvU8 type;
+        NvU16 format;
+        NvU32 power;
+        NvU32 scale;
+        NvU32 shift;
+
+        bool operator<(const LookupKey& o) const;
+    };
+
+    const NvU8* lookupTable(const ElementwiseStage& stage, NvU16 format);
+    bool runLookup(EMUBufferDescAccessor src, EMUBufferDescAccessor dst, const ElementwiseStage& stage, NvU8** addressList);
+
+    bool executeFused(EMUOperationContainerAccessor ops, EMUOperationBufferContainerAccessor bufs, const NvU16* chain, NvU32 chainLength, NvU8** addressList);
+
+    bool runElementwise(EMUBufferDescAccessor src, EMUBufferDescAccessor dst, const ElementwiseStage* stages, NvU32 numStages, NvU8** addressList);
+    NvDlaError runSoftmax(EMUBufferDescAccessor src, EMUBufferDescAccessor dst, NvU8 axis, const ElementwiseStage* prologue, NvU32 numPrologue, NvU8** addressList);
+
+    bool executeTopK(EMUTopKOpDescAccessor opDesc, EMUTopKBufferDescsAccessor bufDescs, EMUTopKResultAccessor result, NvU8** addressList);
 
 private:
-    std::queue<NvU8*> m_taskQueue;
+    EMUInterfaceA m_emu_if;
+
+    // submitted tasks, [m_taskTail, m_taskHead) are pending
+    NvU8* m_taskRing[TASK_RING_SIZE];
+    NvU64 m_taskHead;
+    NvU64 m_taskTail;
+    // first failure since the last blocking submit
+    NvDlaError m_taskError;
+    std::mutex m_taskMutex;
+    std::condition_variable m_taskCond;
+    std::condition_variable m_taskDoneCond;
 
     NvDlaThreadHandle m_thread;
     bool m_threadActive;
 
     bool m_signalShutdown;
+
+    // helper threads used to split independent rows of a single op
+    NvU32 m_numWorkers;
+    NvDlaThreadHandle m_workers[MAX_WORKERS];
+    WorkerArgs m_workerArgs[MAX_WORKERS];
+    std::mutex m_jobMutex;
+    std::condition_variable m_jobCond;
+    std::condition_variable m_jobDoneCond;
+    NvU32 m_jobGeneration;
+    NvU32 m_jobPending;
+    NvU32 m_jobChunks;
+    NvU32 m_jobRows;
+    RowFunction m_jobFunction;
+    void* m_jobContext;
+    bool m_workersShutdown;
+
+    std::vector<NvF32> m_rowScratch[MAX_WORKERS + 1];
+
+    // integer power/log tables, built on first use
+    std::map<LookupKey, std::vector<NvU8> > m_lookupTables;
+
+    // per task scratch, sized up on demand and then reused
+    std::vector<NvU8*> m_addressList;
+    std::vector<EMUOpType> m_opTypes;
+    std::vector<NvS16> m_opSrc;
+    std::vector<NvS16> m_opDst;
+    std::vector<NvS32> m_opProducer;
+    std::vector<NvU16> m_opOrder;
+    std::vector<NvU8> m_opDone;
+
+    std::atomic<NvU64> m_numAllocations;
 };
 
 } // nvdla::priv
@@ -86,10 +86,16 @@ public: // externally facing
     virtual void unload(void);
     virtual NvDlaError allocateSystemMemory(void **h_mem, NvU64 size, void **pData);
     virtual void freeSystemMemory(void *phMem, NvU64 size);
+    virtual NvDlaError getSystemMemoryFd(void *hMem, NvS32 *fd);
 
     virtual bool bindInputTensor (int index, void *hMem);
     virtual bool bindOutputTensor(int index, void *hMem);
 
+    virtual NvDlaError bindInputTensorBatch(int index, NvU32 numBatch, void *const *hMem);
+    virtual NvDlaError bindInputTensorBatch(int index, NvU32 numBatch, void *hMem, NvU64 batchStride);
+    virtual NvDlaError bindOutputTensorBatch(int index, NvU32 numBatch, void *const *hMem);
+    virtual NvDlaError bindOutputTensorBatch(int index, NvU32 numBatch, void *hMem, NvU64 batchStride);
+
     virtual NvDlaError getNetworkDataType(uint8_t *) const;
 
     virtual NvDlaError getNumInputTensors(int *);
@@ -99,8 +105,13 @@ public: // externally facing
     virtual NvDlaError getNumOutputTensors(int *);
     virtual NvDlaError getOutputTensorDesc(int id, IRuntime::NvDlaTensor *);
     virtual NvDlaError setOutputTensorDesc(int id, const IRuntime::NvDlaTensor *);
+    virtual NvDlaError getOutputTopK(int id, NvU32 k, IRuntime::NvDlaTopK *);
+    virtual NvDlaError getTopK(const IRuntime::NvDlaTensor *, const void *data, NvU32 k, IRuntime::NvDlaTopK *);
 
     virtual bool submit();
+    virtual NvDlaError submitBatch(NvU32 numBatch);
+
+    virtual NvDlaError getStats(IRuntime::NvDlaRuntimeStats *);
 
 public: // internally facing
     Runtime();
@@ -120,7 +131,7 @@ protected:
     inline bool debugBinding() const { return false; }
     inline bool debugStrideRewrite() const { return false; }
 
-    NvDlaError submitInternal(void);
+    NvDlaError submitInternal(NvU32 numBatch);
 
     virtual void *getDLADeviceContext(size_t sel_i);
     size_t getMaxDLADevices() { return 1; }
@@ -128,6 +139,17 @@ protected:
     void *m_dla_handle;
     void *m_dla_device_handles[2];
     Emulator *m_emu_engine;
+    EMUInterfaceA m_emu_if;
+    NvU8 *m_emu_task_mem;           // one descriptor per batch element
+    size_t m_emu_task_mem_size;
+    NvU32 m_emu_task_mem_count;
+    NvU64 m_submit_allocations;
+
+    NvU64 m_num_submits;
+    NvU64 m_num_batch_elements;
+    NvU64 m_num_emu_tasks;
+    NvU64 m_last_submit_us;
+    NvU64 m_last_wait_us;
 
     void *h_network_desc_mem;
     void *h_op_desc_mem;
@@ -280,12 +302,14 @@ protected:
     bool versionsCompatible(const ILoadable::Version &, const ILoadable::Version &);
 
     size_t m_numDLATasks;
+    std::vector<Task *> m_submit_order; // every task of one run, in submit order
 
     NvDlaError loadMemory(Loadable *, Memory *);
     void unloadMemory(Memory *);
-    bool fillTaskAddressList(Task *task, NvDlaTask *);
+    bool fillTaskAddressList(Task *task, NvU32 run, NvDlaTask *);
 
-    bool fillEMUTaskAddressList(Task *task, EMUTaskDescAccessor taskDescAcc);
+    bool fillEMUTaskAddressList(Task *task, NvU32 run, EMUTaskDescAccessor taskDescAcc);
+    NvDlaError reloadDependencyGraph(NvU32 numRuns);
 
     //
     // maintenance of ids/lookups for bind ids, associated memory, tensor descs
@@ -295,6 +319,52 @@ protected:
     std::vector<std::vector<Memory *>> m_bindable_memory; // indexed on [iod][bind_id]
     std::map<void *, void *> m_hmem_memory_map; // maintains 1-1 relation between hmem and mapped memory.
 
+    // per element buffers of a batch bound tensor. a single buffer is
+    // walked by stride, several are used one per element.
+    struct BatchBinding
+    {
+        BatchBinding() : stride(0), count(0) { }
+        std::vector<void *> hMem;
+        std::vector<void *> virtAddr;
+        NvU64 stride;
+        NvU32 count;
+    };
+    std::vector<BatchBinding> m_batch_bindings[IOD_Max]; // indexed on [iod][bind_id], count 0 when bound singly
+
+    NvDlaError bindTensorBatch(IOD w, int index, NvU32 numBatch, void *const *hMem, NvU64 batchStride);
+    void clearBatchBinding(IOD w, int index);
+    void resolveBatchMemory(Memory *mem, NvU16 addressId, NvU32 run, void **hMem, void **virtAddr, NvU64 *offset);
+
+    //
+    // a submit covers its batch in runs of the loadable. a multi-batch
+    // loadable gives each element of a bindable tensor its own address list
+    // entry, so one run covers m_loadable_batch elements.
+    //
+    NvDlaError initBatchLayout();
+    NvU32 m_loadable_batch;
+    std::vector<NvU32> m_address_batch_rank;  // indexed on address id, element within a run
+    std::vector<NvU64> m_address_batch_base;  // indexed on address id, offset of element 0
+
+    //
+    // runs after the first get their own copy of the intermediate and
+    // dependency graph memory so every run can be queued in one submit.
+    // not possible when intermediates live in sram, runs then go one by one.
+    //
+    struct RunMemory
+    {
+        void *hMem;
+        void *virtAddr;
+    };
+    bool isRunPrivate(Memory *mem);
+    NvDlaError allocRunMemory(NvU32 numRuns);
+    void freeRunMemory();
+    bool m_runs_packable;
+    std::vector<std::vector<RunMemory>> m_run_memory; // indexed on [run - 1][mem id], null when shared
+
+    NvDlaTask *m_dla_tasks;          // one submit's worth, grown on demand
+    size_t m_dla_task_count;
+    size_t m_dla_address_count;      // largest address total handed to the port, which keeps its own copy
+
     class MemoryId_BindId_Is // helper predicate
     {
     public:
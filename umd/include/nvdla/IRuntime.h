@@ -129,6 +129,31 @@ public:
     };
     typedef struct NvDlaTensor NvDlaTensor;
 
+#define NVDLA_RUNTIME_TOPK_MAX 8U
+#define NVDLA_RUNTIME_BATCH_MAX 64U
+
+    /* softmax top-k of an output tensor, most probable first */
+    struct NvDlaTopK
+    {
+        NvU32 k;
+        NvU32 index[NVDLA_RUNTIME_TOPK_MAX];  /* flattened (c, h, w) index */
+        NvF32 prob[NVDLA_RUNTIME_TOPK_MAX];
+        NvF32 margin;                         /* prob[0] - prob[1] */
+    };
+    typedef struct NvDlaTopK NvDlaTopK;
+
+    struct NvDlaRuntimeStats
+    {
+        NvU64 numSubmits;
+        NvU64 numBatchElements;     /* inferences run by all submits, batched or not */
+        NvU64 numEmuTasks;
+        NvU64 submitAllocations;    /* heap allocations on the submit path, flat once warm:
+                                       task and address lists, emu descriptors, scratch pools, lookup tables */
+        NvU64 lastSubmitUs;         /* the last submit, start to finish */
+        NvU64 lastWaitUs;           /* of which blocked on the engines */
+    };
+    typedef struct NvDlaRuntimeStats NvDlaRuntimeStats;
+
     virtual NvU16 getMaxDevices() = 0;
     virtual NvU16 getNumDevices() = 0;
     virtual bool initEMU(void) = 0;
@@ -139,9 +164,18 @@ public:
     virtual NvDlaError allocateSystemMemory(void **h_mem, NvU64 size, void **pData) = 0;
     virtual void freeSystemMemory(void *phMem, NvU64 size) = 0;
 
+    /* dma-buf fd behind allocateSystemMemory() memory, for mapping it in another process; the runtime keeps it */
+    virtual NvDlaError getSystemMemoryFd(void *hMem, NvS32 *fd) = 0;
+
     virtual bool bindInputTensor(int index, void *hMem) = 0;
     virtual bool bindOutputTensor(int index, void *hMem) = 0;
 
+    /* batch element b uses hMem[b], or hMem + b * batchStride for a single strided buffer */
+    virtual NvDlaError bindInputTensorBatch(int index, NvU32 numBatch, void *const *hMem) = 0;
+    virtual NvDlaError bindInputTensorBatch(int index, NvU32 numBatch, void *hMem, NvU64 batchStride) = 0;
+    virtual NvDlaError bindOutputTensorBatch(int index, NvU32 numBatch, void *const *hMem) = 0;
+    virtual NvDlaError bindOutputTensorBatch(int index, NvU32 numBatch, void *hMem, NvU64 batchStride) = 0;
+
     virtual NvDlaError getNetworkDataType(uint8_t *) const = 0;
 
     virtual NvDlaError getNumInputTensors(int *) = 0;
@@ -151,8 +185,13 @@ public:
     virtual NvDlaError getNumOutputTensors(int *) = 0;
     virtual NvDlaError getOutputTensorDesc(int id, NvDlaTensor *) = 0;
     virtual NvDlaError setOutputTensorDesc(int id, const NvDlaTensor *) = 0;
+    virtual NvDlaError getOutputTopK(int id, NvU32 k, NvDlaTopK *) = 0;
+    virtual NvDlaError getTopK(const NvDlaTensor *, const void *data, NvU32 k, NvDlaTopK *) = 0;
 
     virtual bool submit() = 0;
+    virtual NvDlaError submitBatch(NvU32 numBatch) = 0;
+
+    virtual NvDlaError getStats(NvDlaRuntimeStats *) = 0;
 
 protected:
     IRuntime();
@@ -69,6 +69,7 @@ NvDlaError NvDlaAllocMem(void *session_handle, void *device_handle,
                          NvDlaHeap heap);
 NvDlaError NvDlaFreeMem(void *session_handle, void *device_handle, void *mem_handle,
                         void *pData, NvU32 size);
+NvDlaError NvDlaGetMemFd(void *device_handle, void *mem_handle, NvS32 *fd);
 
 #ifdef __cplusplus
 }
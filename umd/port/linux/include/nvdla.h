@@ -34,6 +34,7 @@
 struct NvDlaMemHandleRec{
     NvS32 fd;
     NvS32 prime_handle;
+    NvS32 shared_fd;    /* writable export for other processes, made on first request */
 };
 typedef struct NvDlaMemHandleRec* NvDlaMemHandle;
 
@@ -47,6 +48,10 @@ typedef struct NvDlaContextRec
 {
     NvS32 fd;
 
+    /* submit scratch, grown as needed and reused across submits */
+    struct nvdla_mem_handle *address_list;
+    NvU32 address_list_size;
+
 } NvDlaContext;
 
 typedef struct NvDlaContextRec *NvDlaDeviceHandle;
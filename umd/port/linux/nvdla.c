@@ -159,6 +159,8 @@ NvDlaFreeMem(void *session_handle, void *device_handle, void *mem_handle, void *
     /* Close the file handle corresponding to that mem */
     if (hMem->fd != 0)
         (void) close(hMem->fd);
+    if (hMem->shared_fd != 0)
+        (void) close(hMem->shared_fd);
 
     args.handle = hMem->prime_handle;
 
@@ -173,40 +175,101 @@ NvDlaFreeMem(void *session_handle, void *device_handle, void *mem_handle, void *
     return NvDlaSuccess;
 }
 
+/* dma-buf fd to hand to another process, still owned by mem_handle */
+NvDlaError
+NvDlaGetMemFd(void *device_handle, void *mem_handle, NvS32 *fd)
+{
+    struct drm_prime_handle req;
+    NvDlaMemHandle hMem = (NvDlaMemHandle)mem_handle;
+    NvDlaDeviceHandle hDlaDev = (NvDlaDeviceHandle)device_handle;
+
+    if (hMem == 0 || hMem->fd <= 0)
+        return NvDlaError_BadParameter;
+
+    /* writable, so the receiver can mmap it to fill in input */
+    if (hMem->shared_fd <= 0) {
+        memset(&req, 0, sizeof(req));
+        req.handle = hMem->prime_handle;
+        req.flags = DRM_CLOEXEC | DRM_RDWR;
+
+        if (ioctl(hDlaDev->fd, DRM_IOCTL_PRIME_HANDLE_TO_FD, &req)) {
+            printf("failed to get shared fd for handle errno=%d\n", errno);
+            return NvDlaError_IoctlFailed;
+        }
+        hMem->shared_fd = req.fd;
+    }
+
+    *fd = hMem->shared_fd;
+
+    return NvDlaSuccess;
+}
+
 NvDlaError
 NvDlaSubmit(void *session_handle, void *device_handle, NvDlaTask *pTasks, NvU32 num_tasks)
 {
     NvDlaDeviceHandle dla_device = (NvDlaDeviceHandle)device_handle;
-    struct nvdla_mem_handle address_list[num_tasks][NVDLA_MAX_BUFFERS_PER_TASK];
-    struct nvdla_ioctl_submit_task tasks[num_tasks];
+    struct nvdla_mem_handle *address_list;
+    struct nvdla_ioctl_submit_task tasks[NVDLA_MAX_TASKS_PER_SUBMIT];
     struct nvdla_submit_args args;
-    uint32_t i;
+    NvDlaError e = NvDlaSuccess;
+    uint32_t num_addresses = 0;
+    uint32_t i, first;
 
-    memset(&args, 0, sizeof(args));
-    args.tasks = (uintptr_t)tasks;
-    args.num_tasks = num_tasks;
+    for (i = 0; i < num_tasks; i++) {
+        if (pTasks[i].num_addresses > NVDLA_MAX_BUFFERS_PER_TASK)
+            return NvDlaError_BadParameter;
+        num_addresses += pTasks[i].num_addresses;
+    }
+
+    /* one block for every address list, kept on the device between submits */
+    if (num_addresses > dla_device->address_list_size) {
+        NvDlaFree(dla_device->address_list);
+        dla_device->address_list_size = 0;
+        dla_device->address_list = NvDlaAlloc(num_addresses * sizeof(*address_list));
+        if (dla_device->address_list == NULL)
+            return NvDlaError_InsufficientMemory;
+        dla_device->address_list_size = num_addresses;
+    }
+    address_list = dla_device->address_list;
 
+    num_addresses = 0;
     for (i = 0; i < num_tasks; i++) {
-        uint32_t num_addresses = tasks[i].num_addresses =
-                            pTasks[i].num_addresses;
         uint32_t j;
 
-        tasks[i].address_list = (uintptr_t)address_list[i];
-        for (j = 0; j < num_addresses; j++) {
+        for (j = 0; j < pTasks[i].num_addresses; j++) {
             NvDlaMemHandle mem_handle = (NvDlaMemHandle)pTasks[i].address_list[j].handle;
 
-            address_list[i][j].handle = (uint32_t)mem_handle->fd;
-            address_list[i][j].offset = pTasks[i].address_list[j].offset;
+            address_list[num_addresses + j].handle = (uint32_t)mem_handle->fd;
+            address_list[num_addresses + j].offset = pTasks[i].address_list[j].offset;
         }
+        num_addresses += pTasks[i].num_addresses;
     }
 
-    if (ioctl(dla_device->fd, DRM_IOCTL_NVDLA_SUBMIT, &args) < 0) {
-        printf("%s: Error IOCTL failed (%s)\n",
-                        __func__, strerror(errno));
-        return NvDlaError_IoctlFailed;
+    /* the kernel takes a bounded number of tasks per ioctl */
+    num_addresses = 0;
+    for (first = 0; first < num_tasks; first += args.num_tasks) {
+        memset(&args, 0, sizeof(args));
+        args.tasks = (uintptr_t)tasks;
+        args.num_tasks = num_tasks - first;
+        if (args.num_tasks > NVDLA_MAX_TASKS_PER_SUBMIT)
+            args.num_tasks = NVDLA_MAX_TASKS_PER_SUBMIT;
+
+        memset(tasks, 0, sizeof(tasks));
+        for (i = 0; i < args.num_tasks; i++) {
+            tasks[i].num_addresses = pTasks[first + i].num_addresses;
+            tasks[i].address_list = (uintptr_t)&address_list[num_addresses];
+            num_addresses += tasks[i].num_addresses;
+        }
+
+        if (ioctl(dla_device->fd, DRM_IOCTL_NVDLA_SUBMIT, &args) < 0) {
+            printf("%s: Error IOCTL failed (%s)\n",
+                            __func__, strerror(errno));
+            e = NvDlaError_IoctlFailed;
+            break;
+        }
     }
 
-    return NvDlaSuccess;
+    return e;
 }
 
 NvDlaError
@@ -272,6 +335,7 @@ NvDlaClose(void *hDlaDevice)
     if (device_handle->fd != -1)
         (void)close(device_handle->fd);
 
+    NvDlaFree(device_handle->address_list);
     NvDlaFree(device_handle);
     return;
 }
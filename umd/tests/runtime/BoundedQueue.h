@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NVDLA_UTILS_BOUNDED_QUEUE_H
+#define NVDLA_UTILS_BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "dlatypes.h"
+
+// Bounded multi-producer/multi-consumer ring, lock free. Every cell carries
+// a sequence number telling producers and consumers whose turn it is, so
+// the only shared writes are the two position counters. Blocking push/pop
+// sleep on a condition variable, taken only when the ring is full or empty.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(NvU32 capacity) :
+        m_cells(roundUpPow2(capacity)),
+        m_mask(NvU32(m_cells.size()) - 1),
+        m_enqueuePos(0),
+        m_dequeuePos(0),
+        m_closed(false),
+        m_pushWaiters(0),
+        m_popWaiters(0),
+        m_depthSum(0),
+        m_depthSamples(0),
+        m_maxDepth(0)
+    {
+        for (NvU32 i = 0; i < m_cells.size(); i++)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool tryPush(const T& v)
+    {
+        Cell* cell;
+        NvU64 pos = m_enqueuePos.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            cell = &m_cells[pos & m_mask];
+            NvU64 seq = cell->sequence.load(std::memory_order_acquire);
+            NvS64 diff = NvS64(seq) - NvS64(pos);
+
+            if (diff == 0)
+            {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;   // full
+            }
+            else
+            {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = v;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T* v)
+    {
+        Cell* cell;
+        NvU64 pos = m_dequeuePos.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            cell = &m_cells[pos & m_mask];
+            NvU64 seq = cell->sequence.load(std::memory_order_acquire);
+            NvS64 diff = NvS64(seq) - NvS64(pos + 1);
+
+            if (diff == 0)
+            {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;   // empty
+            }
+            else
+            {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        *v = cell->value;
+        cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // blocks while full, this is where backpressure comes from
+    void push(const T& v)
+    {
+        if (!tryPush(v))
+        {
+            std::unique_lock<std::mutex> lock(m_waitMutex);
+            m_pushWaiters.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!tryPush(v))
+                m_notFull.wait(lock);
+            m_pushWaiters.fetch_sub(1);
+        }
+
+        wake(m_popWaiters, m_notEmpty);
+        sampleDepth();
+    }
+
+    // blocks while empty, false once the queue is closed and drained
+    bool pop(T* v)
+    {
+        bool ok = tryPop(v);
+
+        if (!ok)
+        {
+            std::unique_lock<std::mutex> lock(m_waitMutex);
+            m_popWaiters.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!(ok = tryPop(v)) && !m_closed.load(std::memory_order_acquire))
+                m_notEmpty.wait(lock);
+            if (!ok)
+                ok = tryPop(v);
+            m_popWaiters.fetch_sub(1);
+        }
+
+        if (ok)
+            wake(m_pushWaiters, m_notFull);
+        return ok;
+    }
+
+    void close()
+    {
+        m_closed.store(true, std::memory_order_release);
+
+        std::lock_guard<std::mutex> lock(m_waitMutex);
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+    NvU32 capacity() const { return m_mask + 1; }
+
+    NvU32 depth() const
+    {
+        NvU64 head = m_enqueuePos.load(std::memory_order_relaxed);
+        NvU64 tail = m_dequeuePos.load(std::memory_order_relaxed);
+        return head > tail ? NvU32(head - tail) : 0;
+    }
+
+    // occupancy seen by producers, averaged over every push
+    NvF32 averageDepth() const
+    {
+        NvU64 n = m_depthSamples.load(std::memory_order_relaxed);
+        return n ? NvF32(m_depthSum.load(std::memory_order_relaxed)) / NvF32(n) : 0.0f;
+    }
+
+    NvU32 maxDepth() const { return m_maxDepth.load(std::memory_order_relaxed); }
+
+protected:
+    struct Cell
+    {
+        std::atomic<NvU64> sequence;
+        T value;
+    };
+
+    static NvU32 roundUpPow2(NvU32 n)
+    {
+        NvU32 r = 2;
+        while (r < n)
+            r <<= 1;
+        return r;
+    }
+
+    // a waiter registers before its last try under the lock, so either it
+    // sees this change or we see it and take the lock to signal it
+    void wake(const std::atomic<NvU32>& waiters, std::condition_variable& cond)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) == 0)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_waitMutex);
+        }
+        cond.notify_one();
+    }
+
+    void sampleDepth()
+    {
+        NvU32 d = depth();
+        NvU32 seen = m_maxDepth.load(std::memory_order_relaxed);
+
+        m_depthSum.fetch_add(d, std::memory_order_relaxed);
+        m_depthSamples.fetch_add(1, std::memory_order_relaxed);
+        while (d > seen && !m_maxDepth.compare_exchange_weak(seen, d, std::memory_order_relaxed))
+            ;
+    }
+
+    std::vector<Cell> m_cells;
+    const NvU32 m_mask;
+
+    // producers and consumers spin on different cache lines
+    char m_pad0[64];
+    std::atomic<NvU64> m_enqueuePos;
+    char m_pad1[64];
+    std::atomic<NvU64> m_dequeuePos;
+    char m_pad2[64];
+    std::atomic<bool> m_closed;
+
+    // blocking callers park here, producers and consumers only lock it
+    // when the other side has a waiter
+    std::mutex m_waitMutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+    std::atomic<NvU32> m_pushWaiters;
+    std::atomic<NvU32> m_popWaiters;
+
+    std::atomic<NvU64> m_depthSum;
+    std::atomic<NvU64> m_depthSamples;
+    std::atomic<NvU32> m_maxDepth;
+};
+
+#endif // NVDLA_UTILS_BOUNDED_QUEUE_H
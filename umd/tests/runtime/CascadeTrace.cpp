@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CascadeTrace.h"
+
+#include <cstdio>
+
+void CascadeTrace::addSubmit(NvU32 part, nvdla::IRuntime* runtime, NvF32 margin)
+{
+    nvdla::IRuntime::NvDlaRuntimeStats stats;
+    Step step;
+
+    step.part = part;
+    step.submitUs = 0;
+    step.waitUs = 0;
+    step.margin = margin;
+
+    if (runtime->getStats(&stats) == NvDlaSuccess)
+    {
+        step.submitUs = stats.lastSubmitUs;
+        step.waitUs = stats.lastWaitUs;
+    }
+
+    steps.push_back(step);
+}
+
+std::string CascadeTrace::format() const
+{
+    std::string out("trace:");
+    char text[96];
+
+    if (cached)
+        out += " cached,";
+
+    for (size_t s = 0; s < steps.size(); s++)
+    {
+        const Step& step = steps[s];
+
+        // a cache hit only knows the answer's margin
+        if (cached)
+            snprintf(text, sizeof(text), " p%u margin %.3f", step.part, step.margin);
+        else
+            snprintf(text, sizeof(text), "%s p%u %lluus wait %lluus margin %.3f", s ? "," : "", step.part,
+                     (unsigned long long)step.submitUs, (unsigned long long)step.waitUs, step.margin);
+        out += text;
+
+        if (s == 0 && !cached && batch > 1)
+        {
+            snprintf(text, sizeof(text), " batch %u", batch);
+            out += text;
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NVDLA_UTILS_CASCADE_TRACE_H
+#define NVDLA_UTILS_CASCADE_TRACE_H
+
+#include <string>
+#include <vector>
+
+#include "nvdla/IRuntime.h"
+
+// What one input went through in the cascade: each loadable it was
+// submitted to, with the time that submit took, how much of it was spent
+// blocked on the engines and the margin it left. Runs answered from the
+// result cache only have the margin of the loadable that answered.
+struct CascadeTrace
+{
+    struct Step
+    {
+        NvU32 part;
+        NvU64 submitUs;
+        NvU64 waitUs;
+        NvF32 margin;
+    };
+
+    CascadeTrace() : cached(false), batch(1) { }
+
+    // the runtime's last submit, which was of loadable part
+    void addSubmit(NvU32 part, nvdla::IRuntime* runtime, NvF32 margin);
+
+    // one line, "trace: p0 1520us wait 1410us margin 0.213, p1 ..."
+    std::string format() const;
+
+    bool cached;
+    NvU32 batch;            /* inputs sharing the first loadable's submit */
+    std::vector<Step> steps;
+};
+
+#endif // NVDLA_UTILS_CASCADE_TRACE_H
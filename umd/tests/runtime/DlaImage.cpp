@@ -30,8 +30,13 @@
 #include "ErrorMacros.h"
 #include "nvdla_os_inf.h"
 #include "half.h"
+#include "PackSimd.h"
 
 #include <stdio.h> // snprintf
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <vector>
 
 const NvU32 NvDlaImage::ms_version = 0;
@@ -260,33 +265,165 @@ NvDlaError NvDlaImage::deserialize(std::stringstream& sstream)
     return NvDlaSuccess;
 }
 
-NvDlaError NvDlaImage::to_float(std::vector<NvF32>* outVec) const
+// Element converters. Feature data is canonicalized like stable hashing
+// does it: -0 becomes +0, fp16 NaN becomes +inf and fp32 NaN the quiet NaN.
+
+static inline void convertElements(const NvU16* src, NvF32* dst, NvU32 n)
+{
+    const PackF32x4 inf = splatF32x4(std::numeric_limits<NvF32>::infinity());
+    const PackF32x4 zero = splatF32x4(0.0f);
+    NvU32 i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        PackF32x4 f = fromHalf4(src + i) + zero;
+        PackU32x4 isNan = (PackU32x4)(f != f);
+
+        f = (PackF32x4)(((PackU32x4)f & ~isNan) | ((PackU32x4)inf & isNan));
+        memcpy(dst + i, &f, sizeof(f));
+    }
+
+    for (; i < n; i++)
+    {
+        NvU16 h[4] = { src[i], 0, 0, 0 };
+        NvF32 f = fromHalf4(h)[0] + 0.0f;
+
+        dst[i] = std::isnan(f) ? std::numeric_limits<NvF32>::infinity() : f;
+    }
+}
+
+static inline void convertElements(const NvF32* src, NvF32* dst, NvU32 n)
+{
+    const PackF32x4 nan = splatF32x4(std::numeric_limits<NvF32>::quiet_NaN());
+    const PackF32x4 zero = splatF32x4(0.0f);
+    NvU32 i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        PackF32x4 f;
+
+        memcpy(&f, src + i, sizeof(f));
+        f += zero;
+
+        PackU32x4 isNan = (PackU32x4)(f != f);
+        f = (PackF32x4)(((PackU32x4)f & ~isNan) | ((PackU32x4)nan & isNan));
+        memcpy(dst + i, &f, sizeof(f));
+    }
+
+    for (; i < n; i++)
+        dst[i] = std::isnan(src[i]) ? std::numeric_limits<NvF32>::quiet_NaN() : src[i] + 0.0f;
+}
+
+template <typename T>
+static inline void convertIntegers(const T* src, NvF32* dst, NvU32 n)
+{
+    NvU32 i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        PackF32x4 f = { NvF32(src[i]), NvF32(src[i + 1]), NvF32(src[i + 2]), NvF32(src[i + 3]) };
+        memcpy(dst + i, &f, sizeof(f));
+    }
+
+    for (; i < n; i++)
+        dst[i] = NvF32(src[i]);
+}
+
+static inline void convertElements(const NvS16* src, NvF32* dst, NvU32 n) { convertIntegers(src, dst, n); }
+static inline void convertElements(const NvS8* src, NvF32* dst, NvU32 n) { convertIntegers(src, dst, n); }
+
+// Converts a C x H x W surface stored as ceil(C/X) planes of X-channel
+// atoms, X == 1 being planar CHW. Each line is converted in one contiguous
+// pass and then scattered into the requested order.
+template <typename T, NvU32 X>
+static NvDlaError convertSurface(const NvDlaImage* image, NvF32* out, NvDlaImage::ElementOrder order)
+{
+    NvU32 width = image->m_meta.width;
+    NvU32 height = image->m_meta.height;
+    NvU32 channel = image->m_meta.channel;
+    NvU32 numGroups = (channel + X - 1) / X;
+    NvU64 lineBytes = NvU64(width) * X * sizeof(T);
+    NvU64 planeSize = NvU64(width) * height;
+    const NvU8* base = static_cast<const NvU8*>(image->m_pData);
+
+    if (width == 0 || height == 0 || channel == 0)
+        return NvDlaSuccess;
+
+    if (NvU64(numGroups - 1) * image->m_meta.surfaceStride + NvU64(height - 1) * image->m_meta.lineStride +
+        lineBytes > image->m_meta.size)
+        ORIGINATE_ERROR(NvDlaError_BadValue, "surface does not fit in %u bytes", image->m_meta.size);
+
+    std::vector<NvF32> line(NvU64(width) * X);
+
+    for (NvU32 g = 0; g < numGroups; g++)
+    {
+        NvU32 c0 = g * X;
+        NvU32 numChannels = std::min(X, channel - c0);
+
+        for (NvU32 y = 0; y < height; y++)
+        {
+            const T* src = reinterpret_cast<const T*>(base + NvU64(g) * image->m_meta.surfaceStride +
+                                                      NvU64(y) * image->m_meta.lineStride);
+
+            convertElements(src, &line[0], width * X);
+
+            if (order == NvDlaImage::ORDER_NHWC)
+            {
+                NvF32* dst = out + NvU64(y) * width * channel + c0;
+
+                for (NvU32 x = 0; x < width; x++, dst += channel)
+                    memcpy(dst, &line[x * X], numChannels * sizeof(NvF32));
+            }
+            else if (X == 1)
+            {
+                memcpy(out + c0 * planeSize + NvU64(y) * width, &line[0], width * sizeof(NvF32));
+            }
+            else
+            {
+                for (NvU32 c = 0; c < numChannels; c++)
+                {
+                    NvF32* dst = out + (c0 + c) * planeSize + NvU64(y) * width;
+
+                    for (NvU32 x = 0; x < width; x++)
+                        dst[x] = line[x * X + c];
+                }
+            }
+        }
+    }
+
+    return NvDlaSuccess;
+}
+
+// per element fallback for pixel formats without a specialized converter
+static NvDlaError toFloatGeneric(const NvDlaImage* image, NvF32* out, NvDlaImage::ElementOrder order)
 {
     NvDlaError e = NvDlaSuccess;
-    std::vector<NvF32> floatData;
-    PixelFormatType pftype = getPixelFormatType();
-    char* buf = reinterpret_cast<char*>(m_pData);
+    NvDlaImage::PixelFormatType pftype = image->getPixelFormatType();
+    char* buf = reinterpret_cast<char*>(image->m_pData);
+    NvU32 width = image->m_meta.width;
+    NvU32 height = image->m_meta.height;
+    NvU32 channel = image->m_meta.channel;
 
-    NvS8 bpe = getBpe();
+    NvS8 bpe = image->getBpe();
     if (bpe <= 0)
         ORIGINATE_ERROR(NvDlaError_BadParameter, "Invalid bytes per element %d", bpe);
     
-    if (pftype == UNKNOWN)
+    if (pftype == NvDlaImage::UNKNOWN)
         ORIGINATE_ERROR(NvDlaError_BadParameter, "Unknown pixel format type %u\n", pftype);
     
-    for (NvU32 c = 0; c < m_meta.channel; c++) 
+    for (NvU32 c = 0; c < channel; c++) 
     {
-        for (NvU32 y = 0; y < m_meta.height; y++) 
+        for (NvU32 y = 0; y < height; y++) 
         {
-            for (NvU32 x = 0; x < m_meta.width; x++)
+            for (NvU32 x = 0; x < width; x++)
             {
-                NvS32 offset = getAddrOffset(x, y, c);
+                NvS32 offset = image->getAddrOffset(x, y, c);
                 if (offset < 0)
                     ORIGINATE_ERROR(NvDlaError_BadValue, "Invalid getAddrOffset() => %d\n", offset);
                 
                 float value = 0.0f;
 
-                if (pftype == IEEEFP)
+                if (pftype == NvDlaImage::IEEEFP)
                 {
                     if (bpe == 2)
                     {
@@ -313,7 +450,7 @@ NvDlaError NvDlaImage::to_float(std::vector<NvF32>* outVec) const
                         ORIGINATE_ERROR(NvDlaError_NotSupported, "Unspported FP type");
                     }
                 }
-                else if (pftype == UINT)
+                else if (pftype == NvDlaImage::UINT)
                 {
                     unsigned int tmp = 0;
                     if (bpe == 1)
@@ -327,7 +464,7 @@ NvDlaError NvDlaImage::to_float(std::vector<NvF32>* outVec) const
                     
                     value = static_cast<NvF32>(tmp);
                 }
-                else if (pftype == INT)
+                else if (pftype == NvDlaImage::INT)
                 {
                     int tmp = 0;
 
@@ -347,16 +484,58 @@ NvDlaError NvDlaImage::to_float(std::vector<NvF32>* outVec) const
                     ORIGINATE_ERROR(NvDlaError_NotSupported, "Unspported type %u", pftype);
                 }
 
-                floatData.push_back(value);
+                if (order == NvDlaImage::ORDER_NHWC)
+                    out[(y * width + x) * channel + c] = value;
+                else
+                    out[(c * height + y) * width + x] = value;
             }
         }
     }
 
-    *outVec = floatData;
-
     return e;
 }
 
+NvDlaError NvDlaImage::to_float(std::vector<NvF32>* outVec) const
+{
+    if (!outVec)
+        ORIGINATE_ERROR(NvDlaError_BadParameter);
+
+    outVec->resize(size_t(m_meta.channel) * m_meta.height * m_meta.width);
+    if (outVec->empty())
+        return NvDlaSuccess;
+
+    PROPAGATE_ERROR(to_float(&(*outVec)[0], outVec->size(), ORDER_NCHW));
+
+    return NvDlaSuccess;
+}
+
+// Fills a caller owned buffer of C*H*W floats in NCHW or NHWC order. Feature
+// layouts go through the per-format converters, anything else falls back to
+// addressing each element.
+NvDlaError NvDlaImage::to_float(NvF32* out, size_t numElements, ElementOrder order) const
+{
+    if (!out || !m_pData)
+        ORIGINATE_ERROR(NvDlaError_BadParameter);
+
+    if (numElements < size_t(m_meta.channel) * m_meta.height * m_meta.width)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "output holds %u elements", NvU32(numElements));
+
+    switch (m_meta.surfaceFormat)
+    {
+        case D_F16_CxHWx_x16_F: PROPAGATE_ERROR((convertSurface<NvU16, 16>(this, out, order))); break;
+        case D_F16_CxHWx_x16_I: PROPAGATE_ERROR((convertSurface<NvS16, 16>(this, out, order))); break;
+        case D_F8_CxHWx_x32_I:  PROPAGATE_ERROR((convertSurface<NvS8, 32>(this, out, order))); break;
+        case D_F32_CxHWx_x8_F:  PROPAGATE_ERROR((convertSurface<NvF32, 8>(this, out, order))); break;
+        case D_F16_CHW_F:       PROPAGATE_ERROR((convertSurface<NvU16, 1>(this, out, order))); break;
+        case D_F16_CHW_I:       PROPAGATE_ERROR((convertSurface<NvS16, 1>(this, out, order))); break;
+        case D_F8_CHW_I:        PROPAGATE_ERROR((convertSurface<NvS8, 1>(this, out, order))); break;
+        case D_F32_CHW_F:       PROPAGATE_ERROR((convertSurface<NvF32, 1>(this, out, order))); break;
+        default:                PROPAGATE_ERROR(toFloatGeneric(this, out, order)); break;
+    }
+
+    return NvDlaSuccess;
+}
+
 NvDlaError NvDlaImage::packData(std::stringstream& sstream, bool stableHash, bool asRaw) const
 {
     NvS8 bpe = getBpe();
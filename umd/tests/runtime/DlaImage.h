@@ -103,6 +103,12 @@ public:
         UNKNOWN = 3
     } PixelFormatType;
 
+    typedef enum _ElementOrder
+    {
+        ORDER_NCHW = 0,
+        ORDER_NHWC = 1
+    } ElementOrder;
+
     static const NvU32 ms_version;
 
     struct Metadata
@@ -131,6 +137,7 @@ public:
     NvDlaError unpackData(std::stringstream& sstream);
 
     NvDlaError to_float(std::vector<NvF32>* outVec) const;
+    NvDlaError to_float(NvF32* out, size_t numElements, ElementOrder order) const;
 };
 
 #endif // NVDLA_UTILS_DLAIMAGE_H
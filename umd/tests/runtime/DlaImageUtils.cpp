@@ -32,15 +32,18 @@
 #include "nvdla_os_inf.h"
 #include "half.h"
 
-extern "C" {
-#include "jpeglib.h"
-}
-
 #include <fstream>
 #include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 
-static NvDlaError parsePGMInfo(std::ifstream& hFile, NvDlaImage* image);
-static NvDlaError parsePGMData(std::ifstream& hFile, NvDlaImage* image);
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 
 static int roundUp(int numToRound, int multiple)
@@ -55,16 +58,109 @@ static int roundUp(int numToRound, int multiple)
     return numToRound + multiple - remainder;
 }
 
+NvDlaError mapFile(std::string filename, const NvU8** data, size_t* size)
+{
+    struct stat st;
+    void* map;
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        ORIGINATE_ERROR(NvDlaError_FileOperationFailed, "Cant open file %s", filename.c_str());
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        ORIGINATE_ERROR(NvDlaError_FileReadFailed, "%s is empty", filename.c_str());
+    }
+
+    // the mapping keeps its own reference to the file
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        ORIGINATE_ERROR(NvDlaError_FileReadFailed, "mmap failed for %s", filename.c_str());
+
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    *data = static_cast<const NvU8*>(map);
+    *size = st.st_size;
+
+    return NvDlaSuccess;
+}
+
+void unmapFile(const NvU8* data, size_t size)
+{
+    if (data)
+        munmap(const_cast<NvU8*>(data), size);
+}
+
 NvDlaError PGM2DIMG(std::string inputfilename, NvDlaImage* output)
 {
-    std::ifstream hFile(inputfilename.c_str());
+    NvDlaError e = NvDlaSuccess;
+    const NvU8* data = NULL;
+    size_t size = 0;
+
+    PROPAGATE_ERROR(mapFile(inputfilename, &data, &size));
+    PROPAGATE_ERROR_FAIL(PGMBuffer2DIMG(data, size, output));
+
+fail:
+    unmapFile(data, size);
+    return e;
+}
+
+// next header line of a PGM, '#' comment lines skipped
+static bool nextPGMLine(const char** pos, const char* end, std::string* line)
+{
+    while (*pos < end)
+    {
+        const char* eol = static_cast<const char*>(memchr(*pos, '\n', end - *pos));
+        if (!eol)
+            return false;
+
+        line->assign(*pos, eol - *pos);
+        *pos = eol + 1;
+
+        if (line->empty() || (*line)[0] != '#')
+            return true;
+    }
+
+    return false;
+}
+
+NvDlaError PGMBuffer2DIMG(const NvU8* data, size_t size, NvDlaImage* output)
+{
+    const char* pos = reinterpret_cast<const char*>(data);
+    const char* end = pos + size;
+    std::string header[3];
+    NvU32 width, height, maxVal;
     NvS8 bpe = -1;
 
-    if (hFile.fail())
-        ORIGINATE_ERROR(NvDlaError_FileOperationFailed, "File operation failed: \"%s\"", inputfilename.c_str());
+    if (!data || !output)
+        ORIGINATE_ERROR(NvDlaError_BadParameter);
 
-    // Parse the header
-    PROPAGATE_ERROR(parsePGMInfo(hFile, output));
+    // Parse header, 3 real ASCII lines
+    for (NvU32 ii = 0; ii < 3; ii++)
+    {
+        if (!nextPGMLine(&pos, end, &header[ii]))
+            ORIGINATE_ERROR(NvDlaError_BadValue, "Truncated PGM header");
+    }
+
+    if (header[0].compare("P5") != 0)
+        ORIGINATE_ERROR(NvDlaError_BadValue, "Unexpected PGM value: %s", header[0].c_str());
+
+    if (sscanf(header[1].c_str(), "%u %u", &width, &height) != 2)
+        ORIGINATE_ERROR(NvDlaError_BadValue, "Unexpected PGM value: %s", header[1].c_str());
+
+    // We only support .pgm's with maxVal == 255
+    if (sscanf(header[2].c_str(), "%u", &maxVal) != 1 || maxVal != 255)
+        ORIGINATE_ERROR(NvDlaError_BadValue, "Unexpected PGM value: %s", header[2].c_str());
+
+    if (NvU64(end - pos) < NvU64(width) * height)
+        ORIGINATE_ERROR(NvDlaError_BadValue, "PGM data is truncated");
+
+    output->m_meta.surfaceFormat = NvDlaImage::T_R8;
+    output->m_meta.width = width;
+    output->m_meta.height = height;
+    output->m_meta.channel = 1;
 
     bpe = output->getBpe();
     if (bpe <= 0)
@@ -77,207 +173,325 @@ NvDlaError PGM2DIMG(std::string inputfilename, NvDlaImage* output)
     output->m_meta.surfaceStride = roundUp(output->m_meta.lineStride * output->m_meta.height, strideAlign);
     output->m_meta.size = roundUp(output->m_meta.surfaceStride, sizeAlign);
 
-    NvDlaDebugPrintf("pgm2dimg %d %d %d %d %d %d %d\n",
-                    output->m_meta.channel,
-                    output->m_meta.height,
-                    output->m_meta.width,
-                    bpe,
-                    output->m_meta.lineStride,
-                    output->m_meta.surfaceStride,
-                    output->m_meta.size);
-
     // Allocate the buffer
     output->m_pData = NvDlaAlloc(output->m_meta.size);
     if (!output->m_pData)
         ORIGINATE_ERROR(NvDlaError_InsufficientMemory);
 
-    // Copy the data
-    PROPAGATE_ERROR(parsePGMData(hFile, output));
-
-    hFile.close();
+    // Copy the rows, padding stays zero
+    NvU8* buf = static_cast<NvU8*>(output->m_pData);
+    memset(buf, 0, output->m_meta.size);
+    for (NvU32 y = 0; y < height; y++)
+        memcpy(buf + NvU64(y) * output->m_meta.lineStride, pos + NvU64(y) * width, width);
 
     return NvDlaSuccess;
 }
 
-NvDlaError JPEG2DIMG(std::string inputFileName, NvDlaImage* output)
+//
+// .dimg files are "DIMG", the format version, the raw Metadata and then
+// every element in c, y, x order. The writer stages data in a fixed buffer
+// and hands planar lines to writev() straight from the surface; the reader
+// maps the file and scatters whole lines back into a surface.
+//
+
+#define DIMG_IO_BUFFER_SIZE (64 * 1024)
+#define DIMG_IO_MAX_IOV 64
+
+// channels per atom for the feature layouts, 0 for formats that need
+// NvDlaImage::getAddrOffset() per element
+static NvU32 dimgAtomChannels(NvDlaImage::PixelFormat format)
 {
-    NvDlaError e = NvDlaSuccess;
-    NvU8* rowPtr[1];
-    struct jpeg_decompress_struct info;
-    struct jpeg_error_mgr err;
+    switch (format)
+    {
+        case NvDlaImage::D_F8_CHW_I:
+        case NvDlaImage::D_F16_CHW_I:
+        case NvDlaImage::D_F16_CHW_F:
+        case NvDlaImage::D_F32_CHW_F:
+            return 1;
+        case NvDlaImage::D_F32_CxHWx_x8_F:
+            return 8;
+        case NvDlaImage::D_F16_CxHWx_x16_I:
+        case NvDlaImage::D_F16_CxHWx_x16_F:
+            return 16;
+        case NvDlaImage::D_F8_CxHWx_x32_I:
+            return 32;
+        default:
+            return 0;
+    }
+}
 
-    FILE* fp = fopen(inputFileName.c_str(), "rb");
-    if (!fp) {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "Cant open file %s", inputFileName.c_str());
+static NvU16 halfBits(half_float::half h)
+{
+    NvU16 bits;
+    memcpy(&bits, &h, sizeof(bits));
+    return bits;
+}
+
+// the stable hash rules of NvDlaImage::packData(), on raw bits
+static void canonicalizeHalf(NvU16* v, NvU32 n)
+{
+    static const NvU16 matchBits = halfBits(half_float::half(float(0x8000)));
+    static const NvU16 nanBits = halfBits(half_float::half(float(0x7C00)));
+
+    for (NvU32 i = 0; i < n; i++)
+    {
+        if (v[i] == matchBits)
+            v[i] = 0x0000;
+        else if ((v[i] & 0x7c00) == 0x7c00 && (v[i] & 0x03ff) != 0)
+            v[i] = nanBits;
     }
+}
 
-    // Prepare for jpeg decomp
-    info.err = jpeg_std_error(&err);
-    info.dct_method = JDCT_ISLOW;
-    jpeg_create_decompress(&info);
-
-    jpeg_stdio_src(&info, fp);
-    jpeg_read_header(&info, TRUE);
-
-    // FIXME: right now assuming 8-bit jpegs
-    switch(info.jpeg_color_space) {
-        case JCS_GRAYSCALE:
-            output->m_meta.surfaceFormat = NvDlaImage::T_R8;
-            output->m_meta.channel = 1;
-            break;
-#if defined(JCS_EXTENSIONS)
-        case JCS_YCbCr: // FIXME: dont know how to handle compression yet
-        case JCS_RGB:
-            output->m_meta.surfaceFormat = NvDlaImage::T_R8G8B8;
-            output->m_meta.channel = 3;
-            break;
-        case JCS_EXT_RGB: // upsizing to 4 Chnls from 3 Chnls
-        case JCS_EXT_RGBX:
-            output->m_meta.surfaceFormat = NvDlaImage::T_R8G8B8X8;
-            output->m_meta.channel = 4;
-            break;
-        case JCS_EXT_BGR: // upsizing to 4 Chnls from 3 Chnls
-        case JCS_EXT_BGRX:
-            output->m_meta.surfaceFormat = NvDlaImage::T_B8G8R8X8;
-            output->m_meta.channel = 4;
-            break;
-        case JCS_EXT_XBGR:
-            output->m_meta.surfaceFormat = NvDlaImage::T_X8B8G8R8;
-            output->m_meta.channel = 4;
-            break;
-        case JCS_EXT_XRGB:
-            output->m_meta.surfaceFormat = NvDlaImage::T_X8R8G8B8;
-            output->m_meta.channel = 4;
-            break;
-#if defined(JCS_ALPHA_EXTENSIONS)
-        case JCS_EXT_RGBA:
-            output->m_meta.surfaceFormat = NvDlaImage::T_R8G8B8A8;
-            output->m_meta.channel = 4;
-            break;
-        case JCS_EXT_BGRA:
-            output->m_meta.surfaceFormat = NvDlaImage::T_B8G8R8A8;
-            output->m_meta.channel = 4;
-            break;
-        case JCS_EXT_ABGR:
-            output->m_meta.surfaceFormat = NvDlaImage::T_A8B8G8R8;
-            output->m_meta.channel = 4;
-            break;
-        case JCS_EXT_ARGB:
-            output->m_meta.surfaceFormat = NvDlaImage::T_A8R8G8B8;
-            output->m_meta.channel = 4;
-            break;
-#endif  // JCS_ALPHA_EXTENSIONS
-#endif  // JCS_EXTENSIONS
-        case JCS_CMYK:
-        case JCS_YCCK:
-        default: ORIGINATE_ERROR_FAIL(NvDlaError_NotSupported, "JPEG color space %d not supported", info.jpeg_color_space);
+static void canonicalizeFloat(NvF32* v, NvU32 n)
+{
+    for (NvU32 i = 0; i < n; i++)
+    {
+        if (v[i] == 0x80000000)
+            v[i] = 0x0;
+        else if (std::isnan(v[i]))
+            v[i] = 0x7FBFFFFF;
     }
+}
 
-    NvDlaDebugPrintf("surface format: %d\n", (int)output->m_meta.surfaceFormat);
+class DimgWriter
+{
+public:
+    DimgWriter(int fd) : m_fd(fd), m_used(0), m_error(false) {}
 
-    jpeg_start_decompress(&info);
+    NvU8* reserve(size_t n)
+    {
+        if (m_used + n > sizeof(m_buf))
+            flush();
+        return m_buf + m_used;
+    }
 
-    // Read image size
-    output->m_meta.height = info.image_height;
-    output->m_meta.width = info.image_width;
-    output->m_meta.lineStride = roundUp(output->m_meta.width * output->m_meta.channel * output->getBpe(), 32);
-    output->m_meta.surfaceStride = 0;
-    output->m_meta.size = output->m_meta.lineStride * output->m_meta.height;
+    void commit(size_t n) { m_used += n; }
 
-    NvDlaDebugPrintf("dlaimg height: %d x %d x %d: ", output->m_meta.height, output->m_meta.width, output->m_meta.channel);
-    NvDlaDebugPrintf("LS: %d SS: %d Size: %d\n", output->m_meta.lineStride, output->m_meta.surfaceStride, output->m_meta.size);
+    void put(const void* data, size_t n)
+    {
+        const NvU8* p = static_cast<const NvU8*>(data);
+
+        while (n)
+        {
+            size_t chunk = std::min(n, sizeof(m_buf) - m_used);
+
+            memcpy(m_buf + m_used, p, chunk);
+            m_used += chunk;
+            p += chunk;
+            n -= chunk;
+            if (m_used == sizeof(m_buf))
+                flush();
+        }
+    }
 
-    // Allocate the buffer
-    output->m_pData = NvDlaAlloc(output->m_meta.size);
-    NvDlaMemset(output->m_pData, 0, output->m_meta.size);
-    if (!output->m_pData)
-        ORIGINATE_ERROR(NvDlaError_InsufficientMemory);
+    // lines straight from the surface, after whatever is staged
+    void putLines(struct iovec* iov, int count)
+    {
+        flush();
+        writeAll(iov, count);
+    }
+
+    void flush()
+    {
+        struct iovec iov;
+
+        if (!m_used)
+            return;
+
+        iov.iov_base = m_buf;
+        iov.iov_len = m_used;
+        writeAll(&iov, 1);
+        m_used = 0;
+    }
 
-    // copy the data
+    bool failed() const { return m_error; }
+
+protected:
+    void writeAll(struct iovec* iov, int count)
     {
-        rowPtr[0] = static_cast<NvU8*>(output->m_pData);
-        while (info.output_scanline < info.output_height) {
-            jpeg_read_scanlines(&info, rowPtr, 1);
-            rowPtr[0] += output->m_meta.lineStride;
+        while (count > 0 && !m_error)
+        {
+            ssize_t n = writev(m_fd, iov, count);
+
+            if (n < 0)
+            {
+                m_error = (errno != EINTR);
+                continue;
+            }
+
+            while (count > 0 && size_t(n) >= iov->iov_len)
+            {
+                n -= iov->iov_len;
+                iov++;
+                count--;
+            }
+
+            if (count > 0)
+            {
+                iov->iov_base = static_cast<NvU8*>(iov->iov_base) + n;
+                iov->iov_len -= n;
+            }
         }
     }
 
-fail:
-    jpeg_finish_decompress(&info);
-    fclose(fp);
-    return e;
-}
+    int m_fd;
+    size_t m_used;
+    bool m_error;
+    NvU8 m_buf[DIMG_IO_BUFFER_SIZE];
+};
 
-static NvDlaError parsePGMInfo(std::ifstream& hFile, NvDlaImage* image)
+// gathers elements [x0, x0 + n) of line (c, y) into dst
+static void gatherLine(const NvDlaImage* image, NvU32 atomChannels, NvU32 bpe,
+                       NvU32 c, NvU32 y, NvU32 x0, NvU32 n, NvU8* dst)
 {
-    NvU32 width;
-    NvU32 height;
-    NvU32 maxVal;
-    std::istringstream iss;
-    std::string header[3];
-    NvU32 ii = 0;
+    const NvU8* buf = static_cast<const NvU8*>(image->m_pData);
 
-    // Parse header, read 3 real ASCII lines
-    while (ii < 3)
+    if (atomChannels == 0)
     {
-        std::getline(hFile, header[ii]);
+        for (NvU32 x = 0; x < n; x++, dst += bpe)
+            memcpy(dst, buf + image->getAddrOffset(x0 + x, y, c), bpe);
+        return;
+    }
 
-        // Pass over comments
-        if (header[ii][0] == '#')
-            continue;
+    const NvU8* src = buf + NvU64(c / atomChannels) * image->m_meta.surfaceStride +
+                      NvU64(y) * image->m_meta.lineStride +
+                      (NvU64(x0) * atomChannels + c % atomChannels) * bpe;
+    NvU32 step = atomChannels * bpe;
 
-        ii = ii + 1;
+    switch (bpe)
+    {
+        case 1: for (NvU32 x = 0; x < n; x++, src += step) dst[x] = *src; break;
+        case 2: for (NvU32 x = 0; x < n; x++, src += step) memcpy(dst + 2 * x, src, 2); break;
+        default: for (NvU32 x = 0; x < n; x++, src += step) memcpy(dst + 4 * x, src, 4); break;
     }
+}
 
-    // Parse the magic word
-    if (header[0].compare("P5") != 0)
-        ORIGINATE_ERROR(NvDlaError_BadValue, "Unexpected PGM value: %s", header[0].c_str());
+static void scatterLine(NvDlaImage* image, NvU32 atomChannels, NvU32 bpe,
+                        NvU32 c, NvU32 y, const NvU8* src)
+{
+    NvU8* buf = static_cast<NvU8*>(image->m_pData);
+    NvU32 width = image->m_meta.width;
 
-    // Gather the width and height parameters
-    iss.str(header[1]);
-    if (!(iss >> width >> height))
-        ORIGINATE_ERROR(NvDlaError_BadValue, "Unexpected PGM value: %s", header[1].c_str());
-    iss.clear();
+    if (atomChannels == 0)
+    {
+        for (NvU32 x = 0; x < width; x++, src += bpe)
+            memcpy(buf + image->getAddrOffset(x, y, c), src, bpe);
+        return;
+    }
 
-    // Gather the max value
-    iss.str(header[2]);
-    if (!(iss >> maxVal))
-        ORIGINATE_ERROR(NvDlaError_BadValue, "Unexpected PGM value: %s", header[2].c_str());
-    iss.clear();
+    NvU8* dst = buf + NvU64(c / atomChannels) * image->m_meta.surfaceStride +
+                NvU64(y) * image->m_meta.lineStride + NvU64(c % atomChannels) * bpe;
+    NvU32 step = atomChannels * bpe;
 
-    // We only support .pgm's with maxVal == 255
-    if (maxVal != 255)
-        ORIGINATE_ERROR(NvDlaError_BadValue, "Unexpected PGM value: %s", header[2].c_str());
+    if (atomChannels == 1)
+    {
+        memcpy(dst, src, NvU64(width) * bpe);
+        return;
+    }
 
-    // Transfer information
-    image->m_meta.surfaceFormat = NvDlaImage::T_R8;
-    image->m_meta.width = width;
-    image->m_meta.height = height;
-    image->m_meta.channel = 1;
+    switch (bpe)
+    {
+        case 1: for (NvU32 x = 0; x < width; x++, dst += step) *dst = src[x]; break;
+        case 2: for (NvU32 x = 0; x < width; x++, dst += step) memcpy(dst, src + 2 * x, 2); break;
+        default: for (NvU32 x = 0; x < width; x++, dst += step) memcpy(dst, src + 4 * x, 4); break;
+    }
+}
 
-    NvDlaDebugPrintf("ppgminfo %d %d %d\n",
-                    image->m_meta.channel,
-                    image->m_meta.height,
-                    image->m_meta.width);
+// the readable dump, the element values in NCHW order as text
+static NvDlaError writeDimgRaw(DimgWriter* writer, const NvDlaImage* input)
+{
+    std::vector<NvF32> values;
+
+    PROPAGATE_ERROR(input->to_float(&values));
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        char* text = reinterpret_cast<char*>(writer->reserve(32));
+        writer->commit(snprintf(text, 32, "%g ", values[i]));
+    }
 
     return NvDlaSuccess;
 }
 
-static NvDlaError parsePGMData(std::ifstream& hFile, NvDlaImage* image)
+static NvDlaError writeDimgData(DimgWriter* writer, const NvDlaImage* input, bool stableHash, bool rawDump)
 {
-    void* buf = image->m_pData;
+    NvS8 bpe = input->getBpe();
+    NvDlaImage::PixelFormatType pftype = input->getPixelFormatType();
+    NvU32 atomChannels = dimgAtomChannels(input->m_meta.surfaceFormat);
+    NvU32 width = input->m_meta.width;
+    NvU32 height = input->m_meta.height;
+    NvU32 channel = input->m_meta.channel;
+    bool canonicalize;
 
-    // Clear contents
-    memset(buf, 0, image->m_meta.size);
+    if (bpe <= 0)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "Invalid bytes per element %d", bpe);
+    if (pftype == NvDlaImage::UNKNOWN)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "Unknown pixel format type %u\n", pftype);
+    if (width == 0 || height == 0 || channel == 0)
+        return NvDlaSuccess;
+
+    if (atomChannels != 0 &&
+        NvU64((channel - 1) / atomChannels) * input->m_meta.surfaceStride +
+        NvU64(height - 1) * input->m_meta.lineStride + NvU64(width) * atomChannels * bpe > input->m_meta.size)
+        ORIGINATE_ERROR(NvDlaError_BadValue, "surface does not fit in %u bytes", input->m_meta.size);
+
+    if (rawDump)
+        return writeDimgRaw(writer, input);
+
+    canonicalize = stableHash && pftype == NvDlaImage::IEEEFP;
+    if (canonicalize && bpe != 2 && bpe != 4)
+        ORIGINATE_ERROR(NvDlaError_NotSupported, "Unspported FP type");
 
-    // Copy contents
-    for (NvU32 y=0; y<image->m_meta.height; y++)
+    // planar lines that go out untouched are written from the surface itself
+    if (atomChannels == 1 && !canonicalize)
     {
-        char* linebuf = reinterpret_cast<char*>(buf) + (y * image->m_meta.lineStride);
-        hFile.read(linebuf, image->m_meta.width);
+        struct iovec iov[DIMG_IO_MAX_IOV];
+        int count = 0;
+        const NvU8* buf = static_cast<const NvU8*>(input->m_pData);
+
+        for (NvU32 c = 0; c < channel; c++)
+        {
+            for (NvU32 y = 0; y < height; y++)
+            {
+                iov[count].iov_base = const_cast<NvU8*>(buf + NvU64(c) * input->m_meta.surfaceStride +
+                                                        NvU64(y) * input->m_meta.lineStride);
+                iov[count].iov_len = NvU64(width) * bpe;
+                if (++count == DIMG_IO_MAX_IOV)
+                {
+                    writer->putLines(iov, count);
+                    count = 0;
+                }
+            }
+        }
+
+        if (count)
+            writer->putLines(iov, count);
+
+        return NvDlaSuccess;
+    }
 
-        if (hFile.fail())
-             ORIGINATE_ERROR(NvDlaError_FileOperationFailed, "File operation failed");
+    // everything else is gathered into the write buffer a chunk at a time
+    NvU32 chunk = std::min(width, NvU32(DIMG_IO_BUFFER_SIZE / bpe));
+
+    for (NvU32 c = 0; c < channel; c++)
+    {
+        for (NvU32 y = 0; y < height; y++)
+        {
+            for (NvU32 x0 = 0; x0 < width; x0 += chunk)
+            {
+                NvU32 n = std::min(chunk, width - x0);
+                NvU8* dst = writer->reserve(n * bpe);
+
+                gatherLine(input, atomChannels, bpe, c, y, x0, n, dst);
+
+                if (canonicalize && bpe == 2)
+                    canonicalizeHalf(reinterpret_cast<NvU16*>(dst), n);
+                else if (canonicalize)
+                    canonicalizeFloat(reinterpret_cast<NvF32*>(dst), n);
+
+                writer->commit(n * bpe);
+            }
+        }
     }
 
     return NvDlaSuccess;
@@ -285,38 +499,91 @@ static NvDlaError parsePGMData(std::ifstream& hFile, NvDlaImage* image)
 
 NvDlaError DIMG2DIMGFile(const NvDlaImage* input, std::string outputfilename, bool stableHash, bool rawDump)
 {
-    // Prepare NvDlaImage serialization stream
-    std::stringstream sstream;
+    NvDlaError e = NvDlaSuccess;
+    DimgWriter* writer = NULL;
 
-    if (rawDump)
-        PROPAGATE_ERROR(input->packData(sstream, stableHash, true));
-    else
-        PROPAGATE_ERROR(input->serialize(sstream, stableHash));
+    int fd = open(outputfilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        ORIGINATE_ERROR(NvDlaError_FileOperationFailed, "Cant open file %s", outputfilename.c_str());
 
-    const std::string& str = sstream.str();
+    // the staging buffer is too big for the stack of every caller
+    writer = new DimgWriter(fd);
 
-    std::ofstream file;
-    file.open(outputfilename.c_str(), std::ofstream::binary);
-    file.write(str.c_str(), str.length());
-    file.close();
+    if (!rawDump)
+    {
+        writer->put("DIMG", 4);
+        writer->put(&NvDlaImage::ms_version, sizeof(NvDlaImage::ms_version));
+        writer->put(&input->m_meta, sizeof(input->m_meta));
+    }
 
-    return NvDlaSuccess;
+    PROPAGATE_ERROR_FAIL(writeDimgData(writer, input, stableHash, rawDump));
+
+    writer->flush();
+    if (writer->failed())
+        ORIGINATE_ERROR_FAIL(NvDlaError_FileWriteFailed, "write failed for %s", outputfilename.c_str());
+
+fail:
+    delete writer;
+    close(fd);
+    return e;
 }
 
 NvDlaError DIMGFile2DIMG(std::string inputfilename, NvDlaImage* output)
 {
-    // Prepare NvDlaImage deserialization stream
-    std::stringstream sstream;
+    NvDlaError e = NvDlaSuccess;
+    const NvU8* map = NULL;
+    const NvU8* data;
+    size_t mapSize = 0;
+    size_t headerSize = 4 + sizeof(NvU32) + sizeof(output->m_meta);
+    NvU64 lineBytes, dataSize;
+    NvU32 version, atomChannels;
+    NvS8 bpe;
 
-    std::ifstream file;
-    file.open(inputfilename.c_str(), std::ifstream::binary);
-    copy(std::istreambuf_iterator<char>(file),
-         std::istreambuf_iterator<char>(),
-         std::ostreambuf_iterator<char>(sstream));
+    PROPAGATE_ERROR(mapFile(inputfilename, &map, &mapSize));
 
-    PROPAGATE_ERROR(output->deserialize(sstream));
+    if (mapSize < headerSize)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "%s is too short", inputfilename.c_str());
 
-    file.close();
+    if (memcmp(map, "DIMG", 4) != 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "Unknown NvDlaImage header");
 
-    return NvDlaSuccess;
+    memcpy(&version, map + 4, sizeof(version));
+    if (version != NvDlaImage::ms_version)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "Mismatching NvDlaImage version %u: expected version %u", version, NvDlaImage::ms_version);
+
+    memcpy(&output->m_meta, map + 8, sizeof(output->m_meta));
+
+    bpe = output->getBpe();
+    if (bpe <= 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "Invalid bytes per element %d", bpe);
+    if (output->getPixelFormatType() == NvDlaImage::UNKNOWN)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "Unknown pixel format type");
+
+    lineBytes = NvU64(output->m_meta.width) * bpe;
+    dataSize = lineBytes * output->m_meta.height * output->m_meta.channel;
+    if (NvU64(mapSize) < headerSize + dataSize)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "%s is truncated", inputfilename.c_str());
+
+    atomChannels = dimgAtomChannels(output->m_meta.surfaceFormat);
+    if (dataSize && atomChannels != 0 &&
+        NvU64((output->m_meta.channel - 1) / atomChannels) * output->m_meta.surfaceStride +
+        NvU64(output->m_meta.height - 1) * output->m_meta.lineStride +
+        NvU64(output->m_meta.width) * atomChannels * bpe > output->m_meta.size)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadValue, "surface does not fit in %u bytes", output->m_meta.size);
+
+    output->m_pData = NvDlaAlloc(output->m_meta.size);
+    if (!output->m_pData)
+        ORIGINATE_ERROR_FAIL(NvDlaError_InsufficientMemory);
+    memset(output->m_pData, 0, output->m_meta.size);
+
+    data = map + headerSize;
+    for (NvU32 c = 0; dataSize && c < output->m_meta.channel; c++)
+    {
+        for (NvU32 y = 0; y < output->m_meta.height; y++, data += lineBytes)
+            scatterLine(output, atomChannels, bpe, c, y, data);
+    }
+
+fail:
+    unmapFile(map, mapSize);
+    return e;
 }
@@ -33,11 +33,15 @@
 
 #include "DlaImage.h"
 
+// read-only mapping of a whole file, released with unmapFile()
+NvDlaError mapFile(std::string filename, const NvU8** data, size_t* size);
+void unmapFile(const NvU8* data, size_t size);
+
 NvDlaError PGM2DIMG(std::string inputfilename, NvDlaImage* output);
+NvDlaError PGMBuffer2DIMG(const NvU8* data, size_t size, NvDlaImage* output);
 NvDlaError DIMG2Tiff(const NvDlaImage* input, std::string outputfilename);
 NvDlaError DIMG2DIMGFile(const NvDlaImage* input, std::string outputfilename, bool stableHash, bool rawDump);
 NvDlaError DIMGFile2DIMG(std::string inputfilename, NvDlaImage* output);
-NvDlaError JPEG2DIMG(std::string inputfilename, NvDlaImage* output);
 
 #if defined(NVDLA_UTILS_CAFFE) || defined(NVDLA_UTILS_NVCAFFE)
 #include <caffe/blob.hpp>
@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ErrorMacros.h"
+#ifndef RUNTIME_TEST_H
+#define RUNTIME_TEST_H
+#include "RuntimeTest.h"
+#endif
+
+#include "ImageLoader.h"
+#include "Pipeline.h"
+#include "ResultCache.h"
+#include "main.h"
+
+#include "nvdla_os_inf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+ImageLoader::ImageLoader(nvdla::IRuntime* runtime, const nvdla::IRuntime::NvDlaTensor& desc,
+                         const PreprocessParams& params) :
+    m_runtime(runtime),
+    m_desc(desc),
+    m_params(params),
+    m_images(NULL),
+    m_nextClaim(0),
+    m_nextOut(0),
+    m_released(0),
+    m_stop(false)
+{
+}
+
+ImageLoader::~ImageLoader()
+{
+    stop();
+
+    for (size_t b = 0; b < m_buffers.size(); b++)
+    {
+        if (m_buffers[b].handle)
+            m_runtime->freeSystemMemory(m_buffers[b].handle, m_desc.bufferSize);
+    }
+}
+
+NvDlaError ImageLoader::start(const std::vector<std::string>* images, NvU32 numThreads, NvU32 depth)
+{
+    if (!images || !m_threads.empty())
+        ORIGINATE_ERROR(NvDlaError_InvalidState, "loader already started");
+
+    // every decoder needs a slot of its own to make progress
+    depth = std::max(depth, numThreads + 1);
+
+    m_images = images;
+    m_buffers.resize(depth);
+    for (NvU32 b = 0; b < depth; b++)
+    {
+        Buffer& buffer = m_buffers[b];
+
+        buffer.handle = NULL;
+        buffer.data = NULL;
+        buffer.ready = false;
+        PROPAGATE_ERROR(m_runtime->allocateSystemMemory(&buffer.handle, m_desc.bufferSize, &buffer.data));
+    }
+
+    for (NvU32 t = 0; t < std::max(numThreads, 1U); t++)
+        m_threads.push_back(std::thread(&ImageLoader::workerLoop, this));
+
+    return NvDlaSuccess;
+}
+
+void ImageLoader::workerLoop()
+{
+    for (;;)
+    {
+        NvU32 index;
+        Buffer* buffer;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            // the ring slot of image i frees up once image i - depth is released
+            while (!m_stop && m_nextClaim < m_images->size() &&
+                   m_nextClaim >= m_released + m_buffers.size())
+                m_claimCond.wait(lock);
+
+            if (m_stop || m_nextClaim >= m_images->size())
+                return;
+
+            index = m_nextClaim++;
+            buffer = &m_buffers[index % m_buffers.size()];
+        }
+
+        NvDlaError status = imageFile2Tensor(m_images->at(index), &m_params, &m_desc, buffer->data);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            buffer->image = index;
+            buffer->status = status;
+            buffer->ready = true;
+        }
+        m_readyCond.notify_all();
+    }
+}
+
+bool ImageLoader::next(Item* item)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_stop || m_nextOut >= m_images->size())
+        return false;
+
+    Buffer& buffer = m_buffers[m_nextOut % m_buffers.size()];
+
+    while (!m_stop && !(buffer.ready && buffer.image == m_nextOut))
+        m_readyCond.wait(lock);
+
+    if (m_stop)
+        return false;
+
+    item->image = buffer.image;
+    item->status = buffer.status;
+    item->handle = buffer.handle;
+    item->data = buffer.data;
+    m_nextOut++;
+
+    return true;
+}
+
+void ImageLoader::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_released >= m_nextOut)
+            return;
+
+        m_buffers[m_released % m_buffers.size()].ready = false;
+        m_released++;
+    }
+    m_claimCond.notify_all();
+}
+
+void ImageLoader::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_claimCond.notify_all();
+    m_readyCond.notify_all();
+
+    for (size_t t = 0; t < m_threads.size(); t++)
+        m_threads[t].join();
+    m_threads.clear();
+}
+
+// one resident loadable of the cascade and its own in/out tensors
+struct BatchPart : CascadePart
+{
+    void* inputHandle;
+    void* inputData;
+    void* outputHandle;
+    void* outputData;
+    NvU64 outputSize;
+};
+
+// part 0 keeps one output per batch element in a single strided buffer
+static NvDlaError initBatchPart(const TestAppArgs* appArgs, NvU32 index, const BatchPart* first,
+                                NvU32 numBatch, BatchPart* part)
+{
+    PROPAGATE_ERROR(loadCascadePart(appArgs, index, first, part));
+
+    nvdla::IRuntime* runtime = part->info.runtime;
+
+    PROPAGATE_ERROR(runtime->allocateSystemMemory(&part->inputHandle, part->inputDesc.bufferSize, &part->inputData));
+    part->outputSize = part->outputDesc.bufferSize * numBatch;
+    PROPAGATE_ERROR(runtime->allocateSystemMemory(&part->outputHandle, part->outputSize, &part->outputData));
+
+    return NvDlaSuccess;
+}
+
+static void destroyBatchPart(const TestAppArgs* appArgs, BatchPart* part)
+{
+    nvdla::IRuntime* runtime = part->info.runtime;
+
+    if (runtime != NULL)
+    {
+        if (part->inputHandle)
+            runtime->freeSystemMemory(part->inputHandle, part->inputDesc.bufferSize);
+        if (part->outputHandle)
+            runtime->freeSystemMemory(part->outputHandle, part->outputSize);
+    }
+
+    unloadCascadePart(appArgs, part);
+    delete part;
+}
+
+// runs the cascade on one decoded input from part first on, part 0 reads the loader's tensor
+static NvDlaError scoreImage(std::vector<BatchPart*>& parts, const ImageLoader::Item& item, NvU32 first,
+                             NvU32* finalPart, nvdla::IRuntime::NvDlaTopK* topk)
+{
+    for (NvU32 p = first; p < parts.size(); p++)
+    {
+        BatchPart* part = parts[p];
+        nvdla::IRuntime* runtime = part->info.runtime;
+        void* inputHandle = item.handle;
+
+        if (p > 0)
+        {
+            memcpy(part->inputData, item.data, part->inputDesc.bufferSize);
+            inputHandle = part->inputHandle;
+        }
+
+        if (!runtime->bindInputTensor(0, inputHandle))
+            ORIGINATE_ERROR(NvDlaError_BadParameter, "runtime->bindInputTensor() failed");
+        if (!runtime->bindOutputTensor(0, part->outputHandle))
+            ORIGINATE_ERROR(NvDlaError_BadParameter, "runtime->bindOutputTensor() failed");
+
+        if (!runtime->submit())
+            ORIGINATE_ERROR(NvDlaError_BadParameter, "runtime->submit() failed");
+
+        PROPAGATE_ERROR(runtime->getTopK(&part->outputDesc, part->outputData, 2, topk));
+
+        *finalPart = p;
+        if (!shouldEscalate(*topk, p, parts.size()))
+            break;
+    }
+
+    return NvDlaSuccess;
+}
+
+// submits the decoded items to part 0 together, then escalates the unsure ones one by one.
+// with a cache, hits are answered up front and fresh results are remembered
+static NvDlaError scoreBatch(std::vector<BatchPart*>& parts, ResultCache* cache, NvU64 cascade,
+                             ImageLoader::Item* items, NvU32 numItems,
+                             NvU32* finalPart, nvdla::IRuntime::NvDlaTopK* topk)
+{
+    BatchPart* part = parts[0];
+    nvdla::IRuntime* runtime = part->info.runtime;
+    void* inputHandles[NVDLA_RUNTIME_BATCH_MAX];
+    ResultCache::Key keys[NVDLA_RUNTIME_BATCH_MAX];
+    bool cached[NVDLA_RUNTIME_BATCH_MAX];
+    NvU32 numBatch = 0;
+
+    for (NvU32 i = 0; i < numItems; i++)
+    {
+        cached[i] = false;
+        if (items[i].status != NvDlaSuccess)
+            continue;
+
+        if (cache)
+        {
+            keys[i] = ResultCache::makeKey(cascade, items[i].data, part->inputDesc.bufferSize);
+            cached[i] = cache->lookup(keys[i], items[i].data, &finalPart[i], &topk[i], NULL);
+        }
+        if (!cached[i])
+            inputHandles[numBatch++] = items[i].handle;
+    }
+
+    if (numBatch == 0)
+        return NvDlaSuccess;
+
+    PROPAGATE_ERROR(runtime->bindInputTensorBatch(0, numBatch, inputHandles));
+    PROPAGATE_ERROR(runtime->bindOutputTensorBatch(0, numBatch, part->outputHandle, part->outputDesc.bufferSize));
+    PROPAGATE_ERROR(runtime->submitBatch(numBatch));
+
+    for (NvU32 i = 0, b = 0; i < numItems; i++)
+    {
+        if (items[i].status != NvDlaSuccess || cached[i])
+            continue;
+
+        const NvU8* output = static_cast<const NvU8*>(part->outputData) + b++ * part->outputDesc.bufferSize;
+        PROPAGATE_ERROR(runtime->getTopK(&part->outputDesc, output, 2, &topk[i]));
+
+        finalPart[i] = 0;
+        if (shouldEscalate(topk[i], 0, parts.size()))
+        {
+            items[i].status = scoreImage(parts, items[i], 1, &finalPart[i], &topk[i]);
+            output = static_cast<const NvU8*>(parts[finalPart[i]]->outputData);
+        }
+
+        if (cache && items[i].status == NvDlaSuccess)
+            cache->insert(keys[i], items[i].data, finalPart[i], topk[i], output, parts[finalPart[i]]->outputDesc.bufferSize);
+    }
+
+    return NvDlaSuccess;
+}
+
+NvDlaError runImageBatch(const TestAppArgs* appArgs, const std::vector<std::string>& images)
+{
+    NvDlaError e = NvDlaSuccess;
+    std::vector<BatchPart*> parts;
+    ImageLoader* loader = NULL;
+    PreprocessParams params;
+    ImageLoader::Item items[NVDLA_RUNTIME_BATCH_MAX];
+    NvU32 numParts = appArgs->loadableNames.size();
+    NvU32 numThreads = std::max(appArgs->numThreads, 1U);
+    NvU32 batchSize = std::min(std::max(appArgs->batchSize, 1U), NVDLA_RUNTIME_BATCH_MAX);
+    ResultCache* cache = NULL;
+    NvU64 cascade = 0;
+    NvU32 failed = 0;
+
+    if (numParts == 0)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "no loadables");
+
+    for (NvU32 p = 0; p < numParts; p++)
+    {
+        BatchPart* part = new BatchPart();
+
+        part->inputHandle = part->outputHandle = NULL;
+        parts.push_back(part);
+        PROPAGATE_ERROR_FAIL(initBatchPart(appArgs, p, p > 0 ? parts[0] : NULL, p == 0 ? batchSize : 1, part));
+
+        cascade = hashBytes(part->info.pData, part->info.loadableSize, cascade);
+    }
+
+    if (appArgs->cacheSize)
+        cache = new ResultCache(NvU64(appArgs->cacheSize) << 20);
+
+    initPreprocessParams(appArgs, &params);
+
+    {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+        loader = new ImageLoader(parts[0]->info.runtime, parts[0]->inputDesc, params);
+        PROPAGATE_ERROR_FAIL(loader->start(&images, numThreads, batchSize + numThreads));
+
+        while (true)
+        {
+            nvdla::IRuntime::NvDlaTopK topk[NVDLA_RUNTIME_BATCH_MAX];
+            NvU32 finalPart[NVDLA_RUNTIME_BATCH_MAX];
+            NvU32 numItems = 0;
+
+            while (numItems < batchSize && loader->next(&items[numItems]))
+                numItems++;
+            if (numItems == 0)
+                break;
+
+            // a failed submit fails every image in the batch
+            NvDlaError batchStatus = scoreBatch(parts, cache, cascade, items, numItems, finalPart, topk);
+            for (NvU32 i = 0; i < numItems; i++)
+            {
+                const ImageLoader::Item& item = items[i];
+                NvDlaError status = item.status == NvDlaSuccess ? batchStatus : item.status;
+
+                loader->release();
+
+                if (status != NvDlaSuccess)
+                {
+                    failed++;
+                    NvDlaDebugPrintf("%s: failed (0x%x)\n", images[item.image].c_str(), status);
+                    continue;
+                }
+
+                NvDlaDebugPrintf("%s: loadable %u, class %u, prob %f, margin %f\n", images[item.image].c_str(),
+                                 finalPart[i], topk[i].index[0], topk[i].prob[0], topk[i].margin);
+            }
+        }
+
+        NvF64 ms = std::chrono::duration<NvF64, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        NvDlaDebugPrintf("batch: %u images in %.1f ms, %.1f images/s, %u decode threads, batch %u\n",
+                         NvU32(images.size()), ms, ms > 0.0 ? images.size() * 1000.0 / ms : 0.0, numThreads, batchSize);
+        if (cache)
+            cache->printStats();
+    }
+
+    if (failed != 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_TestApplicationFailed, "%u of %u images failed", failed, NvU32(images.size()));
+
+fail:
+    delete loader;
+    delete cache;
+    for (size_t p = 0; p < parts.size(); p++)
+        destroyBatchPart(appArgs, parts[p]);
+
+    return e;
+}
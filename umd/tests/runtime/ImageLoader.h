@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NVDLA_UTILS_IMAGE_LOADER_H
+#define NVDLA_UTILS_IMAGE_LOADER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Preprocess.h"
+
+#include "nvdla/IRuntime.h"
+
+struct TestAppArgs;
+
+// Decodes a list of images on a pool of worker threads into a small ring of
+// input tensors allocated from the runtime, and hands them out in list
+// order. Files are mmap'd and decoded from memory, and a decoder only
+// starts on an image once a ring slot is free, so memory stays bounded
+// however long the list is.
+class ImageLoader
+{
+public:
+    struct Item
+    {
+        NvU32 image;        /* index into the image list */
+        NvDlaError status;  /* the tensor is only valid on success */
+        void* handle;       /* runtime memory handle, bindable as is */
+        void* data;
+    };
+
+    ImageLoader(nvdla::IRuntime* runtime, const nvdla::IRuntime::NvDlaTensor& desc,
+                const PreprocessParams& params);
+    ~ImageLoader();
+
+    // allocates depth tensors and starts numThreads decoders over images
+    NvDlaError start(const std::vector<std::string>* images, NvU32 numThreads, NvU32 depth);
+
+    // blocks until the next image in list order is ready, false after the last
+    bool next(Item* item);
+
+    // hands the oldest item back to the pool, once per next()
+    void release();
+
+    void stop();
+
+protected:
+    struct Buffer
+    {
+        void* handle;
+        void* data;
+        NvU32 image;
+        NvDlaError status;
+        bool ready;
+    };
+
+    void workerLoop();
+
+    nvdla::IRuntime* m_runtime;
+    nvdla::IRuntime::NvDlaTensor m_desc;
+    PreprocessParams m_params;
+    const std::vector<std::string>* m_images;
+
+    std::vector<Buffer> m_buffers;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_claimCond;
+    std::condition_variable m_readyCond;
+    NvU32 m_nextClaim;
+    NvU32 m_nextOut;
+    NvU32 m_released;
+    bool m_stop;
+};
+
+// Scores every image in list order through the loadable cascade, one
+// resident runtime per loadable, with decoding overlapped by ImageLoader.
+NvDlaError runImageBatch(const TestAppArgs* appArgs, const std::vector<std::string>& images);
+
+#endif // NVDLA_UTILS_IMAGE_LOADER_H
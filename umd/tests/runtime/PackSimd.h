@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NVDLA_UTILS_PACK_SIMD_H
+#define NVDLA_UTILS_PACK_SIMD_H
+
+#include "dlatypes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// four lane helpers shared by the input packers and output converters
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+typedef NvF32 PackF32x4 __attribute__((vector_size(16)));
+typedef NvU32 PackU32x4 __attribute__((vector_size(16)));
+
+static inline PackU32x4 splatU32x4(NvU32 v)
+{
+    PackU32x4 r = { v, v, v, v };
+    return r;
+}
+
+static inline PackF32x4 splatF32x4(NvF32 v)
+{
+    PackF32x4 r = { v, v, v, v };
+    return r;
+}
+
+// fp32 -> fp16 on four lanes, round to nearest even like half_float::half
+static inline void toHalf4(PackF32x4 v, NvU16* out)
+{
+#if defined(__aarch64__)
+    vst1_u16(out, vreinterpret_u16_f16(vcvt_f16_f32((float32x4_t)v)));
+#elif defined(__F16C__)
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_cvtps_ph((__m128)v, _MM_FROUND_TO_NEAREST_INT));
+#else
+    const NvU32 f32Infinity = 255U << 23;
+    const NvU32 f16Overflow = (127U + 16U) << 23;
+    const NvU32 f16Normal = (127U - 14U) << 23;
+    const NvU32 denormMagic = ((127U - 15U) + (23U - 10U) + 1U) << 23;
+
+    PackU32x4 f = (PackU32x4)v;
+    PackU32x4 sign = f & splatU32x4(0x80000000U);
+    f ^= sign;
+
+    PackU32x4 isOverflow = (PackU32x4)(f >= splatU32x4(f16Overflow));
+    PackU32x4 isNan = (PackU32x4)(f > splatU32x4(f32Infinity));
+    PackU32x4 isDenorm = (PackU32x4)(f < splatU32x4(f16Normal));
+
+    // denormals: let the fp adder shift the mantissa into place
+    PackU32x4 magic = splatU32x4(denormMagic);
+    PackU32x4 denorm = (PackU32x4)((PackF32x4)f + (PackF32x4)magic) - magic;
+
+    // normals: rebias the exponent and round the dropped 13 bits
+    PackU32x4 mantOdd = (f >> 13) & splatU32x4(1U);
+    PackU32x4 normal = (f + splatU32x4(((15U - 127U) << 23) + 0xfffU) + mantOdd) >> 13;
+
+    PackU32x4 special = (isNan & splatU32x4(0x7e00U)) | (~isNan & splatU32x4(0x7c00U));
+    PackU32x4 h = (isOverflow & special) |
+                  (~isOverflow & ((isDenorm & denorm) | (~isDenorm & normal)));
+    h |= sign >> 16;
+
+    for (NvU32 c = 0; c < 4; c++)
+        out[c] = NvU16(h[c]);
+#endif
+}
+
+// fp32 -> int8 on four lanes, round to nearest even and saturate
+static inline void toInt8x4(PackF32x4 v, NvS8* out)
+{
+#if defined(__aarch64__)
+    int16x4_t s = vqmovn_s32(vcvtnq_s32_f32((float32x4_t)v));
+    NvU32 packed = vget_lane_u32(vreinterpret_u32_s8(vqmovn_s16(vcombine_s16(s, s))), 0);
+    memcpy(out, &packed, sizeof(packed));
+#elif defined(__SSE2__)
+    __m128 f = _mm_min_ps(_mm_max_ps((__m128)v, _mm_set1_ps(-128.0f)), _mm_set1_ps(127.0f));
+    __m128i i = _mm_cvtps_epi32(f);
+    i = _mm_packs_epi32(i, i);
+    NvS32 packed = _mm_cvtsi128_si32(_mm_packs_epi16(i, i));
+    memcpy(out, &packed, sizeof(packed));
+#else
+    for (NvU32 c = 0; c < 4; c++)
+        out[c] = NvS8(lrintf(std::min(std::max(v[c], -128.0f), 127.0f)));
+#endif
+}
+
+// fp16 -> fp32 on four lanes, exact
+static inline PackF32x4 fromHalf4(const NvU16* in)
+{
+#if defined(__aarch64__)
+    return (PackF32x4)vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(in)));
+#elif defined(__F16C__)
+    return (PackF32x4)_mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in)));
+#else
+    PackU32x4 h = { in[0], in[1], in[2], in[3] };
+    PackU32x4 sign = (h & splatU32x4(0x8000U)) << 16;
+    PackU32x4 bits = (h & splatU32x4(0x7fffU)) << 13;
+
+    // rebias by 2^112, the multiply also normalizes denormals
+    PackF32x4 f = (PackF32x4)bits * splatF32x4(5.192296858534828e+33f);
+    PackU32x4 isSpecial = (PackU32x4)(bits >= splatU32x4(0x7c00U << 13));
+
+    bits = ((PackU32x4)f & ~isSpecial) | ((bits | splatU32x4(0x7f800000U)) & isSpecial);
+    return (PackF32x4)(bits | sign);
+#endif
+}
+
+#endif // NVDLA_UTILS_PACK_SIMD_H
@@ -0,0 +1,541 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Pipeline.h"
+#include "Preprocess.h"
+#include "main.h"
+
+#include "nvdla_os_inf.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+NvDlaError loadCascadePart(const TestAppArgs* appArgs, NvU32 index, const CascadePart* first, CascadePart* part)
+{
+    NvS32 numTensors = 0;
+
+    part->info.runtime = nvdla::createRuntime();
+    if (part->info.runtime == NULL)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "createRuntime() failed");
+
+    PROPAGATE_ERROR(readLoadable(appArgs, &part->info, index));
+    PROPAGATE_ERROR(loadLoadable(appArgs, &part->info));
+
+    if (!part->info.runtime->initEMU())
+        ORIGINATE_ERROR(NvDlaError_DeviceNotFound, "runtime->initEMU() failed");
+
+    PROPAGATE_ERROR(part->info.runtime->getNumInputTensors(&numTensors));
+    if (numTensors < 1)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "loadable %u has no input", index);
+    PROPAGATE_ERROR(part->info.runtime->getNumOutputTensors(&numTensors));
+    if (numTensors < 1)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "loadable %u has no output", index);
+
+    PROPAGATE_ERROR(part->info.runtime->getInputTensorDesc(0, &part->inputDesc));
+    PROPAGATE_ERROR(part->info.runtime->getOutputTensorDesc(0, &part->outputDesc));
+
+    if (first && part->inputDesc.bufferSize != first->inputDesc.bufferSize)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "loadable %u input does not match loadable 0", index);
+
+    return NvDlaSuccess;
+}
+
+void unloadCascadePart(const TestAppArgs* appArgs, CascadePart* part)
+{
+    if (part->info.runtime != NULL)
+    {
+        part->info.runtime->stopEMU();
+        unloadLoadable(appArgs, &part->info);
+        nvdla::destroyRuntime(part->info.runtime);
+        part->info.runtime = NULL;
+    }
+    delete[] part->info.pData;
+    part->info.pData = NULL;
+}
+
+bool shouldEscalate(const nvdla::IRuntime::NvDlaTopK& topk, NvU32 part, NvU32 numParts)
+{
+    return topk.margin < CONF_THRESH && part + 1 < numParts;
+}
+
+Pipeline::Pipeline(const TestAppArgs* appArgs) :
+    m_appArgs(appArgs),
+    m_images(NULL),
+    m_cache(NULL),
+    m_cascade(0),
+    m_free(NULL),
+    m_decoded(NULL),
+    m_submitted(NULL),
+    m_nextImage(0),
+    m_retired(0),
+    m_failed(0),
+    m_latencyUs(0),
+    m_retiredAtPart(NULL)
+{
+    static const char* names[STAGE_COUNT] = { "decode", "preprocess", "submit", "postprocess" };
+
+    for (NvU32 s = 0; s < STAGE_COUNT; s++)
+    {
+        m_stages[s].name = names[s];
+        m_stages[s].numWorkers = 0;
+        m_stages[s].items = 0;
+        m_stages[s].busyUs = 0;
+    }
+}
+
+Pipeline::~Pipeline()
+{
+    for (size_t s = 0; s < m_slots.size(); s++)
+    {
+        Slot* slot = m_slots[s];
+
+        for (size_t p = 0; p < m_parts.size(); p++)
+        {
+            nvdla::IRuntime* runtime = m_parts[p]->info.runtime;
+
+            if (slot->inputHandle[p])
+                runtime->freeSystemMemory(slot->inputHandle[p], m_parts[p]->inputDesc.bufferSize);
+            if (slot->outputHandle[p])
+                runtime->freeSystemMemory(slot->outputHandle[p], m_parts[p]->outputDesc.bufferSize);
+        }
+
+        if (slot->source.m_pData)
+            NvDlaFree(slot->source.m_pData);
+        delete slot;
+    }
+
+    for (size_t p = 0; p < m_parts.size(); p++)
+    {
+        unloadCascadePart(m_appArgs, m_parts[p]);
+        delete m_parts[p];
+    }
+
+    for (size_t p = 0; p < m_submit.size(); p++)
+        delete m_submit[p];
+
+    delete m_cache;
+    delete m_free;
+    delete m_decoded;
+    delete m_submitted;
+    delete[] m_retiredAtPart;
+}
+
+NvDlaError Pipeline::init()
+{
+    NvDlaError e = NvDlaSuccess;
+    NvU32 numParts = m_appArgs->loadableNames.size();
+    NvU32 numThreads = std::max(m_appArgs->numThreads, 1U);
+    NvU32 numSlots;
+
+    if (numParts == 0)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "no loadables");
+
+    for (NvU32 p = 0; p < numParts; p++)
+    {
+        Part* part = new Part();
+
+        m_parts.push_back(part);
+        PROPAGATE_ERROR(loadCascadePart(m_appArgs, p, p > 0 ? m_parts[0] : NULL, part));
+
+        m_cascade = hashBytes(part->info.pData, part->info.loadableSize, m_cascade);
+    }
+
+    if (m_appArgs->cacheSize)
+        m_cache = new ResultCache(NvU64(m_appArgs->cacheSize) << 20);
+
+    m_stages[STAGE_DECODE].numWorkers = numThreads;
+    m_stages[STAGE_PREPROCESS].numWorkers = numThreads;
+    m_stages[STAGE_SUBMIT].numWorkers = numParts;
+    m_stages[STAGE_POSTPROCESS].numWorkers = numThreads;
+
+    // enough slots to fill every queue and keep every worker busy
+    numSlots = 3 * QUEUE_DEPTH + 3 * numThreads + numParts;
+
+    m_free = new BoundedQueue<NvU32>(numSlots);
+    m_decoded = new BoundedQueue<NvU32>(QUEUE_DEPTH);
+    m_submitted = new BoundedQueue<NvU32>(QUEUE_DEPTH);
+    for (NvU32 p = 0; p < numParts; p++)
+    {
+        // postprocess must never block on an escalation or submit and
+        // postprocess could wait on each other
+        m_submit.push_back(new BoundedQueue<NvU32>(p == 0 ? QUEUE_DEPTH : numSlots));
+    }
+
+    m_retiredAtPart = new std::atomic<NvU32>[numParts];
+    for (NvU32 p = 0; p < numParts; p++)
+        m_retiredAtPart[p] = 0;
+
+    for (NvU32 s = 0; s < numSlots; s++)
+    {
+        Slot* slot = new Slot();
+
+        m_slots.push_back(slot);
+        slot->inputHandle.assign(numParts, NULL);
+        slot->inputData.assign(numParts, NULL);
+        slot->outputHandle.assign(numParts, NULL);
+        slot->outputData.assign(numParts, NULL);
+
+        for (NvU32 p = 0; p < numParts; p++)
+        {
+            nvdla::IRuntime* runtime = m_parts[p]->info.runtime;
+
+            PROPAGATE_ERROR(runtime->allocateSystemMemory(&slot->inputHandle[p],
+                                                          m_parts[p]->inputDesc.bufferSize, &slot->inputData[p]));
+            PROPAGATE_ERROR(runtime->allocateSystemMemory(&slot->outputHandle[p],
+                                                          m_parts[p]->outputDesc.bufferSize, &slot->outputData[p]));
+        }
+
+        m_free->push(s);
+    }
+
+    NvDlaDebugPrintf("pipeline: %u loadables, %u slots, %u threads per stage\n", numParts, numSlots, numThreads);
+
+    return e;
+}
+
+void Pipeline::account(StageId stage, Clock::time_point begin)
+{
+    NvU64 us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - begin).count();
+
+    m_stages[stage].items++;
+    m_stages[stage].busyUs += us;
+}
+
+NvDlaError Pipeline::decode(Slot* slot)
+{
+    const std::string& path = m_images->at(slot->image);
+    PreprocessParams params;
+
+    switch (getImageType(path))
+    {
+        case IMAGE_TYPE_PGM:
+            PROPAGATE_ERROR(PGM2DIMG(path, &slot->source));
+            break;
+        case IMAGE_TYPE_JPG:
+            // decoding and packing are a single pass for JPEGs
+            initPreprocessParams(m_appArgs, &params);
+            PROPAGATE_ERROR(JPEG2Tensor(path, &params, &m_parts[0]->inputDesc, slot->inputData[0]));
+            slot->packed = true;
+            break;
+        default:
+            ORIGINATE_ERROR(NvDlaError_NotSupported, "Unknown image type: %s", path.c_str());
+    }
+
+    return NvDlaSuccess;
+}
+
+NvDlaError Pipeline::preprocess(Slot* slot)
+{
+    NvDlaError e = NvDlaSuccess;
+    PreprocessParams params;
+
+    if (!slot->packed)
+    {
+        initPreprocessParams(m_appArgs, &params);
+        e = packImageToTensor(&slot->source, &params, &m_parts[0]->inputDesc, slot->inputData[0]);
+
+        NvDlaFree(slot->source.m_pData);
+        slot->source.m_pData = NULL;
+
+        PROPAGATE_ERROR(e);
+    }
+
+    // a repeated input takes the whole cascade's answer and skips inference
+    if (m_cache)
+    {
+        slot->cacheKey = ResultCache::makeKey(m_cascade, slot->inputData[0], m_parts[0]->inputDesc.bufferSize);
+        slot->cached = m_cache->lookup(slot->cacheKey, slot->inputData[0], &slot->part, &slot->topk, &slot->outputData[0]);
+    }
+
+    return NvDlaSuccess;
+}
+
+NvDlaError Pipeline::submit(Slot* slot, NvU32 part)
+{
+    nvdla::IRuntime* runtime = m_parts[part]->info.runtime;
+
+    if (part > 0)
+        memcpy(slot->inputData[part], slot->inputData[0], m_parts[part]->inputDesc.bufferSize);
+
+    if (!runtime->bindInputTensor(0, slot->inputHandle[part]))
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "runtime->bindInputTensor() failed");
+    if (!runtime->bindOutputTensor(0, slot->outputHandle[part]))
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "runtime->bindOutputTensor() failed");
+
+    if (!runtime->submit())
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "runtime->submit() failed");
+
+    return NvDlaSuccess;
+}
+
+NvDlaError Pipeline::postprocess(Slot* slot, bool* escalate)
+{
+    Part* part = m_parts[slot->part];
+
+    PROPAGATE_ERROR(part->info.runtime->getTopK(&part->outputDesc, slot->outputData[slot->part], 2, &slot->topk));
+
+    *escalate = shouldEscalate(slot->topk, slot->part, m_parts.size());
+
+    if (m_cache && !*escalate)
+        m_cache->insert(slot->cacheKey, slot->inputData[0], slot->part, slot->topk,
+                        slot->outputData[slot->part], part->outputDesc.bufferSize);
+
+    return NvDlaSuccess;
+}
+
+void Pipeline::decodeLoop()
+{
+    for (;;)
+    {
+        NvU32 index = m_nextImage++;
+        NvU32 s;
+
+        if (index >= m_images->size())
+            break;
+
+        // a free slot is the admission ticket, none means everything is backed up
+        if (!m_free->pop(&s))
+            break;
+
+        Clock::time_point begin = Clock::now();
+        Slot* slot = m_slots[s];
+
+        slot->image = index;
+        slot->part = 0;
+        slot->packed = false;
+        slot->cached = false;
+        slot->start = begin;
+        slot->status = decode(slot);
+        account(STAGE_DECODE, begin);
+
+        if (slot->status != NvDlaSuccess)
+            retire(s);
+        else
+            m_decoded->push(s);
+    }
+}
+
+void Pipeline::preprocessLoop()
+{
+    NvU32 s;
+
+    while (m_decoded->pop(&s))
+    {
+        Clock::time_point begin = Clock::now();
+        Slot* slot = m_slots[s];
+
+        slot->status = preprocess(slot);
+        account(STAGE_PREPROCESS, begin);
+
+        if (slot->status != NvDlaSuccess || slot->cached)
+            retire(s);
+        else
+            m_submit[0]->push(s);
+    }
+}
+
+void Pipeline::submitLoop(NvU32 part)
+{
+    NvU32 s;
+
+    while (m_submit[part]->pop(&s))
+    {
+        Clock::time_point begin = Clock::now();
+        Slot* slot = m_slots[s];
+
+        slot->status = submit(slot, part);
+        account(STAGE_SUBMIT, begin);
+
+        if (slot->status != NvDlaSuccess)
+            retire(s);
+        else
+            m_submitted->push(s);
+    }
+}
+
+void Pipeline::postprocessLoop()
+{
+    NvU32 s;
+
+    while (m_submitted->pop(&s))
+    {
+        Clock::time_point begin = Clock::now();
+        Slot* slot = m_slots[s];
+        bool escalate = false;
+
+        slot->status = postprocess(slot, &escalate);
+        account(STAGE_POSTPROCESS, begin);
+
+        if (slot->status == NvDlaSuccess && escalate)
+        {
+            slot->part++;
+            m_submit[slot->part]->push(s);
+        }
+        else
+        {
+            retire(s);
+        }
+    }
+}
+
+void Pipeline::retire(NvU32 s)
+{
+    Slot* slot = m_slots[s];
+    NvU64 us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - slot->start).count();
+
+    if (slot->status != NvDlaSuccess)
+    {
+        m_failed++;
+        NvDlaDebugPrintf("%s: failed (0x%x)\n", m_images->at(slot->image).c_str(), slot->status);
+    }
+    else
+    {
+        m_retiredAtPart[slot->part]++;
+        NvDlaDebugPrintf("%s: loadable %u, class %u, prob %f, margin %f\n",
+                         m_images->at(slot->image).c_str(), slot->part,
+                         slot->topk.index[0], slot->topk.prob[0], slot->topk.margin);
+    }
+
+    if (slot->source.m_pData)
+    {
+        NvDlaFree(slot->source.m_pData);
+        slot->source.m_pData = NULL;
+    }
+
+    m_latencyUs += us;
+    m_free->push(s);
+    m_retired++;
+}
+
+void Pipeline::shutdown()
+{
+    m_free->close();
+    m_decoded->close();
+    for (size_t p = 0; p < m_submit.size(); p++)
+        m_submit[p]->close();
+    m_submitted->close();
+
+    for (size_t t = 0; t < m_threads.size(); t++)
+        m_threads[t].join();
+    m_threads.clear();
+}
+
+NvDlaError Pipeline::run(const std::vector<std::string>& images)
+{
+    NvU32 numThreads = m_stages[STAGE_DECODE].numWorkers;
+
+    if (m_slots.empty())
+        ORIGINATE_ERROR(NvDlaError_InvalidState, "pipeline not initialized");
+
+    m_images = &images;
+    m_nextImage = 0;
+    m_retired = 0;
+    m_begin = Clock::now();
+
+    for (NvU32 t = 0; t < numThreads; t++)
+    {
+        m_threads.push_back(std::thread(&Pipeline::decodeLoop, this));
+        m_threads.push_back(std::thread(&Pipeline::preprocessLoop, this));
+        m_threads.push_back(std::thread(&Pipeline::postprocessLoop, this));
+    }
+    for (NvU32 p = 0; p < m_parts.size(); p++)
+        m_threads.push_back(std::thread(&Pipeline::submitLoop, this, p));
+
+    // every image retires exactly once, failed ones included
+    while (m_retired.load() < images.size())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    m_end = Clock::now();
+    shutdown();
+
+    if (m_failed.load() != 0)
+        ORIGINATE_ERROR(NvDlaError_TestApplicationFailed, "%u of %u images failed", m_failed.load(), NvU32(images.size()));
+
+    return NvDlaSuccess;
+}
+
+void Pipeline::printStats() const
+{
+    NvF64 wallUs = NvF64(std::chrono::duration_cast<std::chrono::microseconds>(m_end - m_begin).count());
+    NvU32 retired = m_retired.load();
+    const BoundedQueue<NvU32>* inbound[STAGE_COUNT] = { m_free, m_decoded, m_submit[0], m_submitted };
+
+    if (wallUs <= 0.0)
+        return;
+
+    NvDlaDebugPrintf("pipeline: %u images in %.1f ms, %.1f images/s, mean latency %.2f ms\n",
+                     retired, wallUs / 1000.0, retired * 1e6 / wallUs,
+                     retired ? NvF64(m_latencyUs.load()) / retired / 1000.0 : 0.0);
+
+    // utilization is busy time over wall time summed across the stage's workers,
+    // the stage closest to 100% is the one bounding throughput
+    NvDlaDebugPrintf("%-12s %8s %10s %8s %10s %10s\n", "stage", "items", "mean ms", "util", "queue avg", "queue max");
+    for (NvU32 s = 0; s < STAGE_COUNT; s++)
+    {
+        const Stage& stage = m_stages[s];
+        NvU64 items = stage.items.load();
+        NvF64 busy = NvF64(stage.busyUs.load());
+
+        NvDlaDebugPrintf("%-12s %8llu %10.3f %7.1f%% %10.2f %10u\n", stage.name, (unsigned long long)items,
+                         items ? busy / items / 1000.0 : 0.0,
+                         100.0 * busy / (wallUs * std::max(stage.numWorkers, 1U)),
+                         inbound[s]->averageDepth(), inbound[s]->maxDepth());
+    }
+
+    for (size_t p = 0; p < m_parts.size(); p++)
+        NvDlaDebugPrintf("loadable %u: %u images finished here\n", NvU32(p), m_retiredAtPart[p].load());
+
+    if (m_cache)
+        m_cache->printStats();
+}
+
+NvDlaError listImages(const std::string& dir, std::vector<std::string>* images)
+{
+    NvDlaDirHandle handle;
+    char name[256];
+
+    PROPAGATE_ERROR(NvDlaOpendir(dir.c_str(), &handle));
+
+    while (NvDlaReaddir(handle, name, sizeof(name)) == NvDlaSuccess)
+    {
+        std::string path = dir + "/" + name;
+
+        if (getImageType(path) != IMAGE_TYPE_UNKNOWN)
+            images->push_back(path);
+    }
+
+    NvDlaClosedir(handle);
+
+    std::sort(images->begin(), images->end());
+
+    if (images->empty())
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "no .pgm/.jpg images in %s", dir.c_str());
+
+    return NvDlaSuccess;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NVDLA_UTILS_PIPELINE_H
+#define NVDLA_UTILS_PIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "DlaImage.h"
+#include "ErrorMacros.h"
+#include "ResultCache.h"
+#ifndef RUNTIME_TEST_H
+#define RUNTIME_TEST_H
+#include "RuntimeTest.h"
+#endif
+
+#include "nvdla/IRuntime.h"
+
+// One resident loadable of the cascade, shared by Pipeline and runImageBatch.
+struct CascadePart
+{
+    TestInfo info;
+    nvdla::IRuntime::NvDlaTensor inputDesc;
+    nvdla::IRuntime::NvDlaTensor outputDesc;
+};
+
+// creates the runtime and loads loadable index into part. escalation copies
+// the packed input across as is, so later parts must match first's input
+NvDlaError loadCascadePart(const TestAppArgs* appArgs, NvU32 index, const CascadePart* first, CascadePart* part);
+void unloadCascadePart(const TestAppArgs* appArgs, CascadePart* part);
+
+// a result from part goes on to the next loadable while it is unsure
+bool shouldEscalate(const nvdla::IRuntime::NvDlaTopK& topk, NvU32 part, NvU32 numParts);
+
+// Streams a list of images through decode -> preprocess -> submit ->
+// postprocess. Each stage has its own threads and hands slot indices to the
+// next one over a bounded lock-free queue, so a full queue stalls the
+// stages in front of it and throughput is set by the slowest stage.
+// Low-confidence results go back to the submit stage of the next loadable.
+class Pipeline
+{
+public:
+    enum StageId
+    {
+        STAGE_DECODE = 0,
+        STAGE_PREPROCESS,
+        STAGE_SUBMIT,
+        STAGE_POSTPROCESS,
+        STAGE_COUNT
+    };
+
+    explicit Pipeline(const TestAppArgs* appArgs);
+    ~Pipeline();
+
+    // loads every loadable and allocates the in-flight tensor buffers
+    NvDlaError init();
+
+    NvDlaError run(const std::vector<std::string>& images);
+
+    void printStats() const;
+
+protected:
+    typedef std::chrono::steady_clock Clock;
+
+    // queue depth between stages; escalations get room for every slot
+    static const NvU32 QUEUE_DEPTH = 4;
+
+    typedef CascadePart Part;
+
+    // everything one in-flight image owns
+    struct Slot
+    {
+        NvU32 image;
+        NvU32 part;
+        bool packed;
+        bool cached;
+        ResultCache::Key cacheKey;
+        NvDlaError status;
+        NvDlaImage source;
+        std::vector<void*> inputHandle;
+        std::vector<void*> inputData;
+        std::vector<void*> outputHandle;
+        std::vector<void*> outputData;
+        nvdla::IRuntime::NvDlaTopK topk;
+        Clock::time_point start;
+    };
+
+    struct Stage
+    {
+        const char* name;
+        NvU32 numWorkers;
+        std::atomic<NvU64> items;
+        std::atomic<NvU64> busyUs;
+    };
+
+    void decodeLoop();
+    void preprocessLoop();
+    void submitLoop(NvU32 part);
+    void postprocessLoop();
+
+    NvDlaError decode(Slot* slot);
+    NvDlaError preprocess(Slot* slot);
+    NvDlaError submit(Slot* slot, NvU32 part);
+    NvDlaError postprocess(Slot* slot, bool* escalate);
+
+    void retire(NvU32 slot);
+    void account(StageId stage, Clock::time_point begin);
+
+    void shutdown();
+
+    const TestAppArgs* m_appArgs;
+    const std::vector<std::string>* m_images;
+
+    std::vector<Part*> m_parts;
+    ResultCache* m_cache;       // NULL unless --cache
+    NvU64 m_cascade;            // loadable identity for cache keys
+    std::vector<Slot*> m_slots;
+
+    BoundedQueue<NvU32>* m_free;
+    BoundedQueue<NvU32>* m_decoded;
+    std::vector<BoundedQueue<NvU32>*> m_submit;     // one per loadable
+    BoundedQueue<NvU32>* m_submitted;
+
+    Stage m_stages[STAGE_COUNT];
+    std::vector<std::thread> m_threads;
+
+    std::atomic<NvU32> m_nextImage;
+    std::atomic<NvU32> m_retired;
+    std::atomic<NvU32> m_failed;
+    std::atomic<NvU64> m_latencyUs;
+    std::atomic<NvU32>* m_retiredAtPart;
+
+    Clock::time_point m_begin;
+    Clock::time_point m_end;
+};
+
+NvDlaError listImages(const std::string& dir, std::vector<std::string>* images);
+
+#endif // NVDLA_UTILS_PIPELINE_H
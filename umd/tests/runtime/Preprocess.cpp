@@ -0,0 +1,705 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ErrorMacros.h"
+#ifndef RUNTIME_TEST_H
+#define RUNTIME_TEST_H
+#include "RuntimeTest.h"
+#endif
+
+#include "DlaImageUtils.h"
+#include "PackSimd.h"
+#include "Preprocess.h"
+
+#include "nvdla_os_inf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "jpeglib.h"
+
+// bytes per pixel of D_F16_CxHWx_x16_F and D_F8_CxHWx_x32_I surfaces alike,
+// one atom of 16 fp16 or 32 int8 channels
+#define FEATURE_ATOM_SIZE 32
+
+// scanlines handed out by one jpeg_read_scanlines() call at most
+#define JPEG_BATCH_LINES 16
+
+// resizes smaller than this many output pixels per thread stay serial
+#define RESIZE_MIN_PIXELS_PER_THREAD (64 * 1024)
+#define RESIZE_MAX_THREADS 4
+
+template <NvU32 NC>
+static inline PackF32x4 loadPixel(const NvU8* p)
+{
+    PackF32x4 v = { NvF32(p[0]),
+                    NC > 1 ? NvF32(p[1]) : 0.0f,
+                    NC > 2 ? NvF32(p[2]) : 0.0f,
+                    NC > 3 ? NvF32(p[3]) : 0.0f };
+    return v;
+}
+
+// first NC channels of an atom, as fp16 or as already quantized int8
+template <NvU32 NC, bool INT8>
+static inline void storePixel(PackF32x4 v, NvU8* dst)
+{
+    if (INT8)
+    {
+        NvS8 q[4];
+        toInt8x4(v, q);
+        memcpy(dst, q, NC);
+    }
+    else
+    {
+        NvU16 h[4];
+        toHalf4(v, h);
+        memcpy(dst, h, NC * sizeof(NvU16));
+    }
+}
+
+// one source row of width pixels with NC interleaved 8-bit channels
+template <NvU32 NC, bool INT8>
+static void packRow(const NvU8* src, NvU8* dst, NvU32 width, PackF32x4 scale, PackF32x4 bias)
+{
+    for (NvU32 x = 0; x < width; x++, src += NC, dst += FEATURE_ATOM_SIZE)
+        storePixel<NC, INT8>(loadPixel<NC>(src) * scale + bias, dst);
+}
+
+typedef void (*PackRowFunction)(const NvU8* src, NvU8* dst, NvU32 width, PackF32x4 scale, PackF32x4 bias);
+
+static const PackRowFunction packRowFunctions[2][4] =
+{
+    { packRow<1, false>, packRow<2, false>, packRow<3, false>, packRow<4, false> },
+    { packRow<1, true>, packRow<2, true>, packRow<3, true>, packRow<4, true> },
+};
+
+// destination of a pack, validated against the tensor once
+struct PackTarget
+{
+    NvU8* base;
+    NvU32 width;
+    NvU32 height;
+    NvU32 lineStride;
+    NvU64 size;
+    bool int8;        /* D_F8_CxHWx_x32_I, otherwise D_F16_CxHWx_x16_F */
+    PackF32x4 scale;  /* int8 targets have the quantization folded in */
+    PackF32x4 bias;
+};
+
+static NvDlaError initPackTarget(const PreprocessParams* params, const nvdla::IRuntime::NvDlaTensor* tensor,
+                                 NvU32 channel, void* dst, PackTarget* target)
+{
+    NvU32 lineStride, surfaceStride;
+    NvU32 width = tensor->dims.w;
+    NvU32 height = tensor->dims.h;
+    bool int8 = tensor->dataType == TENSOR_DATA_TYPE_INT8;
+    NvS32 atomChannels = int8 ? 32 : 16;
+
+    if (channel == 0 || channel > 4)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "source has %u channels", channel);
+
+    if (tensor->dims.w <= 0 || tensor->dims.h <= 0)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "tensor is %dx%d", tensor->dims.w, tensor->dims.h);
+
+    // These calculations work for channels within one atom
+    if (tensor->dims.c > atomChannels || NvU32(tensor->dims.c) < channel)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "tensor has %d channels", tensor->dims.c);
+
+    lineStride = tensor->stride[1] ? tensor->stride[1] : width * FEATURE_ATOM_SIZE;
+    surfaceStride = tensor->stride[2] ? tensor->stride[2] : lineStride * height;
+
+    if (lineStride < width * FEATURE_ATOM_SIZE || surfaceStride < lineStride * height ||
+        tensor->bufferSize < NvU64(surfaceStride))
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "tensor buffer too small for %ux%u", width, height);
+
+    target->base = static_cast<NvU8*>(dst);
+    target->width = width;
+    target->height = height;
+    target->lineStride = lineStride;
+    target->size = tensor->bufferSize;
+    target->int8 = int8;
+
+    // the loadable carries no input quantization, guessing one would skew every result
+    if (int8 && params->inputScale <= 0.0f)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "int8 input tensor needs --inputscale/--inputoffset");
+
+    // q = y / inputScale + inputOffset, folded into y = x * scale + bias
+    for (NvU32 c = 0; c < 4; c++)
+    {
+        target->scale[c] = int8 ? params->scale[c] / params->inputScale : params->scale[c];
+        target->bias[c] = int8 ? params->bias[c] / params->inputScale + params->inputOffset : params->bias[c];
+    }
+
+    return NvDlaSuccess;
+}
+
+// converts rows [y, y + numRows) from an interleaved 8-bit source
+static void packRows(const PackTarget* target, const NvU8* src, NvU32 srcStride,
+                     NvU32 channel, NvU32 y, NvU32 numRows)
+{
+    for (NvU32 r = 0; r < numRows; r++, src += srcStride)
+    {
+        NvU8* drow = target->base + NvU64(y + r) * target->lineStride;
+
+        // unused channels and line padding are zero
+        memset(drow, 0, target->lineStride);
+
+        packRowFunctions[target->int8][channel - 1](src, drow, target->width, target->scale, target->bias);
+    }
+}
+
+static void finishPackTarget(const PackTarget* target)
+{
+    NvU64 used = NvU64(target->lineStride) * target->height;
+
+    memset(target->base + used, 0, size_t(target->size - used));
+}
+
+// source pixels feeding one output pixel along an axis, weights sum to 1
+struct ResizeTap
+{
+    NvU32 start;
+    NvU32 count;
+    NvU32 weights;  /* index of the first weight in ResizeAxis::weights */
+};
+
+// one axis of a resize: output [dstOffset, dstOffset + taps.size()) samples
+// the source span [srcStart, srcStart + srcLength)
+struct ResizeAxis
+{
+    NvU32 dstOffset;
+    NvF32 srcStart;
+    NvF32 srcLength;
+    std::vector<ResizeTap> taps;
+    std::vector<NvF32> weights;
+};
+
+// output / source scale of the content along each axis
+static void fitScale(NvU32 fit, NvU32 srcWidth, NvU32 srcHeight, NvU32 width, NvU32 height,
+                     NvF32* scaleX, NvF32* scaleY)
+{
+    *scaleX = NvF32(width) / srcWidth;
+    *scaleY = NvF32(height) / srcHeight;
+
+    if (fit == PREPROCESS_FIT_CROP)
+        *scaleX = *scaleY = std::max(*scaleX, *scaleY);
+    else if (fit == PREPROCESS_FIT_LETTERBOX)
+        *scaleX = *scaleY = std::min(*scaleX, *scaleY);
+}
+
+static void initResizeAxis(NvU32 fit, NvU32 filter, NvU32 srcSize, NvU32 dstSize, NvF32 scale, ResizeAxis* axis)
+{
+    NvU32 contentSize = dstSize;
+    NvF32 ratio;
+    bool area;
+
+    axis->dstOffset = 0;
+    axis->srcStart = 0.0f;
+    axis->srcLength = NvF32(srcSize);
+
+    if (fit == PREPROCESS_FIT_CROP)
+    {
+        axis->srcLength = std::min(NvF32(srcSize), dstSize / scale);
+        axis->srcStart = (srcSize - axis->srcLength) * 0.5f;
+    }
+    else if (fit == PREPROCESS_FIT_LETTERBOX)
+    {
+        contentSize = std::max(1U, std::min(dstSize, NvU32(std::lround(srcSize * scale))));
+        axis->dstOffset = (dstSize - contentSize) / 2;
+    }
+
+    ratio = axis->srcLength / contentSize;
+    area = filter == PREPROCESS_RESIZE_AREA || (filter == PREPROCESS_RESIZE_AUTO && ratio > 1.0f);
+
+    axis->taps.resize(contentSize);
+    axis->weights.clear();
+
+    for (NvU32 d = 0; d < contentSize; d++)
+    {
+        ResizeTap& tap = axis->taps[d];
+
+        tap.weights = axis->weights.size();
+
+        if (area)
+        {
+            // box filter, each source pixel weighted by its overlap
+            NvF32 lo = axis->srcStart + d * ratio;
+            NvF32 hi = lo + ratio;
+            NvU32 first = std::min(NvU32(lo), srcSize - 1);
+            NvU32 last = std::min(NvU32(std::ceil(hi)), srcSize);
+            NvF32 sum = 0.0f;
+
+            tap.start = first;
+            for (NvU32 i = first; i < last; i++)
+            {
+                NvF32 w = std::min(hi, NvF32(i + 1)) - std::max(lo, NvF32(i));
+                axis->weights.push_back(w > 0.0f ? w : 0.0f);
+                sum += axis->weights.back();
+            }
+
+            if (sum <= 0.0f)
+            {
+                axis->weights.resize(tap.weights);
+                axis->weights.push_back(sum = 1.0f);
+                last = first + 1;
+            }
+
+            tap.count = last - first;
+            for (NvU32 i = 0; i < tap.count; i++)
+                axis->weights[tap.weights + i] /= sum;
+        }
+        else
+        {
+            // pixel centers line up, edges clamp
+            NvF32 s = axis->srcStart + (d + 0.5f) * ratio - 0.5f;
+            s = std::min(std::max(s, 0.0f), NvF32(srcSize - 1));
+
+            tap.start = NvU32(s);
+            NvF32 f = s - tap.start;
+
+            if (f > 0.0f && tap.start + 1 < srcSize)
+            {
+                tap.count = 2;
+                axis->weights.push_back(1.0f - f);
+                axis->weights.push_back(f);
+            }
+            else
+            {
+                tap.count = 1;
+                axis->weights.push_back(1.0f);
+            }
+        }
+    }
+}
+
+struct ResizeJob
+{
+    const PackTarget* target;
+    const NvU8* src;
+    NvU32 srcStride;
+    NvU32 channel;
+    ResizeAxis x;
+    ResizeAxis y;
+    NvU32 colBegin;  /* source columns any output pixel reads */
+    NvU32 colEnd;
+};
+
+// output rows [begin, end): vertical taps into line, then horizontal taps,
+// normalization and the store, all four channels per lane
+template <NvU32 NC, bool INT8>
+static void resizeRows(const ResizeJob* job, NvU32 begin, NvU32 end, PackF32x4* line)
+{
+    const PackTarget* target = job->target;
+    const ResizeAxis& ax = job->x;
+    const ResizeAxis& ay = job->y;
+    NvU32 numCols = job->colEnd - job->colBegin;
+
+    for (NvU32 y = begin; y < end; y++)
+    {
+        NvU8* drow = target->base + NvU64(y) * target->lineStride;
+
+        // borders, unused channels and line padding are zero
+        memset(drow, 0, target->lineStride);
+
+        if (y < ay.dstOffset || y >= ay.dstOffset + ay.taps.size())
+            continue;
+
+        const ResizeTap& ty = ay.taps[y - ay.dstOffset];
+
+        for (NvU32 k = 0; k < ty.count; k++)
+        {
+            const NvU8* srow = job->src + NvU64(ty.start + k) * job->srcStride + job->colBegin * NC;
+            PackF32x4 w = splatF32x4(ay.weights[ty.weights + k]);
+
+            if (k == 0)
+            {
+                for (NvU32 x = 0; x < numCols; x++)
+                    line[x] = loadPixel<NC>(srow + x * NC) * w;
+            }
+            else
+            {
+                for (NvU32 x = 0; x < numCols; x++)
+                    line[x] += loadPixel<NC>(srow + x * NC) * w;
+            }
+        }
+
+        NvU8* dst = drow + NvU64(ax.dstOffset) * FEATURE_ATOM_SIZE;
+
+        for (NvU32 x = 0; x < ax.taps.size(); x++, dst += FEATURE_ATOM_SIZE)
+        {
+            const ResizeTap& tx = ax.taps[x];
+            const PackF32x4* l = line + (tx.start - job->colBegin);
+            const NvF32* w = &ax.weights[tx.weights];
+            PackF32x4 acc = l[0] * splatF32x4(w[0]);
+
+            for (NvU32 k = 1; k < tx.count; k++)
+                acc += l[k] * splatF32x4(w[k]);
+
+            storePixel<NC, INT8>(acc * target->scale + target->bias, dst);
+        }
+    }
+}
+
+typedef void (*ResizeRowsFunction)(const ResizeJob* job, NvU32 begin, NvU32 end, PackF32x4* line);
+
+static const ResizeRowsFunction resizeRowsFunctions[2][4] =
+{
+    { resizeRows<1, false>, resizeRows<2, false>, resizeRows<3, false>, resizeRows<4, false> },
+    { resizeRows<1, true>, resizeRows<2, true>, resizeRows<3, true>, resizeRows<4, true> },
+};
+
+static void resizeBand(const ResizeJob* job, NvU32 begin, NvU32 end)
+{
+    std::vector<PackF32x4> line(job->colEnd - job->colBegin);
+
+    resizeRowsFunctions[job->target->int8][job->channel - 1](job, begin, end, &line[0]);
+}
+
+// resamples an interleaved 8-bit source to the target size in one pass,
+// in row bands on up to params->threads threads for large outputs
+static NvDlaError resizeToTarget(const PackTarget* target, const PreprocessParams* params,
+                                 const NvU8* src, NvU32 srcStride, NvU32 srcWidth, NvU32 srcHeight, NvU32 channel)
+{
+    ResizeJob job;
+    std::vector<std::thread> threads;
+    NvF32 scaleX, scaleY;
+    NvU32 numThreads, band;
+
+    if (srcWidth == 0 || srcHeight == 0)
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "source is %ux%u", srcWidth, srcHeight);
+
+    fitScale(params->fit, srcWidth, srcHeight, target->width, target->height, &scaleX, &scaleY);
+
+    job.target = target;
+    job.src = src;
+    job.srcStride = srcStride;
+    job.channel = channel;
+    initResizeAxis(params->fit, params->filter, srcWidth, target->width, scaleX, &job.x);
+    initResizeAxis(params->fit, params->filter, srcHeight, target->height, scaleY, &job.y);
+
+    const ResizeTap& lastTap = job.x.taps.back();
+    job.colBegin = job.x.taps.front().start;
+    job.colEnd = lastTap.start + lastTap.count;
+
+    numThreads = std::max(1U, std::min(params->threads, NvU32(RESIZE_MAX_THREADS)));
+    numThreads = std::min(numThreads, std::max(1U, target->width * target->height / RESIZE_MIN_PIXELS_PER_THREAD));
+    band = (target->height + numThreads - 1) / numThreads;
+
+    for (NvU32 t = 1; t < numThreads; t++)
+    {
+        NvU32 begin = std::min(t * band, target->height);
+        NvU32 end = std::min(begin + band, target->height);
+
+        threads.push_back(std::thread(resizeBand, &job, begin, end));
+    }
+
+    resizeBand(&job, 0, std::min(band, target->height));
+
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+
+    return NvDlaSuccess;
+}
+
+void initPreprocessParams(const TestAppArgs* appArgs, PreprocessParams* params)
+{
+    for (NvU32 c = 0; c < 4; c++)
+    {
+        if (appArgs->normalize_value[c] == 0)
+        {
+            params->scale[c] = 1.0f;
+            params->bias[c] = 0.0f;
+        }
+        else
+        {
+            // ((x / 255) - mean) / std
+            params->scale[c] = 1.0f / (255.0f * appArgs->normalize_value[c]);
+            params->bias[c] = -appArgs->mean[c] / appArgs->normalize_value[c];
+        }
+    }
+
+    params->fit = PREPROCESS_FIT_STRETCH;
+    if (appArgs->fitMode == "crop")
+        params->fit = PREPROCESS_FIT_CROP;
+    else if (appArgs->fitMode == "letterbox")
+        params->fit = PREPROCESS_FIT_LETTERBOX;
+
+    params->filter = PREPROCESS_RESIZE_AUTO;
+    if (appArgs->resizeFilter == "bilinear")
+        params->filter = PREPROCESS_RESIZE_BILINEAR;
+    else if (appArgs->resizeFilter == "area")
+        params->filter = PREPROCESS_RESIZE_AREA;
+
+    // int8 inputs are refused unless these are given
+    params->inputScale = appArgs->inputScale;
+    params->inputOffset = appArgs->inputOffset;
+
+    // the pipeline already preprocesses several images at once
+    params->threads = 1;
+    if (appArgs->inputDir == "")
+        params->threads = std::max(1U, std::thread::hardware_concurrency());
+}
+
+NvDlaError packImageToTensor(const NvDlaImage* in, const PreprocessParams* params,
+                             const nvdla::IRuntime::NvDlaTensor* tensor, void* dst)
+{
+    PackTarget target;
+
+    if (!in || !params || !tensor || !dst || !in->m_pData)
+        ORIGINATE_ERROR(NvDlaError_BadParameter);
+
+    switch (in->m_meta.surfaceFormat)
+    {
+        case NvDlaImage::T_R8:
+        case NvDlaImage::T_R8G8B8:
+        case NvDlaImage::T_B8G8R8:
+        case NvDlaImage::T_R8G8B8X8:
+        case NvDlaImage::T_B8G8R8X8:
+        case NvDlaImage::T_X8R8G8B8:
+        case NvDlaImage::T_X8B8G8R8:
+        case NvDlaImage::T_R8G8B8A8:
+        case NvDlaImage::T_B8G8R8A8:
+        case NvDlaImage::T_A8R8G8B8:
+        case NvDlaImage::T_A8B8G8R8:
+            break;
+        default:
+            ORIGINATE_ERROR(NvDlaError_NotSupported, "unsupported source format %d", in->m_meta.surfaceFormat);
+    }
+
+    PROPAGATE_ERROR(initPackTarget(params, tensor, in->m_meta.channel, dst, &target));
+
+    if (in->m_meta.width == target.width && in->m_meta.height == target.height)
+        packRows(&target, static_cast<const NvU8*>(in->m_pData), in->m_meta.lineStride,
+                 in->m_meta.channel, 0, target.height);
+    else
+        PROPAGATE_ERROR(resizeToTarget(&target, params, static_cast<const NvU8*>(in->m_pData), in->m_meta.lineStride,
+                                       in->m_meta.width, in->m_meta.height, in->m_meta.channel));
+    finishPackTarget(&target);
+
+    return NvDlaSuccess;
+}
+
+// libjpeg's own error_exit() exits the process, this one jumps back to the
+// decoder. Warnings stay quiet, the decoder checks for them once done.
+struct JpegError
+{
+    struct jpeg_error_mgr mgr;
+    jmp_buf jump;
+};
+
+static void jpegErrorExit(j_common_ptr info)
+{
+    longjmp(reinterpret_cast<JpegError*>(info->err)->jump, 1);
+}
+
+static void jpegOutputMessage(j_common_ptr info)
+{
+}
+
+// smallest M/8 libjpeg scale that does not drop below the output resolution
+static NvU32 jpegScaleNum(NvF32 scaleX, NvF32 scaleY)
+{
+    for (NvU32 m = 1; m < 8; m++)
+    {
+        if (m >= 8.0f * scaleX - 1e-4f && m >= 8.0f * scaleY - 1e-4f)
+            return m;
+    }
+
+    return 8;
+}
+
+NvDlaError JPEG2Tensor(std::string inputFileName, const PreprocessParams* params,
+                       const nvdla::IRuntime::NvDlaTensor* tensor, void* dst)
+{
+    NvDlaError e = NvDlaSuccess;
+    const NvU8* data = NULL;
+    size_t size = 0;
+
+    PROPAGATE_ERROR(mapFile(inputFileName, &data, &size));
+    PROPAGATE_ERROR_FAIL(JPEGBuffer2Tensor(data, size, params, tensor, dst));
+
+fail:
+    unmapFile(data, size);
+    return e;
+}
+
+NvDlaError JPEGBuffer2Tensor(const NvU8* data, size_t size, const PreprocessParams* params,
+                             const nvdla::IRuntime::NvDlaTensor* tensor, void* dst)
+{
+    NvDlaError e = NvDlaSuccess;
+    struct jpeg_decompress_struct info;
+    JpegError err;
+    JSAMPROW rowPtr[JPEG_BATCH_LINES];
+    NvU8* volatile rows = NULL;     /* kept across a longjmp */
+    NvU32 channel, rowBytes, batchLines;
+    NvF32 scaleX, scaleY;
+    PackTarget target;
+    volatile bool started = false;
+    bool resize;
+
+    if (!data || !size || !params || !tensor || !dst)
+        ORIGINATE_ERROR(NvDlaError_BadParameter);
+
+    info.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = jpegErrorExit;
+    err.mgr.output_message = jpegOutputMessage;
+    jpeg_create_decompress(&info);
+
+    // a corrupt image from a client fails its own run only
+    if (setjmp(err.jump))
+    {
+        char message[JMSG_LENGTH_MAX];
+
+        err.mgr.format_message(reinterpret_cast<j_common_ptr>(&info), message);
+        started = false;
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "JPEG decode failed: %s", message);
+    }
+
+    jpeg_mem_src(&info, const_cast<NvU8*>(data), size);
+    jpeg_read_header(&info, TRUE);
+
+    switch (info.jpeg_color_space)
+    {
+        case JCS_GRAYSCALE:
+            info.out_color_space = JCS_GRAYSCALE;
+            break;
+        case JCS_YCbCr:
+        case JCS_RGB:
+            // single channel networks only need luma, skip chroma entirely
+            info.out_color_space = tensor->dims.c == 1 ? JCS_GRAYSCALE : JCS_RGB;
+            break;
+        default:
+            ORIGINATE_ERROR_FAIL(NvDlaError_NotSupported, "JPEG color space %d not supported", info.jpeg_color_space);
+    }
+
+    PROPAGATE_ERROR_FAIL(initPackTarget(params, tensor, info.out_color_space == JCS_RGB ? 3 : 1, dst, &target));
+
+    // let the IDCT do the bulk of the downscale, then decode at that size
+    fitScale(params->fit, info.image_width, info.image_height, target.width, target.height, &scaleX, &scaleY);
+    info.scale_num = jpegScaleNum(scaleX, scaleY);
+    info.scale_denom = 8;
+    info.dct_method = JDCT_IFAST;
+    jpeg_calc_output_dimensions(&info);
+
+    // anything the IDCT could not match exactly is decoded whole and resized
+    channel = info.output_components;
+    rowBytes = info.output_width * channel;
+    resize = info.output_width != target.width || info.output_height != target.height;
+    batchLines = resize ? info.output_height : JPEG_BATCH_LINES;
+
+    rows = static_cast<NvU8*>(NvDlaAlloc(NvU64(rowBytes) * batchLines));
+    if (!rows)
+        ORIGINATE_ERROR_FAIL(NvDlaError_InsufficientMemory);
+
+    for (NvU32 r = 0; r < JPEG_BATCH_LINES && r < batchLines; r++)
+        rowPtr[r] = rows + r * rowBytes;
+
+    jpeg_start_decompress(&info);
+    started = true;
+
+    while (info.output_scanline < info.output_height)
+    {
+        NvU32 y = info.output_scanline;
+        NvU32 numRows = std::min(NvU32(JPEG_BATCH_LINES), info.output_height - y);
+
+        if (resize)
+        {
+            for (NvU32 r = 0; r < numRows; r++)
+                rowPtr[r] = rows + NvU64(y + r) * rowBytes;
+        }
+
+        numRows = jpeg_read_scanlines(&info, rowPtr, numRows);
+
+        if (!resize)
+            packRows(&target, rows, rowBytes, channel, y, numRows);
+    }
+
+    // libjpeg pads a truncated scan out with gray and only warns
+    if (err.mgr.num_warnings)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "JPEG data is corrupt or truncated");
+
+    if (resize)
+        PROPAGATE_ERROR_FAIL(resizeToTarget(&target, params, rows, rowBytes, info.output_width, info.output_height, channel));
+
+    finishPackTarget(&target);
+
+fail:
+    if (started && info.output_scanline == info.output_height)
+        jpeg_finish_decompress(&info);
+    jpeg_destroy_decompress(&info);
+    if (rows)
+        NvDlaFree(rows);
+
+    return e;
+}
+
+NvDlaError imageBuffer2Tensor(const NvU8* data, size_t size, const PreprocessParams* params,
+                              const nvdla::IRuntime::NvDlaTensor* tensor, void* dst)
+{
+    NvDlaError e = NvDlaSuccess;
+    NvDlaImage image;
+
+    if (!data || size < 2)
+        ORIGINATE_ERROR(NvDlaError_BadParameter);
+
+    // JPEGs start with an SOI marker, binary PGMs with "P5"
+    if (data[0] == 0xFF && data[1] == 0xD8)
+        return JPEGBuffer2Tensor(data, size, params, tensor, dst);
+
+    if (data[0] != 'P' || data[1] != '5')
+        ORIGINATE_ERROR(NvDlaError_NotSupported, "unknown image format");
+
+    image.m_pData = NULL;
+    PROPAGATE_ERROR_FAIL(PGMBuffer2DIMG(data, size, &image));
+    PROPAGATE_ERROR_FAIL(packImageToTensor(&image, params, tensor, dst));
+
+fail:
+    if (image.m_pData)
+        NvDlaFree(image.m_pData);
+    return e;
+}
+
+NvDlaError imageFile2Tensor(std::string inputFileName, const PreprocessParams* params,
+                            const nvdla::IRuntime::NvDlaTensor* tensor, void* dst)
+{
+    NvDlaError e = NvDlaSuccess;
+    const NvU8* data = NULL;
+    size_t size = 0;
+
+    PROPAGATE_ERROR(mapFile(inputFileName, &data, &size));
+    PROPAGATE_ERROR_FAIL(imageBuffer2Tensor(data, size, params, tensor, dst));
+
+fail:
+    unmapFile(data, size);
+    return e;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NVDLA_UTILS_PREPROCESS_H
+#define NVDLA_UTILS_PREPROCESS_H
+
+#include "DlaImage.h"
+
+#include <string>
+
+#include "nvdla/IRuntime.h"
+
+struct TestAppArgs;
+
+// how a source of another size or aspect is fitted to the tensor dims
+#define PREPROCESS_FIT_STRETCH   0U
+#define PREPROCESS_FIT_CROP      1U /* scale to cover, center crop     */
+#define PREPROCESS_FIT_LETTERBOX 2U /* scale to fit, zero the borders  */
+
+#define PREPROCESS_RESIZE_AUTO     0U /* area when shrinking, else bilinear */
+#define PREPROCESS_RESIZE_BILINEAR 1U
+#define PREPROCESS_RESIZE_AREA     2U
+
+// y = x * scale[c] + bias[c], folded from the --normalize/--mean options
+struct PreprocessParams
+{
+    NvF32 scale[4];
+    NvF32 bias[4];
+    NvF32 inputScale;   /* int8 tensors: q = y / inputScale + inputOffset */
+    NvF32 inputOffset;
+    NvU32 fit;
+    NvU32 filter;
+    NvU32 threads;  /* row bands of a resize run in parallel */
+};
+
+void initPreprocessParams(const TestAppArgs* appArgs, PreprocessParams* params);
+
+// Converts an 8-bit R8/RGB/RGBX image into the input tensor's layout,
+// D_F8_CxHWx_x32_I for INT8 tensors and D_F16_CxHWx_x16_F otherwise, and
+// writes it straight into the mapped tensor, padding included. Sources of any
+// other size are resized on the way, in the same pass.
+NvDlaError packImageToTensor(const NvDlaImage* in, const PreprocessParams* params,
+                             const nvdla::IRuntime::NvDlaTensor* tensor, void* dst);
+
+// Decodes a JPEG straight into the input tensor: libjpeg downscales in the
+// IDCT towards the tensor dims and batches of scanlines are packed as they
+// come out, without a full resolution intermediate image. When the scaled
+// image still differs from the tensor it is resized like packImageToTensor().
+NvDlaError JPEG2Tensor(std::string inputFileName, const PreprocessParams* params,
+                       const nvdla::IRuntime::NvDlaTensor* tensor, void* dst);
+NvDlaError JPEGBuffer2Tensor(const NvU8* data, size_t size, const PreprocessParams* params,
+                             const nvdla::IRuntime::NvDlaTensor* tensor, void* dst);
+
+// A JPEG or binary PGM held in memory, told apart by its magic bytes.
+NvDlaError imageBuffer2Tensor(const NvU8* data, size_t size, const PreprocessParams* params,
+                              const nvdla::IRuntime::NvDlaTensor* tensor, void* dst);
+NvDlaError imageFile2Tensor(std::string inputFileName, const PreprocessParams* params,
+                            const nvdla::IRuntime::NvDlaTensor* tensor, void* dst);
+
+#endif // NVDLA_UTILS_PREPROCESS_H
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ResultCache.h"
+
+#include "nvdla_os_inf.h"
+
+#include <cstring>
+
+static inline NvU64 rotl64(NvU64 v, NvU32 r)
+{
+    return (v << r) | (v >> (64 - r));
+}
+
+static inline NvU64 load64(const NvU8* p)
+{
+    NvU64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline NvU64 mix64(NvU64 h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// four independent lanes over 32 byte blocks keep the multipliers busy,
+// input tensors are large enough that the block loop is all that matters
+NvU64 hashBytes(const void* data, size_t size, NvU64 seed)
+{
+    const NvU64 prime1 = 0x9e3779b185ebca87ULL;
+    const NvU64 prime2 = 0xc2b2ae3d27d4eb4fULL;
+    const NvU8* p = static_cast<const NvU8*>(data);
+    const NvU8* end = p + size;
+    NvU64 lane[4] = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+    NvU64 h;
+
+    for (; end - p >= 32; p += 32)
+    {
+        for (NvU32 l = 0; l < 4; l++)
+            lane[l] = rotl64(lane[l] + load64(p + 8 * l) * prime2, 31) * prime1;
+    }
+
+    h = rotl64(lane[0], 1) + rotl64(lane[1], 7) + rotl64(lane[2], 12) + rotl64(lane[3], 18);
+    h += NvU64(size);
+
+    for (; end - p >= 8; p += 8)
+        h = rotl64(h ^ (load64(p) * prime2), 27) * prime1;
+    for (; p < end; p++)
+        h = rotl64(h ^ (*p * prime1), 11) * prime2;
+
+    return mix64(h);
+}
+
+ResultCache::ResultCache(NvU64 maxBytes) :
+    m_maxBytes(maxBytes)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+ResultCache::Key ResultCache::makeKey(NvU64 cascade, const void* input, NvU64 inputSize)
+{
+    Key key;
+
+    key.cascade = cascade;
+    key.input = hashBytes(input, inputSize, cascade);
+    key.inputSize = inputSize;
+
+    return key;
+}
+
+const ResultCache::Entry* ResultCache::find(const Key& key, const void* input)
+{
+    std::unordered_map<Key, EntryList::iterator, KeyHash>::iterator f = m_index.find(key);
+
+    // equal hashes are not enough, a collision would hand back someone else's result
+    if (f == m_index.end() || f->second->input.size() != key.inputSize ||
+        (key.inputSize && memcmp(&f->second->input[0], input, key.inputSize) != 0))
+    {
+        m_stats.misses++;
+        return NULL;
+    }
+
+    m_lru.splice(m_lru.begin(), m_lru, f->second);
+    m_stats.hits++;
+
+    return &*f->second;
+}
+
+bool ResultCache::lookup(const Key& key, const void* input, NvU32* part, nvdla::IRuntime::NvDlaTopK* topk,
+                         void* const* outputs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Entry* entry = find(key, input);
+
+    if (!entry)
+        return false;
+
+    *part = entry->part;
+    *topk = entry->topk;
+    if (outputs && !entry->output.empty())
+        memcpy(outputs[entry->part], &entry->output[0], entry->output.size());
+
+    return true;
+}
+
+bool ResultCache::lookupCopy(const Key& key, const void* input, NvU32* part, nvdla::IRuntime::NvDlaTopK* topk,
+                             std::vector<NvU8>* output)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Entry* entry = find(key, input);
+
+    if (!entry)
+        return false;
+
+    *part = entry->part;
+    *topk = entry->topk;
+    *output = entry->output;
+
+    return true;
+}
+
+void ResultCache::insert(const Key& key, const void* input, NvU32 part, const nvdla::IRuntime::NvDlaTopK& topk,
+                         const void* output, NvU64 outputSize)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unordered_map<Key, EntryList::iterator, KeyHash>::iterator f = m_index.find(key);
+
+    // a result that can never fit would only flush everything else
+    if (sizeof(Entry) + key.inputSize + outputSize > m_maxBytes)
+        return;
+
+    if (f != m_index.end())
+    {
+        m_stats.bytes -= entryBytes(*f->second);
+        m_lru.erase(f->second);
+        m_index.erase(f);
+        m_stats.entries--;
+    }
+
+    m_lru.push_front(Entry());
+
+    Entry& entry = m_lru.front();
+    entry.key = key;
+    entry.part = part;
+    entry.topk = topk;
+    entry.input.assign(static_cast<const NvU8*>(input), static_cast<const NvU8*>(input) + key.inputSize);
+    entry.output.assign(static_cast<const NvU8*>(output), static_cast<const NvU8*>(output) + outputSize);
+
+    m_index[key] = m_lru.begin();
+    m_stats.bytes += entryBytes(entry);
+    m_stats.entries++;
+
+    while (m_stats.bytes > m_maxBytes)
+    {
+        Entry& oldest = m_lru.back();
+
+        m_stats.bytes -= entryBytes(oldest);
+        m_index.erase(oldest.key);
+        m_lru.pop_back();
+        m_stats.entries--;
+        m_stats.evictions++;
+    }
+}
+
+ResultCache::Stats ResultCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void ResultCache::printStats() const
+{
+    Stats s = stats();
+    NvU64 lookups = s.hits + s.misses;
+
+    NvDlaDebugPrintf("cache: %llu hits, %llu misses (%.1f%% hit rate), %llu evictions, %llu entries, %.1f of %.1f MB\n",
+                     (unsigned long long)s.hits, (unsigned long long)s.misses,
+                     lookups ? 100.0 * s.hits / lookups : 0.0, (unsigned long long)s.evictions,
+                     (unsigned long long)s.entries, s.bytes / 1048576.0, m_maxBytes / 1048576.0);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NVDLA_UTILS_RESULT_CACHE_H
+#define NVDLA_UTILS_RESULT_CACHE_H
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "nvdla/IRuntime.h"
+
+// fast non-cryptographic 64-bit hash, chain calls through seed
+NvU64 hashBytes(const void* data, size_t size, NvU64 seed);
+
+// Final cascade results keyed by a hash of the packed input tensor and the
+// identity of the loadables that produced them, so byte-identical inputs
+// skip inference. Entries keep the input and a hit is only taken when the
+// bytes match, not just the hash. Bounded by bytes, least recently used
+// entries go first. Safe to share between threads.
+class ResultCache
+{
+public:
+    struct Key
+    {
+        NvU64 cascade;      /* hash of every loadable in the cascade */
+        NvU64 input;        /* hash of the packed input tensor */
+        NvU64 inputSize;
+
+        bool operator==(const Key& o) const
+        {
+            return cascade == o.cascade && input == o.input && inputSize == o.inputSize;
+        }
+    };
+
+    struct Stats
+    {
+        NvU64 hits;
+        NvU64 misses;
+        NvU64 evictions;
+        NvU64 entries;
+        NvU64 bytes;
+    };
+
+    explicit ResultCache(NvU64 maxBytes);
+
+    static Key makeKey(NvU64 cascade, const void* input, NvU64 inputSize);
+
+    // input is what key was made from. on a hit copies the final output
+    // into outputs[*part] unless outputs is NULL
+    bool lookup(const Key& key, const void* input, NvU32* part, nvdla::IRuntime::NvDlaTopK* topk,
+                void* const* outputs);
+    // same, copying the final output into *output
+    bool lookupCopy(const Key& key, const void* input, NvU32* part, nvdla::IRuntime::NvDlaTopK* topk,
+                    std::vector<NvU8>* output);
+
+    void insert(const Key& key, const void* input, NvU32 part, const nvdla::IRuntime::NvDlaTopK& topk,
+                const void* output, NvU64 outputSize);
+
+    Stats stats() const;
+    void printStats() const;
+
+protected:
+    struct Entry
+    {
+        Key key;
+        NvU32 part;
+        nvdla::IRuntime::NvDlaTopK topk;
+        std::vector<NvU8> input;
+        std::vector<NvU8> output;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& k) const { return size_t(k.input ^ k.cascade); }
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    static NvU64 entryBytes(const Entry& entry) { return sizeof(Entry) + entry.input.size() + entry.output.size(); }
+
+    // the entry for key holding exactly input, moved to the front, or NULL
+    const Entry* find(const Key& key, const void* input);
+
+    mutable std::mutex m_mutex;
+    EntryList m_lru;        // most recently used first
+    std::unordered_map<Key, EntryList::iterator, KeyHash> m_index;
+    NvU64 m_maxBytes;
+    Stats m_stats;
+};
+
+#endif // NVDLA_UTILS_RESULT_CACHE_H
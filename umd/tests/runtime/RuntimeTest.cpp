@@ -4,6 +4,7 @@
  * Date: 13/02/2025
  */
 
+#include "CascadeTrace.h"
 #include "DlaImageUtils.h"
 #include "ErrorMacros.h"
 #ifndef RUNTIME_TEST_H
@@ -15,6 +16,7 @@
 
 #include "../../external/include/half.h"
 #include "main.h"
+#include "Preprocess.h"
 #include "nvdla_os_inf.h"
 
 #include "dlaerror.h"
@@ -26,13 +28,11 @@
 #include <chrono>
 #include <thread>
 
-#define CONF_THRESH 0.6
-
 #define OUTPUT_DIMG "output.dimg"
 
 using namespace half_float;
 
-static TestImageTypes getImageType(std::string imageFileName)
+TestImageTypes getImageType(std::string imageFileName)
 {
     TestImageTypes it = IMAGE_TYPE_UNKNOWN;
     std::string ext = imageFileName.substr(imageFileName.find_last_of(".") + 1);
@@ -49,41 +49,39 @@ static TestImageTypes getImageType(std::string imageFileName)
     return it;
 }
 
-static NvDlaError copyImageToInputTensor(const TestAppArgs* appArgs, TestInfo* i, void** pImgBuffer)
+static NvDlaError copyImageToInputTensor(const TestAppArgs* appArgs, TestInfo* i,
+                                         const nvdla::IRuntime::NvDlaTensor* pTDesc, void** pImgBuffer)
 {
     NvDlaError e = NvDlaSuccess;
 
     NvDlaImage* R8Image = new NvDlaImage();
-    NvDlaImage* FF16Image = NULL;
+    PreprocessParams params;
 
     std::string imgPath = /*i->inputImagesPath + */appArgs->inputName;
     TestImageTypes imageType = getImageType(imgPath);
 
-    if (appArgs == NULL || i == NULL || pImgBuffer == NULL)
+    if (appArgs == NULL || i == NULL || pTDesc == NULL || pImgBuffer == NULL)
         ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "NULL input parameter");
 
     if (!R8Image)
         ORIGINATE_ERROR(NvDlaError_InsufficientMemory);
 
+    initPreprocessParams(appArgs, &params);
+
+    // normalize and pack straight into the mapped input tensor
     switch (imageType) {
         case IMAGE_TYPE_PGM:
-            PROPAGATE_ERROR(PGM2DIMG(imgPath, R8Image));
+            PROPAGATE_ERROR_FAIL(PGM2DIMG(imgPath, R8Image));
+            PROPAGATE_ERROR_FAIL(packImageToTensor(R8Image, &params, pTDesc, *pImgBuffer));
             break;
         case IMAGE_TYPE_JPG:
-            PROPAGATE_ERROR(JPEG2DIMG(imgPath, R8Image));
+            PROPAGATE_ERROR_FAIL(JPEG2Tensor(imgPath, &params, pTDesc, *pImgBuffer));
             break;
         default:
             NvDlaDebugPrintf("Unknown image type: %s", imgPath.c_str());
             goto fail;
     }
 
-    FF16Image = i->inputImage;
-    if (FF16Image == NULL)
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "NULL input Image");
-    
-    PROPAGATE_ERROR(createFF16ImageCopy(appArgs, R8Image, FF16Image));
-    PROPAGATE_ERROR(DIMG2DlaBuffer(FF16Image, pImgBuffer));
-
 fail:
     if (R8Image != NULL && R8Image->m_pData != NULL)
         NvDlaFree(R8Image->m_pData);
@@ -103,7 +101,7 @@ fail:
     return e;
 }
 
-static NvDlaError readLoadable(const TestAppArgs* appArgs, TestInfo* i, int loadableNum)
+NvDlaError readLoadable(const TestAppArgs* appArgs, TestInfo* i, int loadableNum)
 {
     NvDlaError e = NvDlaSuccess;
     NVDLA_UNUSED(appArgs);
@@ -152,6 +150,7 @@ static NvDlaError readLoadable(const TestAppArgs* appArgs, TestInfo* i, int load
     }
 
     i->pData = buf;
+    i->loadableSize = file_size;
 
 fail:
     return e;
@@ -205,7 +204,7 @@ NvDlaError setupInputBuffer(const TestAppArgs* appArgs, TestInfo* i, void** pInp
 
     PROPAGATE_ERROR_FAIL(runtime->allocateSystemMemory(&hMem, tDesc.bufferSize, pInputBuffer));
     i->inputHandle = (NvU8 *)hMem;
-    PROPAGATE_ERROR_FAIL(copyImageToInputTensor(appArgs, i, pInputBuffer));
+    PROPAGATE_ERROR_FAIL(copyImageToInputTensor(appArgs, i, &tDesc, pInputBuffer));
 
     if (!runtime->bindInputTensor(0, hMem))
         ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "runtime->bindInputTensor() failed");
@@ -318,65 +317,14 @@ static void cleanupOutputBuffer(const TestAppArgs* appArgs, TestInfo* i)
 }
 
 
-NvF32 calc_confidence(std::vector<NvF32>* outputData)
-{
-    if (!outputData || outputData->size() <= 0)
-    {
-        NvDlaDebugPrintf("[ERROR] Invalid input data when calculating confidence\n");
-        return 0.0f;
-    }
-
-    // Step 1: Normalise vector w/ softmax
-    NvF32 sumExp = 0.0f;
-
-    // 1.1: Get max logit
-    NvF32 maxLogit = outputData->at(0);
-    for (int i = 1; i < outputData->size(); i++)
-    {
-        if (outputData->at(i) > maxLogit)
-        {
-            maxLogit = outputData->at(i);
-        }
-    }
-
-    // 1.2: Calculate sum of exponentials
-    for (int i = 0; i < outputData->size(); i++)
-    {
-        sumExp += exp(outputData->at(i) - maxLogit);
-    }
-
-    // 1.3: Normalise
-    for (int i = 0; i < outputData->size(); i++)
-    {
-        outputData->at(i) = exp(outputData->at(i) - maxLogit) / sumExp;
-    }
-
-    NvF32 top_one = 0;
-    NvF32 top_two = 0;
-
-    for (int i = 0; i < outputData->size(); i++)
-    {
-        if (outputData->at(i) > top_one)
-        {
-            top_two = top_one;
-            top_one = outputData->at(i);
-        }
-        else if (outputData->at(i) > top_two)
-        {
-            top_two = outputData->at(i);
-        }
-    }
-    NvDlaDebugPrintf("Top one: %f\n", top_one);
-    NvDlaDebugPrintf("Top two: %f\n", top_two);
-    return top_one - top_two;
-}
-
-NvDlaError runTest(const TestAppArgs* testAppArgs, TestInfo* i, NvF32* conf, bool* final)
+// runs the next loadable of the cascade, adding its submit to trace
+NvDlaError runTest(const TestAppArgs* testAppArgs, TestInfo* i, NvF32* conf, bool* final, CascadeTrace* trace)
 {
     NvDlaError e = NvDlaSuccess;
     void* pInputBuffer = NULL;
     void* pOutputBuffer = NULL;
-    std::vector<NvF32> outVec;
+    nvdla::IRuntime::NvDlaTopK topk;
+    nvdla::IRuntime::NvDlaRuntimeStats stats;
 
     NvDlaDebugPrintf("Running test...\n");
 
@@ -397,13 +345,20 @@ NvDlaError runTest(const TestAppArgs* testAppArgs, TestInfo* i, NvF32* conf, boo
     if (!runtime->submit())
         ORIGINATE_ERROR(NvDlaError_BadParameter, "runtime->submit() failed");
 
-    // *outputBuffer = i->outputImage;
-
-    PROPAGATE_ERROR_FAIL(DlaBuffer2DIMG(&pOutputBuffer, i->outputImage));
+    // submit path allocations stop growing once it is warm
+    if (runtime->getStats(&stats) == NvDlaSuccess)
+        NvDlaDebugPrintf("Submits: %llu, EMU tasks: %llu, submit allocations: %llu\n",
+                         (unsigned long long)stats.numSubmits, (unsigned long long)stats.numEmuTasks,
+                         (unsigned long long)stats.submitAllocations);
 
-    PROPAGATE_ERROR_FAIL(i->outputImage->to_float(&outVec));
+    // the cascade decision only needs the top two probabilities, read
+    // them from the output surface instead of converting the whole tensor
+    PROPAGATE_ERROR_FAIL(runtime->getOutputTopK(0, 2, &topk));
 
-    *conf = calc_confidence(&outVec);
+    NvDlaDebugPrintf("Top one: %f\n", topk.prob[0]);
+    NvDlaDebugPrintf("Top two: %f\n", topk.k > 1 ? topk.prob[1] : 0.0f);
+    *conf = topk.margin;
+    trace->addSubmit(trace->steps.size(), runtime, topk.margin);
 
     NvDlaDebugPrintf("Confidence: %f\n", *conf);
     NvDlaDebugPrintf("Raw output dump: %d\n", testAppArgs->rawOutputDump);
@@ -412,7 +367,7 @@ NvDlaError runTest(const TestAppArgs* testAppArgs, TestInfo* i, NvF32* conf, boo
     {
         NvDlaDebugPrintf("Confidence is too low, increasing partition\n");
         NvDlaDebugPrintf("Final: %d\n", *final);
-        if (final)
+        if (*final)
         {
             NvDlaDebugPrintf("Cannot increase partition, on final partition, moving to export\n");
         }
@@ -427,7 +382,13 @@ NvDlaError runTest(const TestAppArgs* testAppArgs, TestInfo* i, NvF32* conf, boo
         NvDlaDebugPrintf("Confidence is high enough, stopping\n");
         *final = true;
     }
-    PROPAGATE_ERROR_FAIL(DIMG2DIMGFile(i->outputImage, OUTPUT_DIMG, true, testAppArgs->rawOutputDump));
+
+    // only the partition that answers converts and writes the output image
+    if (*final)
+    {
+        PROPAGATE_ERROR_FAIL(DlaBuffer2DIMG(&pOutputBuffer, i->outputImage));
+        PROPAGATE_ERROR_FAIL(DIMG2DIMGFile(i->outputImage, OUTPUT_DIMG, true, testAppArgs->rawOutputDump));
+    }
 
 fail:
     cleanupOutputBuffer(testAppArgs, i);
@@ -454,6 +415,7 @@ NvDlaError run(const TestAppArgs* tAA, TestInfo* testInfo)
     int final_part = 0;
     bool final = false;
     NvF32 confidence = 0.0f;
+    CascadeTrace trace;
     
     NvDlaDebugPrintf("creating new runtime contexts...\n");
     for (int i = 0; i < tAA->loadableNames.size(); i++)
@@ -483,7 +445,7 @@ NvDlaError run(const TestAppArgs* tAA, TestInfo* testInfo)
             NvDlaDebugPrintf("Final partition, at i=%d\n", i);
         }
 
-        PROPAGATE_ERROR_FAIL(runTest(tAA, testInfo, &confidence, &final));
+        PROPAGATE_ERROR_FAIL(runTest(tAA, testInfo, &confidence, &final, &trace));
         final_part = i;
 
         if (final)
@@ -505,7 +467,7 @@ NvDlaError run(const TestAppArgs* tAA, TestInfo* testInfo)
         nvdla::destroyRuntime(testInfo->runtime);
     }
 
-    // PROPAGATE_ERROR_FAIL(DIMG2DIMGFile(testInfoVec->at(final_part).outputImage, OUTPUT_DIMG, true, tAAvec->at(final_part).rawOutputDump));
+    NvDlaDebugPrintf("%s\n", trace.format().c_str());
 
 fail:
     /* Stop Emulator */
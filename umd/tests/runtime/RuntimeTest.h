@@ -21,20 +21,52 @@ struct TestAppArgs
 {
     std::string inputPath;
     std::string inputName;
+    std::string inputDir;
+    std::string fitMode;
+    std::string resizeFilter;
+    std::string socketPath;
     std::vector<std::string> loadableNames;
     NvS32 serverPort;
     float normalize_value[4];
     float mean[4];
+    float inputScale;
+    float inputOffset;
     bool rawOutputDump;
+    NvU32 numThreads;
+    bool inOrder;
+    NvU32 batchSize;
+    NvU32 cacheSize;
+    NvU32 modelBudget;
+    NvU32 batchWindow;
+    NvS32 metricsPort;
+    NvU32 clientQueue;
+    bool traceRuns;
+    bool remoteShutdown;
 
     TestAppArgs() :
         inputPath("./"),
         inputName(""),
+        inputDir(""),
+        fitMode("stretch"),
+        resizeFilter("auto"),
+        socketPath(""),
         loadableNames(),
         serverPort(6666),
         normalize_value{1.0, 1.0, 1.0, 1.0},
         mean{0.0, 0.0, 0.0, 0.0},
-        rawOutputDump(false)
+        inputScale(0.0),
+        inputOffset(0.0),
+        rawOutputDump(false),
+        numThreads(2),
+        inOrder(false),
+        batchSize(1),
+        cacheSize(0),
+        modelBudget(256),
+        batchWindow(1000),
+        metricsPort(0),
+        clientQueue(4),
+        traceRuns(false),
+        remoteShutdown(false)
     {}
 };
 
@@ -45,6 +77,7 @@ struct TestInfo
     NvU8 *inputHandle;
     NvU8 *outputHandle;
     NvU8 *pData;
+    size_t loadableSize;
     bool dlaServerRunning;
     NvS32 dlaRemoteSock;
     NvS32 dlaServerSock;
@@ -59,6 +92,7 @@ struct TestInfo
         inputHandle(NULL),
         outputHandle(NULL),
         pData(NULL),
+        loadableSize(0),
         dlaServerRunning(false),
         dlaRemoteSock(-1),
         dlaServerSock(-1),
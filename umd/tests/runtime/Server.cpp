@@ -27,8 +27,13 @@
  */
 
 #include "ErrorMacros.h"
+#ifndef RUNTIME_TEST_H
+#define RUNTIME_TEST_H
 #include "RuntimeTest.h"
+#endif
 #include "Server.h"
+#include "Sha256.h"
+#include "main.h"
 
 #include "nvdla/IRuntime.h"
 
@@ -37,651 +42,2287 @@
 #include "dlaerror.h"
 #include "dlatypes.h"
 
-#include <cstdio> // snprintf, fopen
-#include <fstream>
+#include <algorithm>
+#include <cstdio> // snprintf
+#include <sstream>
 #include <string>
 #include <string.h>
-#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
-#include <stdlib.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <errno.h>
-#include <limits.h>
 
-#define MAX_TRY 10
-#define CLOSE_SLEEP 5
+#define MAX_CLIENTS 256
+#define MAX_EVENTS 64
+#define SHUTDOWN_GRACE_MS 5000
+#define TRANSIENT_LINGER_MS 100     /* a transient loadable stays loaded for the next escalation */
+#define HTTP_MAX_REQUEST (16 << 10)
 
-const uint32_t TCPSERVER_MSGLEN = 256;
-const char TCPSERVER_SEPARATOR = '\n';
-const uint32_t TCPSERVER_MAXREADSIZE = 1 << 29; // 512 MB
+const size_t TCPSERVER_RECVCHUNK = 64 << 10;
+const size_t TCPSERVER_MAXIOV = 64;
+const size_t TCPSERVER_RECV_HIGH_WATER = 1 << 20; // stop reading a busy client past this
 
-#define prepareReplyMsg(args...)					\
-do {									\
-    memset(replyMsg, 0, sizeof(replyMsg));				\
-    snprintf(replyMsg, sizeof(replyMsg), "" args);		\
-} while (0)
+// epoll user data, connection ids start after these
+#define EVENT_LISTEN 0ULL
+#define EVENT_WAKE   1ULL
+#define EVENT_METRICS 2ULL
+#define EVENT_LOCAL  3ULL
 
-char replyMsg[256] = {0};               ///< Reply message to client.
-
-static NvDlaError getRecvBufSize(const TestAppArgs* appArgs, TestInfo *testInfo, int32_t *size)
+// request counter labels, by opcode
+static const char* const opcodeNames[ServerMetrics::MAX_OPCODES] =
 {
-    NvDlaError e = NvDlaSuccess;
-    socklen_t m;
-    int retcode;
+    "unknown", "get_welcome", "query_flatbuf", "read_flatbuf", "run_flatbuf", "run_image",
+    "get_numoutputs", "get_output", "shutdown", "get_stats", "map_buffers", "run_buffer"
+};
 
-    if (!size)
-    {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "getRecvBufSize(): -1\n");
-    }
+// by priorityRank()
+static const char* const priorityNames[ServerMetrics::MAX_PRIORITIES] = { "interactive", "normal", "bulk" };
 
-    m = sizeof(*size);
-    retcode = getsockopt(testInfo->dlaRemoteSock, SOL_SOCKET, SO_RCVBUF, (void*)size, &m);
-    if (retcode != 0)
+InferenceServer::Model::~Model()
+{
+    for (size_t p = 0; p < parts.size(); p++)
     {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "getsockopt() failed\n");
+        ModelPart* part = parts[p];
+
+        for (size_t i = 0; i < part->instances.size(); i++)
+            destroyInstance(part, part->instances[i]);
+        delete part;
     }
+}
 
-fail:
-    return e;
+InferenceServer::InferenceServer(const TestAppArgs* appArgs) :
+    m_appArgs(appArgs),
+    m_listenFd(-1),
+    m_metricsFd(-1),
+    m_localFd(-1),
+    m_epollFd(-1),
+    m_wakeFd(-1),
+    m_nextConnId(EVENT_LOCAL + 1),
+    m_modelBytes(0),
+    m_pinnedBytes(0),
+    m_modelBudget(NvU64(appArgs->modelBudget) << 20),
+    m_cache(NULL),
+    m_maxBatch(std::max(appArgs->batchSize, 1U)),
+    m_batchWindowUs(appArgs->batchWindow),
+    m_clientQueue(std::max(appArgs->clientQueue, 1U)),
+    m_readyOrder(0),
+    m_jobs(NULL),
+    m_done(NULL),
+    m_running(0),
+    m_inflight(0),
+    m_stopping(false)
+{
+    memset(m_batchSizes, 0, sizeof(m_batchSizes));
+
+    initPreprocessParams(m_appArgs, &m_params);
+    // requests already run side by side, don't split a resize across threads too
+    m_params.threads = 1;
 }
 
-static NvDlaError getSendBufSize(const TestAppArgs* appArgs, TestInfo *testInfo, int32_t *size)
+InferenceServer::~InferenceServer()
 {
-    NvDlaError e = NvDlaSuccess;
-    socklen_t m;
-    int retcode;
+    Job* job;
 
-    if (!size)
+    // before the workers go, they free the connections' shared buffers
+    while (!m_conns.empty())
+        closeConnection(m_conns.begin()->second);
+
+    // unmaps among them, anything else finds its connection gone
+    while (m_jobs && !m_ready.empty())
     {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "getSendBufSize(): -1\n");
+        m_jobs->push(m_ready.top());
+        m_ready.pop();
     }
 
-    m = sizeof(*size);
-    retcode = getsockopt(testInfo->dlaRemoteSock, SOL_SOCKET, SO_SNDBUF, (void*)size, &m);
-    if (retcode != 0)
+    if (m_jobs)
+        m_jobs->close();
+    for (size_t t = 0; t < m_workers.size(); t++)
+        m_workers[t].join();
+    m_workers.clear();
+
+    while (m_jobs && m_jobs->tryPop(&job))
+        delete job;
+    for (std::map<Model*, PendingBatch>::iterator it = m_pending.begin(); it != m_pending.end(); ++it)
     {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "getsockopt() failed\n");
+        for (size_t j = 0; j < it->second.jobs.size(); j++)
+            delete it->second.jobs[j];
     }
-
-fail:
-    return e;
+    while (m_done && m_done->tryPop(&job))
+        delete job;
+
+    if (m_listenFd >= 0)
+        close(m_listenFd);
+    if (m_metricsFd >= 0)
+        close(m_metricsFd);
+    if (m_localFd >= 0)
+    {
+        close(m_localFd);
+        unlink(m_appArgs->socketPath.c_str());
+    }
+    if (m_wakeFd >= 0)
+        close(m_wakeFd);
+    if (m_epollFd >= 0)
+        close(m_epollFd);
+
+    m_defaultModel.reset();
+    m_models.clear();
+    m_modelLru.clear();
+    delete m_cache;
+    delete m_jobs;
+    delete m_done;
 }
 
-static int64_t getSizeInInteger(char *strSize)
+// Loads an instance of the part without touching its lists, so it can run
+// outside part->mutex. The caller adds it.
+NvDlaError InferenceServer::createInstance(ModelPart* part, NvU32 batch, Instance** instance)
 {
-    char *end;
-    int64_t val = 0;
-
-    char str[TCPSERVER_MSGLEN] = {'\0'};
-    errno = 0; /* To distinguish success/failure after call */
-    strncpy(str, strSize, sizeof(str));
-    val = strtol(str, &end, 10);
-
-    if ((errno == ERANGE) && (val == LONG_MAX || val == LONG_MIN)) {
-        NvDlaDebugPrintf("strtol failed\n");
-        val = -1;
-        goto fail;
+    NvDlaError e = NvDlaSuccess;
+    NvS32 numTensors = 0;
+    Instance* inst = new Instance();
+
+    inst->batch = batch;
+    inst->inputHandle = inst->inputData = NULL;
+    inst->outputHandle = inst->outputData = NULL;
+
+    inst->runtime = nvdla::createRuntime();
+    if (inst->runtime == NULL)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "createRuntime() failed");
+
+    if (!inst->runtime->load(&part->loadable[0], 0))
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "runtime->load failed");
+    if (!inst->runtime->initEMU())
+        ORIGINATE_ERROR_FAIL(NvDlaError_DeviceNotFound, "runtime->initEMU() failed");
+
+    PROPAGATE_ERROR_FAIL(inst->runtime->getNumInputTensors(&numTensors));
+    if (numTensors < 1)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "loadable has no input");
+    PROPAGATE_ERROR_FAIL(inst->runtime->getNumOutputTensors(&numTensors));
+    if (numTensors < 1)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "loadable has no output");
+
+    // a transient part keeps what its first load described, readers don't lock
+    if (!part->transient)
+    {
+        PROPAGATE_ERROR_FAIL(inst->runtime->getInputTensorDesc(0, &part->inputDesc));
+        PROPAGATE_ERROR_FAIL(inst->runtime->getOutputTensorDesc(0, &part->outputDesc));
     }
 
-    if (end == str) {
-        NvDlaDebugPrintf("No digits were found\n");
-        val = -1;
-        goto fail;
-    }
+    PROPAGATE_ERROR_FAIL(inst->runtime->allocateSystemMemory(&inst->inputHandle, part->inputDesc.bufferSize * batch,
+                                                             &inst->inputData));
+    PROPAGATE_ERROR_FAIL(inst->runtime->allocateSystemMemory(&inst->outputHandle, part->outputDesc.bufferSize * batch,
+                                                             &inst->outputData));
 
-    if (val == 0) {
-        NvDlaDebugPrintf("Data Size can't be %ld!\n", val);
-        val = -1;
-        goto fail;
-    }
+    // every instance has its own tensors, so binding once is enough
+    PROPAGATE_ERROR_FAIL(bindInstance(part, inst));
+
+    *instance = inst;
+    return NvDlaSuccess;
 
 fail:
-    return val;
+    destroyInstance(part, inst);
+    return e;
 }
 
-static NvDlaError sendSize(const TestAppArgs* appArgs, TestInfo *testInfo, uint32_t len)
+void InferenceServer::destroyInstance(ModelPart* part, Instance* inst)
 {
-    NvDlaError e = NvDlaSuccess;
+    nvdla::IRuntime* runtime = inst->runtime;
 
-    NvDlaDebugPrintf("Sending size %u bytes.\n", len);
-
-    char buf[256];
-    snprintf(buf, sizeof(buf), "%u\n", len);
-    uint32_t buflen = strlen(buf);
-
-    size_t sentSize = 0;
-    while (sentSize < buflen)
+    if (runtime != NULL)
     {
-        size_t curSize = send(testInfo->dlaRemoteSock, (const char*)buf + sentSize, buflen - sentSize, 0);
-
-        if (curSize > 0)
-            sentSize += curSize;
-
-        if (curSize <= 0)
-            break;
+        if (inst->inputHandle)
+            runtime->freeSystemMemory(inst->inputHandle, part->inputDesc.bufferSize * inst->batch);
+        if (inst->outputHandle)
+            runtime->freeSystemMemory(inst->outputHandle, part->outputDesc.bufferSize * inst->batch);
+
+        // destroying the runtime doesn't give back what load() allocated
+        runtime->unload();
+        runtime->stopEMU();
+        nvdla::destroyRuntime(runtime);
     }
-
-    return e;
+    delete inst;
 }
 
-static NvDlaError sendData(const TestAppArgs* appArgs, TestInfo *testInfo, const void* buf, size_t len)
+// binds an instance to its own tensors, batch elements back to back
+NvDlaError InferenceServer::bindInstance(ModelPart* part, Instance* inst)
 {
-    NvDlaError e = NvDlaSuccess;
-    size_t sentSize = 0;
-    size_t remainingSize = 0;
-    size_t sendSize = 0;
-    int32_t maxSendSize = -1;
-
-    PROPAGATE_ERROR_FAIL(getSendBufSize(appArgs, testInfo, &maxSendSize));
-    if (maxSendSize == -1)
+    if (inst->batch > 1)
+    {
+        PROPAGATE_ERROR(inst->runtime->bindInputTensorBatch(0, inst->batch, inst->inputHandle,
+                                                            part->inputDesc.bufferSize));
+        PROPAGATE_ERROR(inst->runtime->bindOutputTensorBatch(0, inst->batch, inst->outputHandle,
+                                                             part->outputDesc.bufferSize));
+    }
+    else
     {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "Error encountered: %u\n", e);
+        if (!inst->runtime->bindInputTensor(0, inst->inputHandle))
+            ORIGINATE_ERROR(NvDlaError_BadParameter, "runtime->bindInputTensor() failed");
+        if (!inst->runtime->bindOutputTensor(0, inst->outputHandle))
+            ORIGINATE_ERROR(NvDlaError_BadParameter, "runtime->bindOutputTensor() failed");
     }
 
-    while (sentSize < len)
+    return NvDlaSuccess;
+}
+
+NvDlaError InferenceServer::loadModel(const std::vector<std::vector<NvU8> >& loadables, NvU32 numInstances,
+                                      std::shared_ptr<Model>* model)
+{
+    std::shared_ptr<Model> m(new Model());
+    std::vector<NvU64> instanceBytes(loadables.size());
+    NvU64 loadableBytes = 0;
+    NvU64 setBytes = 0;
+    NvU64 freeBytes;
+    NvU64 roomBytes;
+    bool whole;
+
+    // an instance of each loadable first, to size the cascade up
+    for (size_t p = 0; p < loadables.size(); p++)
     {
-        remainingSize = len - sentSize;
-        sendSize = (maxSendSize < (int32_t)remainingSize) ? maxSendSize : remainingSize;
+        ModelPart* part = new ModelPart();
+        Instance* inst;
 
-        size_t curSize = send(testInfo->dlaRemoteSock, (const char*)buf + sentSize, sendSize, 0);
+        m->parts.push_back(part);
+        part->loadable = loadables[p];
+        if (part->loadable.empty())
+            ORIGINATE_ERROR(NvDlaError_BadParameter, "loadable %u is empty", NvU32(p));
 
-        if (curSize > 0)
-            sentSize += curSize;
+        // only the first loadable sees batches, escalations go one by one
+        NvU32 batch = p == 0 ? m_maxBatch : 1;
 
-        if (curSize <= 0)
-            break;
-    }
+        PROPAGATE_ERROR(createInstance(part, batch, &inst));
+        part->instances.push_back(inst);
+        part->idle.push_back(inst);
 
-fail:
-    return e;
-}
+        // escalation copies the packed input across as is
+        if (p > 0 && part->inputDesc.bufferSize != m->parts[0]->inputDesc.bufferSize)
+            ORIGINATE_ERROR(NvDlaError_BadParameter, "loadable %u input does not match loadable 0", NvU32(p));
 
-static NvDlaError readSize(const TestAppArgs* appArgs, TestInfo *testInfo, uint32_t* len)
-{
-    NvDlaError e = NvDlaSuccess;
-    char sizebuf[TCPSERVER_MSGLEN];
-    uint32_t ii = 0;
-    int64_t size = 0;
+        m->identity = hashBytes(&part->loadable[0], part->loadable.size(), m->identity);
 
-    if (!len)
-    {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "readSize(): Invalid Arguments.\n");
+        // the runtime keeps its own copy of the loadable's blobs
+        instanceBytes[p] = part->loadable.size() + batch * (part->inputDesc.bufferSize + part->outputDesc.bufferSize);
+        loadableBytes += part->loadable.size();
+        setBytes += instanceBytes[p];
     }
 
-    memset(sizebuf, 0, sizeof(sizebuf));
+    if (m->parts.empty())
+        ORIGINATE_ERROR(NvDlaError_BadParameter, "no loadables");
+
+    // uploads evict each other to fit, but never the --loadable cascade
+    {
+        std::lock_guard<std::mutex> lock(m_modelsMutex);
+        freeBytes = m_modelBudget > m_pinnedBytes ? m_modelBudget - m_pinnedBytes : 0;
+    }
 
-    *len = 0;
+    // an instance per worker as far as the budget goes, and always one.
+    // a cascade that can't keep one of each loadable keeps only the first.
+    whole = loadableBytes + setBytes <= freeBytes;
+    roomBytes = freeBytes > loadableBytes ? freeBytes - loadableBytes : 0;
+    numInstances = NvU32(std::max<NvU64>(std::min<NvU64>(numInstances,
+                                                         roomBytes / (whole ? setBytes : instanceBytes[0])), 1));
 
-    do
+    for (size_t p = 0; p < m->parts.size(); p++)
     {
-        if (ii > sizeof(sizebuf))
-        {
-            ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "readSize(): No separator found after size.\n");
-        }
+        ModelPart* part = m->parts[p];
 
-        // Read one byte at a time until we hit our separator
-        size_t received = recv(testInfo->dlaRemoteSock, &sizebuf[ii], 1, 0);
+        m->bytes += part->loadable.size();
 
-        if (received > 0)
-            ii += 1;
+        // too big to keep whole, escalations load the rest as they go
+        if (p > 0 && !whole)
+        {
+            destroyInstance(part, part->instances[0]);
+            part->instances.clear();
+            part->idle.clear();
+            part->transient = true;
+            continue;
+        }
 
-        if (received <= 0)
+        for (NvU32 i = 1; i < numInstances; i++)
         {
-            ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "readSize(): Returned zero, connection possibly terminated.\n");
+            Instance* inst;
+            PROPAGATE_ERROR(createInstance(part, p == 0 ? m_maxBatch : 1, &inst));
+            part->instances.push_back(inst);
+            part->idle.push_back(inst);
         }
+        m->bytes += numInstances * instanceBytes[p];
+    }
 
-    } while(sizebuf[ii-1] != TCPSERVER_SEPARATOR);
+    if (!whole && m->parts.size() > 1)
+        NvDlaDebugPrintf("server: a %llu KB cascade is over budget, only its first loadable stays resident\n",
+                         (unsigned long long)((loadableBytes + setBytes) >> 10));
 
-    // Override separator with \0
-    sizebuf[ii-1] = '\0';
+    *model = m;
+    return NvDlaSuccess;
+}
 
-    size = getSizeInInteger(sizebuf);
-    if (size < 0)
-    {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "readSize(): Failed to convert size in string to integer.\n");
-    }
+std::shared_ptr<InferenceServer::Model> InferenceServer::findModel(const std::string& id)
+{
+    std::lock_guard<std::mutex> lock(m_modelsMutex);
+    std::map<std::string, RegistryEntry>::iterator f = m_models.find(id);
 
-    *len = size;
+    if (f == m_models.end())
+        return std::shared_ptr<Model>();
 
-fail:
-    return e;
+    m_modelLru.splice(m_modelLru.begin(), m_modelLru, f->second.lru);
+    return f->second.model;
 }
 
-static NvDlaError readData(const TestAppArgs* appArgs, TestInfo *testInfo, uint32_t size, void** buf, uint32_t* len)
+// Returns the registered model for id, which is not the given one when two
+// clients raced to upload the same loadable. Evicting only drops the
+// registry's reference, runs still holding a model finish on it.
+std::shared_ptr<InferenceServer::Model> InferenceServer::registerModel(const std::string& id,
+                                                                       const std::shared_ptr<Model>& model)
 {
-    NvDlaError e = NvDlaSuccess;
-    int32_t maxRecvSize = -1;
-    void* tmpbuf;
-    uint32_t receivedSize = 0;
-    size_t remainingSize = 0;
-    size_t recvSize = 0;
-
-    PROPAGATE_ERROR_FAIL(getRecvBufSize(appArgs, testInfo, &maxRecvSize));
+    std::lock_guard<std::mutex> lock(m_modelsMutex);
+    std::map<std::string, RegistryEntry>::iterator f = m_models.find(id);
 
-    if (maxRecvSize == -1)
+    if (f != m_models.end())
     {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "Error encountered: %u\n", e);
+        m_modelLru.splice(m_modelLru.begin(), m_modelLru, f->second.lru);
+        return f->second.model;
     }
 
-    if (!buf || !len)
+    while (!m_modelLru.empty() && m_modelBytes + model->bytes > m_modelBudget)
     {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "readData(): Invalid Arguments.\n");
+        std::map<std::string, RegistryEntry>::iterator victim = m_models.find(m_modelLru.back());
+
+        NvDlaDebugPrintf("server: evicting a %llu KB model for a %llu KB one\n",
+                         (unsigned long long)(victim->second.model->bytes >> 10),
+                         (unsigned long long)(model->bytes >> 10));
+        m_modelBytes -= victim->second.model->bytes;
+        m_models.erase(victim);
+        m_modelLru.pop_back();
     }
 
-    if (size > TCPSERVER_MAXREADSIZE)
-    {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "readData(): size (%u bytes) exceeds maximum buffer size requirements (%u bytes).\n", size, TCPSERVER_MAXREADSIZE);
-    }
+    RegistryEntry& entry = m_models[id];
+    entry.model = model;
+    entry.lru = m_modelLru.insert(m_modelLru.begin(), id);
+    m_modelBytes += model->bytes;
 
-    // Allocate read buffer to copy into
-    tmpbuf = (void*)malloc(size);
-    if (!tmpbuf)
-    {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "readData(): Allocation failed.\n");
-    }
+    return model;
+}
 
-    // Read the buffer
-    while (receivedSize < size)
-    {
-        remainingSize = size - receivedSize;
-        recvSize = (maxRecvSize < (int32_t)remainingSize) ? maxRecvSize : remainingSize;
+// The model a run targets, taking its id off the front of the payload if
+// the request names one. NULL if it isn't resident.
+std::shared_ptr<InferenceServer::Model> InferenceServer::requestModel(Connection* c, const DlaWireHeader& header,
+                                                                      const NvU8** data, size_t* size)
+{
+    if (!(header.flags & DLA_WIRE_FLAG_MODEL))
+        return c->model.lock();
+
+    if (*size < DLA_WIRE_MODEL_ID_SIZE)
+        return std::shared_ptr<Model>();
+
+    std::string id(reinterpret_cast<const char*>(*data), DLA_WIRE_MODEL_ID_SIZE);
+    *data += DLA_WIRE_MODEL_ID_SIZE;
+    *size -= DLA_WIRE_MODEL_ID_SIZE;
+
+    return findModel(id);
+}
+
+// Any idle instance, or the wanted one, which BufferSet runs need. NULL if
+// a transient part failed to load.
+InferenceServer::Instance* InferenceServer::acquire(ModelPart* part, Instance* want)
+{
+    std::unique_lock<std::mutex> lock(part->mutex);
+    std::vector<Instance*>::iterator f;
+    Instance* inst = NULL;
 
-        size_t curSize = recv(testInfo->dlaRemoteSock, (void*)((size_t)tmpbuf + receivedSize), recvSize, 0);
+    part->waiters++;
 
-        if (curSize > 0)
-            receivedSize += curSize;
+    for (;;)
+    {
+        if (want)
+            f = std::find(part->idle.begin(), part->idle.end(), want);
+        else
+            f = part->idle.empty() ? part->idle.end() : part->idle.end() - 1;
+        if (f != part->idle.end())
+        {
+            inst = *f;
+            part->idle.erase(f);
+            break;
+        }
 
-        if (curSize <= 0)
+        // whoever finds a transient part unloaded loads it, without holding
+        // up releases, and the others wait
+        if (part->transient && part->instances.empty() && !part->loading)
         {
-            ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "readData(): Returned zero, connection possibly terminated.\n");
+            NvDlaError e;
+
+            part->loading = true;
+            lock.unlock();
+            e = createInstance(part, 1, &inst);
+            lock.lock();
+            part->loading = false;
+            part->cond.notify_all();
+
+            if (e != NvDlaSuccess)
+            {
+                inst = NULL;
+                break;
+            }
+            part->instances.push_back(inst);
+            break;
         }
+
+        part->cond.wait(lock);
     }
 
-    *buf = tmpbuf;
-    *len = receivedSize;
+    part->waiters--;
+    return inst;
+}
 
-fail:
-    return e;
+void InferenceServer::release(ModelPart* part, Instance* instance)
+{
+    std::lock_guard<std::mutex> lock(part->mutex);
+
+    // a transient part stays loaded a little longer, see unloadIdleParts()
+    if (part->transient)
+        part->releasedUs = metricsNowUs();
+
+    part->idle.push_back(instance);
+
+    // waiters may be after different instances
+    part->cond.notify_all();
 }
 
-static NvDlaError send(const TestAppArgs* appArgs, TestInfo *testInfo, const void* buf, uint32_t len)
+NvDlaError InferenceServer::startListening(NvS32 port, NvU32 address, NvU64 event, int* fd)
 {
     NvDlaError e = NvDlaSuccess;
+    struct sockaddr_in dlaServerAddr;
+    struct epoll_event ev;
+    int one = 1;
 
-    if (!buf)
-    {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "send(): Invalid Arguments.\n");
-    }
+    *fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (*fd < 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "unable to create socket: %s", strerror(errno));
+
+    // restarts must not wait out TIME_WAIT
+    setsockopt(*fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
 
-    PROPAGATE_ERROR_FAIL(sendSize(appArgs, testInfo, len));
+    memset(&dlaServerAddr, 0, sizeof(dlaServerAddr));
+    dlaServerAddr.sin_family = AF_INET;
+    dlaServerAddr.sin_addr.s_addr = htonl(address);
+    dlaServerAddr.sin_port = htons(port);
 
-    PROPAGATE_ERROR_FAIL(sendData(appArgs, testInfo, buf, len));
+    if (bind(*fd, (struct sockaddr *)&dlaServerAddr, sizeof(dlaServerAddr)))
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "unable to bind server at port %d: %s", port,
+                             strerror(errno));
+
+    if (listen(*fd, SOMAXCONN) < 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "unable to listen on the socket: %s", strerror(errno));
+
+    ev.events = EPOLLIN;
+    ev.data.u64 = event;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, *fd, &ev) < 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "epoll_ctl failed: %s", strerror(errno));
+
+    NvDlaDebugPrintf("using %s, listening at port:%d\n", inet_ntoa(dlaServerAddr.sin_addr), port);
 
 fail:
     return e;
 }
 
-static NvDlaError read(const TestAppArgs* appArgs, TestInfo *testInfo, void** buf, uint32_t* len)
+NvDlaError InferenceServer::startLocalListening()
 {
-    uint32_t size;
     NvDlaError e = NvDlaSuccess;
+    const std::string& path = m_appArgs->socketPath;
+    struct sockaddr_un localAddr;
+    struct epoll_event ev;
 
-    if (!buf || !len)
-    {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "read(): Invalid Arguments.\n");
-    }
+    if (path.size() >= sizeof(localAddr.sun_path))
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "socket path too long: %s", path.c_str());
+
+    m_localFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_localFd < 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "unable to create socket: %s", strerror(errno));
+
+    // a socket left behind by an earlier server would fail the bind
+    unlink(path.c_str());
+
+    memset(&localAddr, 0, sizeof(localAddr));
+    localAddr.sun_family = AF_UNIX;
+    strncpy(localAddr.sun_path, path.c_str(), sizeof(localAddr.sun_path) - 1);
 
-    PROPAGATE_ERROR_FAIL(readSize(appArgs, testInfo, &size));
+    if (bind(m_localFd, (struct sockaddr *)&localAddr, sizeof(localAddr)))
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "unable to bind server at %s: %s", path.c_str(),
+                             strerror(errno));
 
-    PROPAGATE_ERROR_FAIL(readData(appArgs, testInfo, size, buf, len));
+    if (listen(m_localFd, SOMAXCONN) < 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "unable to listen on the socket: %s", strerror(errno));
+
+    ev.events = EPOLLIN;
+    ev.data.u64 = EVENT_LOCAL;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_localFd, &ev) < 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "epoll_ctl failed: %s", strerror(errno));
+
+    NvDlaDebugPrintf("listening at %s\n", path.c_str());
 
 fail:
     return e;
 }
 
-static NvDlaError startServer(const TestAppArgs* appArgs, TestInfo *testInfo)
+NvDlaError InferenceServer::init()
 {
     NvDlaError e = NvDlaSuccess;
-    struct sockaddr_in dlaServerAddr;
-    int attempt;
+    NvU32 numWorkers = std::max(m_appArgs->numThreads, 1U);
+    struct epoll_event ev;
 
-    /* Re-attempt for binding, incase bind() fails. */
-    for (attempt = 0; attempt < MAX_TRY; attempt++) {
-        /* Create socket file descriptor. */
-        if ((testInfo->dlaServerSock = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-            NvDlaDebugPrintf("Unable to create socket in attempt[%d].\n", attempt);
-            continue;
+    if (m_appArgs->cacheSize)
+        m_cache = new ResultCache(NvU64(m_appArgs->cacheSize) << 20);
 
-            if (attempt >= MAX_TRY) {
-                ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "maximum tries reached\n");
-            }
-        }
+    // the command line cascade gets an instance per worker as well, see loadModel()
+    if (!m_appArgs->loadableNames.empty())
+    {
+        std::vector<std::vector<NvU8> > loadables(m_appArgs->loadableNames.size());
 
-        /* bind to an address. */
-        memset(&dlaServerAddr, 0, sizeof(dlaServerAddr));
-        dlaServerAddr.sin_family = AF_INET;
-        dlaServerAddr.sin_addr.s_addr = htonl(INADDR_ANY);
-        dlaServerAddr.sin_port = htons(6666);
+        for (size_t p = 0; p < loadables.size(); p++)
+        {
+            TestInfo info;
 
-        NvDlaDebugPrintf("using %s, listening at port:%d\n",
-            inet_ntoa(dlaServerAddr.sin_addr), appArgs->serverPort);
+            PROPAGATE_ERROR_FAIL(readLoadable(m_appArgs, &info, p));
+            loadables[p].assign(info.pData, info.pData + info.loadableSize);
+            delete[] info.pData;
+        }
 
-        /* Bind to the given port on any address. */
-        if (bind(testInfo->dlaServerSock, (struct sockaddr *)&dlaServerAddr,
-            sizeof(dlaServerAddr))) {
-            NvDlaDebugPrintf("Binding Failed with errno: %d: Unable " \
-                "to bind server at port: %d\n", errno, appArgs->serverPort);
-            /* Close the socket incase bind failed. */
-            close(testInfo->dlaServerSock);
-            /*
-             * Below sleep is to provide enough time for socket to
-             * to enter in CLOSE state.
-             */
-            sleep(CLOSE_SLEEP);
-            continue;
+        PROPAGATE_ERROR_FAIL(loadModel(loadables, numWorkers, &m_defaultModel));
 
-            /* If max tries are expired report failure to system. */
-            if (attempt >= MAX_TRY) {
-                ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "maximum tries reached\n");
-            }
-        } else {
-            NvDlaDebugPrintf("binding successful.\n");
-        }
-        break;
+        // charged once and never evicted, uploads share what is left
+        std::lock_guard<std::mutex> lock(m_modelsMutex);
+        m_pinnedBytes = m_defaultModel->bytes;
+        m_modelBytes += m_pinnedBytes;
     }
 
-    /* Start listening on the socket. */
-    if (listen(testInfo->dlaServerSock, 10) < 0) {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "unable to listen on the socket\n");
-    } else {
-        NvDlaDebugPrintf("Ready for Client Connection...\n");
-        fflush(stdout);
-    }
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "epoll_create1 failed: %s", strerror(errno));
 
-    testInfo->dlaServerRunning = true;
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "eventfd failed: %s", strerror(errno));
+
+    ev.events = EPOLLIN;
+    ev.data.u64 = EVENT_WAKE;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev) < 0)
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "epoll_ctl failed: %s", strerror(errno));
+
+    PROPAGATE_ERROR_FAIL(startListening(m_appArgs->serverPort, INADDR_ANY, EVENT_LISTEN, &m_listenFd));
+    if (m_appArgs->metricsPort > 0)
+        PROPAGATE_ERROR_FAIL(startListening(m_appArgs->metricsPort, INADDR_LOOPBACK, EVENT_METRICS, &m_metricsFd));
+    if (!m_appArgs->socketPath.empty())
+        PROPAGATE_ERROR_FAIL(startLocalListening());
+
+    // workers are handed a job at a time, so these never fill up
+    m_jobs = new BoundedQueue<Job*>(2 * MAX_CLIENTS);
+    m_done = new BoundedQueue<Job*>(2 * MAX_CLIENTS);
+
+    for (NvU32 t = 0; t < numWorkers; t++)
+        m_workers.push_back(std::thread(&InferenceServer::workerLoop, this));
+
+    NvDlaDebugPrintf("server: %u workers, %u loadables\n", numWorkers,
+                     m_defaultModel ? NvU32(m_defaultModel->parts.size()) : 0U);
+    NvDlaDebugPrintf("Ready for Client Connection...\n");
 
 fail:
     return e;
 }
 
-static NvDlaError processWelcomeMessage(const TestAppArgs* appArgs, TestInfo *testInfo)
+//
+// worker side
+//
+
+void InferenceServer::workerLoop()
 {
-    NvDlaError e = NvDlaSuccess;
+    Job* job;
+    NvU64 one = 1;
 
-    /* Send the welcome message */
-    char welcomeMessage[] = "Hello World!";
-    NvDlaDebugPrintf("Sending welcome message: {%s}\n", welcomeMessage);
+    while (m_jobs->pop(&job))
+    {
+        job->started = metricsNowUs();
 
-    PROPAGATE_ERROR_FAIL(send(appArgs, testInfo, (void*)welcomeMessage, strlen(welcomeMessage)));
+        if (job->type == JOB_BATCH)
+        {
+            for (size_t j = 0; j < job->batch.size(); j++)
+                m_metrics.queueWait.record(job->started - job->batch[j]->received);
+        }
+        else
+        {
+            m_metrics.queueWait.record(job->started - job->received);
+        }
 
-fail:
-    return e;
+        execute(job);
+        job->finished = metricsNowUs();
+        m_done->push(job);
+
+        if (write(m_wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+            NvDlaDebugPrintf("server: eventfd write failed: %s\n", strerror(errno));
+    }
 }
 
-static NvDlaError executeTest(const TestAppArgs* appArgs, TestInfo *testInfo)
+// Runs jobs for one model through its first loadable as a single batched
+// submit, then finishes each on its own. Inputs that fail to decode or hit
+// the result cache drop out of the batch.
+void InferenceServer::runBatch(Job* const* jobs, NvU32 numJobs)
 {
     NvDlaError e = NvDlaSuccess;
+    Model* model = jobs[0]->model.get();
+    ModelPart* part = model->parts[0];
+    Instance* inst = acquire(part);
+    NvU8* inputs = static_cast<NvU8*>(inst->inputData);
+    NvU8* outputs = static_cast<NvU8*>(inst->outputData);
+    NvU64 inputSize = part->inputDesc.bufferSize;
+    NvU64 outputSize = part->outputDesc.bufferSize;
+    std::vector<ResultCache::Key> keys(numJobs);
+    std::vector<NvU32> slots;   /* job of each batch element */
+    NvU64 submitUs = 0;
+
+    // flushBatch() never hands over more jobs than inst->batch
+    for (NvU32 j = 0; j < numJobs; j++)
+    {
+        Job* job = jobs[j];
+        Result* result = new Result();
+        NvU8* input = inputs + slots.size() * inputSize;
 
-    std::vector<std::string> loadableNames;
+        job->result.reset(result);
+        result->cached = false;
 
-    NvDlaDebugPrintf("Executing the Test...\n");
+        // RUN_FLATBUF has no image and runs on a zeroed input
+        if (!job->data)
+        {
+            memset(input, 0, inputSize);
+        }
+        else
+        {
+            NvU64 start = metricsNowUs();
 
-    e = run(appArgs, testInfo);
-    if (e == NvDlaSuccess)
-        prepareReplyMsg("[OK] Test PASSED!");
-    else
-        prepareReplyMsg("[OK] Test FAILED!");
+            job->status = imageBuffer2Tensor(job->data, job->dataSize, &m_params, &part->inputDesc, input);
+            m_metrics.decode.record(metricsNowUs() - start);
+            if (job->status != NvDlaSuccess)
+                continue;
+        }
 
-    NvDlaDebugPrintf("Execution Done: %s\n", replyMsg);
+        if (m_cache)
+        {
+            keys[j] = ResultCache::makeKey(model->identity, input, inputSize);
+            if (m_cache->lookupCopy(keys[j], input, &result->part, &result->topk, &result->output))
+            {
+                CascadeTrace::Step step = { result->part, 0, 0, result->topk.margin };
+
+                result->cached = true;
+                result->trace.cached = true;
+                result->trace.steps.push_back(step);
+                m_metrics.cacheHits.fetch_add(1, std::memory_order_relaxed);
+                result->outputDesc = model->parts[result->part]->outputDesc;
+                continue;
+            }
+        }
 
-    /* Send the test completion message */
-    NvDlaDebugPrintf("Sending test completion message: {%s}\n", replyMsg);
+        slots.push_back(j);
+    }
 
-    // PROPAGATE_ERROR_FAIL(send(appArgs, testInfo, (void*)replyMsg, strlen(replyMsg)));
+    if (!slots.empty())
+    {
+        NvU64 start = metricsNowUs();
 
-fail:
-    return e;
-}
+        if (slots.size() == 1 && !inst->runtime->submit())
+            e = NvDlaError_BadParameter;
+        else if (slots.size() > 1)
+            e = inst->runtime->submitBatch(slots.size());
 
-static NvDlaError processRunFlatbuf(const TestAppArgs* appArgs, TestInfo *testInfo)
-{
-    NvDlaError e = NvDlaSuccess;
+        submitUs = metricsNowUs() - start;
+        m_metrics.submits[0].fetch_add(1, std::memory_order_relaxed);
+    }
 
-    // PROPAGATE_ERROR_FAIL(executeTest(appArgs, testInfo));
+    for (NvU32 k = 0; k < slots.size(); k++)
+    {
+        Job* job = jobs[slots[k]];
+        Result* result = job->result.get();
+        NvU64 start = metricsNowUs();
 
-fail:
-    return e;
+        job->status = e;
+        result->trace.batch = slots.size();
+        if (e == NvDlaSuccess)
+            job->status = escalate(model, inst->runtime, inputs + k * inputSize, outputs + k * outputSize, result);
+
+        // the batch's submit is on every one of its runs
+        m_metrics.inference.record(submitUs + metricsNowUs() - start);
+
+        if (job->status == NvDlaSuccess && m_cache)
+            m_cache->insert(keys[slots[k]], inputs + k * inputSize, result->part, result->topk,
+                            &result->output[0], result->output.size());
+    }
+
+    release(part, inst);
 }
 
-static NvDlaError processQueryCachedFlatbuf(const TestAppArgs* appArgs, TestInfo *testInfo)
+// Takes an input the first loadable has run on through the rest of the
+// cascade while the margin stays low, one submit at a time.
+NvDlaError InferenceServer::escalate(Model* model, nvdla::IRuntime* runtime, const NvU8* input, const NvU8* output,
+                                     Result* result)
 {
     NvDlaError e = NvDlaSuccess;
+    ModelPart* part = model->parts[0];
+    Instance* inst = NULL;
+    NvU32 p;
+
+    PROPAGATE_ERROR_FAIL(runtime->getTopK(&part->outputDesc, output, 2, &result->topk));
+    result->trace.addSubmit(0, runtime, result->topk.margin);
 
-    const char* queryBuf = testInfo->pData != NULL ? "YES" : "NO";
+    for (p = 1; p < model->parts.size() && result->topk.margin < CONF_THRESH; p++)
+    {
+        if (inst)
+            release(part, inst);
+        part = model->parts[p];
+        inst = acquire(part);
+        if (!inst)
+            ORIGINATE_ERROR_FAIL(NvDlaError_InsufficientMemory, "loading loadable %u failed", p);
+
+        memcpy(inst->inputData, input, part->inputDesc.bufferSize);
+        m_metrics.submits[std::min(p, ServerMetrics::MAX_PARTS - 1)].fetch_add(1, std::memory_order_relaxed);
+        if (!inst->runtime->submit())
+            ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "runtime->submit() failed");
+
+        output = static_cast<const NvU8*>(inst->outputData);
+        PROPAGATE_ERROR_FAIL(inst->runtime->getTopK(&part->outputDesc, output, 2, &result->topk));
+        result->trace.addSubmit(p, inst->runtime, result->topk.margin);
+    }
 
-    PROPAGATE_ERROR_FAIL(send(appArgs, testInfo, (void*)queryBuf, strlen(queryBuf)));
+    result->part = p - 1;
+    result->outputDesc = part->outputDesc;
+    result->output.assign(output, output + part->outputDesc.bufferSize);
 
 fail:
+    if (inst)
+        release(part, inst);
     return e;
 }
 
-static NvDlaError processReadFlatbuf(const TestAppArgs* appArgs, TestInfo *testInfo)
+NvDlaError InferenceServer::serializeOutput(Job* job)
 {
     NvDlaError e = NvDlaSuccess;
-    void* buf = NULL;
-    uint32_t len = 0;
+    const Result* result = job->result.get();
+    std::stringstream sstream;
+    NvDlaImage image;
+
+    image.m_pData = NULL;
 
-    PROPAGATE_ERROR_FAIL(read(appArgs, testInfo, &buf, &len));
+    PROPAGATE_ERROR_FAIL(Tensor2DIMG(&result->outputDesc, &image));
+    memcpy(image.m_pData, &result->output[0], std::min<size_t>(image.m_meta.size, result->output.size()));
 
-    testInfo->pData = (NvU8 *)buf;
+    PROPAGATE_ERROR_FAIL(image.serialize(sstream, true));
+    job->reply = sstream.str();
 
 fail:
+    if (image.m_pData)
+        NvDlaFree(image.m_pData);
     return e;
 }
 
-static NvDlaError processRunImage(const TestAppArgs* appArgs, TestInfo* testInfo)
+// Allocates job->slot input and output pairs through one instance of the
+// model's first loadable, which then runs everything put in them.
+NvDlaError InferenceServer::mapBuffers(Job* job)
 {
     NvDlaError e = NvDlaSuccess;
-    std::ofstream imgFile(appArgs->inputName.c_str(), std::ofstream::binary);
-
-    void* buf = NULL;
-    uint32_t len = 0;
-
-    PROPAGATE_ERROR_FAIL(read(appArgs, testInfo, &buf, &len));
-
-    NvDlaDebugPrintf("starting to run image %s of size %d\n", appArgs->inputName.c_str(), len);
-
-    imgFile.write((const char*)buf, len);
-    imgFile.close();
+    std::shared_ptr<BufferSet> buffers(new BufferSet());
+    Model* model = job->model.get();
+    ModelPart* part = model->parts[0];
+    Instance* inst = acquire(part);
+    nvdla::IRuntime* runtime = inst->runtime;
+
+    buffers->model = job->model;
+    buffers->owner = inst;
+    buffers->inputSize = part->inputDesc.bufferSize;
+    buffers->outputSize = 0;
+    for (size_t p = 0; p < model->parts.size(); p++)
+        buffers->outputSize = std::max(buffers->outputSize, model->parts[p]->outputDesc.bufferSize);
+
+    for (NvU32 s = 0; s < job->slot; s++)
+    {
+        void* handle;
+        void* data;
+        NvS32 fd;
+
+        PROPAGATE_ERROR_FAIL(runtime->allocateSystemMemory(&handle, buffers->inputSize, &data));
+        buffers->inputHandles.push_back(handle);
+        buffers->inputData.push_back(data);
+        PROPAGATE_ERROR_FAIL(runtime->getSystemMemoryFd(handle, &fd));
+        buffers->fds.push_back(fd);
+
+        PROPAGATE_ERROR_FAIL(runtime->allocateSystemMemory(&handle, buffers->outputSize, &data));
+        buffers->outputHandles.push_back(handle);
+        buffers->outputData.push_back(data);
+        PROPAGATE_ERROR_FAIL(runtime->getSystemMemoryFd(handle, &fd));
+        buffers->fds.push_back(fd);
+    }
 
-    // PROPAGATE_ERROR_FAIL(executeTest(appArgs, testInfo));
+    job->buffers = buffers;
 
 fail:
-    if (buf != NULL)
-        free(buf);
+    release(part, inst);
+    if (e != NvDlaSuccess)
+        unmapBuffers(buffers.get());
     return e;
-
 }
 
-static NvDlaError processGetNumOutputs(const TestAppArgs* appArgs, TestInfo *testInfo)
+// frees the memory, which closes the fds; clients keep their mappings
+void InferenceServer::unmapBuffers(BufferSet* buffers)
 {
-    NvDlaError e = NvDlaSuccess;
+    ModelPart* part = buffers->model->parts[0];
+    Instance* inst = acquire(part, buffers->owner);
 
-    char buf[32];
-    snprintf(buf, sizeof(buf), "%d", testInfo->numOutputs);
+    for (size_t b = 0; b < buffers->inputHandles.size(); b++)
+        inst->runtime->freeSystemMemory(buffers->inputHandles[b], buffers->inputSize);
+    for (size_t b = 0; b < buffers->outputHandles.size(); b++)
+        inst->runtime->freeSystemMemory(buffers->outputHandles[b], buffers->outputSize);
 
-    PROPAGATE_ERROR_FAIL(send(appArgs, testInfo, reinterpret_cast<void*>(buf), strlen(buf)));
+    buffers->inputHandles.clear();
+    buffers->inputData.clear();
+    buffers->outputHandles.clear();
+    buffers->outputData.clear();
+    buffers->fds.clear();
 
-fail:
-    return e;
+    release(part, inst);
 }
 
-static NvDlaError processGetOutput(const TestAppArgs* appArgs, TestInfo *testInfo)
+// Runs a slot of a BufferSet, binding its owner to the slot for the first
+// loadable. Escalations copy the input into their own tensors as usual and
+// leave their output in the slot as well. The result cache is skipped, the
+// client may rewrite the input under it at any time.
+NvDlaError InferenceServer::runBuffer(Job* job)
 {
     NvDlaError e = NvDlaSuccess;
-    std::stringstream sstream;
-    void* buf = NULL;
-    uint32_t len = 0;
-    int32_t index = 0;
+    NvDlaError rebind;
+    BufferSet* buffers = job->buffers.get();
+    Model* model = buffers->model.get();
+    ModelPart* part = model->parts[0];
+    Instance* inst = acquire(part, buffers->owner);
+    Result* result = new Result();
+    NvU64 start = metricsNowUs();
 
-    /* Get the output index */
-    NvDlaDebugPrintf("Receiving output index...\n");
+    job->result.reset(result);
+    result->cached = false;
 
-    PROPAGATE_ERROR_FAIL(read(appArgs, testInfo, &buf, &len));
+    if (!inst->runtime->bindInputTensor(0, buffers->inputHandles[job->slot]) ||
+        !inst->runtime->bindOutputTensor(0, buffers->outputHandles[job->slot]))
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "binding buffer slot %u failed", job->slot);
 
-    NvDlaDebugPrintf("Receiving output index...Done\n");
-    index = atoi((char*)buf);
+    m_metrics.submits[0].fetch_add(1, std::memory_order_relaxed);
+    if (!inst->runtime->submit())
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "runtime->submit() failed");
 
-    /* Prepare NvDlaImage serialization stream */
-    e = testInfo->outputImage->serialize(sstream, true);
-    if (e != 0)
-        return e;
+    PROPAGATE_ERROR_FAIL(escalate(model, inst->runtime, static_cast<const NvU8*>(buffers->inputData[job->slot]),
+                                  static_cast<const NvU8*>(buffers->outputData[job->slot]), result));
 
-    NvDlaDebugPrintf("Sending test output[%d]\n", index);
-    PROPAGATE_ERROR_FAIL(send(appArgs, testInfo, reinterpret_cast<const void*>(sstream.str().c_str()), sstream.str().length()));
+    if (result->part > 0)
+        memcpy(buffers->outputData[job->slot], &result->output[0], result->output.size());
 
 fail:
-    if (buf != NULL)
-        free(buf);
+    m_metrics.inference.record(metricsNowUs() - start);
+
+    rebind = bindInstance(part, inst);
+    if (rebind != NvDlaSuccess && e == NvDlaSuccess)
+        e = rebind;
+
+    release(part, inst);
     return e;
 }
 
-static NvDlaError getCommand(const TestAppArgs* appArgs, TestInfo *testInfo, char* cmd)
+void InferenceServer::execute(Job* job)
 {
-    NvDlaError e = NvDlaSuccess;
-    void* buf = NULL;
-    uint32_t len = 0;
+    switch (job->type)
+    {
+        case JOB_LOAD:
+        {
+            std::vector<std::vector<NvU8> > loadables(1);
+            NvU8 digest[SHA256_DIGEST_SIZE];
+
+            // a model another client already uploaded is not loaded twice
+            sha256(job->data, job->dataSize, digest);
+            job->modelId.assign(reinterpret_cast<const char*>(digest), sizeof(digest));
+            job->model = findModel(job->modelId);
+            if (job->model)
+            {
+                job->reply = "OK";
+                break;
+            }
+
+            if (job->data == &job->payload[0] && job->dataSize == job->payload.size())
+                loadables[0].swap(job->payload);
+            else
+                loadables[0].assign(job->data, job->data + job->dataSize);
+            job->status = loadModel(loadables, m_workers.size(), &job->model);
+            job->reply = job->status == NvDlaSuccess ? "OK" : "[ERR] loadable failed to load";
+        }
+        break;
 
-    NvDlaDebugPrintf("Waiting for command from Client...\n");
+        case JOB_RUN:
+        case JOB_BATCH:
+        {
+            Job* const* runs = job->type == JOB_BATCH ? &job->batch[0] : &job;
+            NvU32 numRuns = job->type == JOB_BATCH ? job->batch.size() : 1;
+
+            if (job->buffers)
+                job->status = runBuffer(job);
+            else
+                runBatch(runs, numRuns);
+
+            for (NvU32 j = 0; j < numRuns; j++)
+            {
+                const Job* run = runs[j];
+                char reply[256];
+
+                m_metrics.runs.fetch_add(1, std::memory_order_relaxed);
+                if (run->status == NvDlaSuccess)
+                    m_metrics.answered[std::min(run->result->part, ServerMetrics::MAX_PARTS - 1)].fetch_add(
+                        1, std::memory_order_relaxed);
+                else
+                    m_metrics.runFailures.fetch_add(1, std::memory_order_relaxed);
+
+                if (run->status == NvDlaSuccess)
+                    snprintf(reply, sizeof(reply), "[OK] Test PASSED! loadable %u, class %u, prob %f, margin %f%s",
+                             run->result->part, run->result->topk.index[0], run->result->topk.prob[0],
+                             run->result->topk.margin, run->result->cached ? ", cached" : "");
+                else
+                    snprintf(reply, sizeof(reply), "[OK] Test FAILED!");
+                runs[j]->reply = reply;
+
+                if (run->status != NvDlaSuccess)
+                    continue;
+
+                if (m_appArgs->traceRuns)
+                    NvDlaDebugPrintf("server: client %llu request %u %s\n", (unsigned long long)run->conn,
+                                     run->request.requestId, run->result->trace.format().c_str());
+                if (run->request.flags & DLA_WIRE_FLAG_TRACE)
+                    runs[j]->reply += "\n" + run->result->trace.format();
+            }
+        }
+        break;
 
-    PROPAGATE_ERROR_FAIL(read(appArgs, testInfo, &buf, &len));
+        case JOB_OUTPUT:
+            job->status = serializeOutput(job);
+            if (job->status != NvDlaSuccess)
+                job->reply = "[ERR] output serialization failed";
+            break;
 
-    memcpy(cmd, buf, len);
-    cmd[len] = '\0';
+        case JOB_MAP:
+            job->status = mapBuffers(job);
+            if (job->status == NvDlaSuccess)
+            {
+                NvU32 slots = htonl(job->slot);
+                NvU32 sizes[4] = { htonl(NvU32(job->buffers->inputSize >> 32)), htonl(NvU32(job->buffers->inputSize)),
+                                   htonl(NvU32(job->buffers->outputSize >> 32)), htonl(NvU32(job->buffers->outputSize)) };
 
-    NvDlaDebugPrintf("Received command: {%s}\n", cmd);
+                job->reply.assign(reinterpret_cast<const char*>(&slots), sizeof(slots));
+                job->reply.append(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+            }
+            else
+            {
+                job->reply = "[ERR] buffer allocation failed";
+            }
+            break;
 
-    free(buf);
+        case JOB_UNMAP:
+            unmapBuffers(job->buffers.get());
+            job->buffers.reset();
+            break;
 
-fail:
-    return e;
+        case JOB_UNLOAD:
+            unloadPart(job->model->parts[job->slot]);
+            break;
+    }
 }
 
-static NvDlaError processShutDownServer(const TestAppArgs* appArgs, TestInfo *testInfo)
+// Unloads a transient part no run has wanted since it was queued for it.
+void InferenceServer::unloadPart(ModelPart* part)
 {
-    NvDlaError e = NvDlaSuccess;
+    Instance* inst = NULL;
 
-    char shutbuf[] = "ACK_SHUTDOWN";
+    {
+        std::lock_guard<std::mutex> lock(part->mutex);
 
-    /* Send the number of outputs */
-    NvDlaDebugPrintf("Sending ACK_SHUTDOWN msg to client.\n");
+        part->unloading = false;
+        if (part->waiters == 0 && !part->idle.empty() &&
+            metricsNowUs() - part->releasedUs >= TRANSIENT_LINGER_MS * 1000ULL)
+        {
+            inst = part->idle[0];
+            part->idle.clear();
+            part->instances.clear();
+        }
+    }
 
-    testInfo->dlaServerRunning = false;
+    if (inst)
+        destroyInstance(part, inst);
+}
 
-    PROPAGATE_ERROR_FAIL(send(appArgs, testInfo, (void*)shutbuf, strlen(shutbuf)));
+//
+// event loop side
+//
 
-fail:
-    return e;
+void InferenceServer::updateEvents(Connection* c)
+{
+    struct epoll_event ev;
+    NvU32 want = 0;
+
+    // a busy client may queue up requests, but only so much of them
+    if (!c->closing && (!c->jobsOut || c->rbuf.size() - c->rpos < TCPSERVER_RECV_HIGH_WATER))
+        want |= EPOLLIN;
+    if (!c->wqueue.empty())
+        want |= EPOLLOUT;
+
+    if (want == c->events)
+        return;
+
+    ev.events = want;
+    ev.data.u64 = c->id;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, c->fd, &ev) == 0)
+        c->events = want;
 }
 
-static bool isClientConnected(const TestAppArgs* appArgs, TestInfo *testInfo)
+void InferenceServer::closeConnection(Connection* c)
 {
-    int optval, ret;
-    socklen_t optlen = sizeof(optval);
+    if (!c->http)
+        NvDlaDebugPrintf("client %llu disconnected\n", (unsigned long long)c->id);
+
+    // buffers a job still has out go when it completes
+    for (size_t f = 0; f < c->wfds.size(); f++)
+        retireBuffers(&c->wfds[f].second);
+    retireBuffers(&c->buffers);
+
+    // a job still out for this client is dropped when it completes
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    m_conns.erase(c->id);
+    delete c;
+}
+
+// Frees a BufferSet on a worker once this is the last reference to it.
+// Event loop only, as are all the references outside running jobs.
+void InferenceServer::retireBuffers(std::shared_ptr<BufferSet>* buffers)
+{
+    if (*buffers && buffers->use_count() == 1 && m_jobs)
+    {
+        Job* job = new Job();
 
-    ret = getsockopt(testInfo->dlaServerSock, SOL_SOCKET, SO_ERROR, &optval, &optlen);
-    if(optval == 0 && ret == 0) {
-        NvDlaDebugPrintf("Client is OFF optval: %d, ret: %d\n", optval, ret);
-        return true;
+        job->type = JOB_UNMAP;
+        job->received = metricsNowUs();
+        job->rank = priorityRank(DLA_WIRE_PRIORITY_BULK << DLA_WIRE_PRIORITY_SHIFT);
+        job->buffers.swap(*buffers);
+
+        pushReady(job);
+        m_inflight++;
     }
 
-    return false;
+    buffers->reset();
 }
 
-static NvDlaError mainEventLoop(TestAppArgs* appArgs, TestInfo *testInfo)
+void InferenceServer::acceptConnections(NvU64 event)
 {
-    NvDlaError e = NvDlaSuccess;
+    int listenFd = event == EVENT_LISTEN ? m_listenFd : event == EVENT_LOCAL ? m_localFd : m_metricsFd;
 
-    /* Main event loop */
-    while(true)
-    {
-        char cmd[256];
-        std::string strCmd = "";
-
-        PROPAGATE_ERROR_FAIL(getCommand(appArgs, testInfo, cmd));
-        strCmd = std::string(cmd);
-
-        if (strcmp(cmd, "GET_WELCOME") == 0)
-        {
-            /* Send Welcome message to client. */
-            PROPAGATE_ERROR_FAIL(processWelcomeMessage(appArgs, testInfo));
-        } else if (strcmp(cmd, "QUERY_FLATBUF") == 0) {
-            /* Query if a flatbuf is already cached and reply accordingly */
-            PROPAGATE_ERROR_FAIL(processQueryCachedFlatbuf(appArgs, testInfo));
-        } else if (strcmp(cmd, "RUN_FLATBUF") == 0) {
-            /* Get the flatbuffer and run the test. */
-            PROPAGATE_ERROR_FAIL(processRunFlatbuf(appArgs, testInfo));
-        } else if (strcmp(cmd, "READ_FLATBUF") == 0) {
-            /* Get the flatbuffer and read it. */
-            PROPAGATE_ERROR_FAIL(processReadFlatbuf(appArgs, testInfo));
-        } else if (strCmd.find(std::string("RUN_IMAGE")) != std::string::npos) {
-            /* Extract file name from command */
-            appArgs->inputName = strCmd.substr(strCmd.find_last_of("_") + 1);
-            /* Get the image and run inference on it using the flatbuffer cached in memory */
-            PROPAGATE_ERROR_FAIL(processRunImage(appArgs, testInfo));
-        } else if (strcmp(cmd, "GET_NUMOUTPUTS") == 0) {
-            /* Get the flatbuffer and run the test. */
-            PROPAGATE_ERROR_FAIL(processGetNumOutputs(appArgs, testInfo));
-        } else if (strcmp(cmd, "GET_OUTPUT") == 0) {
-            /* Get the flatbuffer and run the test. */
-            PROPAGATE_ERROR_FAIL(processGetOutput(appArgs, testInfo));
-        } else if (strcmp(cmd, "SHUTDOWN") == 0) {
-            /* SHUTDOWN the server. */
-            PROPAGATE_ERROR_FAIL(processShutDownServer(appArgs, testInfo));
-            if (!testInfo->dlaServerRunning)
-                break;
-        } else {
-            ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "invalid command");
+    for (;;)
+    {
+        struct epoll_event ev;
+        int one = 1;
+        int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                NvDlaDebugPrintf("accept socket error: %s(errno: %d)\n", strerror(errno), errno);
+            break;
         }
-    }
 
-fail:
-    /* Clear the flatbuffer cached data if available */
-    if (testInfo->pData != NULL) {
-        free(testInfo->pData);
-        testInfo->pData = NULL;
+        if (m_conns.size() >= MAX_CLIENTS)
+        {
+            NvDlaDebugPrintf("server: %u clients already, refusing another\n", MAX_CLIENTS);
+            close(fd);
+            continue;
+        }
+
+        // replies are small and latency bound
+        if (event != EVENT_LOCAL)
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        Connection* c = new Connection(fd, m_nextConnId++, EPOLLIN, event == EVENT_METRICS, event == EVENT_LOCAL);
+        c->model = m_defaultModel;
+
+        ev.events = c->events;
+        ev.data.u64 = c->id;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            NvDlaDebugPrintf("epoll_ctl failed: %s\n", strerror(errno));
+            close(fd);
+            delete c;
+            continue;
+        }
+
+        m_conns[c->id] = c;
+        if (c->http)
+            continue;
+
+        m_metrics.connections.fetch_add(1, std::memory_order_relaxed);
+        NvDlaDebugPrintf("client %llu connected\n", (unsigned long long)c->id);
     }
-    return e;
 }
 
-NvDlaError runServer(const TestAppArgs* appArgs, TestInfo *testInfo)
+void InferenceServer::readConnection(Connection* c)
 {
-    NvDlaError e = NvDlaSuccess;
-
-    if (appArgs->serverPort <= 1024)
+    while (!c->jobsOut || c->rbuf.size() - c->rpos < TCPSERVER_RECV_HIGH_WATER)
     {
-        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, " port:%d is a reserved port.\n", appArgs->serverPort);
-    }
+        // a large payload grows the buffer by at most what of it is in,
+        // so a header alone can't make us commit the length it declares
+        size_t chunk = std::max(TCPSERVER_RECVCHUNK, std::min(c->need, c->rbuf.size() - c->rpos));
+        size_t used = c->rbuf.size();
+        ssize_t n;
 
-    PROPAGATE_ERROR_FAIL(startServer(appArgs, testInfo));
+        c->rbuf.resize(used + chunk);
+        n = recv(c->fd, &c->rbuf[used], chunk, 0);
+        c->rbuf.resize(used + std::max<ssize_t>(n, 0));
 
-    while (testInfo->dlaServerRunning)
-    {
-        if( (testInfo->dlaRemoteSock = accept(testInfo->dlaServerSock, (struct sockaddr*)NULL, NULL)) == -1)
+        if (n > 0)
         {
-            ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "accept socket error: %s(errno: %d)", strerror(errno),errno);
+            m_metrics.bytesIn.fetch_add(n, std::memory_order_relaxed);
+            c->need -= std::min(c->need, size_t(n));
+
+            // a short read means the socket is drained for now
+            if (size_t(n) < chunk)
+                break;
+            continue;
         }
 
-        mainEventLoop(const_cast<TestAppArgs*>(appArgs), testInfo);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+
+        closeConnection(c);
+        return;
     }
 
-    /* We have quit out of the event loop
-     * Close the current connection and wait for a new connection
-     */
-    close(testInfo->dlaRemoteSock);
-    close(testInfo->dlaServerSock);
+    processConnection(c);
+}
+
+void InferenceServer::writeConnection(Connection* c)
+{
+    while (!c->wqueue.empty())
+    {
+        // gather every queued header and payload into one sendmsg
+        struct iovec iov[TCPSERVER_MAXIOV];
+        struct msghdr msg;
+        union
+        {
+            struct cmsghdr align;
+            char buf[CMSG_SPACE(sizeof(int) * 2 * DLA_WIRE_MAX_BUFFERS)];
+        } control;
+        bool withFds = false;
+        size_t niov = 0;
+        ssize_t n;
+
+        for (std::deque<std::string>::iterator it = c->wqueue.begin();
+             it != c->wqueue.end() && niov < TCPSERVER_MAXIOV; ++it, ++niov)
+        {
+            size_t skip = niov ? 0 : c->wpos;
+
+            // fds go with the first byte of their entry, which starts a sendmsg of its own
+            if (niov && !c->wfds.empty() && c->wfds.front().first == c->wpopped + niov)
+                break;
+
+            iov[niov].iov_base = const_cast<char*>(it->data()) + skip;
+            iov[niov].iov_len = it->size() - skip;
+        }
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = niov;
+
+        if (!c->wfds.empty() && c->wfds.front().first == c->wpopped && c->wpos == 0)
+        {
+            const std::vector<int>& fds = c->wfds.front().second->fds;
+            struct cmsghdr* cmsg;
+
+            msg.msg_control = control.buf;
+            msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+            cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+            memcpy(CMSG_DATA(cmsg), &fds[0], sizeof(int) * fds.size());
+            withFds = true;
+        }
+
+        n = sendmsg(c->fd, &msg, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            closeConnection(c);
+            return;
+        }
+
+        m_metrics.bytesOut.fetch_add(n, std::memory_order_relaxed);
+
+        // the client has its own references to them now
+        if (withFds)
+        {
+            retireBuffers(&c->wfds.front().second);
+            c->wfds.pop_front();
+        }
+
+        while (n > 0)
+        {
+            size_t left = c->wqueue.front().size() - c->wpos;
+
+            if (size_t(n) < left)
+            {
+                c->wpos += n;
+                break;
+            }
+
+            n -= left;
+            c->wqueue.pop_front();
+            c->wpos = 0;
+            c->wpopped++;
+        }
+    }
+
+    if (c->wqueue.empty() && c->closing)
+    {
+        closeConnection(c);
+        return;
+    }
+
+    updateEvents(c);
+}
+
+// Queues the reply to the connection's request number seq, holding it
+// back until every earlier request has been answered.
+void InferenceServer::queueReply(Connection* c, NvU64 seq, const DlaWireHeader& request, NvU16 flags,
+                                 std::string payload)
+{
+    if (flags & DLA_WIRE_FLAG_ERROR)
+        m_metrics.errors.fetch_add(1, std::memory_order_relaxed);
+
+    if (seq != c->nextReply)
+    {
+        HeldReply& held = c->held[seq];
+
+        held.request = request;
+        held.flags = flags;
+        held.payload.swap(payload);
+        return;
+    }
+
+    appendReply(c, request, flags, &payload);
+    c->nextReply++;
+
+    while (!c->held.empty() && c->held.begin()->first == c->nextReply)
+    {
+        HeldReply& held = c->held.begin()->second;
+
+        appendReply(c, held.request, held.flags, &held.payload);
+        c->held.erase(c->held.begin());
+        c->nextReply++;
+    }
+}
+
+void InferenceServer::appendReply(Connection* c, const DlaWireHeader& request, NvU16 flags, std::string* payload)
+{
+    DlaWireHeader header;
+    std::string encoded(DLA_WIRE_HEADER_SIZE, '\0');
+
+    header.magic = DLA_WIRE_MAGIC;
+    header.opcode = request.opcode;
+    header.flags = flags | DLA_WIRE_FLAG_REPLY;
+    header.requestId = request.requestId;
+    header.length = payload->size();
+    encodeWireHeader(header, reinterpret_cast<NvU8*>(&encoded[0]));
+
+    // the payload is queued as is, never copied behind its header
+    c->wqueue.push_back(std::string());
+    c->wqueue.back().swap(encoded);
+    if (!payload->empty())
+    {
+        c->wqueue.push_back(std::string());
+        c->wqueue.back().swap(*payload);
+    }
+}
+
+// false until the whole frame is buffered, which stays there until taken
+bool InferenceServer::nextMessage(Connection* c, DlaWireHeader* header, const NvU8** payload)
+{
+    size_t avail = c->rbuf.size() - c->rpos;
+
+    if (avail < DLA_WIRE_HEADER_SIZE)
+    {
+        c->need = DLA_WIRE_HEADER_SIZE - avail;
+        return false;
+    }
+
+    // nothing bigger than the budget could ever be kept resident
+    if (!decodeWireHeader(&c->rbuf[c->rpos], header) ||
+        header->length > wireMaxPayload(header->opcode, NvU32(std::min<NvU64>(m_modelBudget, ~0U))))
+    {
+        NvDlaDebugPrintf("client %llu: malformed frame header, closing\n", (unsigned long long)c->id);
+        c->closing = true;
+        return false;
+    }
+
+    if (avail < DLA_WIRE_HEADER_SIZE + header->length)
+    {
+        c->need = DLA_WIRE_HEADER_SIZE + header->length - avail;
+        return false;
+    }
+
+    *payload = &c->rbuf[c->rpos] + DLA_WIRE_HEADER_SIZE;
+    c->need = 0;
+    return true;
+}
+
+// Hands a request's payload to its job. A payload that ends the receive
+// buffer, as a large one does since its last recv stops there, takes the
+// buffer along instead of being copied out of it.
+void InferenceServer::takePayload(Connection* c, Job* job, const NvU8* data, size_t size)
+{
+    if (size >= TCPSERVER_RECVCHUNK && c->rpos == c->rbuf.size())
+    {
+        job->payload.swap(c->rbuf);
+        c->rpos = 0;
+    }
+    else
+    {
+        job->payload.assign(data, data + size);
+        data = size ? &job->payload[0] : NULL;
+    }
+
+    job->data = data;
+    job->dataSize = size;
+}
+
+void InferenceServer::dispatch(Connection* c, const DlaWireHeader& header, NvU64 seq, NvU64 deadline, Job* job)
+{
+    job->conn = c->id;
+    job->request = header;
+    job->status = NvDlaSuccess;
+    job->received = metricsNowUs();
+    job->rank = priorityRank(header.flags);
+    job->deadline = deadline;
+    job->seq = seq;
+
+    c->jobsOut++;
+    if (job->type != JOB_RUN)
+        c->exclusive = true;
+    m_inflight++;
+
+    // runs wait for company on the same model, see flushBatches()
+    if (job->type == JOB_RUN && !job->buffers && m_maxBatch > 1)
+    {
+        Model* model = job->model.get();
+        PendingBatch& pending = m_pending[model];
+
+        if (pending.jobs.empty())
+        {
+            pending.model = job->model;
+            pending.flushAt = job->received + m_batchWindowUs;
+        }
+        pending.jobs.push_back(job);
+
+        // the window must not eat into a deadline
+        if (deadline)
+            pending.flushAt = std::min(pending.flushAt, deadline - std::min(deadline, model->serviceUs));
+
+        // interactive runs don't wait for company
+        if (pending.jobs.size() >= m_maxBatch || job->rank == 0)
+            flushBatch(model);
+        return;
+    }
+
+    pushReady(job);
+}
+
+void InferenceServer::handleRequest(Connection* c, DlaWireHeader header, const NvU8* payload)
+{
+    NvU32 counted = header.opcode < ServerMetrics::MAX_OPCODES && opcodeNames[header.opcode] ? header.opcode : 0;
+    NvU64 seq = c->nextSeq++;
+    NvU64 deadline = 0;
+
+    m_metrics.requests[counted].fetch_add(1, std::memory_order_relaxed);
+    m_metrics.prioritized[priorityRank(header.flags)].fetch_add(1, std::memory_order_relaxed);
+
+    if (header.flags & DLA_WIRE_FLAG_DEADLINE)
+    {
+        NvU32 budget;
+
+        if (header.length < sizeof(budget))
+        {
+            queueReply(c, seq, header, DLA_WIRE_FLAG_ERROR, "[ERR] deadline missing");
+            return;
+        }
+
+        memcpy(&budget, payload, sizeof(budget));
+        deadline = metricsNowUs() + ntohl(budget);
+        payload += sizeof(budget);
+        header.length -= sizeof(budget);
+    }
+
+    switch (header.opcode)
+    {
+        case DLA_OP_GET_WELCOME:
+            queueReply(c, seq, header, 0, "Hello World!");
+            break;
+
+        case DLA_OP_QUERY_FLATBUF:
+        {
+            std::shared_ptr<Model> model;
+
+            if (header.length == DLA_WIRE_MODEL_ID_SIZE)
+            {
+                // a hit also makes it the connection's model
+                model = findModel(std::string(reinterpret_cast<const char*>(payload), header.length));
+                if (model)
+                {
+                    c->model = model;
+                    c->result.reset();
+                }
+            }
+            else if (header.length == 0)
+            {
+                model = c->model.lock();
+            }
+            else
+            {
+                queueReply(c, seq, header, DLA_WIRE_FLAG_ERROR, "[ERR] model ids are SHA-256 digests");
+                break;
+            }
+
+            queueReply(c, seq, header, 0, model ? "YES" : "NO");
+        }
+        break;
+
+        case DLA_OP_READ_FLATBUF:
+        {
+            Job* job = new Job();
+            job->type = JOB_LOAD;
+            takePayload(c, job, payload, header.length);
+            dispatch(c, header, seq, deadline, job);
+        }
+        break;
+
+        case DLA_OP_RUN_FLATBUF:
+        case DLA_OP_RUN_IMAGE:
+        {
+            const NvU8* body = payload;
+            size_t bodySize = header.length;
+            std::shared_ptr<Model> model = requestModel(c, header, &body, &bodySize);
+            const NvU8* image = NULL;
+
+            if (!model)
+            {
+                // evicted or never uploaded, the client has to READ_FLATBUF it
+                queueReply(c, seq, header, DLA_WIRE_FLAG_ERROR, "[ERR] model not loaded");
+                break;
+            }
+
+            // turn away what couldn't make it even with a worker to itself
+            if (deadline && metricsNowUs() + model->serviceUs > deadline)
+            {
+                m_metrics.shed.fetch_add(1, std::memory_order_relaxed);
+                queueReply(c, seq, header, DLA_WIRE_FLAG_ERROR, "[ERR] deadline cannot be met");
+                break;
+            }
+
+            // the name is only there for the client, images are told apart by content
+            if (header.opcode == DLA_OP_RUN_IMAGE)
+            {
+                const NvU8* end = static_cast<const NvU8*>(memchr(body, '\0',
+                                      std::min<size_t>(bodySize, DLA_WIRE_MAX_NAME + 1)));
+                if (!end)
+                {
+                    queueReply(c, seq, header, DLA_WIRE_FLAG_ERROR, "[ERR] RUN_IMAGE needs a file name");
+                    break;
+                }
+                image = end + 1;
+            }
+
+            Job* job = new Job();
+            job->type = JOB_RUN;
+            job->model = model;
+
+            if (image)
+                takePayload(c, job, image, bodySize - (image - body));
+
+            dispatch(c, header, seq, deadline, job);
+        }
+        break;
+
+        case DLA_OP_MAP_BUFFERS:
+        {
+            const NvU8* body = payload;
+            size_t bodySize = header.length;
+            std::shared_ptr<Model> model = requestModel(c, header, &body, &bodySize);
+            NvU32 slots = 0;
+
+            if (bodySize == sizeof(slots))
+            {
+                memcpy(&slots, body, sizeof(slots));
+                slots = ntohl(slots);
+            }
+
+            if (!c->local)
+            {
+                queueReply(c, seq, header, DLA_WIRE_FLAG_ERROR, "[ERR] buffers need the local socket");
+                break;
+            }
+            if (!model)
+            {
+                queueReply(c, seq, header, DLA_WIRE_FLAG_ERROR, "[ERR] model not loaded");
+                break;
+            }
+            if (slots == 0 || slots > DLA_WIRE_MAX_BUFFERS)
+            {
+                queueReply(c, seq, header, DLA_WIRE_FLAG_ERROR, "[ERR] bad buffer count");
+                break;
+            }
+
+            Job* job = new Job();
+            job->type = JOB_MAP;
+            job->model = model;
+            job->slot = slots;
+            dispatch(c, header, seq, deadline, job);
+        }
+        break;
+
+        case DLA_OP_RUN_BUFFER:
+        {
+            NvU32 slot = ~0U;
+
+            if (header.length == sizeof(slot))
+            {
+                memcpy(&slot, payload, sizeof(slot));
+                slot = ntohl(slot);
+            }
+
+            if (!c->buffers || slot >= c->buffers->inputHandles.size())
+            {
+                queueReply(c, seq, header, DLA_WIRE_FLAG_ERROR, "[ERR] no such buffer");
+                break;
+            }
+
+            if (deadline && metricsNowUs() + c->buffers->model->serviceUs > deadline)
+            {
+                m_metrics.shed.fetch_add(1, std::memory_order_relaxed);
+                queueReply(c, seq, header, DLA_WIRE_FLAG_ERROR, "[ERR] deadline cannot be met");
+                break;
+            }
+
+            Job* job = new Job();
+            job->type = JOB_RUN;
+            job->model = c->buffers->model;
+            job->buffers = c->buffers;
+            job->slot = slot;
+            dispatch(c, header, seq, deadline, job);
+        }
+        break;
+
+        case DLA_OP_GET_NUMOUTPUTS:
+            queueReply(c, seq, header, 0, c->result ? "1" : "0");
+            break;
+
+        case DLA_OP_GET_OUTPUT:
+        {
+            NvU32 index = ~0U;
+
+            if (header.length == sizeof(index))
+            {
+                memcpy(&index, payload, sizeof(index));
+                index = ntohl(index);
+            }
+
+            if (!c->result || index != 0)
+            {
+                queueReply(c, seq, header, DLA_WIRE_FLAG_ERROR, "[ERR] no output");
+                break;
+            }
+
+            Job* job = new Job();
+            job->type = JOB_OUTPUT;
+            job->result = c->result;
+            dispatch(c, header, seq, deadline, job);
+        }
+        break;
+
+        case DLA_OP_SHUTDOWN:
+            if (!c->local && !m_appArgs->remoteShutdown)
+            {
+                queueReply(c, seq, header, DLA_WIRE_FLAG_ERROR, "[ERR] shutdown needs the local socket");
+                break;
+            }
+
+            NvDlaDebugPrintf("Sending ACK_SHUTDOWN msg to client.\n");
+            queueReply(c, seq, header, 0, "ACK_SHUTDOWN");
+
+            // stop taking clients, finish what is in flight
+            m_stopping = true;
+            if (m_listenFd >= 0)
+            {
+                epoll_ctl(m_epollFd, EPOLL_CTL_DEL, m_listenFd, NULL);
+                close(m_listenFd);
+                m_listenFd = -1;
+            }
+            if (m_localFd >= 0)
+            {
+                epoll_ctl(m_epollFd, EPOLL_CTL_DEL, m_localFd, NULL);
+                close(m_localFd);
+                m_localFd = -1;
+                unlink(m_appArgs->socketPath.c_str());
+            }
+            break;
+
+        case DLA_OP_GET_STATS:
+        {
+            std::string text;
+
+            renderStats(&text);
+            queueReply(c, seq, header, 0, text);
+        }
+        break;
+
+        default:
+            // the frame is intact, so the connection can carry on
+            NvDlaDebugPrintf("client %llu: invalid opcode %u\n", (unsigned long long)c->id, header.opcode);
+            queueReply(c, seq, header, DLA_WIRE_FLAG_ERROR, "[ERR] invalid opcode");
+            break;
+    }
+}
+
+void InferenceServer::processConnection(Connection* c)
+{
+    DlaWireHeader header;
+    const NvU8* payload;
+
+    if (c->http)
+    {
+        serveHttp(c);
+        return;
+    }
+
+    while (!c->closing && !c->exclusive && !m_stopping && nextMessage(c, &header, &payload))
+    {
+        bool run = header.opcode == DLA_OP_RUN_FLATBUF || header.opcode == DLA_OP_RUN_IMAGE ||
+                   header.opcode == DLA_OP_RUN_BUFFER;
+
+        // runs overlap up to the client's queue cap, anything else waits for them
+        if (c->jobsOut >= (run ? m_clientQueue : 1U))
+            break;
+
+        c->rpos += DLA_WIRE_HEADER_SIZE + header.length;
+        handleRequest(c, header, payload);
+    }
+
+    // drop consumed bytes, moving a partial frame to the front
+    if (c->rpos == c->rbuf.size())
+    {
+        c->rbuf.clear();
+        c->rpos = 0;
+    }
+    else if (c->rpos >= TCPSERVER_RECVCHUNK)
+    {
+        c->rbuf.erase(c->rbuf.begin(), c->rbuf.begin() + c->rpos);
+        c->rpos = 0;
+    }
+
+    writeConnection(c);
+}
+
+// Answers a scrape of the metrics port with what GET_STATS returns, once
+// the request's headers are in. Nothing in them changes the answer.
+void InferenceServer::serveHttp(Connection* c)
+{
+    static const char endOfHeaders[] = "\r\n\r\n";
+    std::vector<NvU8>::iterator end;
+    std::string body;
+    char head[256];
+
+    end = std::search(c->rbuf.begin() + c->rpos, c->rbuf.end(), endOfHeaders, endOfHeaders + 4);
+    if (c->closing || end == c->rbuf.end())
+    {
+        if (c->rbuf.size() > HTTP_MAX_REQUEST)
+            c->closing = true;
+        writeConnection(c);
+        return;
+    }
+
+    renderStats(&body);
+    snprintf(head, sizeof(head),
+             "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+             "Content-Length: %zu\r\nConnection: close\r\n\r\n", body.size());
+
+    c->wqueue.push_back(head);
+    c->wqueue.push_back(std::string());
+    c->wqueue.back().swap(body);
+    c->rbuf.clear();
+    c->rpos = 0;
+    c->closing = true;
+
+    writeConnection(c);
+}
+
+void InferenceServer::flushBatch(Model* model)
+{
+    std::map<Model*, PendingBatch>::iterator f = m_pending.find(model);
+    Job* batch = new Job();
+
+    batch->type = JOB_BATCH;
+    batch->received = metricsNowUs();
+    batch->model = f->second.model;
+    batch->batch.swap(f->second.jobs);
+    m_pending.erase(f);
+
+    // the batch is as urgent as its most urgent run
+    batch->rank = batch->batch[0]->rank;
+    for (size_t j = 0; j < batch->batch.size(); j++)
+    {
+        Job* run = batch->batch[j];
+
+        batch->rank = std::min(batch->rank, run->rank);
+        if (run->deadline && (!batch->deadline || run->deadline < batch->deadline))
+            batch->deadline = run->deadline;
+    }
+
+    pushReady(batch);
+}
+
+// Flushes batches whose window is up, returns the ms until the next one is
+// due or -1 if none are pending.
+int InferenceServer::flushBatches()
+{
+    NvU64 now = metricsNowUs();
+    std::map<Model*, PendingBatch>::iterator it = m_pending.begin();
+    NvS64 nextUs = -1;
+
+    while (it != m_pending.end())
+    {
+        Model* model = it->first;
+        NvS64 leftUs = NvS64(it->second.flushAt) - NvS64(now);
+
+        ++it;
+        if (leftUs <= 0)
+            flushBatch(model);
+        else if (nextUs < 0 || leftUs < nextUs)
+            nextUs = leftUs;
+    }
+
+    return nextUs < 0 ? -1 : int((nextUs + 999) / 1000);
+}
+
+// Has a worker unload transient parts left idle for TRANSIENT_LINGER_MS,
+// returns the ms until the next one is due or -1 if none are loaded.
+int InferenceServer::unloadIdleParts()
+{
+    std::vector<std::shared_ptr<Model> > models;
+    NvU64 now = metricsNowUs();
+    NvS64 nextUs = -1;
+
+    // only cascades over budget have transient parts, and all but the first are
+    if (m_defaultModel && m_defaultModel->parts.size() > 1 && m_defaultModel->parts[1]->transient)
+        models.push_back(m_defaultModel);
+    {
+        std::lock_guard<std::mutex> lock(m_modelsMutex);
+
+        for (std::map<std::string, RegistryEntry>::iterator it = m_models.begin(); it != m_models.end(); ++it)
+        {
+            const std::shared_ptr<Model>& model = it->second.model;
+
+            if (model->parts.size() > 1 && model->parts[1]->transient)
+                models.push_back(model);
+        }
+    }
+
+    for (size_t m = 0; m < models.size(); m++)
+    {
+        for (size_t p = 1; p < models[m]->parts.size(); p++)
+        {
+            ModelPart* part = models[m]->parts[p];
+            NvS64 leftUs;
+
+            {
+                std::lock_guard<std::mutex> lock(part->mutex);
+
+                if (part->unloading || part->waiters || part->idle.empty())
+                    continue;
+                leftUs = NvS64(part->releasedUs + TRANSIENT_LINGER_MS * 1000ULL) - NvS64(now);
+                if (leftUs <= 0)
+                    part->unloading = true;
+            }
+
+            if (leftUs > 0)
+            {
+                if (nextUs < 0 || leftUs < nextUs)
+                    nextUs = leftUs;
+                continue;
+            }
+
+            Job* job = new Job();
+
+            job->type = JOB_UNLOAD;
+            job->model = models[m];
+            job->slot = NvU32(p);
+            job->received = now;
+            job->rank = priorityRank(DLA_WIRE_PRIORITY_BULK << DLA_WIRE_PRIORITY_SHIFT);
+            pushReady(job);
+            m_inflight++;
+        }
+    }
+
+    return nextUs < 0 ? -1 : int((nextUs + 999) / 1000);
+}
+
+// interactive first, then normal, then bulk
+NvU32 InferenceServer::priorityRank(NvU16 flags)
+{
+    switch ((flags & DLA_WIRE_PRIORITY_MASK) >> DLA_WIRE_PRIORITY_SHIFT)
+    {
+        case DLA_WIRE_PRIORITY_INTERACTIVE:
+            return 0;
+        case DLA_WIRE_PRIORITY_BULK:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+void InferenceServer::pushReady(Job* job)
+{
+    job->order = m_readyOrder++;
+    m_ready.push(job);
+}
+
+// Hands the most urgent ready jobs to idle workers, shedding runs that
+// can't make their deadline any more on the way.
+void InferenceServer::schedule()
+{
+    while (m_running < m_workers.size() && !m_ready.empty())
+    {
+        Job* job = m_ready.top();
+        NvU64 now = metricsNowUs();
+
+        m_ready.pop();
+
+        if (job->type == JOB_BATCH)
+        {
+            size_t kept = 0;
+
+            for (size_t j = 0; j < job->batch.size(); j++)
+            {
+                Job* run = job->batch[j];
+
+                if (run->deadline && now + job->model->serviceUs > run->deadline)
+                    shed(run);
+                else
+                    job->batch[kept++] = run;
+            }
+
+            job->batch.resize(kept);
+            if (kept == 0)
+            {
+                delete job;
+                continue;
+            }
+
+            m_batchSizes[kept]++;
+        }
+        else if (job->type == JOB_RUN && job->deadline && now + job->model->serviceUs > job->deadline)
+        {
+            shed(job);
+            continue;
+        }
+
+        m_jobs->push(job);
+        m_running++;
+    }
+}
+
+// answers a run without running it, it would only be late
+void InferenceServer::shed(Job* job)
+{
+    m_metrics.shed.fetch_add(1, std::memory_order_relaxed);
+
+    job->status = NvDlaError_Timeout;
+    job->reply = "[ERR] deadline cannot be met";
+    completeJob(job);
+    delete job;
+}
+
+void InferenceServer::completeJobs()
+{
+    NvU64 count;
+    Job* job;
+
+    if (read(m_wakeFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        NvDlaDebugPrintf("server: eventfd read failed: %s\n", strerror(errno));
+
+    while (m_done->tryPop(&job))
+    {
+        Job* const* runs = job->type == JOB_BATCH ? &job->batch[0] : &job;
+        size_t numRuns = job->type == JOB_BATCH ? job->batch.size() : 1;
+        NvU64 now = metricsNowUs();
+
+        m_running--;
+
+        // admission and shedding go by this
+        if (job->type == JOB_RUN || job->type == JOB_BATCH)
+        {
+            Model* model = job->model.get();
+            NvU64 took = job->finished - job->started;
+
+            model->serviceUs = model->serviceUs ? (7 * model->serviceUs + took) / 8 : took;
+        }
+
+        for (size_t j = 0; j < numRuns; j++)
+        {
+            if (runs[j]->deadline && now > runs[j]->deadline)
+                m_metrics.deadlineMisses.fetch_add(1, std::memory_order_relaxed);
+            completeJob(runs[j]);
+        }
+
+        delete job;
+    }
+}
+
+// scatters a finished job back to its connection, if still open
+void InferenceServer::completeJob(Job* job)
+{
+    std::map<NvU64, Connection*>::iterator f = m_conns.find(job->conn);
+
+    m_inflight--;
+
+    if (f == m_conns.end())
+    {
+        retireBuffers(&job->buffers);
+    }
+    else
+    {
+        Connection* c = f->second;
+        NvU64 replyEntry = c->wpopped + c->wqueue.size();
+
+        c->jobsOut--;
+        if (job->type != JOB_RUN)
+            c->exclusive = false;
+
+        switch (job->type)
+        {
+            case JOB_LOAD:
+                if (job->status == NvDlaSuccess)
+                {
+                    c->model = registerModel(job->modelId, job->model);
+                    c->result.reset();
+                }
+                else
+                {
+                    NvDlaDebugPrintf("client %llu: loadable failed to load (0x%x)\n",
+                                     (unsigned long long)c->id, job->status);
+                }
+                break;
+
+            case JOB_RUN:
+                m_metrics.service.record(metricsNowUs() - job->received);
+
+                // what GET_OUTPUT returns is the result of the last run asked for
+                if (job->status == NvDlaSuccess && job->seq >= c->resultSeq)
+                {
+                    c->result = job->result;
+                    c->resultSeq = job->seq;
+                }
+                NvDlaDebugPrintf("client %llu: %s\n", (unsigned long long)c->id, job->reply.c_str());
+                break;
+
+            case JOB_MAP:
+                if (job->status == NvDlaSuccess)
+                {
+                    retireBuffers(&c->buffers);
+                    c->buffers = job->buffers;
+                }
+                break;
+
+            case JOB_OUTPUT:
+            case JOB_BATCH:
+            case JOB_UNMAP:
+            case JOB_UNLOAD:
+                break;
+        }
+
+        queueReply(c, job->seq, job->request, job->status == NvDlaSuccess ? 0 : DLA_WIRE_FLAG_ERROR, job->reply);
+        if (job->type == JOB_MAP && job->status == NvDlaSuccess)
+            c->wfds.push_back(std::make_pair(replyEntry, job->buffers));
+        processConnection(c);
+    }
+}
+
+NvDlaError InferenceServer::run()
+{
+    NvDlaError e = NvDlaSuccess;
+    struct epoll_event events[MAX_EVENTS];
+    NvU32 waitedMs = 0;
+
+    for (;;)
+    {
+        int n, timeout = flushBatches();
+        int unloadMs = unloadIdleParts();
+
+        if (unloadMs >= 0 && (timeout < 0 || unloadMs < timeout))
+            timeout = unloadMs;
+
+        schedule();
+
+        if (m_stopping && m_inflight == 0)
+        {
+            bool flushed = true;
+
+            for (std::map<NvU64, Connection*>::iterator it = m_conns.begin(); it != m_conns.end(); ++it)
+                flushed = flushed && it->second->wqueue.empty();
+
+            if (flushed || waitedMs >= SHUTDOWN_GRACE_MS)
+                break;
+        }
+
+        if (m_stopping && (timeout < 0 || timeout > 100))
+            timeout = 100;
+
+        n = epoll_wait(m_epollFd, events, MAX_EVENTS, timeout);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, "epoll_wait failed: %s", strerror(errno));
+        }
+        if (m_stopping && n == 0)
+            waitedMs += 100;
+
+        for (int i = 0; i < n; i++)
+        {
+            NvU64 id = events[i].data.u64;
+            std::map<NvU64, Connection*>::iterator f;
+
+            if (id == EVENT_LISTEN || id == EVENT_METRICS || id == EVENT_LOCAL)
+            {
+                acceptConnections(id);
+                continue;
+            }
+            if (id == EVENT_WAKE)
+            {
+                completeJobs();
+                continue;
+            }
+
+            // an earlier event in this batch may have closed it
+            f = m_conns.find(id);
+            if (f == m_conns.end())
+                continue;
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                closeConnection(f->second);
+                continue;
+            }
+            if (events[i].events & EPOLLIN)
+            {
+                readConnection(f->second);
+                f = m_conns.find(id);
+                if (f == m_conns.end())
+                    continue;
+            }
+            if (events[i].events & EPOLLOUT)
+                writeConnection(f->second);
+        }
+    }
+
+fail:
+    printStats();
+    return e;
+}
+
+void InferenceServer::printStats() const
+{
+    NvU64 batches = 0, runs = 0;
+
+    for (NvU32 b = 1; b <= NVDLA_RUNTIME_BATCH_MAX; b++)
+    {
+        batches += m_batchSizes[b];
+        runs += m_batchSizes[b] * b;
+    }
+
+    if (batches)
+    {
+        NvDlaDebugPrintf("server: %llu runs in %llu batches, %.2f per batch\n", (unsigned long long)runs,
+                         (unsigned long long)batches, double(runs) / batches);
+        for (NvU32 b = 1; b <= NVDLA_RUNTIME_BATCH_MAX; b++)
+        {
+            if (m_batchSizes[b])
+                NvDlaDebugPrintf("server:   batch %2u: %llu\n", b, (unsigned long long)m_batchSizes[b]);
+        }
+    }
+
+    if (m_metrics.service.count())
+        NvDlaDebugPrintf("server: run latency p50 %llu us, p99 %llu us, p99.9 %llu us\n",
+                         (unsigned long long)m_metrics.service.percentile(0.5),
+                         (unsigned long long)m_metrics.service.percentile(0.99),
+                         (unsigned long long)m_metrics.service.percentile(0.999));
+
+    if (m_metrics.shed.load() || m_metrics.deadlineMisses.load())
+        NvDlaDebugPrintf("server: %llu runs shed, %llu past their deadline\n",
+                         (unsigned long long)m_metrics.shed.load(), (unsigned long long)m_metrics.deadlineMisses.load());
+
+    if (m_cache)
+        m_cache->printStats();
+}
+
+// Event loop only, the gauges below read its state unlocked.
+void InferenceServer::renderStats(std::string* out)
+{
+    NvU64 pending = 0, buffered = 0, defaultBytes = 0, modelBytes, numModels;
+    char labels[64];
+
+    for (std::map<Model*, PendingBatch>::const_iterator it = m_pending.begin(); it != m_pending.end(); ++it)
+        pending += it->second.jobs.size();
+
+    for (std::map<NvU64, Connection*>::const_iterator it = m_conns.begin(); it != m_conns.end(); ++it)
+    {
+        buffered += it->second->rbuf.capacity();
+        for (size_t q = 0; q < it->second->wqueue.size(); q++)
+            buffered += it->second->wqueue[q].size();
+    }
+
+    if (m_defaultModel)
+        defaultBytes = m_defaultModel->bytes;
+
+    {
+        std::lock_guard<std::mutex> lock(m_modelsMutex);
+        modelBytes = m_modelBytes - m_pinnedBytes;
+        numModels = m_models.size();
+    }
+
+    appendMetric(out, "nvdla_server_connections", "gauge", "Open client connections.", double(m_conns.size()));
+    appendMetric(out, "nvdla_server_connections_total", "counter", "Client connections accepted.",
+                 double(m_metrics.connections.load(std::memory_order_relaxed)));
+
+    appendMetricHeader(out, "nvdla_server_requests_total", "counter", "Requests parsed, by opcode.");
+    for (NvU32 o = 0; o < ServerMetrics::MAX_OPCODES; o++)
+    {
+        if (!opcodeNames[o])
+            continue;
+        snprintf(labels, sizeof(labels), "opcode=\"%s\"", opcodeNames[o]);
+        appendMetricSample(out, "nvdla_server_requests_total", labels,
+                           double(m_metrics.requests[o].load(std::memory_order_relaxed)));
+    }
+
+    appendMetric(out, "nvdla_server_error_replies_total", "counter", "Replies flagged as errors.",
+                 double(m_metrics.errors.load(std::memory_order_relaxed)));
+    appendMetric(out, "nvdla_server_received_bytes_total", "counter", "Bytes read from clients.",
+                 double(m_metrics.bytesIn.load(std::memory_order_relaxed)));
+    appendMetric(out, "nvdla_server_sent_bytes_total", "counter", "Bytes written to clients.",
+                 double(m_metrics.bytesOut.load(std::memory_order_relaxed)));
+
+    appendMetric(out, "nvdla_server_inflight_jobs", "gauge", "Jobs dispatched and not completed yet.",
+                 double(m_inflight));
+    appendMetric(out, "nvdla_server_ready_jobs", "gauge", "Jobs waiting for a worker.", double(m_ready.size()));
+    appendMetric(out, "nvdla_server_running_jobs", "gauge", "Jobs handed to workers.", double(m_running));
+    appendMetric(out, "nvdla_server_batching_runs", "gauge", "Runs waiting for a batch to fill.", double(pending));
+
+    appendMetric(out, "nvdla_server_runs_total", "counter", "Runs completed.",
+                 double(m_metrics.runs.load(std::memory_order_relaxed)));
+    appendMetric(out, "nvdla_server_run_failures_total", "counter", "Runs that failed to decode or submit.",
+                 double(m_metrics.runFailures.load(std::memory_order_relaxed)));
+    appendMetric(out, "nvdla_server_cache_hits_total", "counter", "Runs answered from the result cache.",
+                 double(m_metrics.cacheHits.load(std::memory_order_relaxed)));
+
+    appendMetricHeader(out, "nvdla_server_prioritized_requests_total", "counter", "Requests, by priority class.");
+    for (NvU32 p = 0; p < ServerMetrics::MAX_PRIORITIES; p++)
+    {
+        snprintf(labels, sizeof(labels), "priority=\"%s\"", priorityNames[p]);
+        appendMetricSample(out, "nvdla_server_prioritized_requests_total", labels,
+                           double(m_metrics.prioritized[p].load(std::memory_order_relaxed)));
+    }
+    appendMetric(out, "nvdla_server_shed_runs_total", "counter", "Runs answered unrun, their deadline out of reach.",
+                 double(m_metrics.shed.load(std::memory_order_relaxed)));
+    appendMetric(out, "nvdla_server_deadline_misses_total", "counter", "Runs that completed past their deadline.",
+                 double(m_metrics.deadlineMisses.load(std::memory_order_relaxed)));
+
+    appendMetricHeader(out, "nvdla_server_submits_total", "counter", "Submits, by loadable of the cascade.");
+    for (NvU32 p = 0; p < ServerMetrics::MAX_PARTS; p++)
+    {
+        snprintf(labels, sizeof(labels), "part=\"%u\"", p);
+        appendMetricSample(out, "nvdla_server_submits_total", labels,
+                           double(m_metrics.submits[p].load(std::memory_order_relaxed)));
+    }
+
+    // anything past part 0 escalated
+    appendMetricHeader(out, "nvdla_server_answered_runs_total", "counter",
+                       "Successful runs, by the loadable whose result was returned.");
+    for (NvU32 p = 0; p < ServerMetrics::MAX_PARTS; p++)
+    {
+        snprintf(labels, sizeof(labels), "part=\"%u\"", p);
+        appendMetricSample(out, "nvdla_server_answered_runs_total", labels,
+                           double(m_metrics.answered[p].load(std::memory_order_relaxed)));
+    }
+
+    appendMetricHeader(out, "nvdla_server_batches_total", "counter", "Batches flushed, by size.");
+    for (NvU32 b = 1; b <= m_maxBatch && b <= NVDLA_RUNTIME_BATCH_MAX; b++)
+    {
+        snprintf(labels, sizeof(labels), "size=\"%u\"", b);
+        appendMetricSample(out, "nvdla_server_batches_total", labels, double(m_batchSizes[b]));
+    }
+
+    m_metrics.queueWait.appendPrometheus(out, "nvdla_server_queue_wait_seconds",
+                                         "Time from dispatch to a worker, batching included.");
+    m_metrics.decode.appendPrometheus(out, "nvdla_server_decode_seconds", "Image decode and preprocessing time.");
+    m_metrics.inference.appendPrometheus(out, "nvdla_server_inference_seconds",
+                                         "Submit time per run, escalations included.");
+    m_metrics.service.appendPrometheus(out, "nvdla_server_run_seconds", "Run request parsed to reply queued.");
+
+    appendMetric(out, "nvdla_server_models", "gauge", "Client uploaded models resident.", double(numModels));
+    appendMetric(out, "nvdla_server_model_bytes", "gauge", "Estimated memory of client uploaded models.",
+                 double(modelBytes));
+    appendMetric(out, "nvdla_server_default_model_bytes", "gauge", "Estimated memory of the --loadable cascade.",
+                 double(defaultBytes));
+    appendMetric(out, "nvdla_server_connection_buffer_bytes", "gauge", "Socket buffers held for clients.",
+                 double(buffered));
+
+    if (m_cache)
+    {
+        ResultCache::Stats cache = m_cache->stats();
+
+        appendMetric(out, "nvdla_server_cache_entries", "gauge", "Result cache entries.", double(cache.entries));
+        appendMetric(out, "nvdla_server_cache_bytes", "gauge", "Result cache memory.", double(cache.bytes));
+        appendMetric(out, "nvdla_server_cache_evictions_total", "counter", "Result cache evictions.",
+                     double(cache.evictions));
+    }
+}
+
+NvDlaError runServer(const TestAppArgs* appArgs, TestInfo *testInfo)
+{
+    NvDlaError e = NvDlaSuccess;
+    InferenceServer server(appArgs);
+
+    if (appArgs->serverPort <= 1024)
+    {
+        ORIGINATE_ERROR_FAIL(NvDlaError_BadParameter, " port:%d is a reserved port.\n", appArgs->serverPort);
+    }
+
+    PROPAGATE_ERROR_FAIL(server.init());
+
+    testInfo->dlaServerRunning = true;
+    e = server.run();
+    testInfo->dlaServerRunning = false;
+    PROPAGATE_ERROR_FAIL(e);
 
 fail:
     return e;
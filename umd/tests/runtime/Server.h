@@ -29,6 +29,324 @@
 #ifndef _DLA_SERVER_H_
 #define _DLA_SERVER_H_
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "CascadeTrace.h"
+#include "Preprocess.h"
+#include "ResultCache.h"
+#include "ServerMetrics.h"
+#include "WireProtocol.h"
+
+#include "nvdla/IRuntime.h"
+
+struct TestAppArgs;
+struct TestInfo;
+
+// Serves the dla_client protocol to many clients at once. One epoll thread
+// only moves and parses bytes; a pool of workers sharing the resident
+// runtimes does decoding, inference and output serialization, and hands
+// results back through an eventfd. Each connection sees its replies in
+// request order, and no connection waits behind another one's inference.
+class InferenceServer
+{
+public:
+    explicit InferenceServer(const TestAppArgs* appArgs);
+    ~InferenceServer();
+
+    // listens, starts the workers and loads the --loadable cascade if any
+    NvDlaError init();
+
+    // serves until a local client, or any with --remoteshutdown, sends SHUTDOWN
+    NvDlaError run();
+
+protected:
+    // one loaded runtime, bound once to its own input and output tensors,
+    // batch elements of them laid out back to back
+    struct Instance
+    {
+        nvdla::IRuntime* runtime;
+        NvU32 batch;
+        void* inputHandle;
+        void* inputData;
+        void* outputHandle;
+        void* outputData;
+    };
+
+    // a loadable and the instances workers take turns on
+    struct ModelPart
+    {
+        std::vector<NvU8> loadable;
+        nvdla::IRuntime::NvDlaTensor inputDesc;
+        nvdla::IRuntime::NvDlaTensor outputDesc;
+        std::vector<Instance*> instances;
+        std::vector<Instance*> idle;
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool transient;     /* one instance, loaded only while runs want it */
+        bool loading;       /* a transient instance is being loaded, unlocked */
+        bool unloading;     /* a JOB_UNLOAD for it is queued */
+        NvU64 releasedUs;   /* metricsNowUs() the transient instance was last released */
+        NvU32 waiters;      /* in acquire() */
+    };
+
+    // a cascade of loadables, escalating while the margin is low
+    struct Model
+    {
+        Model() : identity(0), bytes(0), serviceUs(0) { }
+        ~Model();
+
+        std::vector<ModelPart*> parts;
+        NvU64 identity;     /* result cache key */
+        NvU64 bytes;        /* estimated resident size */
+        NvU64 serviceUs;    /* running average of a run on a worker, event loop only */
+    };
+
+    // uploaded models by SHA-256 of the loadable, least recently used first out
+    struct RegistryEntry
+    {
+        std::shared_ptr<Model> model;
+        std::list<std::string>::iterator lru;
+    };
+
+    // tensor buffers shared with a local client, allocated through and
+    // only ever bound to owner, a first loadable instance
+    struct BufferSet
+    {
+        std::shared_ptr<Model> model;
+        Instance* owner;
+        NvU64 inputSize;
+        NvU64 outputSize;               /* the largest output of the cascade */
+        std::vector<void*> inputHandles;
+        std::vector<void*> inputData;
+        std::vector<void*> outputHandles;
+        std::vector<void*> outputData;
+        std::vector<int> fds;           /* dma-bufs, in and out for each slot, the runtime owns them */
+    };
+
+    struct Result
+    {
+        NvU32 part;
+        bool cached;
+        nvdla::IRuntime::NvDlaTopK topk;
+        nvdla::IRuntime::NvDlaTensor outputDesc;
+        std::vector<NvU8> output;
+        CascadeTrace trace;
+    };
+
+    enum JobType
+    {
+        JOB_LOAD = 0,   /* READ_FLATBUF */
+        JOB_RUN,        /* RUN_FLATBUF, RUN_IMAGE */
+        JOB_OUTPUT,     /* GET_OUTPUT */
+        JOB_BATCH,      /* JOB_RUNs for one model, run together */
+        JOB_MAP,        /* MAP_BUFFERS */
+        JOB_UNMAP,      /* frees a BufferSet nothing uses any more */
+        JOB_UNLOAD      /* unloads a transient loadable left idle, slot is its part */
+    };
+
+    struct Job
+    {
+        Job() :
+            type(JOB_RUN), conn(0), request(), data(NULL), dataSize(0), slot(0), status(NvDlaSuccess),
+            received(0), started(0), finished(0), rank(0), deadline(0), seq(0), order(0)
+        { }
+
+        ~Job()
+        {
+            for (size_t j = 0; j < batch.size(); j++)
+                delete batch[j];
+        }
+
+        JobType type;
+        NvU64 conn;
+        DlaWireHeader request;
+        std::shared_ptr<Model> model;
+        std::shared_ptr<Result> result;
+        std::vector<NvU8> payload;
+        const NvU8* data;           /* within payload, NULL for RUN_FLATBUF */
+        size_t dataSize;
+        std::string modelId;        /* JOB_LOAD */
+        std::vector<Job*> batch;    /* JOB_BATCH */
+        std::shared_ptr<BufferSet> buffers;
+        NvU32 slot;                 /* RUN_BUFFER slot, MAP_BUFFERS slot count */
+        std::string reply;
+        NvDlaError status;
+        NvU64 received;             /* metricsNowUs() at dispatch */
+        NvU64 started;              /* and on a worker */
+        NvU64 finished;
+        NvU32 rank;                 /* 0 first, see priorityRank() */
+        NvU64 deadline;             /* metricsNowUs() clock, 0 for none */
+        NvU64 seq;                  /* reply order on the connection */
+        NvU64 order;                /* arrival in the ready queue */
+    };
+
+    // ready queue order, priority_queue keeps the greatest on top
+    struct JobOrder
+    {
+        bool operator()(const Job* a, const Job* b) const
+        {
+            NvU64 aDeadline = a->deadline ? a->deadline : ~0ULL;
+            NvU64 bDeadline = b->deadline ? b->deadline : ~0ULL;
+
+            if (a->rank != b->rank)
+                return a->rank > b->rank;
+            if (aDeadline != bDeadline)
+                return aDeadline > bDeadline;
+            return a->order > b->order;
+        }
+    };
+
+    struct PendingBatch
+    {
+        std::shared_ptr<Model> model;
+        std::vector<Job*> jobs;
+        NvU64 flushAt;              /* metricsNowUs() clock */
+    };
+
+    // a reply that finished ahead of earlier requests of its connection
+    struct HeldReply
+    {
+        DlaWireHeader request;
+        NvU16 flags;
+        std::string payload;
+    };
+
+    struct Connection
+    {
+        Connection(int sock, NvU64 connId, NvU32 registered, bool isHttp, bool isLocal) :
+            fd(sock), id(connId), events(registered), rpos(0), need(0), wpos(0), jobsOut(0), exclusive(false),
+            nextSeq(0), nextReply(0), resultSeq(0), closing(false), http(isHttp), local(isLocal), wpopped(0)
+        { }
+
+        int fd;
+        NvU64 id;
+        NvU32 events;               /* registered with epoll */
+        std::vector<NvU8> rbuf;
+        size_t rpos;
+        size_t need;                /* bytes still missing from the frame being read */
+        std::deque<std::string> wqueue;
+        size_t wpos;                /* sent from wqueue.front() */
+        NvU32 jobsOut;
+        bool exclusive;             /* a job other than a run is out, later requests wait */
+        NvU64 nextSeq;              /* of the next request read */
+        NvU64 nextReply;            /* of the next reply to queue */
+        std::map<NvU64, HeldReply> held;
+        NvU64 resultSeq;            /* of the run result holds */
+        bool closing;               /* close once wqueue is flushed */
+        bool http;                  /* a --metricsport scrape */
+        bool local;                 /* on the --socket Unix socket */
+        NvU64 wpopped;              /* wqueue entries sent so far */
+        std::deque<std::pair<NvU64, std::shared_ptr<BufferSet> > > wfds;  /* fds to pass with wqueue entry first */
+        std::shared_ptr<BufferSet> buffers;
+        std::weak_ptr<Model> model; /* eviction unloads it under the client */
+        std::shared_ptr<Result> result;
+    };
+
+    NvDlaError startListening(NvS32 port, NvU32 address, NvU64 event, int* fd);
+    NvDlaError startLocalListening();
+    NvDlaError loadModel(const std::vector<std::vector<NvU8> >& loadables, NvU32 numInstances,
+                         std::shared_ptr<Model>* model);
+    NvDlaError createInstance(ModelPart* part, NvU32 batch, Instance** instance);
+    static void destroyInstance(ModelPart* part, Instance* instance);
+    NvDlaError bindInstance(ModelPart* part, Instance* instance);
+
+    std::shared_ptr<Model> findModel(const std::string& id);
+    std::shared_ptr<Model> registerModel(const std::string& id, const std::shared_ptr<Model>& model);
+    std::shared_ptr<Model> requestModel(Connection* c, const DlaWireHeader& header, const NvU8** data, size_t* size);
+
+    Instance* acquire(ModelPart* part, Instance* want = NULL);
+    void release(ModelPart* part, Instance* instance);
+
+    // worker side
+    void workerLoop();
+    void execute(Job* job);
+    void runBatch(Job* const* jobs, NvU32 numJobs);
+    NvDlaError escalate(Model* model, nvdla::IRuntime* runtime, const NvU8* input, const NvU8* output,
+                        Result* result);
+    NvDlaError serializeOutput(Job* job);
+    NvDlaError mapBuffers(Job* job);
+    void unmapBuffers(BufferSet* buffers);
+    NvDlaError runBuffer(Job* job);
+    void unloadPart(ModelPart* part);
+
+    // event loop side
+    void acceptConnections(NvU64 event);
+    void readConnection(Connection* c);
+    void writeConnection(Connection* c);
+    void processConnection(Connection* c);
+    bool nextMessage(Connection* c, DlaWireHeader* header, const NvU8** payload);
+    void handleRequest(Connection* c, DlaWireHeader header, const NvU8* payload);
+    void serveHttp(Connection* c);
+    void takePayload(Connection* c, Job* job, const NvU8* data, size_t size);
+    void dispatch(Connection* c, const DlaWireHeader& header, NvU64 seq, NvU64 deadline, Job* job);
+    void flushBatch(Model* model);
+    int flushBatches();
+    int unloadIdleParts();
+    static NvU32 priorityRank(NvU16 flags);
+    void pushReady(Job* job);
+    void schedule();
+    void shed(Job* job);
+    void completeJobs();
+    void completeJob(Job* job);
+    void printStats() const;
+    void renderStats(std::string* out);
+    void queueReply(Connection* c, NvU64 seq, const DlaWireHeader& request, NvU16 flags, std::string payload);
+    void appendReply(Connection* c, const DlaWireHeader& request, NvU16 flags, std::string* payload);
+    void updateEvents(Connection* c);
+    void closeConnection(Connection* c);
+    void retireBuffers(std::shared_ptr<BufferSet>* buffers);
+
+    const TestAppArgs* m_appArgs;
+    PreprocessParams m_params;
+
+    int m_listenFd;
+    int m_metricsFd;
+    int m_localFd;
+    int m_epollFd;
+    int m_wakeFd;               /* eventfd the workers poke on completion */
+
+    std::map<NvU64, Connection*> m_conns;
+    NvU64 m_nextConnId;
+
+    std::shared_ptr<Model> m_defaultModel;  /* --loadable cascade, shared by every client */
+    std::mutex m_modelsMutex;
+    std::map<std::string, RegistryEntry> m_models;
+    std::list<std::string> m_modelLru;      /* most recently used first */
+    NvU64 m_modelBytes;                     /* of everything resident, against the budget */
+    NvU64 m_pinnedBytes;                    /* of m_modelBytes, the --loadable cascade */
+    NvU64 m_modelBudget;
+    ResultCache* m_cache;
+
+    NvU32 m_maxBatch;
+    NvU32 m_batchWindowUs;
+    std::map<Model*, PendingBatch> m_pending;
+    NvU64 m_batchSizes[NVDLA_RUNTIME_BATCH_MAX + 1];    /* flushed batches by size */
+    ServerMetrics m_metrics;
+
+    NvU32 m_clientQueue;
+    std::priority_queue<Job*, std::vector<Job*>, JobOrder> m_ready;
+    NvU64 m_readyOrder;
+
+    BoundedQueue<Job*>* m_jobs;
+    BoundedQueue<Job*>* m_done;
+    std::vector<std::thread> m_workers;
+    NvU32 m_running;            /* handed to workers, at most one each */
+    NvU32 m_inflight;
+    bool m_stopping;
+};
+
 NvDlaError runServer(const TestAppArgs* appArgs, TestInfo *testInfo);
 
 #endif /* end of _DLA_SERVER_H_ */
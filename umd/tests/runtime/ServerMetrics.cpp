@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ServerMetrics.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+NvU64 metricsNowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+LatencyHistogram::LatencyHistogram() :
+    m_count(0),
+    m_sum(0)
+{
+    for (NvU32 b = 0; b < NUM_BUCKETS; b++)
+        m_buckets[b].store(0, std::memory_order_relaxed);
+}
+
+// below SUB_COUNT buckets are exact, above it the top SUB_BITS + 1 bits pick one
+NvU32 LatencyHistogram::bucketOf(NvU64 us)
+{
+    if (us < SUB_COUNT)
+        return NvU32(us);
+
+    NvU32 top = 63 - __builtin_clzll(us);
+    NvU32 shift = top - SUB_BITS;
+
+    return SUB_COUNT * (shift + 1) + NvU32((us >> shift) & (SUB_COUNT - 1));
+}
+
+NvU64 LatencyHistogram::bucketLimit(NvU32 bucket)
+{
+    if (bucket < SUB_COUNT)
+        return bucket;
+
+    NvU32 shift = bucket / SUB_COUNT - 1;
+    NvU64 base = NvU64(SUB_COUNT + bucket % SUB_COUNT) << shift;
+
+    return base + (NvU64(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(NvU64 us)
+{
+    m_buckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(us, std::memory_order_relaxed);
+}
+
+NvU64 LatencyHistogram::percentile(double q) const
+{
+    NvU64 total = 0;
+    NvU64 seen = 0;
+    NvU64 rank;
+
+    for (NvU32 b = 0; b < NUM_BUCKETS; b++)
+        total += m_buckets[b].load(std::memory_order_relaxed);
+    if (total == 0)
+        return 0;
+
+    rank = NvU64(q * double(total - 1)) + 1;
+    for (NvU32 b = 0; b < NUM_BUCKETS; b++)
+    {
+        seen += m_buckets[b].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return bucketLimit(b);
+    }
+
+    return bucketLimit(NUM_BUCKETS - 1);
+}
+
+void LatencyHistogram::appendPrometheus(std::string* out, const char* name, const char* help) const
+{
+    static const char* const quantiles[] = { "0.5", "0.9", "0.99", "0.999" };
+    char labels[32];
+    std::string sample;
+
+    appendMetricHeader(out, name, "summary", help);
+
+    for (NvU32 i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++)
+    {
+        snprintf(labels, sizeof(labels), "quantile=\"%s\"", quantiles[i]);
+        appendMetricSample(out, name, labels, percentile(atof(quantiles[i])) * 1e-6);
+    }
+
+    sample = std::string(name) + "_sum";
+    appendMetricSample(out, sample.c_str(), NULL, sum() * 1e-6);
+    sample = std::string(name) + "_count";
+    appendMetricSample(out, sample.c_str(), NULL, double(count()));
+}
+
+ServerMetrics::ServerMetrics() :
+    connections(0),
+    errors(0),
+    bytesIn(0),
+    bytesOut(0),
+    runs(0),
+    runFailures(0),
+    cacheHits(0),
+    shed(0),
+    deadlineMisses(0)
+{
+    for (NvU32 o = 0; o < MAX_OPCODES; o++)
+        requests[o].store(0, std::memory_order_relaxed);
+    for (NvU32 p = 0; p < MAX_PARTS; p++)
+    {
+        submits[p].store(0, std::memory_order_relaxed);
+        answered[p].store(0, std::memory_order_relaxed);
+    }
+    for (NvU32 p = 0; p < MAX_PRIORITIES; p++)
+        prioritized[p].store(0, std::memory_order_relaxed);
+}
+
+void appendMetricHeader(std::string* out, const char* name, const char* type, const char* help)
+{
+    out->append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out->append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+void appendMetricSample(std::string* out, const char* name, const char* labels, double value)
+{
+    char number[32];
+
+    snprintf(number, sizeof(number), "%.9g", value);
+    out->append(name);
+    if (labels)
+        out->append("{").append(labels).append("}");
+    out->append(" ").append(number).append("\n");
+}
+
+void appendMetric(std::string* out, const char* name, const char* type, const char* help, double value)
+{
+    appendMetricHeader(out, name, type, help);
+    appendMetricSample(out, name, NULL, value);
+}
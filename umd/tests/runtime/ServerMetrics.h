@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NVDLA_UTILS_SERVER_METRICS_H
+#define NVDLA_UTILS_SERVER_METRICS_H
+
+#include <atomic>
+#include <string>
+
+#include "dlatypes.h"
+
+// monotonic microseconds, for latencies only
+NvU64 metricsNowUs();
+
+// Log-linear latency histogram after HdrHistogram: values in microseconds,
+// each power of two split into 16 linear buckets, so any percentile is
+// within about 6% from 1us up to days. record() is three relaxed atomic
+// adds and safe from any thread; readers see a slightly torn but never
+// invalid view.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(NvU64 us);
+
+    NvU64 count() const { return m_count.load(std::memory_order_relaxed); }
+    NvU64 sum() const { return m_sum.load(std::memory_order_relaxed); }
+
+    // upper bound of the bucket holding quantile q, 0 when empty
+    NvU64 percentile(double q) const;
+
+    // a Prometheus summary in seconds
+    void appendPrometheus(std::string* out, const char* name, const char* help) const;
+
+protected:
+    static const NvU32 SUB_BITS = 4;
+    static const NvU32 SUB_COUNT = 1U << SUB_BITS;
+    static const NvU32 NUM_BUCKETS = SUB_COUNT * (64 - SUB_BITS + 1);
+
+    static NvU32 bucketOf(NvU64 us);
+    static NvU64 bucketLimit(NvU32 bucket);
+
+    std::atomic<NvU64> m_buckets[NUM_BUCKETS];
+    std::atomic<NvU64> m_count;
+    std::atomic<NvU64> m_sum;
+};
+
+// What the server counts on its hot paths. Everything is a relaxed atomic
+// so workers never take a lock for it; gauges such as queue depth are read
+// off the server itself when the stats are rendered.
+struct ServerMetrics
+{
+    static const NvU32 MAX_OPCODES = 16;
+    static const NvU32 MAX_PARTS = 8;     /* deeper loadables count as the last */
+    static const NvU32 MAX_PRIORITIES = 3;  /* interactive, normal, bulk */
+
+    ServerMetrics();
+
+    std::atomic<NvU64> connections;             /* accepted */
+    std::atomic<NvU64> requests[MAX_OPCODES];   /* by opcode, 0 for unknown ones */
+    std::atomic<NvU64> errors;                  /* error replies */
+    std::atomic<NvU64> bytesIn;
+    std::atomic<NvU64> bytesOut;
+    std::atomic<NvU64> runs;
+    std::atomic<NvU64> runFailures;
+    std::atomic<NvU64> cacheHits;
+    std::atomic<NvU64> submits[MAX_PARTS];      /* by loadable, a batch counts once */
+    std::atomic<NvU64> answered[MAX_PARTS];     /* runs by the loadable that settled them */
+    std::atomic<NvU64> prioritized[MAX_PRIORITIES]; /* requests by priority class */
+    std::atomic<NvU64> shed;                    /* runs dropped before their deadline */
+    std::atomic<NvU64> deadlineMisses;          /* runs answered after their deadline */
+
+    LatencyHistogram queueWait;     /* dispatch to a worker, batching window included */
+    LatencyHistogram decode;        /* image file to input tensor */
+    LatencyHistogram inference;     /* submits, escalations included */
+    LatencyHistogram service;       /* run request parsed to reply queued */
+};
+
+// Prometheus text exposition, format 0.0.4
+void appendMetricHeader(std::string* out, const char* name, const char* type, const char* help);
+void appendMetricSample(std::string* out, const char* name, const char* labels, double value);
+void appendMetric(std::string* out, const char* name, const char* type, const char* help, double value);
+
+#endif // NVDLA_UTILS_SERVER_METRICS_H
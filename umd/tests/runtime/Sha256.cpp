@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Sha256.h"
+
+#include <string.h>
+
+static const NvU32 sha256K[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline NvU32 rotr32(NvU32 x, NvU32 n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+static void sha256Block(NvU32 state[8], const NvU8* block)
+{
+    NvU32 w[64];
+    NvU32 a = state[0], b = state[1], c = state[2], d = state[3];
+    NvU32 e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (NvU32 i = 0; i < 16; i++)
+        w[i] = (NvU32(block[4 * i]) << 24) | (NvU32(block[4 * i + 1]) << 16) |
+               (NvU32(block[4 * i + 2]) << 8) | NvU32(block[4 * i + 3]);
+
+    for (NvU32 i = 16; i < 64; i++)
+    {
+        NvU32 s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        NvU32 s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    for (NvU32 i = 0; i < 64; i++)
+    {
+        NvU32 t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + sha256K[i] + w[i];
+        NvU32 t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void sha256(const void* data, size_t size, NvU8 digest[SHA256_DIGEST_SIZE])
+{
+    NvU32 state[8] =
+    {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    const NvU8* p = static_cast<const NvU8*>(data);
+    NvU8 tail[128];
+    size_t rest, tailSize;
+    NvU64 bits = NvU64(size) * 8;
+
+    for (rest = size; rest >= 64; rest -= 64, p += 64)
+        sha256Block(state, p);
+
+    // 0x80, zeros, then the bit length big endian, one or two blocks
+    tailSize = rest + 9 <= 64 ? 64 : 128;
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, p, rest);
+    tail[rest] = 0x80;
+    for (NvU32 i = 0; i < 8; i++)
+        tail[tailSize - 1 - i] = NvU8(bits >> (8 * i));
+
+    for (size_t off = 0; off < tailSize; off += 64)
+        sha256Block(state, tail + off);
+
+    for (NvU32 i = 0; i < 8; i++)
+    {
+        digest[4 * i] = NvU8(state[i] >> 24);
+        digest[4 * i + 1] = NvU8(state[i] >> 16);
+        digest[4 * i + 2] = NvU8(state[i] >> 8);
+        digest[4 * i + 3] = NvU8(state[i]);
+    }
+}
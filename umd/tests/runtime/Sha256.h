@@ -26,9 +26,16 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#ifndef _DLA_SERVER_H_
-#define _DLA_SERVER_H_
+#ifndef NVDLA_UTILS_SHA256_H
+#define NVDLA_UTILS_SHA256_H
 
-NvDlaError runServer(const TestAppArgs* appArgs, TestInfo *testInfo);
+#include <stddef.h>
 
-#endif /* end of _DLA_SERVER_H_ */
+#include "dlatypes.h"
+
+#define SHA256_DIGEST_SIZE 32U
+
+// FIPS 180-4 SHA-256, for ids a client can compute on its own
+void sha256(const void* data, size_t size, NvU8 digest[SHA256_DIGEST_SIZE]);
+
+#endif // NVDLA_UTILS_SHA256_H
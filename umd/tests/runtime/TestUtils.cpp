@@ -34,9 +34,9 @@
 
 #include "main.h"
 
-#include "half.h"
 #include "nvdla_os_inf.h"
 
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -117,98 +117,3 @@ NvDlaError Tensor2DIMG(const nvdla::IRuntime::NvDlaTensor* tensor, NvDlaImage* i
 
     return NvDlaSuccess;
 }
-
-static int roundUp(int num, int mul)
-{
-    int rem;
-
-    if (mul == 0)
-        rem = 0;
-    else
-        rem = num % mul;
-
-    if (rem == 0)
-        return num;
-
-    return num + mul - rem;
-}
-
-// This format conversion can be generalized and moved to DlaImageUtils
-NvDlaError createFF16ImageCopy(const TestAppArgs* appArgs, NvDlaImage* in, NvDlaImage* out)
-{
-    out->m_meta.surfaceFormat = NvDlaImage::D_F16_CxHWx_x16_F;
-    out->m_meta.width = in->m_meta.width;
-    out->m_meta.height = in->m_meta.height;
-    out->m_meta.channel = in->m_meta.channel;
-
-    NvS8 bpe = out->getBpe();
-    if (bpe <= 0)
-        ORIGINATE_ERROR(NvDlaError_BadParameter);
-
-    // Enforce stride and size alignment of 32B
-    NvU32 strideAlign = 32;
-    NvU32 sizeAlign = 32;
-    // These calculations work for channels <= 16
-    if (out->m_meta.channel > 16)
-        ORIGINATE_ERROR(NvDlaError_BadParameter);
-
-    // Number of input channels should be <= 4
-    if (in->m_meta.channel > 4)
-        ORIGINATE_ERROR(NvDlaError_BadParameter);
-
-    out->m_meta.lineStride = roundUp(out->m_meta.width * roundUp(out->m_meta.channel * bpe, strideAlign), strideAlign);
-    out->m_meta.surfaceStride = roundUp(out->m_meta.lineStride * out->m_meta.height, strideAlign);
-    out->m_meta.size = roundUp(out->m_meta.surfaceStride, sizeAlign);
-
-    // Allocate the buffer
-    out->m_pData = NvDlaAlloc(out->m_meta.size);
-
-    // Copy the data
-    memset(out->m_pData, 0, out->m_meta.size);
-
-    NvU8* ibuf = static_cast<NvU8*>(in->m_pData);
-    NvU8* obuf = static_cast<NvU8*>(out->m_pData);
-
-    for (NvU32 y=0; y < in->m_meta.height; y++)
-    {
-        for (NvU32 x=0; x < in->m_meta.width; x++)
-        {
-            for (NvU32 z=0; z < in->m_meta.channel; z++)
-            {
-                NvS32 ioffset = in->getAddrOffset(x, y, z);
-                NvS32 ooffset = out->getAddrOffset(x, y, z);
-
-                if (ioffset < 0)
-                    ORIGINATE_ERROR(NvDlaError_BadParameter);
-                if (ooffset < 0)
-                    ORIGINATE_ERROR(NvDlaError_BadParameter);
-
-                NvU8* inp = ibuf + ioffset;
-                half_float::half* outp = reinterpret_cast<half_float::half*>(obuf + ooffset);
-                if (appArgs->normalize_value[z] == 0)
-                    *outp = half_float::half(float(*inp));
-                else
-                    *outp = half_float::half(((float(*inp)/255.0) - float(appArgs->mean[z]))/appArgs->normalize_value[z]);
-            }
-        }
-    }
-
-    // Print first 10 elements of the first row
-    if (1) {
-        for (NvU32 x=0; x < 10; x++)
-        {
-            NvDlaDebugPrintf("[");
-            for (NvU32 z=0; z < in->m_meta.channel; z++)
-            {
-                NvS32 ooffset = out->getAddrOffset(x, 0, z);
-                half_float::half* outp = reinterpret_cast<half_float::half*>(obuf + ooffset);
-                NvDlaDebugPrintf(" %f", float(*outp));
-            }
-            NvDlaDebugPrintf("]\n");
-        }
-        NvDlaDebugPrintf("\n");
-    }
-
-    return NvDlaSuccess;
-}
-
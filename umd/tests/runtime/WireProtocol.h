@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _DLA_WIRE_PROTOCOL_H_
+#define _DLA_WIRE_PROTOCOL_H_
+
+#include "dlatypes.h"
+
+#include <arpa/inet.h>
+#include <string.h>
+
+// Every message, either way, is a fixed header followed by the payload:
+//
+//   u32 magic | u16 opcode | u16 flags | u32 request id | u32 payload length
+//
+// all in network byte order. Replies echo the opcode and request id and set
+// DLA_WIRE_FLAG_REPLY. A client may send any number of requests before
+// reading replies; they come back in request order. Up to --clientqueue
+// runs of one client are worked on at once, any other request waits for
+// them.
+//
+// Requests carry a priority class in their flags. Interactive work goes
+// ahead of normal work, which goes ahead of bulk work, and runs of the same
+// class are ordered by deadline. A run with DLA_WIRE_FLAG_DEADLINE starts
+// with a u32 budget in microseconds from when the server reads it. Runs that
+// can no longer make their deadline are shed before they get to the DLA and
+// answered with an error.
+//
+// A run with DLA_WIRE_FLAG_TRACE is answered with a second line tracing it
+// through the cascade: the loadables it ran on, each submit's time and the
+// part of it spent waiting on the engines, and the margin each one left.
+//
+// Models are named by the SHA-256 of their loadable. A client queries the
+// id, uploads with READ_FLATBUF only if the server doesn't have it, and
+// names it in runs with DLA_WIRE_FLAG_MODEL. Runs without the flag use the
+// connection's last queried or uploaded model, else the --loadable cascade.
+//
+// Over the --socket Unix socket a client can also MAP_BUFFERS once: the
+// reply carries the dma-buf fds of that many input and output tensor pairs
+// as SCM_RIGHTS, in, out, in, out... The client mmaps them, writes the
+// packed input tensor and sends RUN_BUFFER with just the slot index. The
+// first loadable reads the input in place and the final output is left in
+// the slot's output buffer, so no tensor bytes cross the socket.
+//
+// A frame declaring more payload than its opcode can carry, see
+// wireMaxPayload(), closes the connection.
+
+#define DLA_WIRE_MAGIC          0x4e56444cU     /* "NVDL" */
+#define DLA_WIRE_HEADER_SIZE    16U
+#define DLA_WIRE_MAX_IMAGE      (64U << 20)     /* a RUN_IMAGE file */
+#define DLA_WIRE_MAX_CONTROL    64U             /* any other request but READ_FLATBUF */
+#define DLA_WIRE_MAX_NAME       255U
+#define DLA_WIRE_MODEL_ID_SIZE  32U
+#define DLA_WIRE_MAX_BUFFERS    16U
+
+enum DlaWireOpcode
+{
+    DLA_OP_GET_WELCOME = 1,
+    DLA_OP_QUERY_FLATBUF,   /* payload: optional model id, reply "YES" or "NO" */
+    DLA_OP_READ_FLATBUF,    /* payload: loadable, reply "OK" */
+    DLA_OP_RUN_FLATBUF,     /* run on a zeroed input */
+    DLA_OP_RUN_IMAGE,       /* payload: file name, NUL, JPEG or PGM file bytes */
+    DLA_OP_GET_NUMOUTPUTS,
+    DLA_OP_GET_OUTPUT,      /* payload: u32 output index */
+    DLA_OP_SHUTDOWN,
+    DLA_OP_GET_STATS,       /* reply: metrics in the Prometheus text format */
+    DLA_OP_MAP_BUFFERS,     /* payload: u32 slots, reply: u32 slots | u64 input size | u64 output size, fds */
+    DLA_OP_RUN_BUFFER       /* payload: u32 slot */
+};
+
+enum DlaWireFlags
+{
+    DLA_WIRE_FLAG_REPLY = 1 << 0,
+    DLA_WIRE_FLAG_ERROR = 1 << 1,   /* payload is an error message */
+    DLA_WIRE_FLAG_MODEL = 1 << 2,   /* run payload starts with a model id */
+    DLA_WIRE_FLAG_DEADLINE = 1 << 3,/* payload starts with a u32 budget in us, before any model id */
+    DLA_WIRE_FLAG_TRACE = 1 << 4    /* run reply gets a second line, the CascadeTrace */
+};
+
+#define DLA_WIRE_PRIORITY_SHIFT 8
+#define DLA_WIRE_PRIORITY_MASK  (3U << DLA_WIRE_PRIORITY_SHIFT)
+
+enum DlaWirePriority
+{
+    DLA_WIRE_PRIORITY_NORMAL = 0,
+    DLA_WIRE_PRIORITY_INTERACTIVE,
+    DLA_WIRE_PRIORITY_BULK
+};
+
+struct DlaWireHeader
+{
+    NvU32 magic;
+    NvU16 opcode;
+    NvU16 flags;
+    NvU32 requestId;
+    NvU32 length;
+};
+
+static inline void encodeWireHeader(const DlaWireHeader& h, NvU8* out)
+{
+    NvU32 magic = htonl(h.magic);
+    NvU16 opcode = htons(h.opcode);
+    NvU16 flags = htons(h.flags);
+    NvU32 requestId = htonl(h.requestId);
+    NvU32 length = htonl(h.length);
+
+    memcpy(out + 0, &magic, 4);
+    memcpy(out + 4, &opcode, 2);
+    memcpy(out + 6, &flags, 2);
+    memcpy(out + 8, &requestId, 4);
+    memcpy(out + 12, &length, 4);
+}
+
+// false on a bad magic, the stream can't be resynchronized after that
+static inline bool decodeWireHeader(const NvU8* in, DlaWireHeader* h)
+{
+    memcpy(&h->magic, in + 0, 4);
+    memcpy(&h->opcode, in + 4, 2);
+    memcpy(&h->flags, in + 6, 2);
+    memcpy(&h->requestId, in + 8, 4);
+    memcpy(&h->length, in + 12, 4);
+
+    h->magic = ntohl(h->magic);
+    h->opcode = ntohs(h->opcode);
+    h->flags = ntohs(h->flags);
+    h->requestId = ntohl(h->requestId);
+    h->length = ntohl(h->length);
+
+    return h->magic == DLA_WIRE_MAGIC;
+}
+
+// The most payload a request may declare, deadline and model id included.
+// Uploads are bounded by the largest loadable the server accepts.
+static inline NvU32 wireMaxPayload(NvU16 opcode, NvU32 maxLoadable)
+{
+    const NvU32 prefix = sizeof(NvU32) + DLA_WIRE_MODEL_ID_SIZE;
+
+    switch (opcode)
+    {
+        case DLA_OP_READ_FLATBUF:
+            return maxLoadable > ~0U - prefix ? ~0U : maxLoadable + prefix;
+        case DLA_OP_RUN_IMAGE:
+            return prefix + DLA_WIRE_MAX_NAME + 1 + DLA_WIRE_MAX_IMAGE;
+        default:
+            return DLA_WIRE_MAX_CONTROL;
+    }
+}
+
+#endif /* end of _DLA_WIRE_PROTOCOL_H_ */
@@ -10,6 +10,8 @@
 #include "RuntimeTest.h"
 #endif
 #include "Server.h"
+#include "ImageLoader.h"
+#include "Pipeline.h"
 
 #include "nvdla_os_inf.h"
 
@@ -74,14 +76,53 @@ fail:
     return e;
 }
 
+static NvDlaError launchPipeline(const TestAppArgs* appArgs)
+{
+    NvDlaError e = NvDlaSuccess;
+    std::vector<std::string> images;
+    Pipeline pipeline(appArgs);
+
+    PROPAGATE_ERROR_FAIL(listImages(appArgs->inputDir, &images));
+
+    // regression sweeps and offline scoring want results in file order
+    if (appArgs->inOrder)
+        return runImageBatch(appArgs, images);
+
+    PROPAGATE_ERROR_FAIL(pipeline.init());
+
+    e = pipeline.run(images);
+    pipeline.printStats();
+    PROPAGATE_ERROR_FAIL(e);
+
+fail:
+    return e;
+}
+
 static void printHelp(char* argv[]) {
         NvDlaDebugPrintf("Usage: %s [-options] --parts <int> (--loadable <loadable_file>)+\n", argv[0]);
         NvDlaDebugPrintf("where options include:\n");
         NvDlaDebugPrintf("    -h                    print this help message\n");
         NvDlaDebugPrintf("    -s                    launch test in server mode\n");
+        NvDlaDebugPrintf("    --port <int>          server port (default 6666)\n");
+        NvDlaDebugPrintf("    --models <MB>         server memory for resident models (default 256)\n");
+        NvDlaDebugPrintf("    --metricsport <int>   serve Prometheus metrics over HTTP on localhost (default 0, off)\n");
+        NvDlaDebugPrintf("    --socket <path>       also serve local clients on a Unix socket, with shared tensor buffers\n");
+        NvDlaDebugPrintf("    --remoteshutdown      let TCP clients stop the server, not just --socket ones\n");
         NvDlaDebugPrintf("    --image <file>        input jpg/pgm file\n");
+        NvDlaDebugPrintf("    --imagedir <dir>      stream every jpg/pgm in <dir> through the pipeline\n");
+        NvDlaDebugPrintf("    --threads <int>       worker threads per pipeline stage (default 2)\n");
+        NvDlaDebugPrintf("    --inorder             score --imagedir images one by one in file order\n");
+        NvDlaDebugPrintf("    --batch <int>         --inorder images or server runs per submit of the first loadable (default 1)\n");
+        NvDlaDebugPrintf("    --batchwindow <us>    longest a server run waits for others to batch with (default 1000)\n");
+        NvDlaDebugPrintf("    --clientqueue <int>   server runs of one client worked on at once (default 4)\n");
+        NvDlaDebugPrintf("    --trace               log every server run's path through the cascade\n");
+        NvDlaDebugPrintf("    --cache <MB>          reuse results for byte-identical input tensors (default 0, off)\n");
+        NvDlaDebugPrintf("    --fit <mode>          stretch, crop or letterbox inputs to the network size (default stretch)\n");
+        NvDlaDebugPrintf("    --resize <filter>     auto, bilinear or area resampling (default auto)\n");
         NvDlaDebugPrintf("    --normalize <value>   normalize value for input image\n");
         NvDlaDebugPrintf("    --mean <value>        comma separated mean value for input image\n");
+        NvDlaDebugPrintf("    --inputscale <value>  int8 input scale, required for int8 input tensors\n");
+        NvDlaDebugPrintf("    --inputoffset <value> int8 input zero point (default 0)\n");
         NvDlaDebugPrintf("    --rawdump             dump raw dimg data\n");
         NvDlaDebugPrintf("    --parts <int>         number of loadables\n");
 }
@@ -120,11 +161,16 @@ int main(int argc, char* argv[])
 
             num_loadables = atoi(argv[++ii]);
         }
+        else if (std::strcmp(arg, "-s") == 0)
+        {
+            serverMode = true;
+        }
 
         ii++;
     }
 
-    if (num_loadables == 0) 
+    // a server may start empty and take its loadables from clients
+    if (num_loadables == 0 && !serverMode)
     {
         showHelp = true;
         missingArg = true;
@@ -159,10 +205,69 @@ int main(int argc, char* argv[])
             showHelp = true;
             break;
         }
-        if(std::strcmp(arg, "-s") == 0)
+        if (std::strcmp(arg, "-s") == 0)
         {
             serverMode = true;
-            break;
+        }
+        else if (std::strcmp(arg, "--port") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                showHelp = true;
+                break;
+            }
+
+            tAA.serverPort = atoi(argv[++ii]);
+        }
+        else if (std::strcmp(arg, "--models") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                showHelp = true;
+                break;
+            }
+
+            tAA.modelBudget = atoi(argv[++ii]);
+        }
+        else if (std::strcmp(arg, "--socket") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                showHelp = true;
+                break;
+            }
+
+            tAA.socketPath = std::string(argv[++ii]);
+        }
+        else if (std::strcmp(arg, "--metricsport") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                showHelp = true;
+                break;
+            }
+
+            tAA.metricsPort = atoi(argv[++ii]);
+        }
+        else if (std::strcmp(arg, "--clientqueue") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                showHelp = true;
+                break;
+            }
+
+            tAA.clientQueue = atoi(argv[++ii]);
+        }
+        else if (std::strcmp(arg, "--batchwindow") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                showHelp = true;
+                break;
+            }
+
+            tAA.batchWindow = atoi(argv[++ii]);
         }
         else if (std::strcmp(arg, "-i") == 0)
         {
@@ -187,6 +292,89 @@ int main(int argc, char* argv[])
 
             tAA.inputName = std::string(argv[++ii]);
         }
+        else if (std::strcmp(arg, "--imagedir") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                NvDlaDebugPrintf("[ERROR] No image directory provided\n");
+                showHelp = true;
+                break;
+            }
+
+            tAA.inputDir = std::string(argv[++ii]);
+        }
+        else if (std::strcmp(arg, "--threads") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                showHelp = true;
+                break;
+            }
+
+            tAA.numThreads = atoi(argv[++ii]);
+        }
+        else if (std::strcmp(arg, "--inorder") == 0)
+        {
+            tAA.inOrder = true;
+        }
+        else if (std::strcmp(arg, "--cache") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                showHelp = true;
+                break;
+            }
+
+            tAA.cacheSize = atoi(argv[++ii]);
+        }
+        else if (std::strcmp(arg, "--batch") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                showHelp = true;
+                break;
+            }
+
+            tAA.batchSize = atoi(argv[++ii]);
+            if (tAA.batchSize < 1 || tAA.batchSize > NVDLA_RUNTIME_BATCH_MAX)
+            {
+                NvDlaDebugPrintf("[ERROR] --batch must be 1 to %u\n", NVDLA_RUNTIME_BATCH_MAX);
+                showHelp = true;
+                break;
+            }
+        }
+        else if (std::strcmp(arg, "--fit") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                showHelp = true;
+                break;
+            }
+
+            tAA.fitMode = std::string(argv[++ii]);
+            if (tAA.fitMode != "stretch" && tAA.fitMode != "crop" && tAA.fitMode != "letterbox")
+            {
+                NvDlaDebugPrintf("[ERROR] Unknown fit mode %s\n", tAA.fitMode.c_str());
+                showHelp = true;
+                break;
+            }
+        }
+        else if (std::strcmp(arg, "--resize") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                showHelp = true;
+                break;
+            }
+
+            tAA.resizeFilter = std::string(argv[++ii]);
+            if (tAA.resizeFilter != "auto" && tAA.resizeFilter != "bilinear" && tAA.resizeFilter != "area")
+            {
+                NvDlaDebugPrintf("[ERROR] Unknown resize filter %s\n", tAA.resizeFilter.c_str());
+                showHelp = true;
+                break;
+            }
+        }
         else if (std::strcmp(arg, "--loadable") == 0)
         {
             if (ii+1 >= argc)
@@ -257,6 +445,34 @@ int main(int argc, char* argv[])
                 i++;
             }
         }
+        else if (std::strcmp(arg, "--inputscale") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                showHelp = true;
+                break;
+            }
+
+            tAA.inputScale = atof(argv[++ii]);
+        }
+        else if (std::strcmp(arg, "--inputoffset") == 0)
+        {
+            if (ii+1 >= argc)
+            {
+                showHelp = true;
+                break;
+            }
+
+            tAA.inputOffset = atof(argv[++ii]);
+        }
+        else if (std::strcmp(arg, "--trace") == 0)
+        {
+            tAA.traceRuns = true;
+        }
+        else if (std::strcmp(arg, "--remoteshutdown") == 0)
+        {
+            tAA.remoteShutdown = true;
+        }
         else if (std::strcmp(arg, "--rawdump") == 0)
         {
             NvDlaDebugPrintf("Raw output dump enabled\n");
@@ -320,9 +536,11 @@ int main(int argc, char* argv[])
 
     if (serverMode)
     {
-        NvDlaDebugPrintf("Server functionality not implemented\n");
-        return EXIT_FAILURE;
-        // e = launchServer(&tAAvec);
+        e = launchServer(&tAA);
+    }
+    else if (tAA.inputDir != "")
+    {
+        e = launchPipeline(&tAA);
     }
     else
     {
@@ -21,6 +21,9 @@
 #include "RuntimeTest.h"
 #endif
 
+// margin between the top two classes needed to stop the cascade
+#define CONF_THRESH 0.6
+
 enum TestImageTypes
 {
     IMAGE_TYPE_PGM = 0,
@@ -28,12 +31,16 @@ enum TestImageTypes
     IMAGE_TYPE_UNKNOWN = 2,
 };
 
+TestImageTypes getImageType(std::string imageFileName);
+
 NvDlaError launchTest(const TestAppArgs* appArgs);
 NvDlaError testSetup(const TestAppArgs* appArgs, TestInfo* i);
 
 NvDlaError run(const TestAppArgs* appArgs, TestInfo* i);
 
+NvDlaError readLoadable(const TestAppArgs* appArgs, TestInfo* i, int loadableNum);
 NvDlaError loadLoadable(const TestAppArgs* appArgs, TestInfo* i);
+void unloadLoadable(const TestAppArgs* appArgs, TestInfo* i);
 NvDlaError setupBuffers(const TestAppArgs* appArgs, TestInfo* i);
 NvDlaError runTest(const TestAppArgs* appArgs, TestInfo* i);
 
@@ -41,4 +48,3 @@ NvDlaError DIMG2DlaBuffer(const NvDlaImage* image, void** pBuffer);
 NvDlaError DlaBuffer2DIMG(void** pBuffer, NvDlaImage* image);
 
 NvDlaError Tensor2DIMG(const nvdla::IRuntime::NvDlaTensor* pTDesc, NvDlaImage* image);
-NvDlaError createFF16ImageCopy(const TestAppArgs* appArgs, NvDlaImage* in, NvDlaImage* out);
\ No newline at end of file
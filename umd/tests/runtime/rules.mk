@@ -27,9 +27,16 @@
 LOCAL_DIR := $(GET_LOCAL_DIR)
 
 NVDLA_SRC_FILES := \
+    CascadeTrace.cpp \
     DlaImage.cpp \
     DlaImageUtils.cpp \
+    ImageLoader.cpp \
+    Pipeline.cpp \
+    Preprocess.cpp \
+    ResultCache.cpp \
     Server.cpp \
+    ServerMetrics.cpp \
+    Sha256.cpp \
     RuntimeTest.cpp \
     TestUtils.cpp \
     main.cpp
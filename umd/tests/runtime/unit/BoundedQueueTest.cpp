@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+
+#include "BoundedQueue.h"
+
+#include <thread>
+#include <vector>
+
+// producers and consumers that outrun a two-slot ring block rather than
+// drop or duplicate, and close() releases the consumers once drained
+UNIT_TEST(boundedQueueBlocksAndDrains)
+{
+    const NvU32 kThreads = 4;
+    const NvU32 kItems = 20000;
+    BoundedQueue<NvU32> queue(2);
+    std::vector<std::thread> producers, consumers;
+    std::vector<NvU64> sums(kThreads, 0), counts(kThreads, 0);
+    NvU64 sum = 0, count = 0;
+
+    for ( NvU32 t = 0; t < kThreads; t++ ) {
+        consumers.push_back(std::thread([&queue, &sums, &counts, t]() {
+            NvU32 v;
+            while ( queue.pop(&v) ) {
+                sums[t] += v;
+                counts[t]++;
+            }
+        }));
+    }
+    for ( NvU32 t = 0; t < kThreads; t++ ) {
+        producers.push_back(std::thread([&queue, t]() {
+            for ( NvU32 i = 0; i < kItems; i++ ) {
+                queue.push(t * kItems + i + 1);
+            }
+        }));
+    }
+
+    for ( NvU32 t = 0; t < kThreads; t++ ) {
+        producers[t].join();
+    }
+    queue.close();
+    for ( NvU32 t = 0; t < kThreads; t++ ) {
+        consumers[t].join();
+        sum += sums[t];
+        count += counts[t];
+    }
+
+    NvU64 total = NvU64(kThreads) * kItems;
+    CHECK_EQ(count, total);
+    CHECK_EQ(sum, total * (total + 1) / 2);
+    CHECK_EQ(queue.depth(), 0U);
+    CHECK(queue.maxDepth() <= queue.capacity());
+}
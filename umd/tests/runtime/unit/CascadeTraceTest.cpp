@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+
+#include "CascadeTrace.h"
+
+namespace
+{
+
+CascadeTrace::Step traceStep(NvU32 part, NvU64 submitUs, NvU64 waitUs, NvF32 margin)
+{
+    CascadeTrace::Step step;
+
+    step.part = part;
+    step.submitUs = submitUs;
+    step.waitUs = waitUs;
+    step.margin = margin;
+
+    return step;
+}
+
+}
+
+UNIT_TEST(cascadeTraceFormat)
+{
+    CascadeTrace trace;
+
+    CHECK(trace.format() == "trace:");
+
+    trace.batch = 4;
+    trace.steps.push_back(traceStep(0, 1520, 1410, 0.213f));
+    trace.steps.push_back(traceStep(1, 800, 700, 0.9f));
+    CHECK(trace.format() == "trace: p0 1520us wait 1410us margin 0.213 batch 4, p1 800us wait 700us margin 0.900");
+
+    // a cache hit has no submits of its own
+    CascadeTrace cached;
+
+    cached.cached = true;
+    cached.batch = 4;
+    cached.steps.push_back(traceStep(1, 0, 0, 0.9f));
+    CHECK(cached.format() == "trace: cached, p1 margin 0.900");
+}
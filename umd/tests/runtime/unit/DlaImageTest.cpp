@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+
+#include "DlaImage.h"
+#include "DlaImageUtils.h"
+#include "half.h"
+#include "nvdla_os_inf.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+// a w x h x c feature surface of atom-channel groups with packed strides
+void featureImage(NvDlaImage* image, NvDlaImage::PixelFormat format, NvU32 atom, NvU32 bpe,
+                  NvU32 w, NvU32 h, NvU32 c, std::vector<NvU8>* data)
+{
+    std::memset(&image->m_meta, 0, sizeof(image->m_meta));
+    image->m_meta.surfaceFormat = format;
+    image->m_meta.width = w;
+    image->m_meta.height = h;
+    image->m_meta.channel = c;
+    image->m_meta.lineStride = w * atom * bpe;
+    image->m_meta.surfaceStride = h * image->m_meta.lineStride;
+    image->m_meta.size = ((c + atom - 1) / atom) * image->m_meta.surfaceStride;
+
+    data->assign(image->m_meta.size, 0);
+    image->m_pData = &(*data)[0];
+}
+
+void putHalf(NvDlaImage* image, NvU32 x, NvU32 y, NvU32 c, float value)
+{
+    half_float::half h(value);
+
+    std::memcpy(static_cast<NvU8*>(image->m_pData) + image->getAddrOffset(x, y, c), &h, sizeof(h));
+}
+
+float elementValue(NvU32 x, NvU32 y, NvU32 c)
+{
+    return float(c * 100 + y * 10 + x);
+}
+
+NvS8 int8Value(NvU32 x, NvU32 y, NvU32 c)
+{
+    return NvS8(int(c * 5 + y * 3 + x) - 100);
+}
+
+}
+
+// 20 channels over two x16 groups, the second one partly used
+UNIT_TEST(dlaImageHalfToFloat)
+{
+    const NvU32 w = 3, h = 2, c = 20;
+    NvDlaImage image;
+    std::vector<NvU8> data;
+    std::vector<NvF32> nchw, nhwc(w * h * c);
+
+    featureImage(&image, NvDlaImage::D_F16_CxHWx_x16_F, 16, 2, w, h, c, &data);
+    for (NvU32 ci = 0; ci < c; ci++)
+        for (NvU32 y = 0; y < h; y++)
+            for (NvU32 x = 0; x < w; x++)
+                putHalf(&image, x, y, ci, elementValue(x, y, ci));
+
+    CHECK_EQ(image.to_float(&nchw), NvDlaSuccess);
+    CHECK_EQ(image.to_float(&nhwc[0], nhwc.size(), NvDlaImage::ORDER_NHWC), NvDlaSuccess);
+    CHECK_EQ(nchw.size(), size_t(w * h * c));
+
+    for (NvU32 ci = 0; ci < c; ci++)
+        for (NvU32 y = 0; y < h; y++)
+            for (NvU32 x = 0; x < w; x++)
+            {
+                CHECK_EQ(nchw[(ci * h + y) * w + x], elementValue(x, y, ci));
+                CHECK_EQ(nhwc[(y * w + x) * c + ci], elementValue(x, y, ci));
+            }
+
+    // canonicalized like the stable hash: -0 to +0, NaN to +inf
+    putHalf(&image, 0, 0, 0, -0.0f);
+    putHalf(&image, 1, 0, 0, NAN);
+    CHECK_EQ(image.to_float(&nchw), NvDlaSuccess);
+    CHECK(!std::signbit(nchw[0]));
+    CHECK(std::isinf(nchw[1]) && nchw[1] > 0);
+
+    CHECK_EQ(image.to_float(&nhwc[0], nhwc.size() - 1, NvDlaImage::ORDER_NCHW), NvDlaError_BadParameter);
+}
+
+// 40 channels over two x32 groups, signed
+UNIT_TEST(dlaImageInt8ToFloat)
+{
+    const NvU32 w = 3, h = 2, c = 40;
+    NvDlaImage image;
+    std::vector<NvU8> data;
+    std::vector<NvF32> nchw, nhwc(w * h * c);
+
+    featureImage(&image, NvDlaImage::D_F8_CxHWx_x32_I, 32, 1, w, h, c, &data);
+    for (NvU32 ci = 0; ci < c; ci++)
+        for (NvU32 y = 0; y < h; y++)
+            for (NvU32 x = 0; x < w; x++)
+                data[image.getAddrOffset(x, y, ci)] = NvU8(int8Value(x, y, ci));
+
+    CHECK_EQ(image.to_float(&nchw), NvDlaSuccess);
+    CHECK_EQ(image.to_float(&nhwc[0], nhwc.size(), NvDlaImage::ORDER_NHWC), NvDlaSuccess);
+
+    for (NvU32 ci = 0; ci < c; ci++)
+        for (NvU32 y = 0; y < h; y++)
+            for (NvU32 x = 0; x < w; x++)
+            {
+                CHECK_EQ(nchw[(ci * h + y) * w + x], NvF32(int8Value(x, y, ci)));
+                CHECK_EQ(nhwc[(y * w + x) * c + ci], NvF32(int8Value(x, y, ci)));
+            }
+
+    // a surface that does not fit its size is refused
+    image.m_meta.size -= 1;
+    CHECK_EQ(image.to_float(&nchw), NvDlaError_BadValue);
+}
+
+// --rawdump writes the converted values as text
+UNIT_TEST(dlaImageRawDumpIsFloatText)
+{
+    char path[] = "/tmp/dimgXXXXXX";
+    int fd = mkstemp(path);
+    NvDlaImage image;
+    std::vector<NvU8> data;
+    std::stringstream text;
+
+    CHECK(fd >= 0);
+    close(fd);
+
+    featureImage(&image, NvDlaImage::D_F16_CxHWx_x16_F, 16, 2, 2, 1, 2, &data);
+    putHalf(&image, 0, 0, 0, 1.5f);
+    putHalf(&image, 1, 0, 0, -2.0f);
+    putHalf(&image, 0, 0, 1, -0.0f);
+    putHalf(&image, 1, 0, 1, 0.25f);
+
+    CHECK_EQ(DIMG2DIMGFile(&image, path, true, true), NvDlaSuccess);
+    text << std::ifstream(path).rdbuf();
+    CHECK(text.str() == "1.5 -2 0 0.25 ");
+
+    unlink(path);
+}
+
+// written and read back through a .dimg file, layout and values intact
+UNIT_TEST(dlaImageFileRoundTrip)
+{
+    char path[] = "/tmp/dimgXXXXXX";
+    int fd = mkstemp(path);
+    NvDlaImage image, back;
+    std::vector<NvU8> data;
+    std::vector<NvF32> expected, values;
+
+    CHECK(fd >= 0);
+    close(fd);
+
+    featureImage(&image, NvDlaImage::D_F8_CxHWx_x32_I, 32, 1, 3, 2, 40, &data);
+    for (NvU32 ci = 0; ci < 40; ci++)
+        for (NvU32 y = 0; y < 2; y++)
+            for (NvU32 x = 0; x < 3; x++)
+                data[image.getAddrOffset(x, y, ci)] = NvU8(int8Value(x, y, ci));
+
+    CHECK_EQ(DIMG2DIMGFile(&image, path, false, false), NvDlaSuccess);
+    back.m_pData = NULL;
+    CHECK_EQ(DIMGFile2DIMG(path, &back), NvDlaSuccess);
+    CHECK(std::memcmp(&back.m_meta, &image.m_meta, sizeof(image.m_meta)) == 0);
+
+    if (back.m_pData)
+    {
+        CHECK_EQ(image.to_float(&expected), NvDlaSuccess);
+        CHECK_EQ(back.to_float(&values), NvDlaSuccess);
+        CHECK(values == expected);
+        NvDlaFree(back.m_pData);
+    }
+
+    // a short file is refused, not read past its end
+    CHECK_EQ(truncate(path, 4 + sizeof(NvU32) + sizeof(image.m_meta) + 100), 0);
+    back.m_pData = NULL;
+    CHECK_EQ(DIMGFile2DIMG(path, &back), NvDlaError_BadParameter);
+    CHECK(back.m_pData == NULL);
+
+    unlink(path);
+}
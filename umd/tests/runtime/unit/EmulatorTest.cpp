@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+
+#include "priv/Emulator.h"
+#include "priv/emu/emu1/A/emu_interface.h"
+
+#include "half.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace nvdla::priv;
+using half_float::half;
+
+namespace
+{
+
+// a cube over two surfaces, strides padded past the packed size
+const NvU32 kWidth = 3;
+const NvU32 kHeight = 2;
+const NvU32 kChannel = 20;
+const NvU32 kLineStride = kWidth * 32 + 32;
+const NvU32 kSurfStride = kHeight * kLineStride + 64;
+const NvU32 kCubeSize = ((kChannel + 15) / 16) * kSurfStride;
+
+class EmulatorProbe : public Emulator
+{
+public:
+    using Emulator::runSoftmax;
+    using Emulator::processTask;
+};
+
+NvU32 featureOffset(NvU32 w, NvU32 h, NvU32 c)
+{
+    return (c / 16) * kSurfStride + h * kLineStride + w * 32 + (c % 16) * 2;
+}
+
+// distinct values, exact in fp16
+float featureInput(NvU32 w, NvU32 h, NvU32 c)
+{
+    NvU32 flat = (c * kHeight + h) * kWidth + w;
+
+    return float((flat * 37) % 127) / 16.0f - 3.0f;
+}
+
+void fillCube(std::vector<NvU8>* cube)
+{
+    cube->assign(kCubeSize, 0);
+    for ( NvU32 c = 0; c < kChannel; c++ ) {
+        for ( NvU32 h = 0; h < kHeight; h++ ) {
+            for ( NvU32 w = 0; w < kWidth; w++ ) {
+                *reinterpret_cast<half *>(&(*cube)[featureOffset(w, h, c)]) = half(featureInput(w, h, c));
+            }
+        }
+    }
+}
+
+void describe(emu_buffer_desc *desc, NvS16 addressIndex)
+{
+    desc->addressIndex = addressIndex;
+    desc->size = kCubeSize;
+    desc->format = NvU16(EMUBufferType::DLA_FEATURE_FP16_FORMAT);
+    desc->width = kWidth;
+    desc->height = kHeight;
+    desc->channel = kChannel;
+    desc->line_stride = kLineStride;
+    desc->surf_stride = kSurfStride;
+}
+
+NvDlaError runSoftmax(NvU8 axis, std::vector<NvU8>* out)
+{
+    EmulatorProbe emulator;
+    EMUInterfaceA emuIf;
+    emu_operation_buffer_container bufs;
+    std::vector<NvU8> in;
+    NvU8 *addressList[2];
+
+    fillCube(&in);
+    out->assign(kCubeSize, 0);
+    std::memset(&bufs, 0, sizeof(bufs));
+    describe(&bufs.softmax_buffers.src_data, 0);
+    describe(&bufs.softmax_buffers.dst_data, 1);
+    addressList[0] = &in[0];
+    addressList[1] = &(*out)[0];
+
+    EMUSoftmaxBufferDescsAccessor descs =
+        emuIf.operationBufferContainerAccessor(reinterpret_cast<NvU8 *>(&bufs)).softmaxBufferDescsAccessor(0);
+
+    return emulator.runSoftmax(descs.srcDataAccessor(), descs.dstDataAccessor(), axis, NULL, 0, addressList);
+}
+
+// one softmax op laid out as a task: network, ops, buffers, src, dst
+struct SoftmaxTask
+{
+    emu_network_desc network;
+    emu_operation_container ops;
+    emu_operation_buffer_container bufs;
+    std::vector<NvU8> in;
+    std::vector<NvU8> out;
+    NvU8 *addressList[5];
+    emu_task_desc desc;
+
+    explicit SoftmaxTask(NvU8 axis)
+    {
+        fillCube(&in);
+        out.assign(kCubeSize, 0);
+        std::memset(&network, 0, sizeof(network));
+        std::memset(&ops, 0, sizeof(ops));
+        std::memset(&bufs, 0, sizeof(bufs));
+        std::memset(&desc, 0, sizeof(desc));
+        network.operation_desc_index = 1;
+        network.operation_buffer_desc_index = 2;
+        network.num_operations = 1;
+        ops.softmax_op.common.op_type = NVDLA_EMU_OP_SOFTMAX;
+        ops.softmax_op.axis = axis;
+        describe(&bufs.softmax_buffers.src_data, 3);
+        describe(&bufs.softmax_buffers.dst_data, 4);
+        addressList[0] = reinterpret_cast<NvU8 *>(&network);
+        addressList[1] = reinterpret_cast<NvU8 *>(&ops);
+        addressList[2] = reinterpret_cast<NvU8 *>(&bufs);
+        addressList[3] = &in[0];
+        addressList[4] = &out[0];
+
+        // the submitted form carries the mapped addresses
+        desc.num_addresses = 5;
+        for ( NvU32 ii = 0; ii < 5; ii++ ) {
+            desc.address_list[ii].hMem = addressList[ii];
+            desc.address_list[ii].offset = 0;
+        }
+    }
+
+    NvU8 *taskMem() { return reinterpret_cast<NvU8 *>(&desc); }
+
+private:
+    SoftmaxTask(const SoftmaxTask &);
+    SoftmaxTask &operator=(const SoftmaxTask &);
+};
+
+}
+
+// softmax along C, H and W against a scalar reference in double, axis 0
+// runs along C as it did before the axis was honoured
+UNIT_TEST(emulatorSoftmaxAxes)
+{
+    for ( NvU8 axis = 0; axis <= 3; axis++ )
+    {
+        std::vector<NvU8> out;
+        NvU32 length = axis <= 1 ? kChannel : axis == 2 ? kHeight : kWidth;
+        float worst = 0.0f;
+
+        CHECK_EQ(runSoftmax(axis, &out), NvDlaSuccess);
+
+        for ( NvU32 c = 0; c < kChannel; c++ ) {
+            for ( NvU32 h = 0; h < kHeight; h++ ) {
+                for ( NvU32 w = 0; w < kWidth; w++ ) {
+                    double maxval = -INFINITY, sum = 0.0;
+
+                    for ( NvU32 i = 0; i < length; i++ ) {
+                        maxval = std::max(maxval, double(featureInput(axis == 3 ? i : w, axis == 2 ? i : h, axis <= 1 ? i : c)));
+                    }
+                    for ( NvU32 i = 0; i < length; i++ ) {
+                        sum += std::exp(double(featureInput(axis == 3 ? i : w, axis == 2 ? i : h, axis <= 1 ? i : c)) - maxval);
+                    }
+
+                    double expected = std::exp(double(featureInput(w, h, c)) - maxval) / sum;
+                    float actual = float(*reinterpret_cast<const half *>(&out[featureOffset(w, h, c)]));
+
+                    worst = std::max(worst, float(std::fabs(actual - expected)));
+                }
+            }
+        }
+
+        // within fp16 rounding of a probability
+        if ( worst > 1e-3f ) {
+            std::printf("axis %u: off by %g\n", axis, worst);
+        }
+        CHECK(worst <= 1e-3f);
+    }
+
+    std::vector<NvU8> out;
+    CHECK(runSoftmax(4, &out) != NvDlaSuccess);
+}
+
+// a loadable's softmax op with axis 0 gives the channel softmax
+UNIT_TEST(emulatorSoftmaxTaskAxisZero)
+{
+    std::vector<NvU8> channel;
+    EmulatorProbe emulator;
+    SoftmaxTask task(0);
+
+    CHECK_EQ(runSoftmax(1, &channel), NvDlaSuccess);
+    CHECK(emulator.processTask(NULL, task.addressList));
+    CHECK(task.out == channel);
+}
+
+// a failed op fails the task and the blocking submit that waits on it
+UNIT_TEST(emulatorSubmitReportsFailedTask)
+{
+    EmulatorProbe emulator;
+    SoftmaxTask bad(4), good(1), after(1);
+    std::vector<NvU8> channel;
+
+    CHECK(!emulator.processTask(NULL, bad.addressList));
+
+    CHECK_EQ(emulator.start(), NvDlaSuccess);
+    CHECK_EQ(emulator.submit(bad.taskMem(), false), NvDlaSuccess);
+    CHECK(emulator.submit(good.taskMem(), true) != NvDlaSuccess);
+
+    // the failure is reported once, later tasks still run
+    CHECK_EQ(emulator.submit(after.taskMem(), true), NvDlaSuccess);
+    CHECK(emulator.stop());
+
+    CHECK_EQ(runSoftmax(1, &channel), NvDlaSuccess);
+    CHECK(good.out == channel);
+    CHECK(after.out == channel);
+}
+
+// an int8 power op goes through the lookup table, which is only built
+// once the op's descriptors have been accepted
+UNIT_TEST(emulatorInt8PowerLookup)
+{
+    EmulatorProbe emulator;
+    emu_network_desc network;
+    emu_operation_container ops;
+    emu_operation_buffer_container bufs;
+    std::vector<NvU8> in(kSurfStride, 0), out(kSurfStride, 0);
+    NvU8 *addressList[5];
+
+    for ( NvU32 c = 0; c < kChannel; c++ ) {
+        for ( NvU32 h = 0; h < kHeight; h++ ) {
+            for ( NvU32 w = 0; w < kWidth; w++ ) {
+                in[h * kLineStride + w * 32 + c] = NvU8(NvS8(NvS32(c * 13 + h * 7 + w) - 100));
+            }
+        }
+    }
+
+    std::memset(&network, 0, sizeof(network));
+    std::memset(&ops, 0, sizeof(ops));
+    std::memset(&bufs, 0, sizeof(bufs));
+    network.operation_desc_index = 1;
+    network.operation_buffer_desc_index = 2;
+    network.num_operations = 1;
+    ops.power_op.common.op_type = NVDLA_EMU_OP_POWER;
+    ops.power_op.power = 1.0f;
+    ops.power_op.scale = 2.0f;
+    ops.power_op.shift = 1.0f;
+    describe(&bufs.power_buffers.src_data, 3);
+    describe(&bufs.power_buffers.dst_data, 4);
+    bufs.power_buffers.src_data.format = NvU16(EMUBufferType::DLA_FEATURE_INT8_FORMAT);
+    bufs.power_buffers.src_data.size = kSurfStride;
+    bufs.power_buffers.dst_data.size = kSurfStride;
+    addressList[0] = reinterpret_cast<NvU8 *>(&network);
+    addressList[1] = reinterpret_cast<NvU8 *>(&ops);
+    addressList[2] = reinterpret_cast<NvU8 *>(&bufs);
+    addressList[3] = &in[0];
+    addressList[4] = &out[0];
+
+    // an fp16 destination is refused before any table is made, the first
+    // task only sizes the op pools
+    CHECK(!emulator.processTask(NULL, addressList));
+    NvU64 warm = emulator.numAllocations();
+    CHECK(!emulator.processTask(NULL, addressList));
+    CHECK_EQ(emulator.numAllocations(), warm);
+
+    bufs.power_buffers.dst_data.format = NvU16(EMUBufferType::DLA_FEATURE_INT8_FORMAT);
+    CHECK(emulator.processTask(NULL, addressList));
+    CHECK_EQ(emulator.numAllocations(), warm + 1);
+
+    for ( NvU32 c = 0; c < kChannel; c++ ) {
+        for ( NvU32 h = 0; h < kHeight; h++ ) {
+            for ( NvU32 w = 0; w < kWidth; w++ ) {
+                NvS32 x = NvS8(in[h * kLineStride + w * 32 + c]);
+                NvS32 expected = std::min(std::max(2 * x + 1, -128), 127);
+
+                CHECK_EQ(NvS32(NvS8(out[h * kLineStride + w * 32 + c])), expected);
+            }
+        }
+    }
+
+    // the same op again reuses the table
+    CHECK(emulator.processTask(NULL, addressList));
+    CHECK_EQ(emulator.numAllocations(), warm + 1);
+}
+
+// the k most probable entries of the whole cube, in (c, h, w) order
+UNIT_TEST(emulatorTopKMatchesReference)
+{
+    const NvU32 k = 5;
+    const NvU32 total = kWidth * kHeight * kChannel;
+    std::vector<NvU8> cube;
+    std::vector<double> logits(total);
+    std::vector<NvU32> order(total);
+    NvU32 index[Emulator::TOPK_MAX], numOut = 0;
+    NvF32 prob[Emulator::TOPK_MAX], margin = 0.0f;
+    double maxval = -INFINITY, sum = 0.0;
+
+    fillCube(&cube);
+    for ( NvU32 c = 0; c < kChannel; c++ ) {
+        for ( NvU32 h = 0; h < kHeight; h++ ) {
+            for ( NvU32 w = 0; w < kWidth; w++ ) {
+                NvU32 flat = (c * kHeight + h) * kWidth + w;
+
+                logits[flat] = featureInput(w, h, c);
+                order[flat] = flat;
+                maxval = std::max(maxval, logits[flat]);
+            }
+        }
+    }
+    for ( NvU32 i = 0; i < total; i++ ) {
+        sum += std::exp(logits[i] - maxval);
+    }
+    std::sort(order.begin(), order.end(), [&](NvU32 a, NvU32 b) { return logits[a] > logits[b]; });
+
+    CHECK_EQ(Emulator::topK(&cube[0], NvU16(EMUBufferType::DLA_FEATURE_FP16_FORMAT), kWidth, kHeight, kChannel,
+                            kLineStride, kSurfStride, k, &numOut, index, prob, &margin), NvDlaSuccess);
+    CHECK_EQ(numOut, k);
+
+    for ( NvU32 i = 0; i < std::min(numOut, k); i++ ) {
+        double expected = std::exp(logits[order[i]] - maxval) / sum;
+
+        CHECK_EQ(index[i], order[i]);
+        CHECK(std::fabs(prob[i] - expected) <= 1e-5);
+    }
+    CHECK(std::fabs(margin - (prob[0] - prob[1])) <= 1e-6f);
+
+    // k past the cube is clamped, zero is refused
+    CHECK_EQ(Emulator::topK(&cube[0], NvU16(EMUBufferType::DLA_FEATURE_FP16_FORMAT), 1, 1, 2,
+                            kLineStride, kSurfStride, k, &numOut, index, prob, &margin), NvDlaSuccess);
+    CHECK_EQ(numOut, 2U);
+    CHECK(Emulator::topK(&cube[0], NvU16(EMUBufferType::DLA_FEATURE_FP16_FORMAT), kWidth, kHeight, kChannel,
+                         kLineStride, kSurfStride, 0, &numOut, index, prob, &margin) != NvDlaSuccess);
+}
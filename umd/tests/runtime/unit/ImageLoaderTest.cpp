@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+#include "PortStub.h"
+#include "TestLoadable.h"
+
+#include "ImageLoader.h"
+#ifndef RUNTIME_TEST_H
+#define RUNTIME_TEST_H
+#include "RuntimeTest.h"
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+namespace
+{
+
+const NvU32 kAtom = 32;
+
+// a 2x1 binary PGM of pixels a, b
+std::string writePgm(const std::string& dir, NvU32 i, NvU8 a, NvU8 b)
+{
+    char name[32];
+    std::string path;
+
+    snprintf(name, sizeof(name), "/%u.pgm", i);
+    path = dir + name;
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f)
+    {
+        fprintf(f, "P5\n2 1\n255\n%c%c", a, b);
+        fclose(f);
+    }
+
+    return path;
+}
+
+}
+
+// items come out in list order through a ring smaller than the list, and
+// an image that fails to decode still takes its turn
+UNIT_TEST(imageLoaderKeepsListOrder)
+{
+    const NvU32 numImages = 7;
+    const NvU32 missing = 3;
+    char dir[] = "/tmp/loaderXXXXXX";
+    std::vector<NvU8> loadable = buildTestLoadable(1, false);
+    nvdla::IRuntime* runtime = nvdla::createRuntime();
+    nvdla::IRuntime::NvDlaTensor tensor;
+    std::vector<std::string> images;
+    TestAppArgs args;
+    PreprocessParams params;
+    ImageLoader::Item item;
+
+    CHECK(mkdtemp(dir) != NULL);
+    for (NvU32 i = 0; i < numImages; i++)
+    {
+        if (i == missing)
+            images.push_back(std::string(dir) + "/missing.pgm");
+        else
+            images.push_back(writePgm(dir, i, NvU8(i * 10), NvU8(i * 10 + 5)));
+    }
+
+    std::memset(&tensor, 0, sizeof(tensor));
+    tensor.dims.n = 1;
+    tensor.dims.c = 1;
+    tensor.dims.h = 1;
+    tensor.dims.w = 2;
+    tensor.dataType = TENSOR_DATA_TYPE_INT8;
+    tensor.stride[1] = 2 * kAtom;
+    tensor.stride[2] = 2 * kAtom;
+    tensor.bufferSize = 2 * kAtom;
+
+    // q = x
+    args.inputScale = 1.0f / 255.0f;
+    initPreprocessParams(&args, &params);
+
+    CHECK(runtime->load(&loadable[0], 0));
+
+    {
+        ImageLoader loader(runtime, tensor, params);
+
+        CHECK_EQ(loader.start(&images, 2, 2), NvDlaSuccess);
+
+        for (NvU32 i = 0; i < numImages; i++)
+        {
+            CHECK(loader.next(&item));
+            CHECK_EQ(item.image, i);
+
+            if (i == missing)
+            {
+                CHECK(item.status != NvDlaSuccess);
+            }
+            else
+            {
+                const NvU8* data = static_cast<const NvU8*>(item.data);
+
+                CHECK_EQ(item.status, NvDlaSuccess);
+                CHECK_EQ(NvU32(data[0]), i * 10);
+                CHECK_EQ(NvU32(data[kAtom]), i * 10 + 5);
+            }
+            loader.release();
+        }
+        CHECK(!loader.next(&item));
+    }
+
+    runtime->unload();
+    nvdla::destroyRuntime(runtime);
+    CHECK_EQ(gStubAllocations, 0);
+
+    for (NvU32 i = 0; i < numImages; i++)
+        unlink(images[i].c_str());
+    rmdir(dir);
+}
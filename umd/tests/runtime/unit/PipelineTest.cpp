@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+
+#include "Pipeline.h"
+#include "main.h"
+
+#include <cstring>
+
+namespace
+{
+
+nvdla::IRuntime::NvDlaTopK topkWithMargin(NvF32 margin)
+{
+    nvdla::IRuntime::NvDlaTopK topk;
+
+    std::memset(&topk, 0, sizeof(topk));
+    topk.k = 2;
+    topk.prob[0] = 0.5f + margin / 2;
+    topk.prob[1] = 0.5f - margin / 2;
+    topk.margin = margin;
+
+    return topk;
+}
+
+}
+
+// an unsure result moves on while there is a loadable left to ask
+UNIT_TEST(pipelineEscalatesUnsureResults)
+{
+    nvdla::IRuntime::NvDlaTopK unsure = topkWithMargin(CONF_THRESH / 2);
+    nvdla::IRuntime::NvDlaTopK sure = topkWithMargin((1 + CONF_THRESH) / 2);
+
+    CHECK(shouldEscalate(unsure, 0, 2));
+    CHECK(shouldEscalate(unsure, 1, 3));
+    CHECK(!shouldEscalate(unsure, 1, 2));
+    CHECK(!shouldEscalate(unsure, 0, 1));
+
+    CHECK(!shouldEscalate(sure, 0, 2));
+    CHECK(!shouldEscalate(sure, 0, 1));
+}
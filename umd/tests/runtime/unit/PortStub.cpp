@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "PortStub.h"
+
+#include <cstring>
+
+std::mutex gStubMutex;
+std::vector<std::vector<StubTask> > gStubSubmits;
+int gStubAllocations;
+
+namespace
+{
+
+int gDevice;
+
+}
+
+extern "C" {
+
+NvDlaError NvDlaInitialize(void **session_handle)
+{
+    *session_handle = &gDevice;
+    return NvDlaSuccess;
+}
+
+void NvDlaDestroy(void *session_handle)
+{
+}
+
+NvDlaError NvDlaOpen(void *session_handle, NvU32 instance, void **device_handle)
+{
+    *device_handle = &gDevice;
+    return NvDlaSuccess;
+}
+
+void NvDlaClose(void *device_handle)
+{
+}
+
+NvDlaError NvDlaAllocMem(void *session_handle, void *device_handle, void **mem_handle, void **pData,
+                         NvU32 size, NvDlaHeap heap)
+{
+    std::lock_guard<std::mutex> lock(gStubMutex);
+    StubMem *mem = new StubMem;
+
+    mem->data = new NvU8[size];
+    mem->size = size;
+    std::memset(mem->data, 0, size);
+
+    *mem_handle = mem;
+    *pData = mem->data;
+    gStubAllocations++;
+    return NvDlaSuccess;
+}
+
+NvDlaError NvDlaFreeMem(void *session_handle, void *device_handle, void *mem_handle, void *pData, NvU32 size)
+{
+    std::lock_guard<std::mutex> lock(gStubMutex);
+    StubMem *mem = (StubMem *)mem_handle;
+
+    delete[] mem->data;
+    delete mem;
+    gStubAllocations--;
+    return NvDlaSuccess;
+}
+
+NvDlaError NvDlaGetMemFd(void *device_handle, void *mem_handle, NvS32 *fd)
+{
+    *fd = -1;
+    return NvDlaSuccess;
+}
+
+// like the firmware, the first address of every task is a dependency graph it eats
+NvDlaError NvDlaSubmit(void *session_handle, void *device_handle, NvDlaTask *tasks, NvU32 num_tasks)
+{
+    std::lock_guard<std::mutex> lock(gStubMutex);
+
+    gStubSubmits.push_back(std::vector<StubTask>(num_tasks));
+
+    for ( NvU32 ti = 0; ti < num_tasks; ti++ )
+    {
+        StubTask &task = gStubSubmits.back()[ti];
+
+        task.id = tasks[ti].task_id;
+        for ( NvU32 ai = 0; ai < tasks[ti].num_addresses; ai++ ) {
+            task.handles.push_back(tasks[ti].address_list[ai].handle);
+            task.offsets.push_back(tasks[ti].address_list[ai].offset);
+        }
+
+        StubMem *graph = (StubMem *)tasks[ti].address_list[0].handle;
+        task.firstMem.assign(graph->data, graph->data + graph->size);
+    }
+
+    for ( NvU32 ti = 0; ti < num_tasks; ti++ ) {
+        StubMem *graph = (StubMem *)tasks[ti].address_list[0].handle;
+        std::memset(graph->data, 0, graph->size);
+    }
+
+    return NvDlaSuccess;
+}
+
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+
+#include "Preprocess.h"
+#ifndef RUNTIME_TEST_H
+#define RUNTIME_TEST_H
+#include "RuntimeTest.h"
+#endif
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+const NvU32 kAtom = 32;
+
+// a 1-channel w x h feature tensor with packed strides
+nvdla::IRuntime::NvDlaTensor featureTensor(NvU32 w, NvU32 h, NvU8 dataType)
+{
+    nvdla::IRuntime::NvDlaTensor tensor;
+
+    std::memset(&tensor, 0, sizeof(tensor));
+    tensor.dims.n = 1;
+    tensor.dims.c = 1;
+    tensor.dims.h = h;
+    tensor.dims.w = w;
+    tensor.dataType = dataType;
+    tensor.stride[1] = w * kAtom;
+    tensor.stride[2] = w * h * kAtom;
+    tensor.bufferSize = w * h * kAtom;
+
+    return tensor;
+}
+
+// a grey image borrowing pixels
+NvDlaImage greyImage(NvU32 w, NvU32 h, NvU8* pixels)
+{
+    NvDlaImage image;
+
+    image.m_meta.surfaceFormat = NvDlaImage::T_R8;
+    image.m_meta.width = w;
+    image.m_meta.height = h;
+    image.m_meta.channel = 1;
+    image.m_meta.lineStride = w;
+    image.m_meta.surfaceStride = 0;
+    image.m_meta.size = w * h;
+    image.m_pData = pixels;
+
+    return image;
+}
+
+// packs pixels into a w x h int8 tensor with q = x, -1 on failure
+std::vector<NvS32> packInt8(const TestAppArgs& base, NvDlaImage* image, NvU32 w, NvU32 h)
+{
+    TestAppArgs args = base;
+    PreprocessParams params;
+    nvdla::IRuntime::NvDlaTensor tensor = featureTensor(w, h, TENSOR_DATA_TYPE_INT8);
+    std::vector<NvU8> out(tensor.bufferSize, 0xff);
+    std::vector<NvS32> values;
+
+    args.inputScale = 1.0f / 255.0f;
+    initPreprocessParams(&args, &params);
+    if (packImageToTensor(image, &params, &tensor, &out[0]) != NvDlaSuccess)
+        return std::vector<NvS32>(w * h, -1);
+
+    for (NvU32 y = 0; y < h; y++)
+        for (NvU32 x = 0; x < w; x++)
+            values.push_back(NvS8(out[y * tensor.stride[1] + x * kAtom]));
+
+    return values;
+}
+
+}
+
+// int8 tensors take the quantization from the command line, never a guess
+UNIT_TEST(preprocessInt8NeedsInputScale)
+{
+    TestAppArgs args;
+    PreprocessParams params;
+    NvU8 pixels[2] = { 0, 255 };
+    NvDlaImage image = greyImage(2, 1, pixels);
+    nvdla::IRuntime::NvDlaTensor tensor = featureTensor(2, 1, TENSOR_DATA_TYPE_INT8);
+    std::vector<NvU8> out(tensor.bufferSize, 0xff);
+
+    initPreprocessParams(&args, &params);
+    CHECK(packImageToTensor(&image, &params, &tensor, &out[0]) != NvDlaSuccess);
+
+    // y = x / 255 by default, q = y / (1 / 128) - 64
+    args.inputScale = 1.0f / 128.0f;
+    args.inputOffset = -64.0f;
+    initPreprocessParams(&args, &params);
+    CHECK_EQ(packImageToTensor(&image, &params, &tensor, &out[0]), NvDlaSuccess);
+    CHECK_EQ(NvS32(NvS8(out[0])), -64);
+    CHECK_EQ(NvS32(NvS8(out[kAtom])), 64);
+    CHECK_EQ(out[1], 0);
+}
+
+// auto takes the area filter to shrink and bilinear, centers aligned, to grow
+UNIT_TEST(preprocessResizeKnownPixels)
+{
+    TestAppArgs args;
+    NvU8 wide[4] = { 10, 30, 50, 70 };
+    NvU8 narrow[2] = { 10, 30 };
+    NvDlaImage shrink = greyImage(4, 1, wide);
+    NvDlaImage grow = greyImage(2, 1, narrow);
+    std::vector<NvS32> values;
+
+    values = packInt8(args, &shrink, 2, 1);
+    CHECK_EQ(values[0], 20);
+    CHECK_EQ(values[1], 60);
+
+    values = packInt8(args, &grow, 4, 1);
+    CHECK_EQ(values[0], 10);
+    CHECK_EQ(values[1], 15);
+    CHECK_EQ(values[2], 25);
+    CHECK_EQ(values[3], 30);
+
+    // bilinear on a 2:1 shrink lands between pixel pairs
+    args.resizeFilter = "bilinear";
+    values = packInt8(args, &shrink, 2, 1);
+    CHECK_EQ(values[0], 20);
+    CHECK_EQ(values[1], 60);
+}
+
+// a 4x2 source into a 2x2 tensor
+UNIT_TEST(preprocessFitModes)
+{
+    TestAppArgs args;
+    NvU8 pixels[8] = { 10, 20, 30, 40,
+                       50, 60, 70, 80 };
+    NvDlaImage image = greyImage(4, 2, pixels);
+    std::vector<NvS32> values;
+
+    // both axes resized on their own
+    values = packInt8(args, &image, 2, 2);
+    CHECK_EQ(values[0], 15);
+    CHECK_EQ(values[1], 35);
+    CHECK_EQ(values[2], 55);
+    CHECK_EQ(values[3], 75);
+
+    // full height, the middle two columns
+    args.fitMode = "crop";
+    values = packInt8(args, &image, 2, 2);
+    CHECK_EQ(values[0], 20);
+    CHECK_EQ(values[1], 30);
+    CHECK_EQ(values[2], 60);
+    CHECK_EQ(values[3], 70);
+
+    // halved into the top row, the bottom one zeroed
+    args.fitMode = "letterbox";
+    values = packInt8(args, &image, 2, 2);
+    CHECK_EQ(values[0], 35);
+    CHECK_EQ(values[1], 55);
+    CHECK_EQ(values[2], 0);
+    CHECK_EQ(values[3], 0);
+}
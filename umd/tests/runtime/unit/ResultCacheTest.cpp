@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+
+#include "ResultCache.h"
+
+#include <cstring>
+#include <vector>
+
+// a hit needs the stored input bytes to match, an equal hash is not enough
+UNIT_TEST(resultCacheChecksInputOnHit)
+{
+    ResultCache cache(1 << 20);
+    std::vector<NvU8> input(256), other(256), output(64, 0x5a), copy;
+    nvdla::IRuntime::NvDlaTopK topk, found;
+    NvU32 part = 0;
+
+    for ( NvU32 i = 0; i < input.size(); i++ ) {
+        input[i] = NvU8(i);
+        other[i] = NvU8(255 - i);
+    }
+    std::memset(&topk, 0, sizeof(topk));
+    topk.k = 1;
+    topk.index[0] = 7;
+    topk.margin = 0.75f;
+
+    ResultCache::Key key = ResultCache::makeKey(42, &input[0], input.size());
+    CHECK(!cache.lookupCopy(key, &input[0], &part, &found, &copy));
+    cache.insert(key, &input[0], 1, topk, &output[0], output.size());
+
+    CHECK(cache.lookupCopy(key, &input[0], &part, &found, &copy));
+    CHECK_EQ(part, 1U);
+    CHECK_EQ(found.index[0], 7U);
+    CHECK(copy == output);
+
+    // the same key presented with other bytes, as a hash collision would
+    CHECK(!cache.lookupCopy(key, &other[0], &part, &found, &copy));
+    CHECK(!cache.lookup(key, &other[0], &part, &found, NULL));
+
+    // another cascade over the same input is a different entry
+    CHECK(!cache.lookup(ResultCache::makeKey(43, &input[0], input.size()), &input[0], &part, &found, NULL));
+
+    ResultCache::Stats stats = cache.stats();
+    CHECK_EQ(stats.hits, 1ULL);
+    CHECK_EQ(stats.misses, 4ULL);
+    CHECK_EQ(stats.entries, 1ULL);
+    CHECK(stats.bytes >= input.size() + output.size());
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+#include "PortStub.h"
+#include "TestLoadable.h"
+
+#include "nvdla/IRuntime.h"
+
+// five elements on a batch-2 loadable: three runs, all of them in one submit
+UNIT_TEST(runtimeBatchPacksRunsInOneSubmit)
+{
+    const NvU32 numBatch = 5;
+    std::vector<NvU8> loadable = buildTestLoadable(2, false);
+    nvdla::IRuntime *runtime = nvdla::createRuntime();
+    void *input = NULL, *inputData = NULL;
+    void *outputs[numBatch];
+    void *outputData;
+
+    gStubSubmits.clear();
+    CHECK(runtime->load(&loadable[0], 0));
+
+    CHECK_EQ(runtime->allocateSystemMemory(&input, numBatch * kInputSize, &inputData), NvDlaSuccess);
+    for ( NvU32 bi = 0; bi < numBatch; bi++ ) {
+        CHECK_EQ(runtime->allocateSystemMemory(&outputs[bi], kOutputSize, &outputData), NvDlaSuccess);
+    }
+    CHECK_EQ(runtime->bindInputTensorBatch(0, numBatch, input, kInputSize), NvDlaSuccess);
+    CHECK_EQ(runtime->bindOutputTensorBatch(0, numBatch, outputs), NvDlaSuccess);
+
+    for ( int pass = 0; pass < 2; pass++ )
+    {
+        gStubSubmits.clear();
+        CHECK_EQ(runtime->submitBatch(numBatch), NvDlaSuccess);
+        CHECK_EQ(gStubSubmits.size(), 1U);
+        if ( gStubSubmits.size() != 1 || gStubSubmits[0].size() != 6 ) {
+            CHECK_EQ(gStubSubmits.empty() ? 0 : gStubSubmits[0].size(), 6U);
+            break;
+        }
+
+        const std::vector<StubTask> &tasks = gStubSubmits[0];
+        for ( NvU32 run = 0; run < 3; run++ )
+        {
+            const StubTask &first = tasks[2 * run];
+            const StubTask &second = tasks[2 * run + 1];
+            NvU32 e0 = 2 * run;
+            NvU32 e1 = (2 * run + 1 < numBatch) ? 2 * run + 1 : numBatch - 1;
+
+            CHECK_EQ(first.id, 0U);
+            CHECK_EQ(second.id, 1U);
+
+            // dependency graph and scratch are the run's own, weights are shared
+            CHECK(first.handles[0] == second.handles[0]);
+            CHECK(first.handles[4] == second.handles[1]);
+            CHECK(first.handles[1] == tasks[0].handles[1]);
+            CHECK(first.firstMem == tasks[0].firstMem);
+            CHECK(first.firstMem[0] == 0x80);
+            for ( NvU32 other = 0; other < run; other++ ) {
+                CHECK(first.handles[0] != tasks[2 * other].handles[0]);
+                CHECK(first.handles[4] != tasks[2 * other].handles[4]);
+            }
+
+            // the lower offset entry is element 0 of the run
+            CHECK(first.handles[2] == input);
+            CHECK(first.handles[3] == input);
+            CHECK_EQ(first.offsets[2], e1 * kInputSize);
+            CHECK_EQ(first.offsets[3], e0 * kInputSize);
+            CHECK(second.handles[2] == outputs[e0]);
+            CHECK(second.handles[3] == outputs[e1]);
+            CHECK_EQ(second.offsets[2], 0U);
+            CHECK_EQ(second.offsets[3], 0U);
+        }
+    }
+
+    runtime->unload();
+    for ( NvU32 bi = 0; bi < numBatch; bi++ ) {
+        runtime->freeSystemMemory(outputs[bi], kOutputSize);
+    }
+    runtime->freeSystemMemory(input, numBatch * kInputSize);
+    nvdla::destroyRuntime(runtime);
+
+    CHECK_EQ(gStubAllocations, 0);
+}
+
+// with intermediates in sram there is one copy of them, so runs go one by one
+UNIT_TEST(runtimeBatchWithSramRunsInTurn)
+{
+    const NvU32 numBatch = 4;
+    std::vector<NvU8> loadable = buildTestLoadable(2, true);
+    nvdla::IRuntime *runtime = nvdla::createRuntime();
+    void *input = NULL, *output = NULL, *data = NULL;
+
+    gStubSubmits.clear();
+    CHECK(runtime->load(&loadable[0], 0));
+
+    CHECK_EQ(runtime->allocateSystemMemory(&input, numBatch * kInputSize, &data), NvDlaSuccess);
+    CHECK_EQ(runtime->allocateSystemMemory(&output, numBatch * kOutputSize, &data), NvDlaSuccess);
+    CHECK_EQ(runtime->bindInputTensorBatch(0, numBatch, input, kInputSize), NvDlaSuccess);
+    CHECK_EQ(runtime->bindOutputTensorBatch(0, numBatch, output, kOutputSize), NvDlaSuccess);
+
+    CHECK_EQ(runtime->submitBatch(numBatch), NvDlaSuccess);
+    CHECK_EQ(gStubSubmits.size(), 2U);
+
+    for ( size_t si = 0; si < gStubSubmits.size(); si++ )
+    {
+        const std::vector<StubTask> &tasks = gStubSubmits[si];
+
+        CHECK_EQ(tasks.size(), 2U);
+        if ( tasks.size() != 2 ) {
+            continue;
+        }
+        // reloaded for every run
+        CHECK(tasks[0].firstMem[0] == 0x80);
+        CHECK(tasks[0].handles[0] == gStubSubmits[0][0].handles[0]);
+        CHECK(tasks[0].handles[4] == gStubSubmits[0][0].handles[4]);
+        CHECK_EQ(tasks[0].offsets[3], 2 * si * kInputSize);
+        CHECK_EQ(tasks[1].offsets[3], (2 * si + 1) * kOutputSize);
+    }
+
+    runtime->unload();
+    runtime->freeSystemMemory(output, numBatch * kOutputSize);
+    runtime->freeSystemMemory(input, numBatch * kInputSize);
+    nvdla::destroyRuntime(runtime);
+
+    CHECK_EQ(gStubAllocations, 0);
+}
+
+// once the first submit has sized everything, later ones allocate nothing
+UNIT_TEST(runtimeSubmitAllocationsStayFlat)
+{
+    const NvU32 numBatch = 4;
+    std::vector<NvU8> loadable = buildTestLoadable(2, false);
+    nvdla::IRuntime *runtime = nvdla::createRuntime();
+    nvdla::IRuntime::NvDlaRuntimeStats stats;
+    void *input = NULL, *output = NULL, *data = NULL;
+    NvU64 warm;
+
+    CHECK(runtime->load(&loadable[0], 0));
+
+    CHECK_EQ(runtime->allocateSystemMemory(&input, numBatch * kInputSize, &data), NvDlaSuccess);
+    CHECK_EQ(runtime->allocateSystemMemory(&output, numBatch * kOutputSize, &data), NvDlaSuccess);
+    CHECK_EQ(runtime->bindInputTensorBatch(0, numBatch, input, kInputSize), NvDlaSuccess);
+    CHECK_EQ(runtime->bindOutputTensorBatch(0, numBatch, output, kOutputSize), NvDlaSuccess);
+
+    CHECK_EQ(runtime->submitBatch(numBatch), NvDlaSuccess);
+    CHECK_EQ(runtime->getStats(&stats), NvDlaSuccess);
+    warm = stats.submitAllocations;
+    // task list, run copies and the port's address list at least
+    CHECK(warm >= 3);
+
+    for ( int pass = 0; pass < 8; pass++ ) {
+        CHECK_EQ(runtime->submitBatch(pass % 2 ? numBatch : 2), NvDlaSuccess);
+    }
+    CHECK_EQ(runtime->getStats(&stats), NvDlaSuccess);
+    CHECK_EQ(stats.submitAllocations, warm);
+    CHECK_EQ(stats.numSubmits, 9U);
+
+    runtime->unload();
+    runtime->freeSystemMemory(output, numBatch * kOutputSize);
+    runtime->freeSystemMemory(input, numBatch * kInputSize);
+    nvdla::destroyRuntime(runtime);
+
+    gStubSubmits.clear();
+    CHECK_EQ(gStubAllocations, 0);
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+#include "PortStub.h"
+#include "ServerProbe.h"
+#include "TestLoadable.h"
+
+#include "RuntimeTest.h"
+
+// concurrent runs of a model go to the kernel as one submit, a run each
+UNIT_TEST(serverBatchRunsInOneSubmit)
+{
+    const NvU32 numJobs = 3;
+    TestAppArgs args;
+    std::vector<std::vector<NvU8> > loadables(1, buildTestLoadable(1, false));
+
+    args.batchSize = 4;
+
+    {
+        ServerProbe server(&args);
+        std::shared_ptr<ServerProbe::Model> model;
+        ServerProbe::Job jobs[numJobs] = { };
+        ServerProbe::Job* batch[numJobs];
+
+        CHECK_EQ(server.loadModel(loadables, 1, &model), NvDlaSuccess);
+        if ( !model ) {
+            return;
+        }
+
+        for ( NvU32 j = 0; j < numJobs; j++ ) {
+            jobs[j].type = ServerProbe::JOB_RUN;
+            jobs[j].model = model;
+            jobs[j].status = NvDlaError_BadParameter;
+            batch[j] = &jobs[j];
+        }
+
+        gStubSubmits.clear();
+        server.runBatch(batch, numJobs);
+
+        CHECK_EQ(gStubSubmits.size(), 1U);
+        CHECK_EQ(server.submitCount(0), 1U);
+        if ( gStubSubmits.size() == 1 && gStubSubmits[0].size() == 2 * numJobs )
+        {
+            const std::vector<StubTask> &tasks = gStubSubmits[0];
+
+            for ( NvU32 run = 0; run < numJobs; run++ )
+            {
+                const StubTask &first = tasks[2 * run];
+                const StubTask &second = tasks[2 * run + 1];
+
+                CHECK_EQ(first.id, 0U);
+                CHECK_EQ(second.id, 1U);
+                CHECK(first.handles[0] == second.handles[0]);
+                CHECK(first.handles[3] == second.handles[1]);
+                for ( NvU32 other = 0; other < run; other++ ) {
+                    CHECK(first.handles[0] != tasks[2 * other].handles[0]);
+                    CHECK(first.handles[3] != tasks[2 * other].handles[3]);
+                }
+                CHECK_EQ(first.offsets[2], run * kInputSize);
+                CHECK_EQ(second.offsets[2], run * kOutputSize);
+            }
+        }
+        else
+        {
+            CHECK_EQ(gStubSubmits.empty() ? 0 : gStubSubmits[0].size(), 2 * numJobs);
+        }
+
+        for ( NvU32 j = 0; j < numJobs; j++ ) {
+            CHECK_EQ(jobs[j].status, NvDlaSuccess);
+            CHECK(jobs[j].result && jobs[j].result->trace.batch == numJobs);
+            CHECK(jobs[j].result && jobs[j].result->output.size() == kOutputSize);
+        }
+    }
+
+    CHECK_EQ(gStubAllocations, 0);
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+#include "PortStub.h"
+#include "ServerProbe.h"
+#include "TestLoadable.h"
+
+#include "RuntimeTest.h"
+#include "WireProtocol.h"
+
+#include <cstdlib>
+#include <string>
+
+#include "jpeglib.h"
+
+namespace
+{
+
+std::vector<NvU8> encodeJpeg(NvU32 width, NvU32 height)
+{
+    struct jpeg_compress_struct info;
+    struct jpeg_error_mgr err;
+    unsigned char *out = NULL;
+    unsigned long outSize = 0;
+    std::vector<NvU8> row(width);
+
+    info.err = jpeg_std_error(&err);
+    jpeg_create_compress(&info);
+    jpeg_mem_dest(&info, &out, &outSize);
+
+    info.image_width = width;
+    info.image_height = height;
+    info.input_components = 1;
+    info.in_color_space = JCS_GRAYSCALE;
+    jpeg_set_defaults(&info);
+    jpeg_start_compress(&info, TRUE);
+
+    while ( info.next_scanline < height ) {
+        JSAMPROW rowPtr = &row[0];
+
+        for ( NvU32 x = 0; x < width; x++ ) {
+            row[x] = NvU8(x * 7 + info.next_scanline * 13);
+        }
+        jpeg_write_scanlines(&info, &rowPtr, 1);
+    }
+    jpeg_finish_compress(&info);
+
+    std::vector<NvU8> jpeg(out, out + outSize);
+    jpeg_destroy_compress(&info);
+    free(out);
+
+    return jpeg;
+}
+
+void sendImage(int fd, NvU32 requestId, const std::vector<NvU8>& image, size_t keep)
+{
+    std::string name("image.jpg");
+    DlaWireHeader h = { DLA_WIRE_MAGIC, DLA_OP_RUN_IMAGE, 0, requestId, NvU32(name.size() + 1 + keep) };
+    std::vector<NvU8> frame(DLA_WIRE_HEADER_SIZE);
+
+    encodeWireHeader(h, &frame[0]);
+    frame.insert(frame.end(), name.begin(), name.end());
+    frame.push_back(0);
+    frame.insert(frame.end(), image.begin(), image.begin() + keep);
+    send(fd, &frame[0], frame.size(), 0);
+}
+
+}
+
+// a broken image is answered with an error, the server and the client's
+// other runs carry on
+UNIT_TEST(serverRejectsTruncatedJpeg)
+{
+    TestAppArgs args;
+    std::vector<std::vector<NvU8> > loadables(1, buildTestLoadable(1, false));
+    std::vector<NvU8> jpeg = encodeJpeg(64, 64);
+    size_t keep[] = { jpeg.size() * 2 / 3, 40, jpeg.size() };
+    const NvU32 numRuns = sizeof(keep) / sizeof(keep[0]);
+
+    {
+        ServerProbe server(&args);
+        std::shared_ptr<ServerProbe::Model> model;
+        int peer;
+        ServerProbe::Connection* c = server.connect(&peer);
+
+        CHECK_EQ(server.loadModel(loadables, 1, &model), NvDlaSuccess);
+        c->model = model;
+
+        for ( NvU32 i = 0; i < numRuns; i++ ) {
+            sendImage(peer, i, jpeg, keep[i]);
+        }
+        server.readConnection(c);
+
+        server.parkWorkers(numRuns);
+        server.schedule();
+        for ( NvU32 i = 0; i < numRuns; i++ ) {
+            ServerProbe::Job* job = server.scheduled();
+
+            CHECK(job != NULL);
+            if ( !job ) {
+                break;
+            }
+            server.execute(job);
+            CHECK_EQ(job->status, i + 1 < numRuns ? NvDlaError_BadParameter : NvDlaSuccess);
+            server.completeJob(job);
+            delete job;
+        }
+        CHECK(server.connected(c->id));
+
+        // one reply per request, in order, only the broken ones flagged
+        std::vector<NvU8> replies(64 << 10);
+        ssize_t got = recv(peer, &replies[0], replies.size(), MSG_DONTWAIT);
+        size_t pos = 0;
+
+        for ( NvU32 i = 0; i < numRuns; i++ ) {
+            DlaWireHeader h;
+
+            CHECK(got > 0 && pos + DLA_WIRE_HEADER_SIZE <= size_t(got));
+            if ( got <= 0 || pos + DLA_WIRE_HEADER_SIZE > size_t(got) || !decodeWireHeader(&replies[pos], &h) ) {
+                break;
+            }
+            CHECK_EQ(h.requestId, i);
+            CHECK_EQ((h.flags & DLA_WIRE_FLAG_ERROR) != 0, i + 1 < numRuns);
+            pos += DLA_WIRE_HEADER_SIZE + h.length;
+        }
+        CHECK_EQ(pos, size_t(got));
+
+        close(peer);
+    }
+
+    CHECK_EQ(gStubAllocations, 0);
+}
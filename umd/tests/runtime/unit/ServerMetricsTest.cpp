@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+
+#include "ServerMetrics.h"
+
+#include <string>
+
+UNIT_TEST(metricsExpositionLines)
+{
+    std::string out;
+
+    appendMetric(&out, "nvdla_server_runs_total", "counter", "Runs answered.", 42);
+    CHECK(out == "# HELP nvdla_server_runs_total Runs answered.\n"
+                 "# TYPE nvdla_server_runs_total counter\n"
+                 "nvdla_server_runs_total 42\n");
+
+    out.clear();
+    appendMetricSample(&out, "nvdla_server_requests_total", "opcode=\"3\"", 7);
+    CHECK(out == "nvdla_server_requests_total{opcode=\"3\"} 7\n");
+}
+
+// quantiles report the upper bound of their bucket, in seconds
+UNIT_TEST(metricsLatencySummary)
+{
+    LatencyHistogram histogram;
+    std::string out;
+
+    for (NvU32 i = 0; i < 5; i++)
+    {
+        histogram.record(10);
+        histogram.record(100);
+    }
+
+    histogram.appendPrometheus(&out, "nvdla_server_test_seconds", "Test latency.");
+    CHECK(out == "# HELP nvdla_server_test_seconds Test latency.\n"
+                 "# TYPE nvdla_server_test_seconds summary\n"
+                 "nvdla_server_test_seconds{quantile=\"0.5\"} 1e-05\n"
+                 "nvdla_server_test_seconds{quantile=\"0.9\"} 0.000103\n"
+                 "nvdla_server_test_seconds{quantile=\"0.99\"} 0.000103\n"
+                 "nvdla_server_test_seconds{quantile=\"0.999\"} 0.000103\n"
+                 "nvdla_server_test_seconds_sum 0.00055\n"
+                 "nvdla_server_test_seconds_count 10\n");
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+#include "PortStub.h"
+#include "ServerProbe.h"
+#include "TestLoadable.h"
+
+#include "RuntimeTest.h"
+
+namespace
+{
+
+const NvU32 kWeights = 300 << 10;
+
+}
+
+// an instance per worker while the budget lasts, never fewer than one
+UNIT_TEST(serverModelInstancesFollowBudget)
+{
+    struct { NvU32 budgetMB; NvU32 workers; size_t instances; } cases[] = {
+        { 8, 4, 4 },
+        { 1, 4, 2 },
+        { 1, 1, 1 },
+        { 0, 4, 1 },
+    };
+    std::vector<std::vector<NvU8> > loadables(1, buildTestLoadable(1, false, kWeights));
+
+    for ( size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++ )
+    {
+        TestAppArgs args;
+        args.modelBudget = cases[i].budgetMB;
+
+        {
+            ServerProbe server(&args);
+            std::shared_ptr<ServerProbe::Model> model;
+
+            CHECK_EQ(server.loadModel(loadables, cases[i].workers, &model), NvDlaSuccess);
+            if ( !model ) {
+                continue;
+            }
+            CHECK_EQ(model->parts[0]->instances.size(), cases[i].instances);
+            CHECK_EQ(model->parts[0]->idle.size(), cases[i].instances);
+            CHECK(model->bytes > cases[i].instances * kWeights);
+            CHECK(model->bytes < (cases[i].instances + 1) * kWeights + (64U << 10));
+        }
+    }
+
+    CHECK_EQ(gStubAllocations, 0);
+}
+
+// a cascade that can't keep one of each keeps its first loadable only
+UNIT_TEST(serverCascadeOverBudgetGoesTransient)
+{
+    TestAppArgs args;
+    std::vector<std::vector<NvU8> > loadables(2, buildTestLoadable(1, false, kWeights));
+
+    args.modelBudget = 1;
+
+    {
+        ServerProbe server(&args);
+        std::shared_ptr<ServerProbe::Model> model;
+
+        CHECK_EQ(server.loadModel(loadables, 4, &model), NvDlaSuccess);
+        if ( model ) {
+            CHECK_EQ(model->parts[0]->instances.size(), 1U);
+            CHECK(!model->parts[0]->transient);
+            CHECK_EQ(model->parts[1]->instances.size(), 0U);
+            CHECK(model->parts[1]->transient);
+        }
+    }
+
+    CHECK_EQ(gStubAllocations, 0);
+}
+
+// a transient loadable stays loaded between closely spaced escalations
+UNIT_TEST(serverTransientPartLingers)
+{
+    TestAppArgs args;
+    std::vector<std::vector<NvU8> > loadables(2, buildTestLoadable(1, false, kWeights));
+
+    args.modelBudget = 1;
+
+    {
+        ServerProbe server(&args);
+        std::shared_ptr<ServerProbe::Model> model;
+
+        CHECK_EQ(server.loadModel(loadables, 1, &model), NvDlaSuccess);
+        if ( !model ) {
+            return;
+        }
+
+        ServerProbe::ModelPart* part = model->parts[1];
+        ServerProbe::Instance* first = server.acquire(part);
+
+        CHECK(first != NULL);
+        CHECK_EQ(part->instances.size(), 1U);
+        server.release(part, first);
+
+        ServerProbe::Instance* second = server.acquire(part);
+        CHECK(second == first);
+        server.release(part, second);
+
+        // not yet
+        server.unloadPart(part);
+        CHECK_EQ(part->instances.size(), 1U);
+
+        // as if released a second ago
+        part->releasedUs -= 1000000;
+        server.unloadPart(part);
+        CHECK_EQ(part->instances.size(), 0U);
+        CHECK_EQ(part->idle.size(), 0U);
+
+        ServerProbe::Instance* third = server.acquire(part);
+        CHECK(third != NULL);
+        CHECK_EQ(part->instances.size(), 1U);
+        if ( third ) {
+            server.release(part, third);
+        }
+    }
+
+    CHECK_EQ(gStubAllocations, 0);
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NVDLA_SERVER_PROBE_H
+#define NVDLA_SERVER_PROBE_H
+
+#include "Server.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+// opens up the event loop side of the server to drive it without epoll
+class ServerProbe : public InferenceServer
+{
+public:
+    explicit ServerProbe(const TestAppArgs* appArgs) : InferenceServer(appArgs) { }
+
+    using InferenceServer::Connection;
+    using InferenceServer::Job;
+    using InferenceServer::Model;
+    using InferenceServer::ModelPart;
+    using InferenceServer::Instance;
+    using InferenceServer::JOB_RUN;
+    using InferenceServer::JOB_BATCH;
+    using InferenceServer::loadModel;
+    using InferenceServer::acquire;
+    using InferenceServer::release;
+    using InferenceServer::unloadPart;
+    using InferenceServer::readConnection;
+    using InferenceServer::runBatch;
+    using InferenceServer::execute;
+    using InferenceServer::completeJob;
+    using InferenceServer::pushReady;
+    using InferenceServer::schedule;
+
+    // a connection on one end of a socket pair, the test keeps the other
+    Connection* connect(int* peer)
+    {
+        int fds[2];
+
+        socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+
+        Connection* c = new Connection(fds[0], m_nextConnId++, 0, false, true);
+        m_conns[c->id] = c;
+
+        *peer = fds[1];
+        return c;
+    }
+
+    // more workers that never take a job, schedule() hands theirs to the test
+    void parkWorkers(NvU32 numWorkers)
+    {
+        if (!m_jobs)
+            m_jobs = new BoundedQueue<Job*>(64);
+        for (NvU32 t = 0; t < numWorkers; t++)
+            m_workers.push_back(std::thread([] { }));
+    }
+
+    Job* scheduled()
+    {
+        Job* job = NULL;
+
+        return m_jobs->tryPop(&job) ? job : NULL;
+    }
+
+    size_t readyCount() const
+    {
+        return m_ready.size();
+    }
+
+    NvU64 shedCount() const
+    {
+        return m_metrics.shed.load();
+    }
+
+    NvU64 submitCount(NvU32 part) const
+    {
+        return m_metrics.submits[part].load();
+    }
+
+    bool connected(NvU64 id) const
+    {
+        return m_conns.find(id) != m_conns.end();
+    }
+
+    bool stopping() const
+    {
+        return m_stopping;
+    }
+};
+
+#endif // NVDLA_SERVER_PROBE_H
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+#include "ServerProbe.h"
+#include "ServerMetrics.h"
+
+#include "RuntimeTest.h"
+
+namespace
+{
+
+const NvU64 kServiceUs = 1000;
+
+ServerProbe::Job* readyRun(ServerProbe* server, const std::shared_ptr<ServerProbe::Model>& model,
+                           NvU32 rank, NvU64 deadline)
+{
+    ServerProbe::Job* job = new ServerProbe::Job();
+
+    job->model = model;
+    job->rank = rank;
+    job->deadline = deadline;
+    server->pushReady(job);
+    return job;
+}
+
+}
+
+// a zeroed job is a run of the first rank without a deadline
+UNIT_TEST(serverJobStartsZeroed)
+{
+    ServerProbe::Job job;
+
+    CHECK_EQ(job.type, ServerProbe::JOB_RUN);
+    CHECK_EQ(job.conn, 0U);
+    CHECK(job.data == NULL);
+    CHECK_EQ(job.dataSize, 0U);
+    CHECK_EQ(job.status, NvDlaSuccess);
+    CHECK_EQ(job.rank, 0U);
+    CHECK_EQ(job.deadline, 0U);
+    CHECK_EQ(job.received, 0U);
+    CHECK_EQ(job.seq, 0U);
+    CHECK_EQ(job.order, 0U);
+}
+
+// by rank, then the earliest deadline, then arrival; runs that can no
+// longer make their deadline are shed as they come up
+UNIT_TEST(serverScheduleOrderAndShedding)
+{
+    TestAppArgs args;
+    ServerProbe server(&args);
+    std::shared_ptr<ServerProbe::Model> model(new ServerProbe::Model());
+    NvU64 now = metricsNowUs();
+    NvU64 far = now + 1000 * kServiceUs;
+
+    model->serviceUs = kServiceUs;
+
+    ServerProbe::Job* bulk = readyRun(&server, model, 2, 0);
+    ServerProbe::Job* normalFar = readyRun(&server, model, 1, far);
+    readyRun(&server, model, 1, now + kServiceUs / 2);
+    ServerProbe::Job* normal = readyRun(&server, model, 1, 0);
+    ServerProbe::Job* interactive = readyRun(&server, model, 0, 0);
+    ServerProbe::Job* normalFarLater = readyRun(&server, model, 1, far);
+
+    // three workers: the late run is shed on the way to the third
+    server.parkWorkers(3);
+    server.schedule();
+
+    ServerProbe::Job* expected[] = { interactive, normalFar, normalFarLater };
+    for ( size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++ ) {
+        ServerProbe::Job* job = server.scheduled();
+
+        CHECK(job == expected[i]);
+        delete job;
+    }
+    CHECK(server.scheduled() == NULL);
+    CHECK_EQ(server.shedCount(), 1U);
+    CHECK_EQ(server.readyCount(), 2U);
+
+    // the rest waits for workers to come free
+    server.parkWorkers(2);
+    server.schedule();
+
+    ServerProbe::Job* rest[] = { normal, bulk };
+    for ( size_t i = 0; i < sizeof(rest) / sizeof(rest[0]); i++ ) {
+        ServerProbe::Job* job = server.scheduled();
+
+        CHECK(job == rest[i]);
+        delete job;
+    }
+    CHECK_EQ(server.readyCount(), 0U);
+}
+
+// a batch sheds only its late runs, and goes away once none are left
+UNIT_TEST(serverScheduleShedsWithinBatch)
+{
+    TestAppArgs args;
+    ServerProbe server(&args);
+    std::shared_ptr<ServerProbe::Model> model(new ServerProbe::Model());
+    NvU64 now = metricsNowUs();
+    ServerProbe::Job* batch = new ServerProbe::Job();
+    ServerProbe::Job* late = new ServerProbe::Job();
+
+    model->serviceUs = kServiceUs;
+
+    for ( int j = 0; j < 3; j++ ) {
+        ServerProbe::Job* run = new ServerProbe::Job();
+
+        run->model = model;
+        run->deadline = (j == 1) ? now + kServiceUs / 2 : 0;
+        batch->batch.push_back(run);
+    }
+    batch->type = ServerProbe::JOB_BATCH;
+    batch->model = model;
+    server.pushReady(batch);
+
+    late->type = ServerProbe::JOB_BATCH;
+    late->model = model;
+    late->batch.push_back(new ServerProbe::Job());
+    late->batch[0]->model = model;
+    late->batch[0]->deadline = now + kServiceUs / 2;
+    server.pushReady(late);
+
+    server.parkWorkers(2);
+    server.schedule();
+
+    ServerProbe::Job* job = server.scheduled();
+    CHECK(job == batch);
+    if ( job ) {
+        CHECK_EQ(job->batch.size(), 2U);
+        for ( size_t j = 0; j < job->batch.size(); j++ ) {
+            CHECK_EQ(job->batch[j]->deadline, 0U);
+        }
+        delete job;
+    }
+    CHECK(server.scheduled() == NULL);
+    CHECK_EQ(server.shedCount(), 2U);
+    CHECK_EQ(server.readyCount(), 0U);
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TestLoadable.h"
+
+#include "priv/loadable_generated.h"
+
+using namespace nvdla::loadable;
+
+//
+// a loadable compiled for a batch: two dla tasks, each with the dependency
+// graph first, sharing weights and handing data over through scratch
+// memory.  the first reads the input elements, last one first, the second
+// writes the output elements.  optionally carries an sram pool no task
+// touches.
+//
+std::vector<NvU8> buildTestLoadable(NvU32 batch, bool withSram, NvU32 weightsSize)
+{
+    enum { ADDR_GRAPH, ADDR_WEIGHTS, ADDR_SCRATCH, ADDR_TENSORS };
+
+    flatbuffers::FlatBufferBuilder fbb;
+    Version version(0, 7, 0);
+    std::vector<NvU8> graph(kGraphSize), weights(weightsSize);
+    std::vector<flatbuffers::Offset<MemoryListEntry> > mems;
+    std::vector<flatbuffers::Offset<AddressListEntry> > addrs;
+    std::vector<flatbuffers::Offset<TaskListEntry> > tasks;
+    std::vector<flatbuffers::Offset<SubmitListEntry> > submits;
+    std::vector<flatbuffers::Offset<Blob> > blobs;
+    std::vector<flatbuffers::Offset<TensorDescListEntry> > tensorDescs;
+    std::vector<flatbuffers::Offset<EventListEntry> > events;
+    std::vector<flatbuffers::Offset<RelocListEntry> > relocs;
+    std::vector<uint64_t> zero(1, 0);
+
+    for ( NvU32 i = 0; i < kGraphSize; i++ ) {
+        graph[i] = NvU8(0x80 + i);
+    }
+    for ( NvU32 i = 0; i < weightsSize; i++ ) {
+        weights[i] = NvU8(i);
+    }
+    blobs.push_back(CreateBlobDirect(fbb, "task-0-dep_graph", kGraphSize, Interface_DLA1, 0, &version, &graph));
+    blobs.push_back(CreateBlobDirect(fbb, "weights", weightsSize, Interface_DLA1, 0, &version, &weights));
+
+    std::vector<flatbuffers::Offset<flatbuffers::String> > graphContents, weightContents;
+    graphContents.push_back(fbb.CreateString("task-0-dep_graph"));
+    weightContents.push_back(fbb.CreateString("weights"));
+
+    mems.push_back(CreateMemoryListEntry(fbb, MEM_INPUT, MemoryDomain_SYSTEM, MemoryFlags(MemoryFlags_ALLOC | MemoryFlags_INPUT),
+                                         batch * kInputSize, 256, 0, 0, 0, 0));
+    mems.push_back(CreateMemoryListEntry(fbb, MEM_OUTPUT, MemoryDomain_SYSTEM, MemoryFlags(MemoryFlags_ALLOC | MemoryFlags_OUTPUT),
+                                         batch * kOutputSize, 256, 0, 0, 0, 1));
+    mems.push_back(CreateMemoryListEntryDirect(fbb, MEM_SCRATCH, MemoryDomain_SYSTEM, MemoryFlags_ALLOC, 128, 256));
+    mems.push_back(CreateMemoryListEntryDirect(fbb, MEM_GRAPH, MemoryDomain_SYSTEM, MemoryFlags(MemoryFlags_ALLOC | MemoryFlags_SET),
+                                               kGraphSize, 256, &graphContents, &zero));
+    mems.push_back(CreateMemoryListEntryDirect(fbb, MEM_WEIGHTS, MemoryDomain_SYSTEM, MemoryFlags(MemoryFlags_ALLOC | MemoryFlags_SET),
+                                               weightsSize, 256, &weightContents, &zero));
+    if ( withSram ) {
+        mems.push_back(CreateMemoryListEntryDirect(fbb, MEM_SRAM, MemoryDomain_SRAM, MemoryFlags_ALLOC, 128, 256));
+    }
+
+    addrs.push_back(CreateAddressListEntry(fbb, ADDR_GRAPH, MEM_GRAPH, 0, kGraphSize));
+    addrs.push_back(CreateAddressListEntry(fbb, ADDR_WEIGHTS, MEM_WEIGHTS, 0, weightsSize));
+    addrs.push_back(CreateAddressListEntry(fbb, ADDR_SCRATCH, MEM_SCRATCH, 0, 128));
+
+    std::vector<uint16_t> first, second, ids;
+    first.push_back(ADDR_GRAPH);
+    first.push_back(ADDR_WEIGHTS);
+    second.push_back(ADDR_GRAPH);
+    second.push_back(ADDR_SCRATCH);
+
+    for ( NvU32 e = 0; e < batch; e++ ) {
+        NvU16 in = NvU16(ADDR_TENSORS + 2 * e);
+        NvU16 out = NvU16(in + 1);
+
+        addrs.push_back(CreateAddressListEntry(fbb, in, MEM_INPUT, (batch - 1 - e) * kInputSize, kInputSize));
+        addrs.push_back(CreateAddressListEntry(fbb, out, MEM_OUTPUT, e * kOutputSize, kOutputSize));
+        first.push_back(in);
+        second.push_back(out);
+    }
+    first.push_back(ADDR_SCRATCH);
+
+    tasks.push_back(CreateTaskListEntryDirect(fbb, 0, Interface_DLA1, -1, &first));
+    tasks.push_back(CreateTaskListEntryDirect(fbb, 1, Interface_DLA1, -1, &second));
+
+    ids.push_back(0);
+    ids.push_back(1);
+    submits.push_back(CreateSubmitListEntryDirect(fbb, 0, &ids));
+
+    tensorDescs.push_back(CreateTensorDescListEntry(fbb, fbb.CreateString("data"), 0, MEM_INPUT, batch * kInputSize, 0,
+                                                    DataFormat_UNKNOWN, DataType_HALF, DataCategory_FEATURE,
+                                                    PixelFormat_FEATURE, PixelMapping_PITCH_LINEAR,
+                                                    batch, 1, 1, kInputSize / 32, 2, kInputSize, kInputSize));
+    tensorDescs.push_back(CreateTensorDescListEntry(fbb, fbb.CreateString("prob"), 1, MEM_OUTPUT, batch * kOutputSize, 0,
+                                                    DataFormat_UNKNOWN, DataType_HALF, DataCategory_FEATURE,
+                                                    PixelFormat_FEATURE, PixelMapping_PITCH_LINEAR,
+                                                    batch, kOutputChannels, 1, 1, 2, kOutputSize, kOutputSize));
+
+    fbb.Finish(CreateLoadableDirect(fbb, &version, &tasks, &mems, &addrs, &events, &blobs, &tensorDescs, &relocs, &submits));
+
+    return std::vector<NvU8>(fbb.GetBufferPointer(), fbb.GetBufferPointer() + fbb.GetSize());
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NVDLA_UNIT_TEST_H
+#define NVDLA_UNIT_TEST_H
+
+#include <cstdio>
+
+// a test body reports through CHECK, main() runs every registered test
+typedef void (*UnitTestFunc)(int *failures);
+
+struct UnitTestRegistration
+{
+    UnitTestRegistration(const char *name, UnitTestFunc func);
+};
+
+int runUnitTests(const char *filter);
+
+#define UNIT_TEST(name) \
+    static void name(int *failures); \
+    static UnitTestRegistration name##_registration(#name, name); \
+    static void name(int *failures)
+
+#define CHECK(cond) \
+    do { \
+        if ( !(cond) ) { \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            (*failures)++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        if ( !((a) == (b)) ) { \
+            std::printf("%s:%d: check failed: %s == %s (%lld vs %lld)\n", __FILE__, __LINE__, #a, #b, \
+                        (long long)(a), (long long)(b)); \
+            (*failures)++; \
+        } \
+    } while (0)
+
+#endif // NVDLA_UNIT_TEST_H
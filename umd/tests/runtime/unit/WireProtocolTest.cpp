@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+#include "ServerProbe.h"
+
+#include "RuntimeTest.h"
+#include "WireProtocol.h"
+
+#include <vector>
+
+namespace
+{
+
+void sendFrame(int fd, NvU16 opcode, NvU32 length, size_t bodyBytes, NvU32 magic = DLA_WIRE_MAGIC)
+{
+    DlaWireHeader h = { magic, opcode, 0, 1, length };
+    std::vector<NvU8> frame(DLA_WIRE_HEADER_SIZE + bodyBytes, 'x');
+
+    encodeWireHeader(h, &frame[0]);
+    send(fd, &frame[0], frame.size(), 0);
+}
+
+}
+
+UNIT_TEST(wireHeaderRoundTrip)
+{
+    DlaWireHeader in = { DLA_WIRE_MAGIC, DLA_OP_RUN_IMAGE, DLA_WIRE_FLAG_MODEL | DLA_WIRE_FLAG_TRACE, 0x01020304, 0xa0b0c0d0 };
+    DlaWireHeader out;
+    NvU8 bytes[DLA_WIRE_HEADER_SIZE];
+
+    encodeWireHeader(in, bytes);
+    CHECK_EQ(bytes[0], 0x4e);
+    CHECK_EQ(bytes[15], 0xd0);
+    CHECK(decodeWireHeader(bytes, &out));
+    CHECK_EQ(out.opcode, in.opcode);
+    CHECK_EQ(out.flags, in.flags);
+    CHECK_EQ(out.requestId, in.requestId);
+    CHECK_EQ(out.length, in.length);
+
+    bytes[3] ^= 1;
+    CHECK(!decodeWireHeader(bytes, &out));
+}
+
+UNIT_TEST(wirePayloadBounds)
+{
+    const NvU32 prefix = 4 + DLA_WIRE_MODEL_ID_SIZE;
+
+    CHECK_EQ(wireMaxPayload(DLA_OP_READ_FLATBUF, 1U << 20), (1U << 20) + prefix);
+    CHECK_EQ(wireMaxPayload(DLA_OP_READ_FLATBUF, ~0U - 1), ~0U);
+    CHECK_EQ(wireMaxPayload(DLA_OP_RUN_IMAGE, 0), prefix + DLA_WIRE_MAX_NAME + 1 + DLA_WIRE_MAX_IMAGE);
+    CHECK_EQ(wireMaxPayload(DLA_OP_GET_WELCOME, ~0U), DLA_WIRE_MAX_CONTROL);
+    CHECK_EQ(wireMaxPayload(DLA_OP_GET_OUTPUT, ~0U), DLA_WIRE_MAX_CONTROL);
+    CHECK_EQ(wireMaxPayload(0xffff, ~0U), DLA_WIRE_MAX_CONTROL);
+}
+
+// a header declaring a large payload only costs what actually arrives
+UNIT_TEST(serverGrowsPayloadAsItArrives)
+{
+    TestAppArgs args;
+    ServerProbe server(&args);
+    int peer;
+    ServerProbe::Connection* c = server.connect(&peer);
+    NvU32 declared = 48U << 20;
+
+    sendFrame(peer, DLA_OP_RUN_IMAGE, declared, 1000);
+    server.readConnection(c);
+    CHECK(server.connected(c->id));
+    CHECK_EQ(c->need, declared - 1000);
+    CHECK(c->rbuf.capacity() <= (256U << 10));
+
+    for ( int i = 0; i < 8; i++ ) {
+        std::vector<NvU8> more(100 << 10, 'y');
+        send(peer, &more[0], more.size(), 0);
+        server.readConnection(c);
+    }
+    CHECK_EQ(c->rbuf.size(), DLA_WIRE_HEADER_SIZE + 1000 + (800U << 10));
+    CHECK(c->rbuf.capacity() <= (4U << 20));
+
+    close(peer);
+}
+
+UNIT_TEST(serverDropsOversizedFrames)
+{
+    TestAppArgs args;
+    int peer;
+    char eof;
+
+    args.modelBudget = 1;
+
+    struct { NvU16 opcode; NvU32 length; NvU32 magic; bool keep; } cases[] = {
+        { DLA_OP_GET_WELCOME, DLA_WIRE_MAX_CONTROL, DLA_WIRE_MAGIC, true },
+        { DLA_OP_GET_WELCOME, DLA_WIRE_MAX_CONTROL + 1, DLA_WIRE_MAGIC, false },
+        { DLA_OP_READ_FLATBUF, 1U << 20, DLA_WIRE_MAGIC, true },
+        { DLA_OP_READ_FLATBUF, 2U << 20, DLA_WIRE_MAGIC, false },
+        { DLA_OP_RUN_IMAGE, DLA_WIRE_MAX_IMAGE, DLA_WIRE_MAGIC, true },
+        { DLA_OP_RUN_IMAGE, 1U << 29, DLA_WIRE_MAGIC, false },
+        { DLA_OP_GET_WELCOME, 0, DLA_WIRE_MAGIC ^ 1, false },
+    };
+
+    for ( size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++ )
+    {
+        ServerProbe server(&args);
+        ServerProbe::Connection* c = server.connect(&peer);
+        NvU64 id = c->id;
+
+        // the frame stays incomplete, so nothing gets dispatched
+        sendFrame(peer, cases[i].opcode, cases[i].length, 0, cases[i].magic);
+        server.readConnection(c);
+
+        CHECK_EQ(server.connected(id), cases[i].keep);
+        CHECK_EQ(recv(peer, &eof, 1, MSG_DONTWAIT) == 0, !cases[i].keep);
+        close(peer);
+    }
+}
+
+// a TCP client can only stop the server with --remoteshutdown
+UNIT_TEST(serverShutdownNeedsLocalSocket)
+{
+    struct { bool local; bool remoteShutdown; bool stops; } cases[] = {
+        { false, false, false },
+        { false, true, true },
+        { true, false, true },
+    };
+
+    for ( size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++ )
+    {
+        TestAppArgs args;
+        int peer;
+
+        args.remoteShutdown = cases[i].remoteShutdown;
+
+        ServerProbe server(&args);
+        ServerProbe::Connection* c = server.connect(&peer);
+
+        c->local = cases[i].local;
+        sendFrame(peer, DLA_OP_SHUTDOWN, 0, 0);
+        server.readConnection(c);
+
+        CHECK_EQ(server.stopping(), cases[i].stops);
+        close(peer);
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UnitTest.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+struct UnitTestEntry
+{
+    const char *name;
+    UnitTestFunc func;
+};
+
+std::vector<UnitTestEntry> &unitTests()
+{
+    static std::vector<UnitTestEntry> tests;
+    return tests;
+}
+
+}
+
+UnitTestRegistration::UnitTestRegistration(const char *name, UnitTestFunc func)
+{
+    UnitTestEntry entry = { name, func };
+    unitTests().push_back(entry);
+}
+
+int runUnitTests(const char *filter)
+{
+    int failed = 0;
+    int ran = 0;
+
+    for ( size_t ti = 0; ti < unitTests().size(); ti++ )
+    {
+        const UnitTestEntry &test = unitTests()[ti];
+        int failures = 0;
+
+        if ( filter && !std::strstr(test.name, filter) )
+            continue;
+
+        test.func(&failures);
+        std::printf("%-40s %s\n", test.name, failures ? "FAIL" : "ok");
+        failed += failures ? 1 : 0;
+        ran++;
+    }
+
+    std::printf("%d of %d tests passed\n", ran - failed, ran);
+    return failed;
+}
+
+int main(int argc, char *argv[])
+{
+    return runUnitTests(argc > 1 ? argv[1] : NULL) ? 1 : 0;
+}
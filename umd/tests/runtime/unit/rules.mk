@@ -0,0 +1,81 @@
+# Copyright (c) 2017-2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+NVDLA_SRC_FILES := \
+    $(ROOT)/tests/runtime/CascadeTrace.cpp \
+    $(ROOT)/tests/runtime/DlaImage.cpp \
+    $(ROOT)/tests/runtime/DlaImageUtils.cpp \
+    $(ROOT)/tests/runtime/ImageLoader.cpp \
+    $(ROOT)/tests/runtime/Pipeline.cpp \
+    $(ROOT)/tests/runtime/Preprocess.cpp \
+    $(ROOT)/tests/runtime/ResultCache.cpp \
+    $(ROOT)/tests/runtime/Server.cpp \
+    $(ROOT)/tests/runtime/ServerMetrics.cpp \
+    $(ROOT)/tests/runtime/Sha256.cpp \
+    $(ROOT)/tests/runtime/RuntimeTest.cpp \
+    $(ROOT)/tests/runtime/TestUtils.cpp \
+    BoundedQueueTest.cpp \
+    CascadeTraceTest.cpp \
+    DlaImageTest.cpp \
+    EmulatorTest.cpp \
+    ImageLoaderTest.cpp \
+    PipelineTest.cpp \
+    PortStub.cpp \
+    PreprocessTest.cpp \
+    ResultCacheTest.cpp \
+    RuntimeBatchTest.cpp \
+    ServerBatchTest.cpp \
+    ServerImageTest.cpp \
+    ServerMetricsTest.cpp \
+    ServerModelTest.cpp \
+    ServerScheduleTest.cpp \
+    Sha256Test.cpp \
+    TestLoadable.cpp \
+    WireProtocolTest.cpp \
+    main.cpp
+
+INCLUDES += \
+    -I$(ROOT)/include \
+    -I$(ROOT)/core/include \
+    -I$(ROOT)/core/common/include \
+    -I$(ROOT)/core/runtime/include \
+    -I$(ROOT)/port/linux/include \
+    -I$(ROOT)/external/include \
+    -I$(ROOT)/external/libjpeg-turbo \
+    -I$(ROOT)/tests/runtime \
+    -I$(LOCAL_DIR)
+
+MODULE_CPPFLAGS += -DNVDLA_UTILS_ERROR_TAG="\"DLA_UNIT\""
+MODULE_CFLAGS += -DNVDLA_UTILS_ERROR_TAG="\"DLA_UNIT\""
+
+SHARED_LIBS := \
+    $(ROOT)/out/runtime/libnvdla_runtime/libnvdla_runtime.so
+
+MODULE_SRCS := $(NVDLA_SRC_FILES)
+
+include $(ROOT)/make/module.mk